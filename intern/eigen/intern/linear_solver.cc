@@ -268,16 +268,14 @@ void EIG_linear_solver_right_hand_side_add(LinearSolver *solver, int rhs, int in
 
 /* Solve */
 
-bool EIG_linear_solver_solve(LinearSolver *solver)
+bool EIG_linear_solver_factorize(LinearSolver *solver)
 {
+  linear_solver_ensure_matrix_construct(solver);
+
   /* nothing to solve, perhaps all variables were locked */
   if (solver->m == 0 || solver->n == 0)
     return true;
 
-  bool result = true;
-
-  assert(solver->state != LinearSolver::STATE_VARIABLES_CONSTRUCT);
-
   if (solver->state == LinearSolver::STATE_MATRIX_CONSTRUCT) {
     /* create matrix from triplets */
     solver->M.resize(solver->m, solver->n);
@@ -297,11 +295,23 @@ bool EIG_linear_solver_solve(LinearSolver *solver)
     solver->sparseLU = sparseLU;
 
     sparseLU->compute(M);
-    result = (sparseLU->info() == Eigen::Success);
 
     solver->state = LinearSolver::STATE_MATRIX_SOLVED;
   }
 
+  return (solver->sparseLU->info() == Eigen::Success);
+}
+
+bool EIG_linear_solver_solve(LinearSolver *solver)
+{
+  /* nothing to solve, perhaps all variables were locked */
+  if (solver->m == 0 || solver->n == 0)
+    return true;
+
+  assert(solver->state != LinearSolver::STATE_VARIABLES_CONSTRUCT);
+
+  bool result = EIG_linear_solver_factorize(solver);
+
   if (result) {
     /* solve for each right hand side */
     for (int rhs = 0; rhs < solver->num_rhs; rhs++) {
@@ -344,6 +354,33 @@ bool EIG_linear_solver_solve(LinearSolver *solver)
   return result;
 }
 
+bool EIG_linear_solver_solve_vector(const LinearSolver *solver, const double *b, double *r_x)
+{
+  if (solver->m == 0 || solver->n == 0)
+    return true;
+
+  assert(solver->state == LinearSolver::STATE_MATRIX_SOLVED);
+  assert(!solver->least_squares);
+
+  if (solver->sparseLU->info() != Eigen::Success)
+    return false;
+
+  EigenVectorX vb(solver->m);
+  for (int i = 0; i < solver->num_variables; i++) {
+    const LinearSolver::Variable *variable = &solver->variable[i];
+    assert(!variable->locked);
+    vb[variable->index] = b[i];
+  }
+
+  /* solving doesn't modify the factorization, so this is safe to call from multiple threads */
+  const EigenVectorX x = solver->sparseLU->solve(vb);
+
+  for (int i = 0; i < solver->num_variables; i++)
+    r_x[i] = x[solver->variable[i].index];
+
+  return true;
+}
+
 /* Debugging */
 
 void EIG_linear_solver_print_matrix(LinearSolver *solver)
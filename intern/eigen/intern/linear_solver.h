@@ -58,6 +58,14 @@ void EIG_linear_solver_right_hand_side_add(LinearSolver *solver, int rhs, int in
 
 bool EIG_linear_solver_solve(LinearSolver *solver);
 
+/* Factorize the matrix without solving, returns false when the matrix is singular. After this
+ * EIG_linear_solver_solve_vector can solve for any number of right hand sides, also from multiple
+ * threads at the same time. Only supported for square systems without locked variables, b and x
+ * are arrays indexed by variable. */
+
+bool EIG_linear_solver_factorize(LinearSolver *solver);
+bool EIG_linear_solver_solve_vector(const LinearSolver *solver, const double *b, double *r_x);
+
 /* Debugging */
 
 void EIG_linear_solver_print_matrix(LinearSolver *solver);
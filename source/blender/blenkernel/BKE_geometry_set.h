@@ -24,9 +24,11 @@
 extern "C" {
 #endif
 
+struct Depsgraph;
 struct Object;
 struct GeometrySet;
 struct Collection;
+struct Mesh;
 
 void BKE_geometry_set_free(struct GeometrySet *geometry_set);
 
@@ -51,6 +53,33 @@ int BKE_geometry_set_instances(const struct GeometrySet *geometry_set,
                                float (**r_scales)[3],
                                struct InstancedData **r_instanced_data);
 
+/* Instances that reference the same object or collection. The data of all instances in a batch is
+ * stored in contiguous arrays. */
+typedef struct InstancesBatch {
+  InstancedData data;
+  int amount;
+  /* Index of every instance in the instances component, e.g. to be used as persistent id. */
+  int *indices;
+  /* Transform of every instance, relative to the object that owns the geometry. */
+  float (*matrices)[4][4];
+} InstancesBatch;
+
+int BKE_geometry_set_instances_batches(const struct GeometrySet *geometry_set,
+                                       struct InstancesBatch **r_batches);
+void BKE_geometry_set_instances_batches_free(struct InstancesBatch *batches, int batches_amount);
+
+/* Copy the mesh geometry of the geometry set into a new mesh, without its instances. Returns null
+ * when there is no mesh geometry. */
+struct Mesh *BKE_geometry_set_to_mesh(const struct GeometrySet *geometry_set);
+
+/* Join the mesh geometry of all instances in the evaluated geometry set of the object into
+ * \a mesh, which is the object's own geometry (and may be null). Collections are filtered like
+ * for the dupli list of the dependency graph. Takes ownership of \a mesh and returns the result,
+ * e.g. for exporters that don't support instancing. */
+struct Mesh *BKE_geometry_set_realize_instances_to_mesh(struct Depsgraph *depsgraph,
+                                                        const struct Object *object,
+                                                        struct Mesh *mesh);
+
 #ifdef __cplusplus
 }
 #endif
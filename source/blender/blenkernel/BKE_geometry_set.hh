@@ -21,9 +21,14 @@
  */
 
 #include <atomic>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 
+#include "BLI_array.hh"
 #include "BLI_float3.hh"
+#include "BLI_float4x4.hh"
 #include "BLI_hash.hh"
 #include "BLI_map.hh"
 #include "BLI_set.hh"
@@ -129,6 +134,10 @@ class GeometryComponent {
   virtual blender::Set<std::string> attribute_names() const;
   virtual bool is_empty() const;
 
+  /* Returns true when the component is responsible for freeing the data it references. Otherwise
+   * the component may not outlive the data that it was created from. */
+  virtual bool owns_direct_data() const;
+
   /* Get a read-only attribute for the given domain and data type.
    * Returns null when it does not exist. */
   blender::bke::ReadAttributePtr attribute_try_get_for_read(
@@ -237,6 +246,16 @@ struct GeometrySet {
 
   void add(const GeometryComponent &component);
 
+  /**
+   * Call the function for every existing component of the given types. The components are
+   * independent of each other, so they are made mutable and processed in parallel.
+   */
+  void modify_components_in_parallel(
+      blender::Span<GeometryComponentType> component_types,
+      const std::function<void(GeometryComponent &component)> &callback);
+
+  void ensure_owns_direct_data();
+
   void compute_boundbox_without_instances(blender::float3 *r_min, blender::float3 *r_max) const;
 
   friend std::ostream &operator<<(std::ostream &stream, const GeometrySet &geometry_set);
@@ -285,6 +304,7 @@ class MeshComponent : public GeometryComponent {
   Mesh *release();
 
   void copy_vertex_group_names_from_object(const struct Object &object);
+  const blender::Map<std::string, int> &vertex_group_names() const;
 
   const Mesh *get_for_read() const;
   Mesh *get_for_write();
@@ -297,6 +317,8 @@ class MeshComponent : public GeometryComponent {
 
   blender::bke::ReadAttributePtr attribute_try_get_for_read(
       const blender::StringRef attribute_name) const final;
+  blender::bke::ReadAttributePtr attribute_try_adapt_domain(
+      blender::bke::ReadAttributePtr attribute, const AttributeDomain domain) const final;
   blender::bke::WriteAttributePtr attribute_try_get_for_write(
       const blender::StringRef attribute_name) final;
 
@@ -308,6 +330,8 @@ class MeshComponent : public GeometryComponent {
   blender::Set<std::string> attribute_names() const final;
   bool is_empty() const final;
 
+  bool owns_direct_data() const final;
+
   static constexpr inline GeometryComponentType static_type = GeometryComponentType::Mesh;
 };
 
@@ -350,6 +374,8 @@ class PointCloudComponent : public GeometryComponent {
   blender::Set<std::string> attribute_names() const final;
   bool is_empty() const final;
 
+  bool owns_direct_data() const final;
+
   static constexpr inline GeometryComponentType static_type = GeometryComponentType::PointCloud;
 };
 
@@ -361,6 +387,14 @@ class InstancesComponent : public GeometryComponent {
   blender::Vector<blender::float3> scales_;
   blender::Vector<InstancedData> instanced_data_;
 
+  /* Transform matrices that are computed from the positions, rotations and scales when they are
+   * needed. They are never modified after they have been computed, so they can be shared between
+   * copies of the component. */
+  mutable std::mutex transforms_mutex_;
+  mutable std::shared_ptr<const blender::Array<blender::float4x4>> transforms_;
+
+  void tag_transforms_changed();
+
  public:
   InstancesComponent();
   ~InstancesComponent() = default;
@@ -384,7 +418,12 @@ class InstancesComponent : public GeometryComponent {
   blender::Span<blender::float3> positions() const;
   blender::Span<blender::float3> rotations() const;
   blender::Span<blender::float3> scales() const;
+  /* The mutable spans tag the transforms as changed, they should not be kept around after
+   * #transforms() has been called. */
   blender::MutableSpan<blender::float3> positions();
+  blender::MutableSpan<blender::float3> rotations();
+  blender::MutableSpan<blender::float3> scales();
+  blender::Span<blender::float4x4> transforms() const;
   int instances_amount() const;
 
   bool is_empty() const final;
@@ -0,0 +1,63 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bke
+ */
+
+#include "BKE_geometry_set.hh"
+
+#include "DEG_depsgraph.h"
+
+namespace blender::bke {
+
+/**
+ * Geometry that is used by one or more instances, together with the transforms of all these
+ * instances. The geometry itself is not copied, so code that supports instancing (e.g. exporters)
+ * can write the shared data once.
+ */
+struct GeometryInstanceGroup {
+  /* The instanced geometry, without instances. Nested instances get their own group. */
+  GeometrySet geometry_set;
+  /* Transforms of all instances of the geometry, relative to the root geometry set. */
+  Vector<float4x4> transforms;
+};
+
+/**
+ * Collect the geometry referenced by the instances in the geometry set, recursively. The
+ * non-instance components of the geometry set itself are the first group, with an identity
+ * transform. Instances of the same object share a group.
+ *
+ * Objects in instanced collections are filtered with the same rules as the dupli list for the
+ * given evaluation mode, and \a instancer (the object that owns the geometry set, if any) is
+ * skipped when it is part of such a collection.
+ */
+Vector<GeometryInstanceGroup> geometry_set_gather_instances(const GeometrySet &geometry_set,
+                                                            const Object *instancer,
+                                                            eEvaluationMode mode);
+
+/**
+ * Convert all instances to real geometry and join it with the geometry that is not instanced.
+ * Offsets of all instances are computed up front, so that the data of all instances can be copied
+ * and transformed in parallel. Custom data layers are matched by type and name.
+ */
+GeometrySet geometry_set_realize_instances(const GeometrySet &geometry_set,
+                                           const Object *instancer,
+                                           eEvaluationMode mode);
+
+}  // namespace blender::bke
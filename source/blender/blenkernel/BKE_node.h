@@ -312,6 +312,9 @@ typedef struct bNodeType {
 
   /* Execute a geometry node. */
   NodeGeometryExecFunction geometry_node_execute;
+  /* When true, the node is executed before all of its inputs are computed. It can request inputs
+   * lazily with #GeoNodeExecParams::lazy_require_input. */
+  bool geometry_node_execute_supports_laziness;
 
   /* RNA integration */
   ExtensionRNA rna_ext;
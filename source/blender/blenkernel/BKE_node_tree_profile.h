@@ -0,0 +1,72 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bke
+ *
+ * Statistics about the evaluation of the nodes in a node tree, used to find the nodes that are
+ * slow. A profile contains the statistics of a single evaluation, e.g. of one nodes modifier on
+ * one frame. Nodes are identified by their original node tree and their name, so that the
+ * statistics can be displayed in the node editor.
+ */
+
+#include "BLI_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct bNodeTree;
+
+typedef struct NodeProfileStats {
+  /** Wall time spent executing the node in milliseconds. */
+  double time_ms;
+  /** Number of points, vertices and instances in the geometry outputs. */
+  int64_t elements_num;
+  /** Estimated memory used by the outputs in bytes. */
+  int64_t bytes;
+  /** Number of times the node has been executed, lazy nodes can run more than once. */
+  int executions_num;
+} NodeProfileStats;
+
+typedef struct NodeTreeProfile NodeTreeProfile;
+
+NodeTreeProfile *BKE_node_tree_profile_new(float frame);
+void BKE_node_tree_profile_free(NodeTreeProfile *profile);
+
+/**
+ * Accumulate the stats of a node. \a ntree should be the original node tree. Can be called from
+ * multiple threads at the same time.
+ */
+void BKE_node_tree_profile_add(NodeTreeProfile *profile,
+                               const struct bNodeTree *ntree,
+                               const char *node_name,
+                               const NodeProfileStats *stats);
+void BKE_node_tree_profile_set_total_time(NodeTreeProfile *profile, double time_ms);
+
+/** Returns false when the node has not been executed during the profiled evaluation. */
+bool BKE_node_tree_profile_lookup(const NodeTreeProfile *profile,
+                                  const struct bNodeTree *ntree,
+                                  const char *node_name,
+                                  NodeProfileStats *r_stats);
+float BKE_node_tree_profile_frame(const NodeTreeProfile *profile);
+double BKE_node_tree_profile_total_time(const NodeTreeProfile *profile);
+
+#ifdef __cplusplus
+}
+#endif
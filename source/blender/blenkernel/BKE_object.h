@@ -410,11 +410,16 @@ bool BKE_object_empty_image_data_is_visible_in_view3d(const struct Object *ob,
  * If preserve_all_data_layers is truth then the modifier stack is re-evaluated to ensure it
  * preserves all possible custom data layers.
  *
- * NOTE: Dependency graph argument is required when preserve_all_data_layers is truth, and is
- * ignored otherwise. */
+ * If realize_instances is truth then the mesh geometry of the instances in the evaluated
+ * geometry set of the object (e.g. from geometry nodes) is joined into the mesh. These instances
+ * are part of the dupli list as well, so exporters should only use this when they skip them.
+ *
+ * NOTE: Dependency graph argument is required when preserve_all_data_layers or
+ * realize_instances is truth, and is ignored otherwise. */
 struct Mesh *BKE_object_to_mesh(struct Depsgraph *depsgraph,
                                 struct Object *object,
-                                bool preserve_all_data_layers);
+                                bool preserve_all_data_layers,
+                                bool realize_instances);
 
 void BKE_object_to_mesh_clear(struct Object *object);
 
@@ -57,6 +57,26 @@ void BKE_pointcloud_data_update(struct Depsgraph *depsgraph,
                                 struct Scene *scene,
                                 struct Object *object);
 
+/* Level of Detail */
+
+/**
+ * The point indices ordered so that the points of every level are a prefix of the array, which
+ * covers the point cloud evenly with roughly one point per occupied octree cell of that level.
+ */
+typedef struct PointCloudLOD {
+  int *order;
+  /* Number of points in every level, including the points of the coarser levels. The last
+   * level contains all points. */
+  int *level_sizes;
+  int levels_num;
+  /* Bounds of the point positions. */
+  float min[3];
+  float max[3];
+} PointCloudLOD;
+
+struct PointCloudLOD *BKE_pointcloud_lod_build(const struct PointCloud *pointcloud);
+void BKE_pointcloud_lod_free(struct PointCloudLOD *lod);
+
 /* Draw Cache */
 
 enum {
@@ -49,6 +49,22 @@ struct Mesh *BKE_subdiv_to_mesh(struct Subdiv *subdiv,
                                 const SubdivToMeshSettings *settings,
                                 const struct Mesh *coarse_mesh);
 
+/* Subdivided mesh which is kept between evaluations, so that only the vertex positions are
+ * evaluated again when the coarse mesh is only deformed (i.e. by an armature). */
+typedef struct SubdivMeshCache SubdivMeshCache;
+
+SubdivMeshCache *BKE_subdiv_mesh_cache_new(void);
+void BKE_subdiv_mesh_cache_free(SubdivMeshCache *cache);
+
+/* Same as BKE_subdiv_to_mesh(), but when everything except the vertex positions of the coarse
+ * mesh matches the mesh stored in the cache, the result references all data of the cached mesh
+ * except for the vertices, of which only the positions are evaluated. The result must be freed
+ * before the cache. Otherwise the cache is updated with the new result. */
+struct Mesh *BKE_subdiv_to_mesh_cached(struct Subdiv *subdiv,
+                                       const SubdivToMeshSettings *settings,
+                                       const struct Mesh *coarse_mesh,
+                                       SubdivMeshCache *cache);
+
 #ifdef __cplusplus
 }
 #endif
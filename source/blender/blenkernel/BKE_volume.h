@@ -37,6 +37,11 @@ struct VolumeGridVector;
 
 void BKE_volumes_init(void);
 
+/* Global cache of grids read from files, shared between all volume datablocks. */
+
+void BKE_volume_cache_limit_update(void);
+size_t BKE_volume_cache_memory_used(void);
+
 /* Datablock Management */
 
 void BKE_volume_init_grids(struct Volume *volume);
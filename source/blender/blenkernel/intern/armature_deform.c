@@ -237,6 +237,41 @@ static void pchan_bone_deform(bPoseChannel *pchan,
  * #BKE_armature_deform_coords and related functions.
  * \{ */
 
+/**
+ * The bone deforming a vertex group. The deformation of plain bones is copied into an array
+ * indexed by vertex group, so the per vertex loop reads it from a small contiguous block of
+ * memory rather than from the pose channels.
+ */
+typedef struct ArmatureDeformGroup {
+  /** NULL when the group has no bone, or the bone doesn't deform. */
+  bPoseChannel *pchan;
+  /**
+   * B-Bones and bones multiplying weights by their envelope depend on the vertex position,
+   * so they are deformed using #pchan_bone_deform.
+   */
+  bool use_pchan_deform;
+  float deform_mat[4][4];
+  DualQuat deform_dq;
+} ArmatureDeformGroup;
+
+static void armature_deform_group_init(ArmatureDeformGroup *group, bPoseChannel *pchan)
+{
+  const Bone *bone = pchan ? pchan->bone : NULL;
+
+  /* exclude non-deforming bones */
+  if (bone == NULL || (bone->flag & BONE_NO_DEFORM)) {
+    group->pchan = NULL;
+    return;
+  }
+
+  group->pchan = pchan;
+  group->use_pchan_deform = (bone->flag & BONE_MULT_VG_ENV) ||
+                            (bone->segments > 1 &&
+                             pchan->runtime.bbone_segments == bone->segments);
+  copy_m4_m4(group->deform_mat, pchan->chan_mat);
+  group->deform_dq = pchan->runtime.deform_dual_quat;
+}
+
 typedef struct ArmatureUserdata {
   const Object *ob_arm;
   const Object *ob_target;
@@ -255,7 +290,8 @@ typedef struct ArmatureUserdata {
   const MDeformVert *dverts;
   int dverts_len;
 
-  bPoseChannel **pchan_from_defbase;
+  /** Deformation of each vertex group, see #ArmatureDeformGroup. */
+  const ArmatureDeformGroup *deform_groups;
   int defbase_len;
 
   float premat[4][4];
@@ -267,6 +303,98 @@ typedef struct ArmatureUserdata {
   } bmesh;
 } ArmatureUserdata;
 
+/**
+ * Add the weighted matrix of a plain bone to \a mat_accum, as a flat loop over all 16 values
+ * so it compiles to a few vector multiply-adds.
+ */
+BLI_INLINE void armature_deform_mat_madd(float mat_accum[4][4],
+                                         const float deform_mat[4][4],
+                                         const float weight)
+{
+  float *r = &mat_accum[0][0];
+  const float *m = &deform_mat[0][0];
+  for (int i = 0; i < 16; i++) {
+    r[i] += m[i] * weight;
+  }
+}
+
+/**
+ * Accumulate the deformation of the bones of all vertex groups the vertex is in.
+ * Plain bones are applied directly from their #ArmatureDeformGroup.
+ *
+ * For linear blend skinning the matrices of plain bones are blended first and the vertex is
+ * transformed once, instead of transforming it by every bone. The blended matrix also gives the
+ * deform matrix, which otherwise needs a 3x3 multiply-add per bone.
+ *
+ * \return false when none of the groups has a bone.
+ */
+static bool armature_dvert_deform_accumulate(const ArmatureUserdata *data,
+                                             const MDeformVert *dvert,
+                                             const float co[3],
+                                             float vec[3],
+                                             DualQuat *dq,
+                                             float smat[3][3],
+                                             float *r_contrib)
+{
+  const ArmatureDeformGroup *deform_groups = data->deform_groups;
+  const uint defbase_len = (uint)data->defbase_len;
+  const MDeformWeight *dw = dvert->dw;
+  const MDeformWeight *dw_end = dw + dvert->totweight;
+  float mat_accum[4][4];
+  float weight_accum = 0.0f;
+  bool deformed = false;
+
+  if (dq == NULL) {
+    zero_m4(mat_accum);
+  }
+
+  for (; dw != dw_end; dw++) {
+    const uint index = dw->def_nr;
+    if (index >= defbase_len || deform_groups[index].pchan == NULL) {
+      continue;
+    }
+    const ArmatureDeformGroup *group = &deform_groups[index];
+    float weight = dw->weight;
+
+    deformed = true;
+
+    if (group->use_pchan_deform) {
+      const Bone *bone = group->pchan->bone;
+      if (bone->flag & BONE_MULT_VG_ENV) {
+        weight *= distfactor_to_bone(
+            co, bone->arm_head, bone->arm_tail, bone->rad_head, bone->rad_tail, bone->dist);
+      }
+      pchan_bone_deform(group->pchan, weight, vec, dq, smat, co, r_contrib);
+    }
+    else if (weight != 0.0f) {
+      if (dq) {
+        add_weighted_dq_dq(dq, &group->deform_dq, weight);
+      }
+      else {
+        armature_deform_mat_madd(mat_accum, group->deform_mat, weight);
+        weight_accum += weight;
+      }
+      (*r_contrib) += weight;
+    }
+  }
+
+  if (weight_accum != 0.0f) {
+    /* Same as the sum of `(deform_mat * co - co) * weight` over all plain bones. */
+    float tmp[3];
+    mul_v3_m4v3(tmp, mat_accum, co);
+    madd_v3_v3fl(tmp, co, -weight_accum);
+    add_v3_v3(vec, tmp);
+
+    if (smat) {
+      float tmpmat[3][3];
+      copy_m3_m4(tmpmat, mat_accum);
+      add_m3_m3m3(smat, smat, tmpmat);
+    }
+  }
+
+  return deformed;
+}
+
 static void armature_vert_task_with_dvert(const ArmatureUserdata *data,
                                           const int i,
                                           const MDeformVert *dvert)
@@ -328,27 +456,10 @@ static void armature_vert_task_with_dvert(const ArmatureUserdata *data,
   mul_m4_v3(data->premat, co);
 
   if (use_dverts && dvert && dvert->totweight) { /* use weight groups ? */
-    const MDeformWeight *dw = dvert->dw;
-    int deformed = 0;
-    unsigned int j;
-    for (j = dvert->totweight; j != 0; j--, dw++) {
-      const uint index = dw->def_nr;
-      if (index < data->defbase_len && (pchan = data->pchan_from_defbase[index])) {
-        float weight = dw->weight;
-        Bone *bone = pchan->bone;
-
-        deformed = 1;
-
-        if (bone && bone->flag & BONE_MULT_VG_ENV) {
-          weight *= distfactor_to_bone(
-              co, bone->arm_head, bone->arm_tail, bone->rad_head, bone->rad_tail, bone->dist);
-        }
-
-        pchan_bone_deform(pchan, weight, vec, dq, smat, co, &contrib);
-      }
-    }
+    const bool deformed = armature_dvert_deform_accumulate(
+        data, dvert, co, vec, dq, smat, &contrib);
     /* If there are vertex-groups but not groups with bones (like for soft-body groups). */
-    if (deformed == 0 && use_envelope) {
+    if (!deformed && use_envelope) {
       for (pchan = data->ob_arm->pose->chanbase.first; pchan; pchan = pchan->next) {
         if (!(pchan->bone->flag & BONE_NO_DEFORM)) {
           contrib += dist_bone_deform(pchan, vec, dq, smat, co);
@@ -472,7 +583,7 @@ static void armature_deform_coords_impl(const Object *ob_arm,
                                         bGPDstroke *gps_target)
 {
   bArmature *arm = ob_arm->data;
-  bPoseChannel **pchan_from_defbase = NULL;
+  ArmatureDeformGroup *deform_groups = NULL;
   const MDeformVert *dverts = NULL;
   bDeformGroup *dg;
   const bool use_envelope = (deformflag & ARM_DEF_ENVELOPE) != 0;
@@ -542,19 +653,10 @@ static void armature_deform_coords_impl(const Object *ob_arm,
       }
 
       if (use_dverts) {
-        pchan_from_defbase = MEM_callocN(sizeof(*pchan_from_defbase) * defbase_len, "defnrToBone");
-        /* TODO(sergey): Some considerations here:
-         *
-         * - Check whether keeping this consistent across frames gives speedup.
-         */
+        deform_groups = MEM_malloc_arrayN(defbase_len, sizeof(*deform_groups), "defnrToBone");
         for (i = 0, dg = ob_target->defbase.first; dg; i++, dg = dg->next) {
-          pchan_from_defbase[i] = BKE_pose_channel_find_name(ob_arm->pose, dg->name);
-          /* exclude non-deforming bones */
-          if (pchan_from_defbase[i]) {
-            if (pchan_from_defbase[i]->bone->flag & BONE_NO_DEFORM) {
-              pchan_from_defbase[i] = NULL;
-            }
-          }
+          armature_deform_group_init(&deform_groups[i],
+                                     BKE_pose_channel_find_name(ob_arm->pose, dg->name));
         }
       }
     }
@@ -574,7 +676,7 @@ static void armature_deform_coords_impl(const Object *ob_arm,
       .armature_def_nr = armature_def_nr,
       .dverts = dverts,
       .dverts_len = dverts_len,
-      .pchan_from_defbase = pchan_from_defbase,
+      .deform_groups = deform_groups,
       .defbase_len = defbase_len,
       .bmesh =
           {
@@ -608,8 +710,8 @@ static void armature_deform_coords_impl(const Object *ob_arm,
     BLI_task_parallel_range(0, vert_coords_len, &data, armature_vert_task, &settings);
   }
 
-  if (pchan_from_defbase) {
-    MEM_freeN(pchan_from_defbase);
+  if (deform_groups) {
+    MEM_freeN(deform_groups);
   }
 }
 
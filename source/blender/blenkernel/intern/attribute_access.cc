@@ -21,6 +21,7 @@
 #include "BKE_deform.h"
 #include "BKE_geometry_set.hh"
 #include "BKE_mesh.h"
+#include "BKE_mesh_mapping.h"
 #include "BKE_pointcloud.h"
 
 #include "DNA_mesh_types.h"
@@ -30,6 +31,7 @@
 #include "BLI_color.hh"
 #include "BLI_float2.hh"
 #include "BLI_span.hh"
+#include "BLI_task.hh"
 
 #include "CLG_log.h"
 
@@ -38,7 +40,9 @@
 static CLG_LogRef LOG = {"bke.attribute_access"};
 
 using blender::float3;
+using blender::IndexRange;
 using blender::Set;
+using blender::Span;
 using blender::StringRef;
 using blender::bke::ReadAttributePtr;
 using blender::bke::WriteAttributePtr;
@@ -46,6 +50,10 @@ using blender::bke::WriteAttributePtr;
 /* Can't include BKE_object_deform.h right now, due to an enum forward declaration.  */
 extern "C" MDeformVert *BKE_object_defgroup_data_create(ID *id);
 
+/* Number of elements that are processed by a single task when a whole attribute is copied,
+ * converted or interpolated at once. */
+static constexpr int64_t attribute_grain_size = 4096;
+
 namespace blender::bke {
 
 /* -------------------------------------------------------------------- */
@@ -79,9 +87,11 @@ void ReadAttribute::initialize_span() const
   const int element_size = cpp_type_.size();
   array_buffer_ = MEM_mallocN_aligned(size_ * element_size, cpp_type_.alignment(), __func__);
   array_is_temporary_ = true;
-  for (const int i : IndexRange(size_)) {
-    this->get_internal(i, POINTER_OFFSET(array_buffer_, i * element_size));
-  }
+  parallel_for(IndexRange(size_), attribute_grain_size, [&](IndexRange range) {
+    for (const int64_t i : range) {
+      this->get_internal(i, POINTER_OFFSET(array_buffer_, i * element_size));
+    }
+  });
 }
 
 WriteAttribute::~WriteAttribute()
@@ -131,9 +141,11 @@ void WriteAttribute::apply_span_if_necessary()
   BLI_assert(array_buffer_ != nullptr);
 
   const int element_size = cpp_type_.size();
-  for (const int i : IndexRange(size_)) {
-    this->set_internal(i, POINTER_OFFSET(array_buffer_, i * element_size));
-  }
+  parallel_for(IndexRange(size_), attribute_grain_size, [&](IndexRange range) {
+    for (const int64_t i : range) {
+      this->set_internal(i, POINTER_OFFSET(array_buffer_, i * element_size));
+    }
+  });
 }
 
 class VertexWeightWriteAttribute final : public WriteAttribute {
@@ -160,6 +172,17 @@ class VertexWeightWriteAttribute final : public WriteAttribute {
     weight->weight = *reinterpret_cast<const float *>(value);
   }
 
+  void apply_span_if_necessary() override
+  {
+    const float *weights = static_cast<const float *>(array_buffer_);
+    parallel_for(IndexRange(size_), attribute_grain_size, [&](IndexRange range) {
+      for (const int64_t i : range) {
+        MDeformWeight *weight = BKE_defvert_ensure_index(&dverts_[i], dvert_index_);
+        weight->weight = weights[i];
+      }
+    });
+  }
+
   static void get_internal(const MDeformVert *dverts,
                            const int dvert_index,
                            const int64_t index,
@@ -197,6 +220,23 @@ class VertexWeightReadAttribute final : public ReadAttribute {
   {
     VertexWeightWriteAttribute::get_internal(dverts_, dvert_index_, index, r_value);
   }
+
+  void initialize_span() const override
+  {
+    float *weights = static_cast<float *>(
+        MEM_mallocN_aligned(sizeof(float) * size_, alignof(float), __func__));
+    array_buffer_ = weights;
+    array_is_temporary_ = true;
+    if (dverts_ == nullptr) {
+      std::fill_n(weights, size_, 0.0f);
+      return;
+    }
+    parallel_for(IndexRange(size_), attribute_grain_size, [&](IndexRange range) {
+      for (const int64_t i : range) {
+        VertexWeightWriteAttribute::get_internal(dverts_, dvert_index_, i, weights + i);
+      }
+    });
+  }
 };
 
 template<typename T> class ArrayWriteAttribute final : public WriteAttribute {
@@ -286,6 +326,31 @@ class DerivedArrayWriteAttribute final : public WriteAttribute {
     const ElemT &typed_value = *reinterpret_cast<const ElemT *>(value);
     set_function_(struct_value, typed_value);
   }
+
+  void initialize_span() override
+  {
+    ElemT *values = static_cast<ElemT *>(
+        MEM_mallocN_aligned(sizeof(ElemT) * size_, alignof(ElemT), __func__));
+    array_buffer_ = values;
+    array_is_temporary_ = true;
+    /* Callers usually only write to the span, but the span should still contain the original
+     * values. Copying them in a tight loop is cheap compared to the virtual call per element. */
+    parallel_for(IndexRange(size_), attribute_grain_size, [&](IndexRange range) {
+      for (const int64_t i : range) {
+        new (values + i) ElemT(get_function_(data_[i]));
+      }
+    });
+  }
+
+  void apply_span_if_necessary() override
+  {
+    const ElemT *values = static_cast<const ElemT *>(array_buffer_);
+    parallel_for(IndexRange(size_), attribute_grain_size, [&](IndexRange range) {
+      for (const int64_t i : range) {
+        set_function_(data_[i], values[i]);
+      }
+    });
+  }
 };
 
 template<typename StructT, typename ElemT, typename GetFuncT>
@@ -308,6 +373,19 @@ class DerivedArrayReadAttribute final : public ReadAttribute {
     const ElemT value = get_function_(struct_value);
     new (r_value) ElemT(value);
   }
+
+  void initialize_span() const override
+  {
+    ElemT *values = static_cast<ElemT *>(
+        MEM_mallocN_aligned(sizeof(ElemT) * size_, alignof(ElemT), __func__));
+    array_buffer_ = values;
+    array_is_temporary_ = true;
+    parallel_for(IndexRange(size_), attribute_grain_size, [&](IndexRange range) {
+      for (const int64_t i : range) {
+        new (values + i) ElemT(get_function_(data_[i]));
+      }
+    });
+  }
 };
 
 class ConstantReadAttribute final : public ReadAttribute {
@@ -375,6 +453,52 @@ class ConvertedReadAttribute final : public ReadAttribute {
     base_attribute_->get(index, buffer.ptr());
     conversions_.convert(from_type_, to_type_, buffer.ptr(), r_value);
   }
+
+  void initialize_span() const override
+  {
+    /* Convert whole blocks at once, instead of calling the conversion function for every
+     * element separately. */
+    const fn::GSpan from_span = base_attribute_->get_span();
+    array_buffer_ = MEM_mallocN_aligned(
+        size_ * to_type_.size(), to_type_.alignment(), __func__);
+    array_is_temporary_ = true;
+    parallel_for(IndexRange(size_), attribute_grain_size, [&](IndexRange range) {
+      conversions_.convert_to_uninitialized(
+          from_span.slice(range.start(), range.size()),
+          fn::GMutableSpan(to_type_, array_buffer_, size_).slice(range.start(), range.size()));
+    });
+  }
+};
+
+/**
+ * An attribute that owns a temporary array with all its values, e.g. because the values have been
+ * interpolated from another domain.
+ */
+class TemporaryArrayReadAttribute final : public ReadAttribute {
+ public:
+  /* Takes ownership of the buffer, which has to be allocated with #MEM_mallocN_aligned and has
+   * to contain initialized values. */
+  TemporaryArrayReadAttribute(AttributeDomain domain,
+                              const CPPType &type,
+                              const int64_t size,
+                              void *buffer)
+      : ReadAttribute(domain, type, size)
+  {
+    array_buffer_ = buffer;
+    array_is_temporary_ = true;
+  }
+
+  void get_internal(const int64_t index, void *r_value) const override
+  {
+    cpp_type_.copy_to_uninitialized(POINTER_OFFSET(array_buffer_, index * cpp_type_.size()),
+                                    r_value);
+  }
+
+  void initialize_span() const override
+  {
+    /* The buffer is set in the constructor already. */
+    BLI_assert(false);
+  }
 };
 
 /** \} */
@@ -951,6 +1075,208 @@ ReadAttributePtr MeshComponent::attribute_try_get_for_read(const StringRef attri
   return {};
 }
 
+/* Returns the number of float components of attribute types that can be interpolated between
+ * domains by averaging, or zero when the type is not supported. */
+static int interpolated_float_components_num(const blender::fn::CPPType &type)
+{
+  if (type.is<float>()) {
+    return 1;
+  }
+  if (type.is<blender::float2>()) {
+    return 2;
+  }
+  if (type.is<float3>()) {
+    return 3;
+  }
+  if (type.is<blender::Color4f>()) {
+    return 4;
+  }
+  return 0;
+}
+
+/* Set every destination element to the average of the source elements in its group. */
+static void average_groups(Span<MeshElemMap> groups,
+                           const float *src,
+                           const int components,
+                           float *dst)
+{
+  blender::parallel_for(groups.index_range(), attribute_grain_size, [&](IndexRange range) {
+    for (const int64_t i : range) {
+      const MeshElemMap &group = groups[i];
+      float *dst_value = dst + i * components;
+      std::fill_n(dst_value, components, 0.0f);
+      if (group.count == 0) {
+        continue;
+      }
+      for (const int src_index : Span(group.indices, group.count)) {
+        const float *src_value = src + src_index * components;
+        for (const int c : IndexRange(components)) {
+          dst_value[c] += src_value[c];
+        }
+      }
+      const float factor = 1.0f / group.count;
+      for (const int c : IndexRange(components)) {
+        dst_value[c] *= factor;
+      }
+    }
+  });
+}
+
+static void adapt_mesh_domain_corner_to_point(const Mesh &mesh,
+                                              const float *src,
+                                              const int components,
+                                              float *dst)
+{
+  MeshElemMap *vert_to_loop_map;
+  int *vert_to_loop_indices;
+  BKE_mesh_vert_loop_map_create(&vert_to_loop_map,
+                                &vert_to_loop_indices,
+                                mesh.mpoly,
+                                mesh.mloop,
+                                mesh.totvert,
+                                mesh.totpoly,
+                                mesh.totloop);
+  average_groups(Span(vert_to_loop_map, mesh.totvert), src, components, dst);
+  MEM_freeN(vert_to_loop_map);
+  MEM_freeN(vert_to_loop_indices);
+}
+
+static void adapt_mesh_domain_polygon_to_point(const Mesh &mesh,
+                                               const float *src,
+                                               const int components,
+                                               float *dst)
+{
+  MeshElemMap *vert_to_poly_map;
+  int *vert_to_poly_indices;
+  BKE_mesh_vert_poly_map_create(&vert_to_poly_map,
+                                &vert_to_poly_indices,
+                                mesh.mpoly,
+                                mesh.mloop,
+                                mesh.totvert,
+                                mesh.totpoly,
+                                mesh.totloop);
+  average_groups(Span(vert_to_poly_map, mesh.totvert), src, components, dst);
+  MEM_freeN(vert_to_poly_map);
+  MEM_freeN(vert_to_poly_indices);
+}
+
+static void adapt_mesh_domain_point_to_corner(const Mesh &mesh,
+                                              const float *src,
+                                              const int components,
+                                              float *dst)
+{
+  blender::parallel_for(IndexRange(mesh.totloop), attribute_grain_size, [&](IndexRange range) {
+    for (const int64_t loop_index : range) {
+      const int vert_index = mesh.mloop[loop_index].v;
+      std::copy_n(src + vert_index * components, components, dst + loop_index * components);
+    }
+  });
+}
+
+static void adapt_mesh_domain_polygon_to_corner(const Mesh &mesh,
+                                                const float *src,
+                                                const int components,
+                                                float *dst)
+{
+  blender::parallel_for(IndexRange(mesh.totpoly), attribute_grain_size, [&](IndexRange range) {
+    for (const int64_t poly_index : range) {
+      const MPoly &poly = mesh.mpoly[poly_index];
+      const float *src_value = src + poly_index * components;
+      for (const int loop_index : IndexRange(poly.loopstart, poly.totloop)) {
+        std::copy_n(src_value, components, dst + loop_index * components);
+      }
+    }
+  });
+}
+
+/* Average the values of the vertices or corners of every polygon. */
+static void adapt_mesh_domain_to_polygon(const Mesh &mesh,
+                                         const float *src,
+                                         const int components,
+                                         const bool src_is_point,
+                                         float *dst)
+{
+  blender::parallel_for(IndexRange(mesh.totpoly), attribute_grain_size, [&](IndexRange range) {
+    for (const int64_t poly_index : range) {
+      const MPoly &poly = mesh.mpoly[poly_index];
+      float *dst_value = dst + poly_index * components;
+      std::fill_n(dst_value, components, 0.0f);
+      if (poly.totloop == 0) {
+        continue;
+      }
+      for (const int loop_index : IndexRange(poly.loopstart, poly.totloop)) {
+        const int src_index = src_is_point ? mesh.mloop[loop_index].v : loop_index;
+        const float *src_value = src + src_index * components;
+        for (const int c : IndexRange(components)) {
+          dst_value[c] += src_value[c];
+        }
+      }
+      const float factor = 1.0f / poly.totloop;
+      for (const int c : IndexRange(components)) {
+        dst_value[c] *= factor;
+      }
+    }
+  });
+}
+
+ReadAttributePtr MeshComponent::attribute_try_adapt_domain(ReadAttributePtr attribute,
+                                                           const AttributeDomain domain) const
+{
+  if (!attribute) {
+    return {};
+  }
+  const AttributeDomain old_domain = attribute->domain();
+  if (old_domain == domain) {
+    return attribute;
+  }
+  if (mesh_ == nullptr) {
+    return {};
+  }
+  const blender::fn::CPPType &type = attribute->cpp_type();
+  const int components = interpolated_float_components_num(type);
+  if (components == 0) {
+    return {};
+  }
+
+  /* All supported types consist of floats only, so they can be interpolated on the raw arrays
+   * without dispatching on the type for every element. */
+  const float *src = static_cast<const float *>(attribute->get_span().data());
+  const int new_size = this->attribute_domain_size(domain);
+  float *dst = static_cast<float *>(
+      MEM_mallocN_aligned(type.size() * new_size, type.alignment(), __func__));
+
+  const Mesh &mesh = *mesh_;
+  bool success = true;
+  if (old_domain == ATTR_DOMAIN_CORNER && domain == ATTR_DOMAIN_POINT) {
+    adapt_mesh_domain_corner_to_point(mesh, src, components, dst);
+  }
+  else if (old_domain == ATTR_DOMAIN_POLYGON && domain == ATTR_DOMAIN_POINT) {
+    adapt_mesh_domain_polygon_to_point(mesh, src, components, dst);
+  }
+  else if (old_domain == ATTR_DOMAIN_POINT && domain == ATTR_DOMAIN_CORNER) {
+    adapt_mesh_domain_point_to_corner(mesh, src, components, dst);
+  }
+  else if (old_domain == ATTR_DOMAIN_POLYGON && domain == ATTR_DOMAIN_CORNER) {
+    adapt_mesh_domain_polygon_to_corner(mesh, src, components, dst);
+  }
+  else if (old_domain == ATTR_DOMAIN_POINT && domain == ATTR_DOMAIN_POLYGON) {
+    adapt_mesh_domain_to_polygon(mesh, src, components, true, dst);
+  }
+  else if (old_domain == ATTR_DOMAIN_CORNER && domain == ATTR_DOMAIN_POLYGON) {
+    adapt_mesh_domain_to_polygon(mesh, src, components, false, dst);
+  }
+  else {
+    success = false;
+  }
+
+  if (!success) {
+    MEM_freeN(dst);
+    return {};
+  }
+  return std::make_unique<blender::bke::TemporaryArrayReadAttribute>(
+      domain, type, new_size, dst);
+}
+
 WriteAttributePtr MeshComponent::attribute_try_get_for_write(const StringRef attribute_name)
 {
   Mesh *mesh = this->get_for_write();
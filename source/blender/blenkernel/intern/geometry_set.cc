@@ -14,6 +14,11 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include "BLI_array.hh"
+#include "BLI_map.hh"
+#include "BLI_math_matrix.h"
+#include "BLI_task.hh"
+
 #include "BKE_geometry_set.hh"
 #include "BKE_lib_id.h"
 #include "BKE_mesh.h"
@@ -24,10 +29,15 @@
 
 #include "MEM_guardedalloc.h"
 
+using blender::Array;
 using blender::float3;
+using blender::float4x4;
+using blender::IndexRange;
+using blender::Map;
 using blender::MutableSpan;
 using blender::Span;
 using blender::StringRef;
+using blender::UserCounter;
 using blender::Vector;
 
 /* -------------------------------------------------------------------- */
@@ -86,12 +96,29 @@ bool GeometryComponent::is_empty() const
   return false;
 }
 
+bool GeometryComponent::owns_direct_data() const
+{
+  return true;
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
 /** \name Geometry Set
  * \{ */
 
+static GeometryComponent &ensure_component_mutable(UserCounter<GeometryComponent> &component)
+{
+  if (component->is_mutable()) {
+    /* If the referenced component is already mutable, return it directly. */
+    return *component;
+  }
+  /* If the referenced component is shared, make a copy. The copy is not shared and is
+   * therefore mutable. */
+  component = UserCounter<GeometryComponent>{component->copy()};
+  return *component;
+}
+
 /* This method can only be used when the geometry set is mutable. It returns a mutable geometry
  * component of the given type.
  */
@@ -105,19 +132,30 @@ GeometryComponent &GeometrySet::get_component_for_write(GeometryComponentType co
         return **value_ptr;
       },
       [&](GeometryComponentPtr *value_ptr) -> GeometryComponent & {
-        GeometryComponentPtr &value = *value_ptr;
-        if (value->is_mutable()) {
-          /* If the referenced component is already mutable, return it directly. */
-          return *value;
-        }
-        /* If the referenced component is shared, make a copy. The copy is not shared and is
-         * therefore mutable. */
-        GeometryComponent *copied_component = value->copy();
-        value = GeometryComponentPtr{copied_component};
-        return *copied_component;
+        return ensure_component_mutable(*value_ptr);
       });
 }
 
+void GeometrySet::modify_components_in_parallel(
+    Span<GeometryComponentType> component_types,
+    const std::function<void(GeometryComponent &component)> &callback)
+{
+  /* Look up all components first, so that the map is not changed while the components are
+   * processed. Making a component mutable only changes its own slot in the map. */
+  Vector<GeometryComponentPtr *> components;
+  for (const GeometryComponentType component_type : component_types) {
+    GeometryComponentPtr *component = components_.lookup_ptr(component_type);
+    if (component != nullptr) {
+      components.append(component);
+    }
+  }
+  blender::parallel_for(components.index_range(), 1, [&](IndexRange range) {
+    for (const int64_t i : range) {
+      callback(ensure_component_mutable(*components[i]));
+    }
+  });
+}
+
 /* Get the component of the given type. Might return null if the component does not exist yet. */
 const GeometryComponent *GeometrySet::get_component_for_read(
     GeometryComponentType component_type) const
@@ -147,6 +185,18 @@ void GeometrySet::add(const GeometryComponent &component)
   components_.add_new(component.type(), std::move(component_ptr));
 }
 
+/* Replace components that reference data they don't own with owning copies. This is necessary
+ * when the geometry set is kept alive longer than the data it was created from, e.g. in a cache.
+ * Shared components are not modified. */
+void GeometrySet::ensure_owns_direct_data()
+{
+  for (GeometryComponentPtr &component_ptr : components_.values()) {
+    if (!component_ptr->owns_direct_data()) {
+      component_ptr = GeometryComponentPtr{component_ptr->copy()};
+    }
+  }
+}
+
 void GeometrySet::compute_boundbox_without_instances(float3 *r_min, float3 *r_max) const
 {
   const PointCloud *pointcloud = this->get_pointcloud_for_read();
@@ -284,6 +334,7 @@ GeometryComponent *MeshComponent::copy() const
     new_component->mesh_ = BKE_mesh_copy_for_eval(mesh_, false);
     new_component->ownership_ = GeometryOwnershipType::Owned;
   }
+  new_component->vertex_group_names_ = vertex_group_names_;
   return new_component;
 }
 
@@ -334,6 +385,11 @@ void MeshComponent::copy_vertex_group_names_from_object(const Object &object)
   }
 }
 
+const blender::Map<std::string, int> &MeshComponent::vertex_group_names() const
+{
+  return vertex_group_names_;
+}
+
 /* Get the mesh from this component. This method can be used by multiple threads at the same
  * time. Therefore, the returned mesh should not be modified. No ownership is transferred. */
 const Mesh *MeshComponent::get_for_read() const
@@ -358,6 +414,11 @@ bool MeshComponent::is_empty() const
   return mesh_ == nullptr;
 }
 
+bool MeshComponent::owns_direct_data() const
+{
+  return ownership_ == GeometryOwnershipType::Owned;
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -444,6 +505,11 @@ bool PointCloudComponent::is_empty() const
   return pointcloud_ == nullptr;
 }
 
+bool PointCloudComponent::owns_direct_data() const
+{
+  return ownership_ == GeometryOwnershipType::Owned;
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -461,6 +527,8 @@ GeometryComponent *InstancesComponent::copy() const
   new_component->rotations_ = rotations_;
   new_component->scales_ = scales_;
   new_component->instanced_data_ = instanced_data_;
+  std::lock_guard lock{transforms_mutex_};
+  new_component->transforms_ = transforms_;
   return new_component;
 }
 
@@ -470,6 +538,7 @@ void InstancesComponent::clear()
   positions_.clear();
   rotations_.clear();
   scales_.clear();
+  this->tag_transforms_changed();
 }
 
 void InstancesComponent::add_instance(Object *object,
@@ -503,6 +572,7 @@ void InstancesComponent::add_instance(InstancedData data,
   positions_.append(position);
   rotations_.append(rotation);
   scales_.append(scale);
+  this->tag_transforms_changed();
 }
 
 Span<InstancedData> InstancesComponent::instanced_data() const
@@ -527,9 +597,59 @@ blender::Span<blender::float3> InstancesComponent::scales() const
 
 MutableSpan<float3> InstancesComponent::positions()
 {
+  /* The positions might be changed by the caller. */
+  this->tag_transforms_changed();
   return positions_;
 }
 
+MutableSpan<float3> InstancesComponent::rotations()
+{
+  this->tag_transforms_changed();
+  return rotations_;
+}
+
+MutableSpan<float3> InstancesComponent::scales()
+{
+  this->tag_transforms_changed();
+  return scales_;
+}
+
+void InstancesComponent::tag_transforms_changed()
+{
+  std::lock_guard lock{transforms_mutex_};
+  transforms_.reset();
+}
+
+/**
+ * Get the transform matrix of every instance. The matrices are computed in parallel the first
+ * time they are accessed and are invalidated when the instances are changed.
+ */
+Span<float4x4> InstancesComponent::transforms() const
+{
+  {
+    std::lock_guard lock{transforms_mutex_};
+    if (transforms_) {
+      return *transforms_;
+    }
+  }
+
+  /* Compute the matrices without holding the lock. Otherwise a thread waiting for the lock could
+   * be scheduled to run a task of the parallel loop below and deadlock. */
+  std::shared_ptr<Array<float4x4>> transforms = std::make_shared<Array<float4x4>>(
+      positions_.size());
+  blender::parallel_for(positions_.index_range(), 4096, [&](IndexRange range) {
+    for (const int i : range) {
+      loc_eul_size_to_mat4((*transforms)[i].values, positions_[i], rotations_[i], scales_[i]);
+    }
+  });
+
+  std::lock_guard lock{transforms_mutex_};
+  if (!transforms_) {
+    transforms_ = std::move(transforms);
+  }
+  return *transforms_;
+}
+
 int InstancesComponent::instances_amount() const
 {
   const int size = instanced_data_.size();
@@ -577,4 +697,89 @@ int BKE_geometry_set_instances(const GeometrySet *geometry_set,
   return component->instances_amount();
 }
 
+/**
+ * Group the instances by the object or collection they reference. This allows instancing the same
+ * data many times without looking it up for every instance. Instances that don't reference
+ * anything are skipped.
+ */
+int BKE_geometry_set_instances_batches(const GeometrySet *geometry_set,
+                                       InstancesBatch **r_batches)
+{
+  *r_batches = nullptr;
+  const InstancesComponent *component = geometry_set->get_component_for_read<InstancesComponent>();
+  if (component == nullptr) {
+    return 0;
+  }
+  Span<InstancedData> instanced_data = component->instanced_data();
+
+  /* Batches are created in the order in which the referenced data is first used. */
+  Map<const void *, int> batch_index_by_data;
+  Vector<InstancedData> batches_data;
+  Vector<int> batch_sizes;
+  Array<int> batch_index_by_instance(instanced_data.size());
+  for (const int i : instanced_data.index_range()) {
+    const InstancedData &data = instanced_data[i];
+    const void *data_pointer = (data.type == INSTANCE_DATA_TYPE_OBJECT) ?
+                                   (const void *)data.data.object :
+                                   (const void *)data.data.collection;
+    if (data_pointer == nullptr) {
+      batch_index_by_instance[i] = -1;
+      continue;
+    }
+    const int batch_index = batch_index_by_data.lookup_or_add_cb(data_pointer, [&]() {
+      batches_data.append(data);
+      batch_sizes.append(0);
+      return batches_data.size() - 1;
+    });
+    batch_index_by_instance[i] = batch_index;
+    batch_sizes[batch_index]++;
+  }
+
+  const int batches_amount = batches_data.size();
+  if (batches_amount == 0) {
+    return 0;
+  }
+  InstancesBatch *batches = (InstancesBatch *)MEM_calloc_arrayN(
+      batches_amount, sizeof(InstancesBatch), __func__);
+  for (const int batch_index : IndexRange(batches_amount)) {
+    InstancesBatch &batch = batches[batch_index];
+    batch.data = batches_data[batch_index];
+    batch.indices = (int *)MEM_malloc_arrayN(batch_sizes[batch_index], sizeof(int), __func__);
+    batch.matrices = (float(*)[4][4])MEM_malloc_arrayN(
+        batch_sizes[batch_index], sizeof(float[4][4]), __func__);
+  }
+  for (const int i : instanced_data.index_range()) {
+    const int batch_index = batch_index_by_instance[i];
+    if (batch_index != -1) {
+      InstancesBatch &batch = batches[batch_index];
+      batch.indices[batch.amount++] = i;
+    }
+  }
+
+  Span<float4x4> transforms = component->transforms();
+  for (const int batch_index : IndexRange(batches_amount)) {
+    InstancesBatch &batch = batches[batch_index];
+    blender::parallel_for(IndexRange(batch.amount), 4096, [&](IndexRange range) {
+      for (const int i : range) {
+        copy_m4_m4(batch.matrices[i], transforms[batch.indices[i]].values);
+      }
+    });
+  }
+
+  *r_batches = batches;
+  return batches_amount;
+}
+
+void BKE_geometry_set_instances_batches_free(InstancesBatch *batches, const int batches_amount)
+{
+  if (batches == nullptr) {
+    return;
+  }
+  for (const int batch_index : IndexRange(batches_amount)) {
+    MEM_freeN(batches[batch_index].indices);
+    MEM_freeN(batches[batch_index].matrices);
+  }
+  MEM_freeN(batches);
+}
+
 /** \} */
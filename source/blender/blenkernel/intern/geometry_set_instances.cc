@@ -0,0 +1,410 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bke
+ */
+
+#include "BLI_math_vector.h"
+#include "BLI_task.hh"
+
+#include "BKE_collection.h"
+#include "BKE_customdata.h"
+#include "BKE_geometry_set_instances.hh"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+#include "BKE_pointcloud.h"
+
+#include "DNA_collection_types.h"
+#include "DNA_layer_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+#include "DNA_pointcloud_types.h"
+
+#include "DEG_depsgraph_query.h"
+
+namespace blender::bke {
+
+/* Same limit as for the recursion of duplis, to avoid infinite recursion. */
+static constexpr int max_instance_depth = 8;
+/* Number of elements that are copied by one task. */
+static constexpr int64_t realize_grain_size = 4096;
+
+/* -------------------------------------------------------------------- */
+/** \name Gather Instances
+ * \{ */
+
+struct GatherInstancesContext {
+  /* Objects in instanced collections are filtered like for the dupli list. */
+  eEvaluationMode mode;
+  Vector<GeometryInstanceGroup> groups;
+  Map<const Object *, int> group_index_by_object;
+};
+
+/**
+ * Get the geometry of an evaluated object without its instances. The geometry is referenced,
+ * not copied. Besides the geometry set of the object, this uses the evaluated mesh, which is
+ * what mesh objects and curve objects that are converted to a mesh store their geometry in.
+ * Objects that are neither, e.g. meta-balls, don't have geometry that can be realized.
+ */
+static GeometrySet object_get_geometry_set_for_read(const Object &object)
+{
+  GeometrySet geometry_set;
+  if (object.runtime.geometry_set_eval != nullptr) {
+    geometry_set = *object.runtime.geometry_set_eval;
+    geometry_set.remove<InstancesComponent>();
+  }
+  if (!geometry_set.has_mesh()) {
+    Mesh *mesh = BKE_object_get_evaluated_mesh(const_cast<Object *>(&object));
+    if (mesh != nullptr) {
+      geometry_set.replace_mesh(mesh, GeometryOwnershipType::ReadOnly);
+    }
+  }
+  return geometry_set;
+}
+
+static void gather_instances_recursive(const InstancesComponent &component,
+                                       const Object *instancer,
+                                       const float4x4 &transform,
+                                       const int depth,
+                                       GatherInstancesContext &context);
+
+static void gather_collection_recursive(const Collection &collection,
+                                        const Object *instancer,
+                                        const float4x4 &transform,
+                                        const int depth,
+                                        GatherInstancesContext &context);
+
+static void gather_object_recursive(const Object &object,
+                                    const float4x4 &transform,
+                                    const int depth,
+                                    GatherInstancesContext &context)
+{
+  const int group_index = context.group_index_by_object.lookup_or_add_cb(&object, [&]() {
+    context.groups.append({object_get_geometry_set_for_read(object), {}});
+    return context.groups.size() - 1;
+  });
+  context.groups[group_index].transforms.append(transform);
+
+  /* Nested instances, see #make_recursive_duplis. */
+  if (object.runtime.geometry_set_eval != nullptr) {
+    const InstancesComponent *instances =
+        object.runtime.geometry_set_eval->get_component_for_read<InstancesComponent>();
+    if (instances != nullptr) {
+      gather_instances_recursive(*instances, &object, transform, depth + 1, context);
+    }
+  }
+  if ((object.transflag & OB_DUPLICOLLECTION) && object.instance_collection != nullptr) {
+    gather_collection_recursive(
+        *object.instance_collection, &object, transform, depth + 1, context);
+  }
+}
+
+static void gather_collection_recursive(const Collection &collection,
+                                        const Object *instancer,
+                                        const float4x4 &transform,
+                                        const int depth,
+                                        GatherInstancesContext &context)
+{
+  if (depth >= max_instance_depth) {
+    return;
+  }
+  float4x4 offset_matrix = float4x4::identity();
+  sub_v3_v3(offset_matrix.values[3], collection.instance_offset);
+  const float4x4 collection_transform = transform * offset_matrix;
+
+  /* Same objects as #make_duplis_collection. */
+  const eEvaluationMode mode = context.mode;
+  FOREACH_COLLECTION_VISIBLE_OBJECT_RECURSIVE_BEGIN (
+      const_cast<Collection *>(&collection), object, mode) {
+    if (object != instancer) {
+      gather_object_recursive(
+          *object, collection_transform * float4x4(object->obmat), depth, context);
+    }
+  }
+  FOREACH_COLLECTION_VISIBLE_OBJECT_RECURSIVE_END;
+}
+
+static void gather_instances_recursive(const InstancesComponent &component,
+                                       const Object *instancer,
+                                       const float4x4 &transform,
+                                       const int depth,
+                                       GatherInstancesContext &context)
+{
+  if (depth >= max_instance_depth) {
+    return;
+  }
+  Span<InstancedData> instanced_data = component.instanced_data();
+  Span<float4x4> instance_transforms = component.transforms();
+  for (const int i : instanced_data.index_range()) {
+    const InstancedData &data = instanced_data[i];
+    const float4x4 instance_transform = transform * instance_transforms[i];
+    if (data.type == INSTANCE_DATA_TYPE_OBJECT) {
+      if (data.data.object != nullptr) {
+        gather_object_recursive(*data.data.object, instance_transform, depth, context);
+      }
+    }
+    else if (data.type == INSTANCE_DATA_TYPE_COLLECTION) {
+      if (data.data.collection != nullptr) {
+        gather_collection_recursive(
+            *data.data.collection, instancer, instance_transform, depth, context);
+      }
+    }
+  }
+}
+
+Vector<GeometryInstanceGroup> geometry_set_gather_instances(const GeometrySet &geometry_set,
+                                                            const Object *instancer,
+                                                            const eEvaluationMode mode)
+{
+  GatherInstancesContext context;
+  context.mode = mode;
+
+  GeometrySet root_geometry = geometry_set;
+  root_geometry.remove<InstancesComponent>();
+  context.groups.append({std::move(root_geometry), {float4x4::identity()}});
+
+  const InstancesComponent *instances = geometry_set.get_component_for_read<InstancesComponent>();
+  if (instances != nullptr) {
+    gather_instances_recursive(*instances, instancer, float4x4::identity(), 0, context);
+  }
+  return std::move(context.groups);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Realize Instances
+ * \{ */
+
+struct MeshInstance {
+  const Mesh *mesh;
+  const float4x4 *transform;
+  int vert_offset;
+  int edge_offset;
+  int loop_offset;
+  int poly_offset;
+};
+
+static Mesh *join_mesh_instances(Span<GeometryInstanceGroup> groups)
+{
+  /* Compute the offsets of all instances first, so that they can be copied in parallel. The
+   * instances of the same mesh are next to each other, so the source data is still in the cache
+   * when the next instance is copied. */
+  Vector<const Mesh *> meshes;
+  Vector<MeshInstance> instances;
+  int totvert = 0, totedge = 0, totloop = 0, totpoly = 0;
+  for (const GeometryInstanceGroup &group : groups) {
+    const Mesh *mesh = group.geometry_set.get_mesh_for_read();
+    if (mesh == nullptr) {
+      continue;
+    }
+    meshes.append(mesh);
+    for (const float4x4 &transform : group.transforms) {
+      instances.append({mesh, &transform, totvert, totedge, totloop, totpoly});
+      totvert += mesh->totvert;
+      totedge += mesh->totedge;
+      totloop += mesh->totloop;
+      totpoly += mesh->totpoly;
+    }
+  }
+  if (instances.is_empty()) {
+    return nullptr;
+  }
+
+  Mesh *new_mesh = BKE_mesh_new_nomain_from_template(
+      meshes[0], totvert, totedge, 0, totloop, totpoly);
+  /* Add the layers that only exist on the other meshes. */
+  for (const Mesh *mesh : meshes.as_span().drop_front(1)) {
+    CustomData_merge(&mesh->vdata, &new_mesh->vdata, CD_MASK_MESH.vmask, CD_CALLOC, totvert);
+    CustomData_merge(&mesh->edata, &new_mesh->edata, CD_MASK_MESH.emask, CD_CALLOC, totedge);
+    CustomData_merge(&mesh->ldata, &new_mesh->ldata, CD_MASK_MESH.lmask, CD_CALLOC, totloop);
+    CustomData_merge(&mesh->pdata, &new_mesh->pdata, CD_MASK_MESH.pmask, CD_CALLOC, totpoly);
+  }
+  BKE_mesh_update_customdata_pointers(new_mesh, false);
+
+  parallel_for(instances.index_range(), 1, [&](IndexRange instance_range) {
+    for (const int instance_index : instance_range) {
+      const MeshInstance &instance = instances[instance_index];
+      const Mesh &mesh = *instance.mesh;
+      const float4x4 &transform = *instance.transform;
+
+      parallel_for(IndexRange(mesh.totvert), realize_grain_size, [&](IndexRange range) {
+        const int dst_start = instance.vert_offset + range.start();
+        CustomData_copy_data_named(
+            &mesh.vdata, &new_mesh->vdata, range.start(), dst_start, range.size());
+        for (MVert &vert : MutableSpan(new_mesh->mvert + dst_start, range.size())) {
+          copy_v3_v3(vert.co, transform * float3(vert.co));
+        }
+      });
+      parallel_for(IndexRange(mesh.totedge), realize_grain_size, [&](IndexRange range) {
+        const int dst_start = instance.edge_offset + range.start();
+        CustomData_copy_data_named(
+            &mesh.edata, &new_mesh->edata, range.start(), dst_start, range.size());
+        for (MEdge &edge : MutableSpan(new_mesh->medge + dst_start, range.size())) {
+          edge.v1 += instance.vert_offset;
+          edge.v2 += instance.vert_offset;
+        }
+      });
+      parallel_for(IndexRange(mesh.totloop), realize_grain_size, [&](IndexRange range) {
+        const int dst_start = instance.loop_offset + range.start();
+        CustomData_copy_data_named(
+            &mesh.ldata, &new_mesh->ldata, range.start(), dst_start, range.size());
+        for (MLoop &loop : MutableSpan(new_mesh->mloop + dst_start, range.size())) {
+          loop.v += instance.vert_offset;
+          loop.e += instance.edge_offset;
+        }
+      });
+      parallel_for(IndexRange(mesh.totpoly), realize_grain_size, [&](IndexRange range) {
+        const int dst_start = instance.poly_offset + range.start();
+        CustomData_copy_data_named(
+            &mesh.pdata, &new_mesh->pdata, range.start(), dst_start, range.size());
+        for (MPoly &poly : MutableSpan(new_mesh->mpoly + dst_start, range.size())) {
+          poly.loopstart += instance.loop_offset;
+        }
+      });
+    }
+  });
+
+  /* The copied normals are not transformed. */
+  BKE_mesh_calc_normals(new_mesh);
+  return new_mesh;
+}
+
+struct PointCloudInstance {
+  const PointCloud *pointcloud;
+  const float4x4 *transform;
+  int point_offset;
+};
+
+static PointCloud *join_pointcloud_instances(Span<GeometryInstanceGroup> groups)
+{
+  Vector<const PointCloud *> pointclouds;
+  Vector<PointCloudInstance> instances;
+  int totpoint = 0;
+  for (const GeometryInstanceGroup &group : groups) {
+    const PointCloud *pointcloud = group.geometry_set.get_pointcloud_for_read();
+    if (pointcloud == nullptr) {
+      continue;
+    }
+    pointclouds.append(pointcloud);
+    for (const float4x4 &transform : group.transforms) {
+      instances.append({pointcloud, &transform, totpoint});
+      totpoint += pointcloud->totpoint;
+    }
+  }
+  if (instances.is_empty()) {
+    return nullptr;
+  }
+
+  PointCloud *new_pointcloud = BKE_pointcloud_new_nomain(totpoint);
+  for (const PointCloud *pointcloud : pointclouds) {
+    CustomData_merge(&pointcloud->pdata, &new_pointcloud->pdata, CD_MASK_ALL, CD_CALLOC, totpoint);
+  }
+  BKE_pointcloud_update_customdata_pointers(new_pointcloud);
+
+  parallel_for(instances.index_range(), 1, [&](IndexRange instance_range) {
+    for (const int instance_index : instance_range) {
+      const PointCloudInstance &instance = instances[instance_index];
+      const PointCloud &pointcloud = *instance.pointcloud;
+      const float4x4 &transform = *instance.transform;
+
+      parallel_for(IndexRange(pointcloud.totpoint), realize_grain_size, [&](IndexRange range) {
+        const int dst_start = instance.point_offset + range.start();
+        CustomData_copy_data_named(
+            &pointcloud.pdata, &new_pointcloud->pdata, range.start(), dst_start, range.size());
+        for (const int i : IndexRange(dst_start, range.size())) {
+          copy_v3_v3(new_pointcloud->co[i], transform * float3(new_pointcloud->co[i]));
+        }
+      });
+    }
+  });
+
+  return new_pointcloud;
+}
+
+GeometrySet geometry_set_realize_instances(const GeometrySet &geometry_set,
+                                           const Object *instancer,
+                                           const eEvaluationMode mode)
+{
+  if (!geometry_set.has_instances()) {
+    return geometry_set;
+  }
+
+  Vector<GeometryInstanceGroup> groups = geometry_set_gather_instances(
+      geometry_set, instancer, mode);
+
+  /* Start from the geometry that is not instanced, so that components which are not joined
+   * with the instanced geometry are kept. */
+  GeometrySet new_geometry_set = groups[0].geometry_set;
+  Mesh *mesh = join_mesh_instances(groups);
+  if (mesh != nullptr) {
+    new_geometry_set.replace_mesh(mesh);
+  }
+  PointCloud *pointcloud = join_pointcloud_instances(groups);
+  if (pointcloud != nullptr) {
+    new_geometry_set.replace_pointcloud(pointcloud);
+  }
+  return new_geometry_set;
+}
+
+/** \} */
+
+}  // namespace blender::bke
+
+/* -------------------------------------------------------------------- */
+/** \name C API
+ * \{ */
+
+static Mesh *geometry_set_take_mesh(GeometrySet &geometry_set)
+{
+  if (!geometry_set.has_mesh()) {
+    return nullptr;
+  }
+  MeshComponent &component = geometry_set.get_component_for_write<MeshComponent>();
+  /* Makes a copy when the mesh is not owned by the component. */
+  component.get_for_write();
+  return component.release();
+}
+
+Mesh *BKE_geometry_set_to_mesh(const GeometrySet *geometry_set)
+{
+  GeometrySet geometry_set_copy = *geometry_set;
+  return geometry_set_take_mesh(geometry_set_copy);
+}
+
+Mesh *BKE_geometry_set_realize_instances_to_mesh(Depsgraph *depsgraph,
+                                                 const Object *object,
+                                                 Mesh *mesh)
+{
+  const GeometrySet *geometry_set_eval = object->runtime.geometry_set_eval;
+  if (geometry_set_eval == nullptr || !geometry_set_eval->has_instances()) {
+    return mesh;
+  }
+
+  GeometrySet geometry_set;
+  if (mesh != nullptr) {
+    geometry_set.replace_mesh(mesh);
+  }
+  geometry_set.add(*geometry_set_eval->get_component_for_read<InstancesComponent>());
+
+  GeometrySet realized = blender::bke::geometry_set_realize_instances(
+      geometry_set, object, DEG_get_mode(depsgraph));
+  return geometry_set_take_mesh(realized);
+}
+
+/** \} */
@@ -0,0 +1,76 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include "BKE_geometry_set_instances.hh"
+#include "BKE_idtype.h"
+#include "BKE_mesh.h"
+
+#include "BLI_math_vector.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+
+namespace blender::bke::tests {
+
+static GeometrySet create_single_vertex_geometry()
+{
+  Mesh *mesh = BKE_mesh_new_nomain(1, 0, 0, 0, 0);
+  zero_v3(mesh->mvert[0].co);
+  return GeometrySet::create_with_mesh(mesh);
+}
+
+TEST(geometry_set_instances, RealizeNestedInstances)
+{
+  /* Meshes are freed as IDs. */
+  BKE_idtype_init();
+
+  /* Object B only has a vertex, object A has a vertex and an instance of B. */
+  Object ob_b = {{nullptr}};
+  ob_b.type = OB_MESH;
+  ob_b.runtime.geometry_set_eval = new GeometrySet(create_single_vertex_geometry());
+
+  Object ob_a = {{nullptr}};
+  ob_a.type = OB_MESH;
+  GeometrySet *geometry_a = new GeometrySet(create_single_vertex_geometry());
+  geometry_a->get_component_for_write<InstancesComponent>().add_instance(&ob_b, {0, 10, 0});
+  ob_a.runtime.geometry_set_eval = geometry_a;
+
+  /* The root geometry has a vertex and two instances of A. */
+  GeometrySet root = create_single_vertex_geometry();
+  InstancesComponent &instances = root.get_component_for_write<InstancesComponent>();
+  instances.add_instance(&ob_a, {1, 0, 0});
+  instances.add_instance(&ob_a, {2, 0, 0});
+
+  GeometrySet realized = geometry_set_realize_instances(root, nullptr, DAG_EVAL_VIEWPORT);
+  EXPECT_FALSE(realized.has_instances());
+
+  const Mesh *mesh = realized.get_mesh_for_read();
+  ASSERT_NE(mesh, nullptr);
+  /* The geometry of the same object is next to each other, in the order of its instances. */
+  const float3 expected_positions[5] = {
+      {0, 0, 0}, {1, 0, 0}, {2, 0, 0}, {1, 10, 0}, {2, 10, 0}};
+  ASSERT_EQ(mesh->totvert, 5);
+  for (const int i : IndexRange(5)) {
+    EXPECT_V3_NEAR(mesh->mvert[i].co, expected_positions[i], 1e-6f);
+  }
+
+  delete ob_a.runtime.geometry_set_eval;
+  delete ob_b.runtime.geometry_set_eval;
+}
+
+}  // namespace blender::bke::tests
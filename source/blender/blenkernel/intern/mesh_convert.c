@@ -40,6 +40,7 @@
 #include "BKE_DerivedMesh.h"
 #include "BKE_displist.h"
 #include "BKE_editmesh.h"
+#include "BKE_geometry_set.h"
 #include "BKE_key.h"
 #include "BKE_lib_id.h"
 #include "BKE_lib_query.h"
@@ -1229,6 +1230,25 @@ static Mesh *mesh_new_from_mesh_object(Depsgraph *depsgraph,
   return mesh_new_from_mesh(object, mesh_input);
 }
 
+static Mesh *mesh_new_from_geometry_set_object(Object *object)
+{
+  /* Only evaluated objects have a geometry set, the original data can't be converted. */
+  if (object->runtime.geometry_set_eval == NULL) {
+    return NULL;
+  }
+  /* Instances are not realized, like for all other object types they are part of the dupli list
+   * (e.g. `depsgraph.object_instances`), so exporters would get them twice otherwise. See
+   * #BKE_object_to_mesh for exporters that want them realized. */
+  Mesh *mesh_result = BKE_geometry_set_to_mesh(object->runtime.geometry_set_eval);
+  if (mesh_result != NULL) {
+    /* Only copy the name, the ID code has to stay the one of a mesh. */
+    BLI_strncpy(mesh_result->id.name + 2,
+                ((ID *)object->data)->name + 2,
+                sizeof(mesh_result->id.name) - 2);
+  }
+  return mesh_result;
+}
+
 Mesh *BKE_mesh_new_from_object(Depsgraph *depsgraph, Object *object, bool preserve_all_data_layers)
 {
   Mesh *new_mesh = NULL;
@@ -1244,6 +1264,9 @@ Mesh *BKE_mesh_new_from_object(Depsgraph *depsgraph, Object *object, bool preser
     case OB_MESH:
       new_mesh = mesh_new_from_mesh_object(depsgraph, object, preserve_all_data_layers);
       break;
+    case OB_POINTCLOUD:
+      new_mesh = mesh_new_from_geometry_set_object(object);
+      break;
     default:
       /* Object does not have geometry data. */
       return NULL;
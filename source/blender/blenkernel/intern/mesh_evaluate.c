@@ -41,8 +41,10 @@
 #include "BLI_math.h"
 #include "BLI_memarena.h"
 #include "BLI_polyfill_2d.h"
+#include "BLI_sort_utils.h"
 #include "BLI_stack.h"
 #include "BLI_task.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_customdata.h"
@@ -206,6 +208,66 @@ void BKE_mesh_calc_normals_mapping_ex(MVert *mverts,
   fnors = pnors = NULL;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Vertex to Loop Map
+ * \{ */
+
+typedef struct MeshVertLoopsMapData {
+  const MLoop *mloop;
+  int *vert_loop_ends;
+  int *vert_loops;
+} MeshVertLoopsMapData;
+
+static void mesh_vert_loops_map_count_cb(void *__restrict userdata,
+                                         const int lidx,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MeshVertLoopsMapData *data = userdata;
+  atomic_add_and_fetch_int32(&data->vert_loop_ends[data->mloop[lidx].v], 1);
+}
+
+static void mesh_vert_loops_map_fill_cb(void *__restrict userdata,
+                                        const int lidx,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MeshVertLoopsMapData *data = userdata;
+  const int index = atomic_fetch_and_add_int32(&data->vert_loop_ends[data->mloop[lidx].v], 1);
+  data->vert_loops[index] = lidx;
+}
+
+/**
+ * Build the loops of each vertex in parallel. The loops of vertex `v` are
+ * `r_vert_loops[v ? r_vert_loop_ends[v - 1] : 0]` until `r_vert_loop_ends[v]`. Slots are
+ * reserved atomically, so the loops of a vertex are in no particular order.
+ */
+static void mesh_vert_loops_map_build(const MLoop *mloop,
+                                      const int numVerts,
+                                      const int numLoops,
+                                      int *r_vert_loop_ends,
+                                      int *r_vert_loops,
+                                      const TaskParallelSettings *settings)
+{
+  MeshVertLoopsMapData data = {
+      .mloop = mloop,
+      .vert_loop_ends = r_vert_loop_ends,
+      .vert_loops = r_vert_loops,
+  };
+
+  memset(r_vert_loop_ends, 0, sizeof(*r_vert_loop_ends) * (size_t)numVerts);
+  BLI_task_parallel_range(0, numLoops, &data, mesh_vert_loops_map_count_cb, settings);
+
+  /* Turn the counts into start offsets, filling the loops moves them to the end offsets. */
+  int offset = 0;
+  for (int vidx = 0; vidx < numVerts; vidx++) {
+    const int count = r_vert_loop_ends[vidx];
+    r_vert_loop_ends[vidx] = offset;
+    offset += count;
+  }
+  BLI_task_parallel_range(0, numLoops, &data, mesh_vert_loops_map_fill_cb, settings);
+}
+
+/** \} */
+
 typedef struct MeshCalcNormalsData {
   const MPoly *mpolys;
   const MLoop *mloop;
@@ -213,6 +275,9 @@ typedef struct MeshCalcNormalsData {
   float (*pnors)[3];
   float (*lnors_weighted)[3];
   float (*vnors)[3];
+  /* Loops of each vertex, see #mesh_vert_loops_map_build. */
+  int *vert_loop_ends;
+  int *vert_loops;
 } MeshCalcNormalsData;
 
 static void mesh_calc_normals_poly_cb(void *__restrict userdata,
@@ -288,6 +353,24 @@ static void mesh_calc_normals_poly_prepare_cb(void *__restrict userdata,
   }
 }
 
+/* Sort the loops of a vertex. Most vertices only have a few loops, insertion sort is fastest for
+ * those, but vertices with many loops (e.g. the poles of a UV sphere) must not be quadratic. */
+static void mesh_calc_normals_vert_loops_sort(int *loops, const int loops_len)
+{
+  if (loops_len > 16) {
+    qsort(loops, (size_t)loops_len, sizeof(*loops), BLI_sortutil_cmp_int);
+    return;
+  }
+  for (int i = 1; i < loops_len; i++) {
+    const int lidx = loops[i];
+    int j = i;
+    for (; j > 0 && loops[j - 1] > lidx; j--) {
+      loops[j] = loops[j - 1];
+    }
+    loops[j] = lidx;
+  }
+}
+
 static void mesh_calc_normals_poly_finalize_cb(void *__restrict userdata,
                                                const int vidx,
                                                const TaskParallelTLS *__restrict UNUSED(tls))
@@ -297,6 +380,18 @@ static void mesh_calc_normals_poly_finalize_cb(void *__restrict userdata,
   MVert *mv = &data->mverts[vidx];
   float *no = data->vnors[vidx];
 
+  if (data->vert_loops) {
+    /* Sort the loops so that the sum does not depend on threading, this also gives the same
+     * result as scattering the loops in order. */
+    int *loops = &data->vert_loops[vidx ? data->vert_loop_ends[vidx - 1] : 0];
+    const int loops_len = (int)(&data->vert_loops[data->vert_loop_ends[vidx]] - loops);
+    mesh_calc_normals_vert_loops_sort(loops, loops_len);
+    zero_v3(no);
+    for (int i = 0; i < loops_len; i++) {
+      add_v3_v3(no, data->lnors_weighted[loops[i]]);
+    }
+  }
+
   if (UNLIKELY(normalize_v3(no) == 0.0f)) {
     /* following Mesh convention; we use vertex coordinate itself for normal in this case */
     normalize_v3_v3(no, mv->co);
@@ -363,16 +458,30 @@ void BKE_mesh_calc_normals_poly(MVert *mverts,
   BLI_task_parallel_range(0, numPolys, &data, mesh_calc_normals_poly_prepare_cb, &settings);
 
   /* Actually accumulate weighted loop normals into vertex ones. */
-  /* Unfortunately, not possible to thread that
-   * (not in a reasonable, totally lock- and barrier-free fashion),
-   * since several loops will point to the same vertex... */
-  for (int lidx = 0; lidx < numLoops; lidx++) {
-    add_v3_v3(vnors[mloop[lidx].v], data.lnors_weighted[lidx]);
+  /* Gathering only pays off when the vertices are actually split over several threads, otherwise
+   * building the loops of each vertex is pure overhead compared to scattering them. */
+  const bool use_gather = BLI_system_thread_count() > 1 &&
+                          numVerts >= 2 * settings.min_iter_per_thread;
+  if (!use_gather) {
+    for (int lidx = 0; lidx < numLoops; lidx++) {
+      add_v3_v3(vnors[mloop[lidx].v], data.lnors_weighted[lidx]);
+    }
+  }
+  else {
+    /* Several loops point to the same vertex, so gather them per vertex while finalizing. */
+    data.vert_loop_ends = MEM_malloc_arrayN((size_t)numVerts, sizeof(int), __func__);
+    data.vert_loops = MEM_malloc_arrayN((size_t)numLoops, sizeof(int), __func__);
+    mesh_vert_loops_map_build(
+        mloop, numVerts, numLoops, data.vert_loop_ends, data.vert_loops, &settings);
   }
 
   /* Normalize and validate computed vertex normals. */
   BLI_task_parallel_range(0, numVerts, &data, mesh_calc_normals_poly_finalize_cb, &settings);
 
+  if (data.vert_loops) {
+    MEM_freeN(data.vert_loop_ends);
+    MEM_freeN(data.vert_loops);
+  }
   if (free_vnors) {
     MEM_freeN(vnors);
   }
@@ -810,6 +919,7 @@ typedef struct LoopSplitTaskDataCommon {
   int *loop_to_poly;
   const float (*polynors)[3];
 
+  int numVerts;
   int numEdges;
   int numLoops;
   int numPolys;
@@ -1312,54 +1422,70 @@ static void loop_split_worker_do(LoopSplitTaskDataCommon *common_data,
   }
 }
 
-static void loop_split_worker(TaskPool *__restrict pool, void *taskdata)
-{
-  LoopSplitTaskDataCommon *common_data = BLI_task_pool_user_data(pool);
-  LoopSplitTaskData *data = taskdata;
-
+typedef struct LoopSplitTaskTLS {
   /* Temp edge vectors stack, only used when computing lnor spacearr. */
-  BLI_Stack *edge_vectors = common_data->lnors_spacearr ?
-                                BLI_stack_new(sizeof(float[3]), __func__) :
-                                NULL;
-
-#ifdef DEBUG_TIME
-  TIMEIT_START_AVERAGED(loop_split_worker);
-#endif
-
-  for (int i = 0; i < LOOP_SPLIT_TASK_BLOCK_SIZE; i++, data++) {
-    /* A NULL ml_curr is used to tag ended data! */
-    if (data->ml_curr == NULL) {
-      break;
-    }
+  BLI_Stack *edge_vectors;
+} LoopSplitTaskTLS;
+
+typedef struct LoopSplitGeneratorData {
+  LoopSplitTaskDataCommon *common_data;
+  /* Loops of each vertex, see #mesh_vert_loops_map_build. */
+  int *vert_loop_ends;
+  int *vert_loops;
+  /* Whether each loop is the entry point of a 'single' or 'fan' task. */
+  bool *loop_is_entry;
+  /* Whether each loop has been walked while looking for the entry points of smooth fans. */
+  bool *loop_walked;
+  LoopSplitTaskData *tasks;
+} LoopSplitGeneratorData;
+
+static void loop_split_worker(void *__restrict userdata,
+                              const int task_index,
+                              const TaskParallelTLS *__restrict tls)
+{
+  LoopSplitGeneratorData *data = userdata;
+  LoopSplitTaskDataCommon *common_data = data->common_data;
+  LoopSplitTaskTLS *task_tls = tls->userdata_chunk;
 
-    loop_split_worker_do(common_data, data, edge_vectors);
+  if (common_data->lnors_spacearr && task_tls->edge_vectors == NULL) {
+    task_tls->edge_vectors = BLI_stack_new(sizeof(float[3]), __func__);
   }
 
-  if (edge_vectors) {
-    BLI_stack_free(edge_vectors);
-  }
+  loop_split_worker_do(common_data, &data->tasks[task_index], task_tls->edge_vectors);
+}
 
-#ifdef DEBUG_TIME
-  TIMEIT_END_AVERAGED(loop_split_worker);
-#endif
+static void loop_split_worker_free(const void *__restrict UNUSED(userdata),
+                                   void *__restrict chunk)
+{
+  LoopSplitTaskTLS *task_tls = chunk;
+  if (task_tls->edge_vectors) {
+    BLI_stack_free(task_tls->edge_vectors);
+  }
 }
 
 /**
- * Check whether given loop is part of an unknown-so-far cyclic smooth fan, or not.
- * Needed because cyclic smooth fans have no obvious 'entry point',
- * and yet we need to walk them once, and only once.
+ * Walk the smooth fan of a loop between two smooth edges, tagging the walked loops in
+ * \a loop_walked, and return whether it is a cyclic smooth fan. In that case, \a r_entry_index is
+ * the first of its loops in poly order.
+ *
+ * Fans delimited by sharp edges are walked from the loop using the sharp edge as its current one,
+ * so none of their loops between two smooth edges is an entry point. Cyclic smooth fans have no
+ * obvious 'entry point', they are walked from the first of their loops in poly order. Each loop
+ * is walked at most once, since walking stops at loops that have been walked before.
  */
-static bool loop_split_generator_check_cyclic_smooth_fan(const MLoop *mloops,
-                                                         const MPoly *mpolys,
-                                                         const int (*edge_to_loops)[2],
-                                                         const int *loop_to_poly,
-                                                         const int *e2l_prev,
-                                                         BLI_bitmap *skip_loops,
-                                                         const MLoop *ml_curr,
-                                                         const MLoop *ml_prev,
-                                                         const int ml_curr_index,
-                                                         const int ml_prev_index,
-                                                         const int mp_curr_index)
+static bool loop_split_generator_walk_smooth_fan(const MLoop *mloops,
+                                                 const MPoly *mpolys,
+                                                 const int (*edge_to_loops)[2],
+                                                 const int *loop_to_poly,
+                                                 const int numLoops,
+                                                 const int *e2l_prev,
+                                                 const MLoop *ml_curr,
+                                                 const MLoop *ml_prev,
+                                                 const int ml_curr_index,
+                                                 const int ml_prev_index,
+                                                 const int mp_curr_index,
+                                                 bool *loop_walked,
+                                                 int *r_entry_index)
 {
   const unsigned int mv_pivot_index = ml_curr->v; /* The vertex we are "fanning" around! */
   const int *e2lfan_curr;
@@ -1368,11 +1494,6 @@ static bool loop_split_generator_check_cyclic_smooth_fan(const MLoop *mloops,
   int mlfan_curr_index, mlfan_vert_index, mpfan_curr_index;
 
   e2lfan_curr = e2l_prev;
-  if (IS_EDGE_SHARP(e2lfan_curr)) {
-    /* Sharp loop, so not a cyclic smooth fan... */
-    return false;
-  }
-
   mlfan_curr = ml_prev;
   mlfan_curr_index = ml_prev_index;
   mlfan_vert_index = ml_curr_index;
@@ -1382,10 +1503,13 @@ static bool loop_split_generator_check_cyclic_smooth_fan(const MLoop *mloops,
   BLI_assert(mlfan_vert_index >= 0);
   BLI_assert(mpfan_curr_index >= 0);
 
-  BLI_assert(!BLI_BITMAP_TEST(skip_loops, mlfan_vert_index));
-  BLI_BITMAP_ENABLE(skip_loops, mlfan_vert_index);
+  int entry_index = ml_curr_index;
+  int entry_poly_index = mp_curr_index;
+  loop_walked[ml_curr_index] = true;
 
-  while (true) {
+  /* A fan can't have more loops than the mesh, this only guards against endless walks on invalid
+   * geometry. */
+  for (int i = 0; i < numLoops; i++) {
     /* Find next loop of the smooth fan. */
     BKE_mesh_loop_manifold_fan_around_vert_next(mloops,
                                                 mpolys,
@@ -1403,30 +1527,94 @@ static bool loop_split_generator_check_cyclic_smooth_fan(const MLoop *mloops,
       /* Sharp loop/edge, so not a cyclic smooth fan... */
       return false;
     }
-    /* Smooth loop/edge... */
-    if (BLI_BITMAP_TEST(skip_loops, mlfan_vert_index)) {
-      if (mlfan_vert_index == ml_curr_index) {
-        /* We walked around a whole cyclic smooth fan without finding any already-processed loop,
-         * means we can use initial ml_curr/ml_prev edge as start for this smooth fan. */
-        return true;
-      }
-      /* ... already checked in some previous looping, we can abort. */
+    if (mlfan_vert_index == ml_curr_index) {
+      /* We walked around a whole cyclic smooth fan. */
+      *r_entry_index = entry_index;
+      return true;
+    }
+    if (loop_walked[mlfan_vert_index]) {
+      /* The rest of the fan has been walked before and it was not cyclic, we can abort. */
       return false;
     }
+    loop_walked[mlfan_vert_index] = true;
+    if (mpfan_curr_index < entry_poly_index ||
+        (mpfan_curr_index == entry_poly_index && mlfan_vert_index < entry_index)) {
+      entry_index = mlfan_vert_index;
+      entry_poly_index = mpfan_curr_index;
+    }
+  }
+  return false;
+}
+
+/**
+ * Find the loops of a vertex from which its smooth fans are walked. Fans only contain loops of
+ * their vertex, so all vertices are handled in parallel.
+ */
+static void loop_split_generator_fan_entries_cb(void *__restrict userdata,
+                                                const int mv_index,
+                                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  LoopSplitGeneratorData *data = userdata;
+  const LoopSplitTaskDataCommon *common_data = data->common_data;
+  const MLoop *mloops = common_data->mloops;
+  const MPoly *mpolys = common_data->mpolys;
+  const int(*edge_to_loops)[2] = common_data->edge_to_loops;
+  const int *loop_to_poly = common_data->loop_to_poly;
+
+  const int *vert_loops = &data->vert_loops[mv_index ? data->vert_loop_ends[mv_index - 1] : 0];
+  const int vert_loops_len = (int)(&data->vert_loops[data->vert_loop_ends[mv_index]] -
+                                   vert_loops);
 
-    /* ... we can skip it in future, and keep checking the smooth fan. */
-    BLI_BITMAP_ENABLE(skip_loops, mlfan_vert_index);
+  for (int i = 0; i < vert_loops_len; i++) {
+    const int ml_curr_index = vert_loops[i];
+    /* Either a 'single' loop, or the start of a fan ending on a sharp edge. */
+    data->loop_is_entry[ml_curr_index] = IS_EDGE_SHARP(edge_to_loops[mloops[ml_curr_index].e]);
+    data->loop_walked[ml_curr_index] = false;
+  }
+
+  /* Loops between two smooth edges are only entry points of cyclic smooth fans, which can't be
+   * told from the loop alone. */
+  for (int i = 0; i < vert_loops_len; i++) {
+    const int ml_curr_index = vert_loops[i];
+    if (data->loop_is_entry[ml_curr_index] || data->loop_walked[ml_curr_index]) {
+      continue;
+    }
+    const int mp_index = loop_to_poly[ml_curr_index];
+    const MPoly *mp = &mpolys[mp_index];
+    const int ml_prev_index = (ml_curr_index == mp->loopstart) ?
+                                  mp->loopstart + mp->totloop - 1 :
+                                  ml_curr_index - 1;
+    const int *e2l_prev = edge_to_loops[mloops[ml_prev_index].e];
+    if (IS_EDGE_SHARP(e2l_prev)) {
+      /* Walked from the loop at the other end of its fan. */
+      continue;
+    }
+    int entry_index;
+    if (loop_split_generator_walk_smooth_fan(mloops,
+                                             mpolys,
+                                             edge_to_loops,
+                                             loop_to_poly,
+                                             common_data->numLoops,
+                                             e2l_prev,
+                                             &mloops[ml_curr_index],
+                                             &mloops[ml_prev_index],
+                                             ml_curr_index,
+                                             ml_prev_index,
+                                             mp_index,
+                                             data->loop_walked,
+                                             &entry_index)) {
+      data->loop_is_entry[entry_index] = true;
+    }
   }
 }
 
-static void loop_split_generator(TaskPool *pool, LoopSplitTaskDataCommon *common_data)
+static void loop_split_generator(LoopSplitTaskDataCommon *common_data, const bool use_threading)
 {
   MLoopNorSpaceArray *lnors_spacearr = common_data->lnors_spacearr;
   float(*loopnors)[3] = common_data->loopnors;
 
   const MLoop *mloops = common_data->mloops;
   const MPoly *mpolys = common_data->mpolys;
-  const int *loop_to_poly = common_data->loop_to_poly;
   const int(*edge_to_loops)[2] = common_data->edge_to_loops;
   const int numLoops = common_data->numLoops;
   const int numPolys = common_data->numPolys;
@@ -1439,105 +1627,66 @@ static void loop_split_generator(TaskPool *pool, LoopSplitTaskDataCommon *common
   int ml_curr_index;
   int ml_prev_index;
 
-  BLI_bitmap *skip_loops = BLI_BITMAP_NEW(numLoops, __func__);
-
-  LoopSplitTaskData *data_buff = NULL;
-  int data_idx = 0;
-
-  /* Temp edge vectors stack, only used when computing lnor spacearr
-   * (and we are not multi-threading). */
-  BLI_Stack *edge_vectors = NULL;
+  LoopSplitGeneratorData data = {
+      .common_data = common_data,
+      .vert_loop_ends = MEM_malloc_arrayN((size_t)common_data->numVerts, sizeof(int), __func__),
+      .vert_loops = MEM_malloc_arrayN((size_t)numLoops, sizeof(int), __func__),
+      .loop_is_entry = MEM_malloc_arrayN((size_t)numLoops, sizeof(bool), __func__),
+      .loop_walked = MEM_malloc_arrayN((size_t)numLoops, sizeof(bool), __func__),
+  };
 
 #ifdef DEBUG_TIME
   TIMEIT_START_AVERAGED(loop_split_generator);
 #endif
 
-  if (!pool) {
-    if (lnors_spacearr) {
-      edge_vectors = BLI_stack_new(sizeof(float[3]), __func__);
-    }
+  /* We now know edges that can be smoothed (with their vector, and their two loops),
+   * and edges that will be hard! First find the loops from which each smooth fan is walked,
+   * this only reads the mesh and fans never span several vertices, so it is done for all
+   * vertices in parallel. */
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = use_threading;
+  settings.min_iter_per_thread = LOOP_SPLIT_TASK_BLOCK_SIZE;
+  mesh_vert_loops_map_build(
+      mloops, common_data->numVerts, numLoops, data.vert_loop_ends, data.vert_loops, &settings);
+  BLI_task_parallel_range(
+      0, common_data->numVerts, &data, loop_split_generator_fan_entries_cb, &settings);
+  MEM_freeN(data.vert_loop_ends);
+  MEM_freeN(data.vert_loops);
+  MEM_freeN(data.loop_walked);
+
+  int tasks_len = 0;
+  for (int i = 0; i < numLoops; i++) {
+    tasks_len += data.loop_is_entry[i];
   }
+  data.tasks = MEM_calloc_arrayN((size_t)tasks_len, sizeof(*data.tasks), __func__);
 
-  /* We now know edges that can be smoothed (with their vector, and their two loops),
-   * and edges that will be hard! Now, time to generate the normals.
-   */
+  /* Gather the tasks in poly order. Creating lnor spaces uses a memarena, which is not
+   * thread-safe, so this part remains serial, but it is only a linear pass over the loops. */
+  LoopSplitTaskData *task = data.tasks;
   for (mp = mpolys, mp_index = 0; mp_index < numPolys; mp++, mp_index++) {
-    float(*lnors)[3];
     const int ml_last_index = (mp->loopstart + mp->totloop) - 1;
     ml_curr_index = mp->loopstart;
     ml_prev_index = ml_last_index;
 
     ml_curr = &mloops[ml_curr_index];
     ml_prev = &mloops[ml_prev_index];
-    lnors = &loopnors[ml_curr_index];
-
-    for (; ml_curr_index <= ml_last_index; ml_curr++, ml_curr_index++, lnors++) {
-      const int *e2l_curr = edge_to_loops[ml_curr->e];
-      const int *e2l_prev = edge_to_loops[ml_prev->e];
-
-#if 0
-      printf("Checking loop %d / edge %u / vert %u (sharp edge: %d, skiploop: %d)...",
-             ml_curr_index,
-             ml_curr->e,
-             ml_curr->v,
-             IS_EDGE_SHARP(e2l_curr),
-             BLI_BITMAP_TEST_BOOL(skip_loops, ml_curr_index));
-#endif
-
-      /* A smooth edge, we have to check for cyclic smooth fan case.
-       * If we find a new, never-processed cyclic smooth fan, we can do it now using that loop/edge
-       * as 'entry point', otherwise we can skip it. */
-
-      /* Note: In theory, we could make loop_split_generator_check_cyclic_smooth_fan() store
-       * mlfan_vert_index'es and edge indexes in two stacks, to avoid having to fan again around
-       * the vert during actual computation of clnor & clnorspace. However, this would complicate
-       * the code, add more memory usage, and despite its logical complexity,
-       * loop_manifold_fan_around_vert_next() is quite cheap in term of CPU cycles,
-       * so really think it's not worth it. */
-      if (!IS_EDGE_SHARP(e2l_curr) && (BLI_BITMAP_TEST(skip_loops, ml_curr_index) ||
-                                       !loop_split_generator_check_cyclic_smooth_fan(mloops,
-                                                                                     mpolys,
-                                                                                     edge_to_loops,
-                                                                                     loop_to_poly,
-                                                                                     e2l_prev,
-                                                                                     skip_loops,
-                                                                                     ml_curr,
-                                                                                     ml_prev,
-                                                                                     ml_curr_index,
-                                                                                     ml_prev_index,
-                                                                                     mp_index))) {
-        //              printf("SKIPPING!\n");
-      }
-      else {
-        LoopSplitTaskData *data, data_local;
 
-        //              printf("PROCESSING!\n");
-
-        if (pool) {
-          if (data_idx == 0) {
-            data_buff = MEM_calloc_arrayN(
-                LOOP_SPLIT_TASK_BLOCK_SIZE, sizeof(*data_buff), __func__);
-          }
-          data = &data_buff[data_idx];
-        }
-        else {
-          data = &data_local;
-          memset(data, 0, sizeof(*data));
-        }
+    for (; ml_curr_index <= ml_last_index; ml_curr++, ml_curr_index++) {
+      if (data.loop_is_entry[ml_curr_index]) {
+        const int *e2l_curr = edge_to_loops[ml_curr->e];
+        const int *e2l_prev = edge_to_loops[ml_prev->e];
 
         if (IS_EDGE_SHARP(e2l_curr) && IS_EDGE_SHARP(e2l_prev)) {
-          data->lnor = lnors;
-          data->ml_curr = ml_curr;
-          data->ml_prev = ml_prev;
-          data->ml_curr_index = ml_curr_index;
+          task->lnor = &loopnors[ml_curr_index];
+          task->ml_curr = ml_curr;
+          task->ml_prev = ml_prev;
+          task->ml_curr_index = ml_curr_index;
 #if 0 /* Not needed for 'single' loop. */
-          data->ml_prev_index = ml_prev_index;
-          data->e2l_prev = NULL; /* Tag as 'single' task. */
+          task->ml_prev_index = ml_prev_index;
+          task->e2l_prev = NULL; /* Tag as 'single' task. */
 #endif
-          data->mp_index = mp_index;
-          if (lnors_spacearr) {
-            data->lnor_space = BKE_lnor_space_create(lnors_spacearr);
-          }
+          task->mp_index = mp_index;
         }
         /* We *do not need* to check/tag loops as already computed!
          * Due to the fact a loop only links to one of its two edges,
@@ -1550,46 +1699,36 @@ static void loop_split_generator(TaskPool *pool, LoopSplitTaskDataCommon *common
          */
         else {
 #if 0 /* Not needed for 'fan' loops. */
-          data->lnor = lnors;
+          task->lnor = &loopnors[ml_curr_index];
 #endif
-          data->ml_curr = ml_curr;
-          data->ml_prev = ml_prev;
-          data->ml_curr_index = ml_curr_index;
-          data->ml_prev_index = ml_prev_index;
-          data->e2l_prev = e2l_prev; /* Also tag as 'fan' task. */
-          data->mp_index = mp_index;
-          if (lnors_spacearr) {
-            data->lnor_space = BKE_lnor_space_create(lnors_spacearr);
-          }
-        }
-
-        if (pool) {
-          data_idx++;
-          if (data_idx == LOOP_SPLIT_TASK_BLOCK_SIZE) {
-            BLI_task_pool_push(pool, loop_split_worker, data_buff, true, NULL);
-            data_idx = 0;
-          }
+          task->ml_curr = ml_curr;
+          task->ml_prev = ml_prev;
+          task->ml_curr_index = ml_curr_index;
+          task->ml_prev_index = ml_prev_index;
+          task->e2l_prev = e2l_prev; /* Also tag as 'fan' task. */
+          task->mp_index = mp_index;
         }
-        else {
-          loop_split_worker_do(common_data, data, edge_vectors);
+        if (lnors_spacearr) {
+          task->lnor_space = BKE_lnor_space_create(lnors_spacearr);
         }
+        task++;
       }
 
       ml_prev = ml_curr;
       ml_prev_index = ml_curr_index;
     }
   }
+  BLI_assert(task == data.tasks + tasks_len);
 
-  /* Last block of data... Since it is calloc'ed and we use first NULL item as stopper,
-   * everything is fine. */
-  if (pool && data_idx) {
-    BLI_task_pool_push(pool, loop_split_worker, data_buff, true, NULL);
-  }
+  /* Now, time to generate the normals, each fan is independent from the others. */
+  LoopSplitTaskTLS tls = {NULL};
+  settings.userdata_chunk = &tls;
+  settings.userdata_chunk_size = sizeof(tls);
+  settings.func_free = loop_split_worker_free;
+  BLI_task_parallel_range(0, tasks_len, &data, loop_split_worker, &settings);
 
-  if (edge_vectors) {
-    BLI_stack_free(edge_vectors);
-  }
-  MEM_freeN(skip_loops);
+  MEM_freeN(data.tasks);
+  MEM_freeN(data.loop_is_entry);
 
 #ifdef DEBUG_TIME
   TIMEIT_END_AVERAGED(loop_split_generator);
@@ -1602,7 +1741,7 @@ static void loop_split_generator(TaskPool *pool, LoopSplitTaskDataCommon *common
  * (splitting edges).
  */
 void BKE_mesh_normals_loop_split(const MVert *mverts,
-                                 const int UNUSED(numVerts),
+                                 const int numVerts,
                                  MEdge *medges,
                                  const int numEdges,
                                  MLoop *mloops,
@@ -1702,6 +1841,7 @@ void BKE_mesh_normals_loop_split(const MVert *mverts,
       .edge_to_loops = edge_to_loops,
       .loop_to_poly = loop_to_poly,
       .polynors = polynors,
+      .numVerts = numVerts,
       .numEdges = numEdges,
       .numLoops = numLoops,
       .numPolys = numPolys,
@@ -1710,19 +1850,8 @@ void BKE_mesh_normals_loop_split(const MVert *mverts,
   /* This first loop check which edges are actually smooth, and compute edge vectors. */
   mesh_edges_sharp_tag(&common_data, check_angle, split_angle, false);
 
-  if (numLoops < LOOP_SPLIT_TASK_BLOCK_SIZE * 8) {
-    /* Not enough loops to be worth the whole threading overhead... */
-    loop_split_generator(NULL, &common_data);
-  }
-  else {
-    TaskPool *task_pool = BLI_task_pool_create(&common_data, TASK_PRIORITY_HIGH);
-
-    loop_split_generator(task_pool, &common_data);
-
-    BLI_task_pool_work_and_wait(task_pool);
-
-    BLI_task_pool_free(task_pool);
-  }
+  /* Not enough loops to be worth the whole threading overhead otherwise... */
+  loop_split_generator(&common_data, numLoops >= LOOP_SPLIT_TASK_BLOCK_SIZE * 8);
 
   MEM_freeN(edge_to_loops);
   if (!r_loop_to_poly) {
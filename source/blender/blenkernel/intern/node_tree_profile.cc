@@ -0,0 +1,100 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bke
+ */
+
+#include <mutex>
+#include <string>
+
+#include "BLI_map.hh"
+#include "BLI_string_ref.hh"
+
+#include "BKE_node_tree_profile.h"
+
+using blender::Map;
+using blender::StringRef;
+
+struct NodeTreeProfile {
+  /* Nodes are executed in parallel, so adding stats has to be synchronized. */
+  mutable std::mutex mutex;
+  Map<const bNodeTree *, Map<std::string, NodeProfileStats>> stats_by_tree;
+  float frame = 0.0f;
+  double total_time_ms = 0.0;
+};
+
+NodeTreeProfile *BKE_node_tree_profile_new(const float frame)
+{
+  NodeTreeProfile *profile = new NodeTreeProfile();
+  profile->frame = frame;
+  return profile;
+}
+
+void BKE_node_tree_profile_free(NodeTreeProfile *profile)
+{
+  delete profile;
+}
+
+void BKE_node_tree_profile_add(NodeTreeProfile *profile,
+                               const bNodeTree *ntree,
+                               const char *node_name,
+                               const NodeProfileStats *stats)
+{
+  std::lock_guard lock{profile->mutex};
+  Map<std::string, NodeProfileStats> &stats_by_node = profile->stats_by_tree.lookup_or_add_cb(
+      ntree, []() { return Map<std::string, NodeProfileStats>(); });
+  NodeProfileStats &node_stats = stats_by_node.lookup_or_add_cb_as(
+      StringRef(node_name), []() { return NodeProfileStats{0.0, 0, 0, 0}; });
+  node_stats.time_ms += stats->time_ms;
+  node_stats.elements_num += stats->elements_num;
+  node_stats.bytes += stats->bytes;
+  node_stats.executions_num += stats->executions_num;
+}
+
+void BKE_node_tree_profile_set_total_time(NodeTreeProfile *profile, const double time_ms)
+{
+  profile->total_time_ms = time_ms;
+}
+
+bool BKE_node_tree_profile_lookup(const NodeTreeProfile *profile,
+                                  const bNodeTree *ntree,
+                                  const char *node_name,
+                                  NodeProfileStats *r_stats)
+{
+  std::lock_guard lock{profile->mutex};
+  const Map<std::string, NodeProfileStats> *stats_by_node = profile->stats_by_tree.lookup_ptr(
+      ntree);
+  if (stats_by_node == nullptr) {
+    return false;
+  }
+  const NodeProfileStats *node_stats = stats_by_node->lookup_ptr_as(StringRef(node_name));
+  if (node_stats == nullptr) {
+    return false;
+  }
+  *r_stats = *node_stats;
+  return true;
+}
+
+float BKE_node_tree_profile_frame(const NodeTreeProfile *profile)
+{
+  return profile->frame;
+}
+
+double BKE_node_tree_profile_total_time(const NodeTreeProfile *profile)
+{
+  return profile->total_time_ms;
+}
@@ -5463,11 +5463,20 @@ void BKE_object_update_select_id(struct Main *bmain)
   }
 }
 
-Mesh *BKE_object_to_mesh(Depsgraph *depsgraph, Object *object, bool preserve_all_data_layers)
+Mesh *BKE_object_to_mesh(Depsgraph *depsgraph,
+                         Object *object,
+                         bool preserve_all_data_layers,
+                         bool realize_instances)
 {
   BKE_object_to_mesh_clear(object);
 
   Mesh *mesh = BKE_mesh_new_from_object(depsgraph, object, preserve_all_data_layers);
+  if (realize_instances) {
+    mesh = BKE_geometry_set_realize_instances_to_mesh(depsgraph, object, mesh);
+    if (mesh != NULL) {
+      BLI_strncpy(mesh->id.name + 2, ((ID *)object->data)->name + 2, sizeof(mesh->id.name) - 2);
+    }
+  }
   object->runtime.object_as_temp_mesh = mesh;
   return mesh;
 }
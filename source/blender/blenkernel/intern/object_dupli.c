@@ -813,62 +813,62 @@ static const DupliGenerator gen_dupli_verts_pointcloud = {
 
 static void make_duplis_instances_component(const DupliContext *ctx)
 {
-  float(*positions)[3];
-  float(*rotations)[3];
-  float(*scales)[3];
-  InstancedData *instanced_data;
-  const int amount = BKE_geometry_set_instances(
-      ctx->object->runtime.geometry_set_eval, &positions, &rotations, &scales, &instanced_data);
-
-  for (int i = 0; i < amount; i++) {
-    InstancedData *data = &instanced_data[i];
-
-    float scale_matrix[4][4];
-    size_to_mat4(scale_matrix, scales[i]);
-    float rotation_matrix[4][4];
-    eul_to_mat4(rotation_matrix, rotations[i]);
-    float instance_offset_matrix[4][4];
-    mul_m4_m4m4(instance_offset_matrix, rotation_matrix, scale_matrix);
-    copy_v3_v3(instance_offset_matrix[3], positions[i]);
-
-    if (data->type == INSTANCE_DATA_TYPE_OBJECT) {
-      Object *object = data->data.object;
-      if (object != NULL) {
+  /* The instances are grouped by the data they reference. Therefore, duplis of the same object
+   * are created one after another, which allows the draw manager to merge their draw calls into
+   * instanced draw calls and to reuse the per object data. */
+  InstancesBatch *batches;
+  const int batches_amount = BKE_geometry_set_instances_batches(
+      ctx->object->runtime.geometry_set_eval, &batches);
+
+  for (int batch_index = 0; batch_index < batches_amount; batch_index++) {
+    const InstancesBatch *batch = &batches[batch_index];
+
+    if (batch->data.type == INSTANCE_DATA_TYPE_OBJECT) {
+      Object *object = batch->data.data.object;
+      for (int i = 0; i < batch->amount; i++) {
+        const int id = batch->indices[i];
+        float(*instance_offset_matrix)[4] = batch->matrices[i];
+
         float matrix[4][4];
         mul_m4_m4m4(matrix, ctx->object->obmat, instance_offset_matrix);
-        make_dupli(ctx, object, matrix, i);
+        make_dupli(ctx, object, matrix, id);
 
         float space_matrix[4][4];
         mul_m4_m4m4(space_matrix, instance_offset_matrix, object->imat);
         mul_m4_m4_pre(space_matrix, ctx->object->obmat);
-        make_recursive_duplis(ctx, object, space_matrix, i);
+        make_recursive_duplis(ctx, object, space_matrix, id);
       }
     }
-    else if (data->type == INSTANCE_DATA_TYPE_COLLECTION) {
-      Collection *collection = data->data.collection;
-      if (collection != NULL) {
-        float collection_matrix[4][4];
-        unit_m4(collection_matrix);
-        sub_v3_v3(collection_matrix[3], collection->instance_offset);
-        mul_m4_m4_pre(collection_matrix, instance_offset_matrix);
-        mul_m4_m4_pre(collection_matrix, ctx->object->obmat);
-
-        eEvaluationMode mode = DEG_get_mode(ctx->depsgraph);
-        FOREACH_COLLECTION_VISIBLE_OBJECT_RECURSIVE_BEGIN (collection, object, mode) {
-          if (object == ctx->object) {
-            continue;
-          }
+    else if (batch->data.type == INSTANCE_DATA_TYPE_COLLECTION) {
+      Collection *collection = batch->data.data.collection;
+      eEvaluationMode mode = DEG_get_mode(ctx->depsgraph);
+      /* Iterate over the instances for every object in the collection, so that duplis of the
+       * same object stay next to each other. */
+      FOREACH_COLLECTION_VISIBLE_OBJECT_RECURSIVE_BEGIN (collection, object, mode) {
+        if (object == ctx->object) {
+          continue;
+        }
+        for (int i = 0; i < batch->amount; i++) {
+          const int id = batch->indices[i];
+
+          float collection_matrix[4][4];
+          unit_m4(collection_matrix);
+          sub_v3_v3(collection_matrix[3], collection->instance_offset);
+          mul_m4_m4_pre(collection_matrix, batch->matrices[i]);
+          mul_m4_m4_pre(collection_matrix, ctx->object->obmat);
 
           float instance_matrix[4][4];
           mul_m4_m4m4(instance_matrix, collection_matrix, object->obmat);
 
-          make_dupli(ctx, object, instance_matrix, i);
-          make_recursive_duplis(ctx, object, collection_matrix, i);
+          make_dupli(ctx, object, instance_matrix, id);
+          make_recursive_duplis(ctx, object, collection_matrix, id);
         }
-        FOREACH_COLLECTION_VISIBLE_OBJECT_RECURSIVE_END;
       }
+      FOREACH_COLLECTION_VISIBLE_OBJECT_RECURSIVE_END;
     }
   }
+
+  BKE_geometry_set_instances_batches_free(batches, batches_amount);
 }
 
 static const DupliGenerator gen_dupli_instances_component = {
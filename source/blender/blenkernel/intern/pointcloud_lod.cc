@@ -0,0 +1,279 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bke
+ *
+ * Level of detail hierarchy for point clouds.
+ *
+ * The points are sorted along a Morton curve, so that the points in every octree cell are
+ * contiguous. Going from the root to the leaves, every cell that does not contain a point of a
+ * coarser level yet picks one of its points at random. The level of a point is the depth of the
+ * cell that picked it. Ordering the points by level gives an array in which every level is a
+ * prefix that contains about one point per occupied cell, so drawing a prefix gives a subset with
+ * a roughly even spatial distribution.
+ */
+
+#include <algorithm>
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_pointcloud_types.h"
+
+#include "BLI_array.hh"
+#include "BLI_float3.hh"
+#include "BLI_hash.h"
+#include "BLI_math_vector.h"
+#include "BLI_task.hh"
+
+#include "BKE_pointcloud.h"
+
+using blender::Array;
+using blender::float3;
+using blender::IndexRange;
+using blender::MutableSpan;
+using blender::Span;
+
+/* Depth of the finest octree level, limited by the bits available in the Morton code. */
+static constexpr int lod_max_depth = 10;
+static constexpr int radix_bits = 10;
+static constexpr int radix_buckets = 1 << radix_bits;
+static constexpr int64_t chunk_size = 1 << 16;
+
+static uint32_t morton_spread_bits(uint32_t x)
+{
+  x &= 0x3ff;
+  x = (x | (x << 16)) & 0x030000ff;
+  x = (x | (x << 8)) & 0x0300f00f;
+  x = (x | (x << 4)) & 0x030c30c3;
+  x = (x | (x << 2)) & 0x09249249;
+  return x;
+}
+
+static IndexRange chunk_range(const int64_t chunk, const int64_t size)
+{
+  const int64_t start = chunk * chunk_size;
+  return IndexRange(start, std::min(chunk_size, size - start));
+}
+
+static void compute_bounds(Span<float3> positions, float3 &r_min, float3 &r_max)
+{
+  const int64_t chunks_num = (positions.size() + chunk_size - 1) / chunk_size;
+  Array<float3> chunk_min(chunks_num, float3(FLT_MAX));
+  Array<float3> chunk_max(chunks_num, float3(-FLT_MAX));
+  blender::parallel_for(IndexRange(chunks_num), 1, [&](IndexRange chunks) {
+    for (const int64_t chunk : chunks) {
+      for (const int64_t i : chunk_range(chunk, positions.size())) {
+        minmax_v3v3_v3(chunk_min[chunk], chunk_max[chunk], positions[i]);
+      }
+    }
+  });
+  r_min = float3(FLT_MAX);
+  r_max = float3(-FLT_MAX);
+  for (const int64_t chunk : IndexRange(chunks_num)) {
+    minmax_v3v3_v3(r_min, r_max, chunk_min[chunk]);
+    minmax_v3v3_v3(r_min, r_max, chunk_max[chunk]);
+  }
+}
+
+static void compute_morton_codes(Span<float3> positions,
+                                 const float3 &min,
+                                 const float3 &max,
+                                 MutableSpan<uint32_t> r_codes)
+{
+  const float3 size = max - min;
+  const float max_size = std::max({size.x, size.y, size.z});
+  const float scale = (max_size > 0.0f) ? (1 << lod_max_depth) / max_size : 0.0f;
+  auto quantize = [](const float value) {
+    return static_cast<uint32_t>(std::clamp(static_cast<int>(value), 0, (1 << lod_max_depth) - 1));
+  };
+  blender::parallel_for(positions.index_range(), 4096, [&](IndexRange range) {
+    for (const int64_t i : range) {
+      const float3 local = (positions[i] - min) * scale;
+      const uint32_t x = quantize(local.x);
+      const uint32_t y = quantize(local.y);
+      const uint32_t z = quantize(local.z);
+      r_codes[i] = morton_spread_bits(x) | (morton_spread_bits(y) << 1) |
+                   (morton_spread_bits(z) << 2);
+    }
+  });
+}
+
+/**
+ * Stable least significant digit radix sort of the indices by their codes. The histograms are
+ * built for every chunk separately, so that counting and scattering can run in parallel.
+ */
+static void sort_by_morton_code(MutableSpan<uint32_t> codes, MutableSpan<int> indices)
+{
+  const int64_t size = codes.size();
+  const int64_t chunks_num = (size + chunk_size - 1) / chunk_size;
+  Array<uint32_t> codes_tmp(size);
+  Array<int> indices_tmp(size);
+  Array<int64_t> offsets(chunks_num * radix_buckets);
+
+  MutableSpan<uint32_t> src_codes = codes;
+  MutableSpan<int> src_indices = indices;
+  MutableSpan<uint32_t> dst_codes = codes_tmp;
+  MutableSpan<int> dst_indices = indices_tmp;
+
+  const int passes_num = (3 * lod_max_depth + radix_bits - 1) / radix_bits;
+  for (const int pass : IndexRange(passes_num)) {
+    const int shift = pass * radix_bits;
+    offsets.fill(0);
+    blender::parallel_for(IndexRange(chunks_num), 1, [&](IndexRange chunks) {
+      for (const int64_t chunk : chunks) {
+        int64_t *histogram = &offsets[chunk * radix_buckets];
+        for (const int64_t i : chunk_range(chunk, size)) {
+          histogram[(src_codes[i] >> shift) & (radix_buckets - 1)]++;
+        }
+      }
+    });
+
+    /* Turn the histograms into the first destination index of every bucket in every chunk. */
+    int64_t offset = 0;
+    for (const int bucket : IndexRange(radix_buckets)) {
+      for (const int64_t chunk : IndexRange(chunks_num)) {
+        const int64_t count = offsets[chunk * radix_buckets + bucket];
+        offsets[chunk * radix_buckets + bucket] = offset;
+        offset += count;
+      }
+    }
+
+    blender::parallel_for(IndexRange(chunks_num), 1, [&](IndexRange chunks) {
+      for (const int64_t chunk : chunks) {
+        int64_t *chunk_offsets = &offsets[chunk * radix_buckets];
+        for (const int64_t i : chunk_range(chunk, size)) {
+          const int64_t dst = chunk_offsets[(src_codes[i] >> shift) & (radix_buckets - 1)]++;
+          dst_codes[dst] = src_codes[i];
+          dst_indices[dst] = src_indices[i];
+        }
+      }
+    });
+
+    std::swap(src_codes, dst_codes);
+    std::swap(src_indices, dst_indices);
+  }
+
+  if (src_codes.data() != codes.data()) {
+    codes.copy_from(src_codes);
+    indices.copy_from(src_indices);
+  }
+}
+
+/**
+ * Assign the level to the points in the cells of the given depth. The sorted array is split into
+ * chunks that are aligned to cell boundaries, so every cell is handled by exactly one thread.
+ */
+static void assign_level(Span<uint32_t> codes,
+                         Span<int> indices,
+                         const int depth,
+                         MutableSpan<int> levels)
+{
+  const int shift = 3 * (lod_max_depth - depth);
+  const int64_t size = codes.size();
+  auto cell_of = [&](const int64_t i) { return static_cast<uint64_t>(codes[i]) >> shift; };
+
+  blender::parallel_for(codes.index_range(), chunk_size, [&](IndexRange range) {
+    int64_t cell_start = range.start();
+    while (cell_start < range.one_after_last() && cell_start > 0 &&
+           cell_of(cell_start) == cell_of(cell_start - 1)) {
+      cell_start++;
+    }
+    while (cell_start < range.one_after_last()) {
+      const uint64_t cell = cell_of(cell_start);
+      int64_t cell_end = cell_start;
+      bool has_point = false;
+      int64_t best = -1;
+      uint32_t best_priority = 0;
+      for (; cell_end < size && cell_of(cell_end) == cell; cell_end++) {
+        if (levels[cell_end] < depth) {
+          has_point = true;
+        }
+        else {
+          const uint32_t priority = BLI_hash_int(static_cast<uint32_t>(indices[cell_end]));
+          if (best == -1 || priority < best_priority) {
+            best = cell_end;
+            best_priority = priority;
+          }
+        }
+      }
+      if (!has_point && best != -1) {
+        levels[best] = depth;
+      }
+      cell_start = cell_end;
+    }
+  });
+}
+
+PointCloudLOD *BKE_pointcloud_lod_build(const PointCloud *pointcloud)
+{
+  const int totpoint = pointcloud->totpoint;
+  if (totpoint == 0 || pointcloud->co == nullptr) {
+    return nullptr;
+  }
+  const Span<float3> positions{reinterpret_cast<const float3 *>(pointcloud->co), totpoint};
+
+  PointCloudLOD *lod = static_cast<PointCloudLOD *>(MEM_callocN(sizeof(PointCloudLOD), __func__));
+  float3 min, max;
+  compute_bounds(positions, min, max);
+  copy_v3_v3(lod->min, min);
+  copy_v3_v3(lod->max, max);
+
+  Array<uint32_t> codes(totpoint);
+  Array<int> sorted_indices(totpoint);
+  compute_morton_codes(positions, min, max, codes);
+  blender::parallel_for(IndexRange(totpoint), 4096, [&](IndexRange range) {
+    for (const int64_t i : range) {
+      sorted_indices[i] = static_cast<int>(i);
+    }
+  });
+  sort_by_morton_code(codes, sorted_indices);
+
+  /* Points that are not picked by any cell end up in an additional last level. */
+  const int levels_num = lod_max_depth + 2;
+  Array<int> levels(totpoint, levels_num - 1);
+  for (const int depth : IndexRange(lod_max_depth + 1)) {
+    assign_level(codes, sorted_indices, depth, levels);
+  }
+
+  /* Counting sort by level. Within a level the points stay in Morton order, which gives good
+   * memory locality when the buffers are filled. */
+  lod->levels_num = levels_num;
+  lod->level_sizes = static_cast<int *>(MEM_calloc_arrayN(levels_num, sizeof(int), __func__));
+  for (const int i : IndexRange(totpoint)) {
+    lod->level_sizes[levels[i]]++;
+  }
+  Array<int> level_offsets(levels_num);
+  int offset = 0;
+  for (const int level : IndexRange(levels_num)) {
+    level_offsets[level] = offset;
+    offset += lod->level_sizes[level];
+    lod->level_sizes[level] = offset;
+  }
+  lod->order = static_cast<int *>(MEM_malloc_arrayN(totpoint, sizeof(int), __func__));
+  for (const int i : IndexRange(totpoint)) {
+    lod->order[level_offsets[levels[i]]++] = sorted_indices[i];
+  }
+
+  return lod;
+}
+
+void BKE_pointcloud_lod_free(PointCloudLOD *lod)
+{
+  MEM_SAFE_FREE(lod->order);
+  MEM_SAFE_FREE(lod->level_sizes);
+  MEM_freeN(lod);
+}
@@ -38,6 +38,7 @@
 #include "BKE_subdiv.h"
 #include "BKE_subdiv_eval.h"
 
+#include "opensubdiv_capi_type.h"
 #include "opensubdiv_topology_refiner_capi.h"
 
 /* -------------------------------------------------------------------- */
@@ -176,27 +177,35 @@ typedef struct CCGEvalGridsData {
   SubdivCCGMaterialFlagsEvaluator *material_flags_evaluator;
 } CCGEvalGridsData;
 
-static void subdiv_ccg_eval_grid_element_limit(CCGEvalGridsData *data,
-                                               const int ptex_face_index,
-                                               const float u,
-                                               const float v,
-                                               unsigned char *element)
+/* Number of grid elements which are evaluated with a single call into the evaluator. */
+#define CCG_EVAL_BATCH_SIZE 256
+
+static void subdiv_ccg_eval_grid_elements_limit(CCGEvalGridsData *data,
+                                                const OpenSubdiv_PatchCoord *patch_coords,
+                                                const int num_elements,
+                                                unsigned char *elements)
 {
   Subdiv *subdiv = data->subdiv;
   SubdivCCG *subdiv_ccg = data->subdiv_ccg;
+  const int element_size = element_size_bytes_get(subdiv_ccg);
+  float P[CCG_EVAL_BATCH_SIZE][3], N[CCG_EVAL_BATCH_SIZE][3];
+  BLI_assert(num_elements <= CCG_EVAL_BATCH_SIZE);
   if (subdiv->displacement_evaluator != NULL) {
-    BKE_subdiv_eval_final_point(subdiv, ptex_face_index, u, v, (float *)element);
+    BKE_subdiv_eval_final_points(subdiv, patch_coords, num_elements, P);
   }
   else if (subdiv_ccg->has_normal) {
-    BKE_subdiv_eval_limit_point_and_normal(subdiv,
-                                           ptex_face_index,
-                                           u,
-                                           v,
-                                           (float *)element,
-                                           (float *)(element + subdiv_ccg->normal_offset));
+    BKE_subdiv_eval_limit_points_and_normals(subdiv, patch_coords, num_elements, P, N);
   }
   else {
-    BKE_subdiv_eval_limit_point(subdiv, ptex_face_index, u, v, (float *)element);
+    BKE_subdiv_eval_limit_points(subdiv, patch_coords, num_elements, P);
+  }
+  const bool copy_normals = subdiv->displacement_evaluator == NULL && subdiv_ccg->has_normal;
+  for (int i = 0; i < num_elements; i++) {
+    unsigned char *element = elements + (size_t)i * element_size;
+    copy_v3_v3((float *)element, P[i]);
+    if (copy_normals) {
+      copy_v3_v3((float *)(element + subdiv_ccg->normal_offset), N[i]);
+    }
   }
 }
 
@@ -219,14 +228,21 @@ static void subdiv_ccg_eval_grid_element_mask(CCGEvalGridsData *data,
   }
 }
 
-static void subdiv_ccg_eval_grid_element(CCGEvalGridsData *data,
-                                         const int ptex_face_index,
-                                         const float u,
-                                         const float v,
-                                         unsigned char *element)
+/* Evaluate consecutive elements of a grid, at most #CCG_EVAL_BATCH_SIZE of them. */
+static void subdiv_ccg_eval_grid_elements(CCGEvalGridsData *data,
+                                          const OpenSubdiv_PatchCoord *patch_coords,
+                                          const int num_elements,
+                                          unsigned char *elements)
 {
-  subdiv_ccg_eval_grid_element_limit(data, ptex_face_index, u, v, element);
-  subdiv_ccg_eval_grid_element_mask(data, ptex_face_index, u, v, element);
+  subdiv_ccg_eval_grid_elements_limit(data, patch_coords, num_elements, elements);
+  const int element_size = element_size_bytes_get(data->subdiv_ccg);
+  for (int i = 0; i < num_elements; i++) {
+    subdiv_ccg_eval_grid_element_mask(data,
+                                      patch_coords[i].ptex_face,
+                                      patch_coords[i].u,
+                                      patch_coords[i].v,
+                                      elements + (size_t)i * element_size);
+  }
 }
 
 static void subdiv_ccg_eval_regular_grid(CCGEvalGridsData *data, const int face_index)
@@ -234,24 +250,28 @@ static void subdiv_ccg_eval_regular_grid(CCGEvalGridsData *data, const int face_
   SubdivCCG *subdiv_ccg = data->subdiv_ccg;
   const int ptex_face_index = data->face_ptex_offset[face_index];
   const int grid_size = subdiv_ccg->grid_size;
+  const int grid_area = grid_size * grid_size;
   const float grid_size_1_inv = 1.0f / (grid_size - 1);
   const int element_size = element_size_bytes_get(subdiv_ccg);
   SubdivCCGFace *faces = subdiv_ccg->faces;
   SubdivCCGFace **grid_faces = subdiv_ccg->grid_faces;
   const SubdivCCGFace *face = &faces[face_index];
+  OpenSubdiv_PatchCoord patch_coords[CCG_EVAL_BATCH_SIZE];
   for (int corner = 0; corner < face->num_grids; corner++) {
     const int grid_index = face->start_grid_index + corner;
     unsigned char *grid = (unsigned char *)subdiv_ccg->grids[grid_index];
-    for (int y = 0; y < grid_size; y++) {
-      const float grid_v = y * grid_size_1_inv;
-      for (int x = 0; x < grid_size; x++) {
-        const float grid_u = x * grid_size_1_inv;
-        float u, v;
-        BKE_subdiv_rotate_grid_to_quad(corner, grid_u, grid_v, &u, &v);
-        const size_t grid_element_index = (size_t)y * grid_size + x;
-        const size_t grid_element_offset = grid_element_index * element_size;
-        subdiv_ccg_eval_grid_element(data, ptex_face_index, u, v, &grid[grid_element_offset]);
+    for (int start = 0; start < grid_area; start += CCG_EVAL_BATCH_SIZE) {
+      const int num_elements = min_ii(CCG_EVAL_BATCH_SIZE, grid_area - start);
+      for (int i = 0; i < num_elements; i++) {
+        const int grid_element_index = start + i;
+        const float grid_u = (grid_element_index % grid_size) * grid_size_1_inv;
+        const float grid_v = (grid_element_index / grid_size) * grid_size_1_inv;
+        patch_coords[i].ptex_face = ptex_face_index;
+        BKE_subdiv_rotate_grid_to_quad(
+            corner, grid_u, grid_v, &patch_coords[i].u, &patch_coords[i].v);
       }
+      const size_t grid_element_offset = (size_t)start * element_size;
+      subdiv_ccg_eval_grid_elements(data, patch_coords, num_elements, &grid[grid_element_offset]);
     }
     /* Assign grid's face. */
     grid_faces[grid_index] = &faces[face_index];
@@ -265,23 +285,27 @@ static void subdiv_ccg_eval_special_grid(CCGEvalGridsData *data, const int face_
 {
   SubdivCCG *subdiv_ccg = data->subdiv_ccg;
   const int grid_size = subdiv_ccg->grid_size;
+  const int grid_area = grid_size * grid_size;
   const float grid_size_1_inv = 1.0f / (grid_size - 1);
   const int element_size = element_size_bytes_get(subdiv_ccg);
   SubdivCCGFace *faces = subdiv_ccg->faces;
   SubdivCCGFace **grid_faces = subdiv_ccg->grid_faces;
   const SubdivCCGFace *face = &faces[face_index];
+  OpenSubdiv_PatchCoord patch_coords[CCG_EVAL_BATCH_SIZE];
   for (int corner = 0; corner < face->num_grids; corner++) {
     const int grid_index = face->start_grid_index + corner;
     const int ptex_face_index = data->face_ptex_offset[face_index] + corner;
     unsigned char *grid = (unsigned char *)subdiv_ccg->grids[grid_index];
-    for (int y = 0; y < grid_size; y++) {
-      const float u = 1.0f - (y * grid_size_1_inv);
-      for (int x = 0; x < grid_size; x++) {
-        const float v = 1.0f - (x * grid_size_1_inv);
-        const size_t grid_element_index = (size_t)y * grid_size + x;
-        const size_t grid_element_offset = grid_element_index * element_size;
-        subdiv_ccg_eval_grid_element(data, ptex_face_index, u, v, &grid[grid_element_offset]);
+    for (int start = 0; start < grid_area; start += CCG_EVAL_BATCH_SIZE) {
+      const int num_elements = min_ii(CCG_EVAL_BATCH_SIZE, grid_area - start);
+      for (int i = 0; i < num_elements; i++) {
+        const int grid_element_index = start + i;
+        patch_coords[i].ptex_face = ptex_face_index;
+        patch_coords[i].u = 1.0f - ((grid_element_index / grid_size) * grid_size_1_inv);
+        patch_coords[i].v = 1.0f - ((grid_element_index % grid_size) * grid_size_1_inv);
       }
+      const size_t grid_element_offset = (size_t)start * element_size;
+      subdiv_ccg_eval_grid_elements(data, patch_coords, num_elements, &grid[grid_element_offset]);
     }
     /* Assign grid's face. */
     grid_faces[grid_index] = &faces[face_index];
@@ -35,6 +35,7 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "opensubdiv_capi_type.h"
 #include "opensubdiv_evaluator_capi.h"
 #include "opensubdiv_topology_refiner_capi.h"
 
@@ -274,6 +275,96 @@ void BKE_subdiv_eval_final_point(
   }
 }
 
+/* ========================== Batched point queries ========================== */
+
+/* Number of points for which derivatives are stored on the stack at a time. */
+#define EVAL_BATCH_SIZE 256
+
+static bool derivatives_are_degenerate(const float dPdu[3], const float dPdv[3])
+{
+  return is_zero_v3(dPdu) || is_zero_v3(dPdv) || equals_v3v3(dPdu, dPdv);
+}
+
+void BKE_subdiv_eval_limit_points(Subdiv *subdiv,
+                                  const OpenSubdiv_PatchCoord *patch_coords,
+                                  const int num_patch_coords,
+                                  float (*r_P)[3])
+{
+  subdiv->evaluator->evaluatePatchesLimit(
+      subdiv->evaluator, patch_coords, num_patch_coords, (float *)r_P, NULL, NULL);
+}
+
+void BKE_subdiv_eval_limit_points_and_derivatives(Subdiv *subdiv,
+                                                  const OpenSubdiv_PatchCoord *patch_coords,
+                                                  const int num_patch_coords,
+                                                  float (*r_P)[3],
+                                                  float (*r_dPdu)[3],
+                                                  float (*r_dPdv)[3])
+{
+  subdiv->evaluator->evaluatePatchesLimit(subdiv->evaluator,
+                                          patch_coords,
+                                          num_patch_coords,
+                                          (float *)r_P,
+                                          (float *)r_dPdu,
+                                          (float *)r_dPdv);
+  /* Degenerate derivatives are rare, handle them with the single point query which knows how to
+   * step away from them. */
+  for (int i = 0; i < num_patch_coords; i++) {
+    if (derivatives_are_degenerate(r_dPdu[i], r_dPdv[i])) {
+      const OpenSubdiv_PatchCoord *patch_coord = &patch_coords[i];
+      BKE_subdiv_eval_limit_point_and_derivatives(subdiv,
+                                                  patch_coord->ptex_face,
+                                                  patch_coord->u,
+                                                  patch_coord->v,
+                                                  r_P[i],
+                                                  r_dPdu[i],
+                                                  r_dPdv[i]);
+    }
+  }
+}
+
+void BKE_subdiv_eval_limit_points_and_normals(Subdiv *subdiv,
+                                              const OpenSubdiv_PatchCoord *patch_coords,
+                                              const int num_patch_coords,
+                                              float (*r_P)[3],
+                                              float (*r_N)[3])
+{
+  float dPdu[EVAL_BATCH_SIZE][3], dPdv[EVAL_BATCH_SIZE][3];
+  for (int start = 0; start < num_patch_coords; start += EVAL_BATCH_SIZE) {
+    const int num = min_ii(EVAL_BATCH_SIZE, num_patch_coords - start);
+    BKE_subdiv_eval_limit_points_and_derivatives(
+        subdiv, patch_coords + start, num, r_P + start, dPdu, dPdv);
+    for (int i = 0; i < num; i++) {
+      cross_v3_v3v3(r_N[start + i], dPdu[i], dPdv[i]);
+      normalize_v3(r_N[start + i]);
+    }
+  }
+}
+
+void BKE_subdiv_eval_final_points(Subdiv *subdiv,
+                                  const OpenSubdiv_PatchCoord *patch_coords,
+                                  const int num_patch_coords,
+                                  float (*r_P)[3])
+{
+  if (subdiv->displacement_evaluator == NULL) {
+    BKE_subdiv_eval_limit_points(subdiv, patch_coords, num_patch_coords, r_P);
+    return;
+  }
+  float dPdu[EVAL_BATCH_SIZE][3], dPdv[EVAL_BATCH_SIZE][3];
+  for (int start = 0; start < num_patch_coords; start += EVAL_BATCH_SIZE) {
+    const int num = min_ii(EVAL_BATCH_SIZE, num_patch_coords - start);
+    BKE_subdiv_eval_limit_points_and_derivatives(
+        subdiv, patch_coords + start, num, r_P + start, dPdu, dPdv);
+    for (int i = 0; i < num; i++) {
+      const OpenSubdiv_PatchCoord *patch_coord = &patch_coords[start + i];
+      float D[3];
+      BKE_subdiv_eval_displacement(
+          subdiv, patch_coord->ptex_face, patch_coord->u, patch_coord->v, dPdu[i], dPdv[i], D);
+      add_v3_v3(r_P[start + i], D);
+    }
+  }
+}
+
 /* ===================  Patch queries at given resolution =================== */
 
 /* Move buffer forward by a given number of bytes. */
@@ -294,6 +385,24 @@ static void buffer_write_short_value(void **buffer, const short *values_buffer,
   memcpy(*buffer, values_buffer, sizeof(short) * num_values);
 }
 
+/* Fill patch coordinates of a part of the patch grid, the points are ordered as u in rows and v
+ * in columns. */
+static void patch_resolution_coords_fill(const int ptex_face_index,
+                                         const int resolution,
+                                         const int start,
+                                         const int num,
+                                         OpenSubdiv_PatchCoord *r_patch_coords)
+{
+  const float inv_resolution_1 = 1.0f / (float)(resolution - 1);
+  for (int i = 0; i < num; i++) {
+    const int x = (start + i) % resolution;
+    const int y = (start + i) / resolution;
+    r_patch_coords[i].ptex_face = ptex_face_index;
+    r_patch_coords[i].u = x * inv_resolution_1;
+    r_patch_coords[i].v = y * inv_resolution_1;
+  }
+}
+
 void BKE_subdiv_eval_limit_patch_resolution_point(Subdiv *subdiv,
                                                   const int ptex_face_index,
                                                   const int resolution,
@@ -302,12 +411,15 @@ void BKE_subdiv_eval_limit_patch_resolution_point(Subdiv *subdiv,
                                                   const int stride)
 {
   buffer_apply_offset(&buffer, offset);
-  const float inv_resolution_1 = 1.0f / (float)(resolution - 1);
-  for (int y = 0; y < resolution; y++) {
-    const float v = y * inv_resolution_1;
-    for (int x = 0; x < resolution; x++) {
-      const float u = x * inv_resolution_1;
-      BKE_subdiv_eval_limit_point(subdiv, ptex_face_index, u, v, buffer);
+  const int num_points = resolution * resolution;
+  OpenSubdiv_PatchCoord patch_coords[EVAL_BATCH_SIZE];
+  float P[EVAL_BATCH_SIZE][3];
+  for (int start = 0; start < num_points; start += EVAL_BATCH_SIZE) {
+    const int num = min_ii(EVAL_BATCH_SIZE, num_points - start);
+    patch_resolution_coords_fill(ptex_face_index, resolution, start, num, patch_coords);
+    BKE_subdiv_eval_limit_points(subdiv, patch_coords, num, P);
+    for (int i = 0; i < num; i++) {
+      buffer_write_float_value(&buffer, P[i], 3);
       buffer_apply_offset(&buffer, stride);
     }
   }
@@ -329,13 +441,17 @@ void BKE_subdiv_eval_limit_patch_resolution_point_and_derivatives(Subdiv *subdiv
   buffer_apply_offset(&point_buffer, point_offset);
   buffer_apply_offset(&du_buffer, du_offset);
   buffer_apply_offset(&dv_buffer, dv_offset);
-  const float inv_resolution_1 = 1.0f / (float)(resolution - 1);
-  for (int y = 0; y < resolution; y++) {
-    const float v = y * inv_resolution_1;
-    for (int x = 0; x < resolution; x++) {
-      const float u = x * inv_resolution_1;
-      BKE_subdiv_eval_limit_point_and_derivatives(
-          subdiv, ptex_face_index, u, v, point_buffer, du_buffer, dv_buffer);
+  const int num_points = resolution * resolution;
+  OpenSubdiv_PatchCoord patch_coords[EVAL_BATCH_SIZE];
+  float P[EVAL_BATCH_SIZE][3], dPdu[EVAL_BATCH_SIZE][3], dPdv[EVAL_BATCH_SIZE][3];
+  for (int start = 0; start < num_points; start += EVAL_BATCH_SIZE) {
+    const int num = min_ii(EVAL_BATCH_SIZE, num_points - start);
+    patch_resolution_coords_fill(ptex_face_index, resolution, start, num, patch_coords);
+    BKE_subdiv_eval_limit_points_and_derivatives(subdiv, patch_coords, num, P, dPdu, dPdv);
+    for (int i = 0; i < num; i++) {
+      buffer_write_float_value(&point_buffer, P[i], 3);
+      buffer_write_float_value(&du_buffer, dPdu[i], 3);
+      buffer_write_float_value(&dv_buffer, dPdv[i], 3);
       buffer_apply_offset(&point_buffer, point_stride);
       buffer_apply_offset(&du_buffer, du_stride);
       buffer_apply_offset(&dv_buffer, dv_stride);
@@ -355,14 +471,16 @@ void BKE_subdiv_eval_limit_patch_resolution_point_and_normal(Subdiv *subdiv,
 {
   buffer_apply_offset(&point_buffer, point_offset);
   buffer_apply_offset(&normal_buffer, normal_offset);
-  const float inv_resolution_1 = 1.0f / (float)(resolution - 1);
-  for (int y = 0; y < resolution; y++) {
-    const float v = y * inv_resolution_1;
-    for (int x = 0; x < resolution; x++) {
-      const float u = x * inv_resolution_1;
-      float normal[3];
-      BKE_subdiv_eval_limit_point_and_normal(subdiv, ptex_face_index, u, v, point_buffer, normal);
-      buffer_write_float_value(&normal_buffer, normal, 3);
+  const int num_points = resolution * resolution;
+  OpenSubdiv_PatchCoord patch_coords[EVAL_BATCH_SIZE];
+  float P[EVAL_BATCH_SIZE][3], N[EVAL_BATCH_SIZE][3];
+  for (int start = 0; start < num_points; start += EVAL_BATCH_SIZE) {
+    const int num = min_ii(EVAL_BATCH_SIZE, num_points - start);
+    patch_resolution_coords_fill(ptex_face_index, resolution, start, num, patch_coords);
+    BKE_subdiv_eval_limit_points_and_normals(subdiv, patch_coords, num, P, N);
+    for (int i = 0; i < num; i++) {
+      buffer_write_float_value(&point_buffer, P[i], 3);
+      buffer_write_float_value(&normal_buffer, N[i], 3);
       buffer_apply_offset(&point_buffer, point_stride);
       buffer_apply_offset(&normal_buffer, normal_stride);
     }
@@ -381,14 +499,17 @@ void BKE_subdiv_eval_limit_patch_resolution_point_and_short_normal(Subdiv *subdi
 {
   buffer_apply_offset(&point_buffer, point_offset);
   buffer_apply_offset(&normal_buffer, normal_offset);
-  const float inv_resolution_1 = 1.0f / (float)(resolution - 1);
-  for (int y = 0; y < resolution; y++) {
-    const float v = y * inv_resolution_1;
-    for (int x = 0; x < resolution; x++) {
-      const float u = x * inv_resolution_1;
+  const int num_points = resolution * resolution;
+  OpenSubdiv_PatchCoord patch_coords[EVAL_BATCH_SIZE];
+  float P[EVAL_BATCH_SIZE][3], N[EVAL_BATCH_SIZE][3];
+  for (int start = 0; start < num_points; start += EVAL_BATCH_SIZE) {
+    const int num = min_ii(EVAL_BATCH_SIZE, num_points - start);
+    patch_resolution_coords_fill(ptex_face_index, resolution, start, num, patch_coords);
+    BKE_subdiv_eval_limit_points_and_normals(subdiv, patch_coords, num, P, N);
+    for (int i = 0; i < num; i++) {
       short normal[3];
-      BKE_subdiv_eval_limit_point_and_short_normal(
-          subdiv, ptex_face_index, u, v, point_buffer, normal);
+      normal_float_to_short_v3(normal, N[i]);
+      buffer_write_float_value(&point_buffer, P[i], 3);
       buffer_write_short_value(&normal_buffer, normal, 3);
       buffer_apply_offset(&point_buffer, point_stride);
       buffer_apply_offset(&normal_buffer, normal_stride);
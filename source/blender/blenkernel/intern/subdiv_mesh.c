@@ -31,9 +31,11 @@
 
 #include "BLI_alloca.h"
 #include "BLI_math_vector.h"
+#include "BLI_task.h"
 
 #include "BKE_customdata.h"
 #include "BKE_key.h"
+#include "BKE_lib_id.h"
 #include "BKE_mesh.h"
 #include "BKE_subdiv.h"
 #include "BKE_subdiv_eval.h"
@@ -41,6 +43,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "opensubdiv_capi_type.h"
+
 /* -------------------------------------------------------------------- */
 /** \name Subdivision Context
  * \{ */
@@ -76,6 +80,14 @@ typedef struct SubdivMeshContext {
    * when it's not possible is when displacement is used. */
   bool can_evaluate_normals;
   bool have_displacement;
+  /* Limit surface coordinates of inner vertices. Inner vertices are the vast majority of all
+   * vertices, their positions are evaluated in batches after the traversal. Other vertices have
+   * a negative ptex face index. */
+  OpenSubdiv_PatchCoord *inner_vertex_patch_coords;
+  /* Limit surface coordinates of all vertices, only gathered when the result is cached.
+   * Vertices of loose geometry have a negative ptex face index. */
+  bool need_vertex_patch_coords;
+  OpenSubdiv_PatchCoord *vertex_patch_coords;
 } SubdivMeshContext;
 
 static void subdiv_mesh_ctx_cache_uv_layers(SubdivMeshContext *ctx)
@@ -113,10 +125,44 @@ static void subdiv_mesh_prepare_accumulator(SubdivMeshContext *ctx, int num_vert
       sizeof(*ctx->accumulated_counters), num_vertices, "subdiv accumulated counters");
 }
 
+static void subdiv_mesh_prepare_inner_vertex_patch_coords(SubdivMeshContext *ctx,
+                                                          const int num_vertices)
+{
+  ctx->inner_vertex_patch_coords = MEM_malloc_arrayN(
+      num_vertices, sizeof(*ctx->inner_vertex_patch_coords), "subdiv inner patch coords");
+  for (int i = 0; i < num_vertices; i++) {
+    ctx->inner_vertex_patch_coords[i].ptex_face = -1;
+  }
+  if (ctx->need_vertex_patch_coords) {
+    ctx->vertex_patch_coords = MEM_malloc_arrayN(
+        num_vertices, sizeof(*ctx->vertex_patch_coords), "subdiv vertex patch coords");
+    for (int i = 0; i < num_vertices; i++) {
+      ctx->vertex_patch_coords[i].ptex_face = -1;
+    }
+  }
+}
+
+static void subdiv_mesh_store_vertex_patch_coord(const SubdivMeshContext *ctx,
+                                                 const int subdiv_vertex_index,
+                                                 const int ptex_face_index,
+                                                 const float u,
+                                                 const float v)
+{
+  if (ctx->vertex_patch_coords == NULL) {
+    return;
+  }
+  OpenSubdiv_PatchCoord *patch_coord = &ctx->vertex_patch_coords[subdiv_vertex_index];
+  patch_coord->ptex_face = ptex_face_index;
+  patch_coord->u = u;
+  patch_coord->v = v;
+}
+
 static void subdiv_mesh_context_free(SubdivMeshContext *ctx)
 {
   MEM_SAFE_FREE(ctx->accumulated_normals);
   MEM_SAFE_FREE(ctx->accumulated_counters);
+  MEM_SAFE_FREE(ctx->inner_vertex_patch_coords);
+  MEM_SAFE_FREE(ctx->vertex_patch_coords);
 }
 
 /** \} */
@@ -454,21 +500,66 @@ static void subdiv_mesh_tls_free(void *tls_v)
 /** \name Evaluation helper functions
  * \{ */
 
-static void eval_final_point_and_vertex_normal(Subdiv *subdiv,
-                                               const int ptex_face_index,
-                                               const float u,
-                                               const float v,
-                                               float r_P[3],
-                                               short r_N[3])
+/* Number of vertices which are evaluated with a single call into the evaluator. */
+#define SUBDIV_MESH_EVAL_BATCH_SIZE 256
+
+static void subdiv_mesh_eval_inner_vertices_task(void *__restrict userdata,
+                                                 const int batch_index,
+                                                 const TaskParallelTLS *__restrict UNUSED(tls))
 {
+  SubdivMeshContext *ctx = userdata;
+  Subdiv *subdiv = ctx->subdiv;
+  MVert *subdiv_mvert = ctx->subdiv_mesh->mvert;
+  const int start = batch_index * SUBDIV_MESH_EVAL_BATCH_SIZE;
+  const int end = min_ii(start + SUBDIV_MESH_EVAL_BATCH_SIZE, ctx->subdiv_mesh->totvert);
+
+  OpenSubdiv_PatchCoord patch_coords[SUBDIV_MESH_EVAL_BATCH_SIZE];
+  int vertex_indices[SUBDIV_MESH_EVAL_BATCH_SIZE];
+  int num_vertices = 0;
+  for (int vertex_index = start; vertex_index < end; vertex_index++) {
+    const OpenSubdiv_PatchCoord *patch_coord = &ctx->inner_vertex_patch_coords[vertex_index];
+    if (patch_coord->ptex_face < 0) {
+      continue;
+    }
+    patch_coords[num_vertices] = *patch_coord;
+    vertex_indices[num_vertices] = vertex_index;
+    num_vertices++;
+  }
+  if (num_vertices == 0) {
+    return;
+  }
+
+  float P[SUBDIV_MESH_EVAL_BATCH_SIZE][3];
   if (subdiv->displacement_evaluator == NULL) {
-    BKE_subdiv_eval_limit_point_and_short_normal(subdiv, ptex_face_index, u, v, r_P, r_N);
+    float N[SUBDIV_MESH_EVAL_BATCH_SIZE][3];
+    BKE_subdiv_eval_limit_points_and_normals(subdiv, patch_coords, num_vertices, P, N);
+    for (int i = 0; i < num_vertices; i++) {
+      MVert *subdiv_vert = &subdiv_mvert[vertex_indices[i]];
+      copy_v3_v3(subdiv_vert->co, P[i]);
+      normal_float_to_short_v3(subdiv_vert->no, N[i]);
+    }
   }
   else {
-    BKE_subdiv_eval_final_point(subdiv, ptex_face_index, u, v, r_P);
+    BKE_subdiv_eval_final_points(subdiv, patch_coords, num_vertices, P);
+    for (int i = 0; i < num_vertices; i++) {
+      copy_v3_v3(subdiv_mvert[vertex_indices[i]].co, P[i]);
+    }
   }
 }
 
+/* Evaluate positions and normals of all inner vertices which were gathered during the
+ * traversal. */
+static void subdiv_mesh_eval_inner_vertices(SubdivMeshContext *ctx)
+{
+  const int num_vertices = ctx->subdiv_mesh->totvert;
+  const int num_batches = (num_vertices + SUBDIV_MESH_EVAL_BATCH_SIZE - 1) /
+                          SUBDIV_MESH_EVAL_BATCH_SIZE;
+  TaskParallelSettings parallel_range_settings;
+  BLI_parallel_range_settings_defaults(&parallel_range_settings);
+  BLI_task_parallel_range(
+      0, num_batches, ctx, subdiv_mesh_eval_inner_vertices_task, &parallel_range_settings);
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -526,6 +617,7 @@ static bool subdiv_mesh_topology_info(const SubdivForeachContext *foreach_contex
       subdiv_context->coarse_mesh, num_vertices, num_edges, 0, num_loops, num_polygons, mask);
   subdiv_mesh_ctx_cache_custom_data_layers(subdiv_context);
   subdiv_mesh_prepare_accumulator(subdiv_context, num_vertices);
+  subdiv_mesh_prepare_inner_vertex_patch_coords(subdiv_context, num_vertices);
   return true;
 }
 
@@ -694,6 +786,7 @@ static void subdiv_mesh_vertex_corner(const SubdivForeachContext *foreach_contex
   MVert *subdiv_vert = &subdiv_mvert[subdiv_vertex_index];
   evaluate_vertex_and_apply_displacement_copy(
       ctx, ptex_face_index, u, v, coarse_vert, subdiv_vert);
+  subdiv_mesh_store_vertex_patch_coord(ctx, subdiv_vertex_index, ptex_face_index, u, v);
 }
 
 static void subdiv_mesh_ensure_vertex_interpolation(SubdivMeshContext *ctx,
@@ -745,6 +838,7 @@ static void subdiv_mesh_vertex_edge(const SubdivForeachContext *foreach_context,
   subdiv_mesh_ensure_vertex_interpolation(ctx, tls, coarse_poly, coarse_corner);
   evaluate_vertex_and_apply_displacement_interpolate(
       ctx, ptex_face_index, u, v, &tls->vertex_interpolation, subdiv_vert);
+  subdiv_mesh_store_vertex_patch_coord(ctx, subdiv_vertex_index, ptex_face_index, u, v);
 }
 
 static bool subdiv_mesh_is_center_vertex(const MPoly *coarse_poly, const float u, const float v)
@@ -783,7 +877,6 @@ static void subdiv_mesh_vertex_inner(const SubdivForeachContext *foreach_context
 {
   SubdivMeshContext *ctx = foreach_context->user_data;
   SubdivMeshTLS *tls = tls_v;
-  Subdiv *subdiv = ctx->subdiv;
   const Mesh *coarse_mesh = ctx->coarse_mesh;
   const MPoly *coarse_mpoly = coarse_mesh->mpoly;
   const MPoly *coarse_poly = &coarse_mpoly[coarse_poly_index];
@@ -792,8 +885,12 @@ static void subdiv_mesh_vertex_inner(const SubdivForeachContext *foreach_context
   MVert *subdiv_vert = &subdiv_mvert[subdiv_vertex_index];
   subdiv_mesh_ensure_vertex_interpolation(ctx, tls, coarse_poly, coarse_corner);
   subdiv_vertex_data_interpolate(ctx, subdiv_vert, &tls->vertex_interpolation, u, v);
-  eval_final_point_and_vertex_normal(
-      subdiv, ptex_face_index, u, v, subdiv_vert->co, subdiv_vert->no);
+  /* Position and normal are evaluated in batches afterwards. */
+  OpenSubdiv_PatchCoord *patch_coord = &ctx->inner_vertex_patch_coords[subdiv_vertex_index];
+  patch_coord->ptex_face = ptex_face_index;
+  patch_coord->u = u;
+  patch_coord->v = v;
+  subdiv_mesh_store_vertex_patch_coord(ctx, subdiv_vertex_index, ptex_face_index, u, v);
   subdiv_mesh_tag_center_vertex(coarse_poly, subdiv_vert, u, v);
 }
 
@@ -1189,12 +1286,15 @@ static void setup_foreach_callbacks(const SubdivMeshContext *subdiv_context,
 /** \} */
 
 /* -------------------------------------------------------------------- */
-/** \name Public entry point
+/** \name Subdivision into mesh
  * \{ */
 
-Mesh *BKE_subdiv_to_mesh(Subdiv *subdiv,
-                         const SubdivToMeshSettings *settings,
-                         const Mesh *coarse_mesh)
+/* When r_vertex_patch_coords is not NULL the limit surface coordinates of all vertices of the
+ * result are returned in it, and the caller owns the array. */
+static Mesh *subdiv_to_mesh(Subdiv *subdiv,
+                            const SubdivToMeshSettings *settings,
+                            const Mesh *coarse_mesh,
+                            OpenSubdiv_PatchCoord **r_vertex_patch_coords)
 {
   BKE_subdiv_stats_begin(&subdiv->stats, SUBDIV_STATS_SUBDIV_TO_MESH);
   /* Make sure evaluator is up to date with possible new topology, and that
@@ -1218,6 +1318,7 @@ Mesh *BKE_subdiv_to_mesh(Subdiv *subdiv,
   subdiv_context.have_displacement = (subdiv->displacement_evaluator != NULL);
   subdiv_context.can_evaluate_normals = !subdiv_context.have_displacement &&
                                         subdiv_context.subdiv->settings.is_adaptive;
+  subdiv_context.need_vertex_patch_coords = (r_vertex_patch_coords != NULL);
   /* Multi-threaded traversal/evaluation. */
   BKE_subdiv_stats_begin(&subdiv->stats, SUBDIV_STATS_SUBDIV_TO_MESH_GEOMETRY);
   SubdivForeachContext foreach_context;
@@ -1227,6 +1328,9 @@ Mesh *BKE_subdiv_to_mesh(Subdiv *subdiv,
   foreach_context.user_data_tls_size = sizeof(SubdivMeshTLS);
   foreach_context.user_data_tls = &tls;
   BKE_subdiv_foreach_subdiv_geometry(subdiv, &foreach_context, settings, coarse_mesh);
+  if (subdiv_context.subdiv_mesh != NULL && subdiv_context.inner_vertex_patch_coords != NULL) {
+    subdiv_mesh_eval_inner_vertices(&subdiv_context);
+  }
   BKE_subdiv_stats_end(&subdiv->stats, SUBDIV_STATS_SUBDIV_TO_MESH_GEOMETRY);
   Mesh *result = subdiv_context.subdiv_mesh;
   // BKE_mesh_validate(result, true, true);
@@ -1234,9 +1338,302 @@ Mesh *BKE_subdiv_to_mesh(Subdiv *subdiv,
   if (!subdiv_context.can_evaluate_normals) {
     result->runtime.cd_dirty_vert |= CD_MASK_NORMAL;
   }
+  if (r_vertex_patch_coords != NULL) {
+    *r_vertex_patch_coords = subdiv_context.vertex_patch_coords;
+    subdiv_context.vertex_patch_coords = NULL;
+  }
   /* Free used memory. */
   subdiv_mesh_context_free(&subdiv_context);
   return result;
 }
 
 /** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Deform-only cache
+ *
+ * Keeps a copy of the subdivided mesh together with the limit surface coordinates of all its
+ * vertices. When the next coarse mesh only differs in the vertex positions (which is the common
+ * case of a character deformed by an armature) the topology and all the interpolated custom data
+ * of the copy are still valid, so the result is a copy of the cached mesh with vertex positions
+ * evaluated in parallel, which avoids the whole traversal.
+ * \{ */
+
+struct SubdivMeshCache {
+  /* Settings the cached mesh was created with. */
+  SubdivSettings subdiv_settings;
+  SubdivToMeshSettings settings;
+  /* Custom data of the coarse mesh the cached mesh was created from. Positions and normals of
+   * the coarse vertices are ignored when comparing it to a new coarse mesh. */
+  int coarse_totvert;
+  int coarse_totedge;
+  int coarse_totloop;
+  int coarse_totpoly;
+  CustomData coarse_vdata;
+  CustomData coarse_edata;
+  CustomData coarse_ldata;
+  CustomData coarse_pdata;
+  Mesh *subdiv_mesh;
+  OpenSubdiv_PatchCoord *vertex_patch_coords;
+};
+
+SubdivMeshCache *BKE_subdiv_mesh_cache_new(void)
+{
+  return MEM_callocN(sizeof(SubdivMeshCache), "subdiv mesh cache");
+}
+
+static void subdiv_mesh_cache_clear(SubdivMeshCache *cache)
+{
+  if (cache->subdiv_mesh == NULL) {
+    return;
+  }
+  CustomData_free(&cache->coarse_vdata, cache->coarse_totvert);
+  CustomData_free(&cache->coarse_edata, cache->coarse_totedge);
+  CustomData_free(&cache->coarse_ldata, cache->coarse_totloop);
+  CustomData_free(&cache->coarse_pdata, cache->coarse_totpoly);
+  BKE_id_free(NULL, cache->subdiv_mesh);
+  cache->subdiv_mesh = NULL;
+  MEM_SAFE_FREE(cache->vertex_patch_coords);
+}
+
+void BKE_subdiv_mesh_cache_free(SubdivMeshCache *cache)
+{
+  subdiv_mesh_cache_clear(cache);
+  MEM_freeN(cache);
+}
+
+/* Layers which store pointers to data can not be compared by their memory. */
+static bool subdiv_mesh_cache_custom_data_is_supported(const CustomData *data)
+{
+  return !CustomData_has_layer(data, CD_MDISPS) &&
+         !CustomData_has_layer(data, CD_GRID_PAINT_MASK);
+}
+
+static bool subdiv_mesh_cache_layer_data_equal(const CustomDataLayer *layer_a,
+                                               const CustomDataLayer *layer_b,
+                                               const int totelem)
+{
+  if (layer_a->type == CD_MVERT) {
+    const MVert *mvert_a = layer_a->data;
+    const MVert *mvert_b = layer_b->data;
+    for (int i = 0; i < totelem; i++) {
+      if (mvert_a[i].flag != mvert_b[i].flag || mvert_a[i].bweight != mvert_b[i].bweight) {
+        return false;
+      }
+    }
+    return true;
+  }
+  if (layer_a->type == CD_MDEFORMVERT) {
+    const MDeformVert *dvert_a = layer_a->data;
+    const MDeformVert *dvert_b = layer_b->data;
+    for (int i = 0; i < totelem; i++) {
+      if (dvert_a[i].totweight != dvert_b[i].totweight) {
+        return false;
+      }
+      if (dvert_a[i].totweight != 0 &&
+          memcmp(dvert_a[i].dw, dvert_b[i].dw, sizeof(MDeformWeight) * dvert_a[i].totweight)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  const size_t size = (size_t)CustomData_sizeof(layer_a->type) * totelem;
+  return memcmp(layer_a->data, layer_b->data, size) == 0;
+}
+
+/* Compare all layers which are copied when the coarse data is stored in the cache. */
+static bool subdiv_mesh_cache_custom_data_equal(const CustomData *cached,
+                                                const CustomData *data,
+                                                const int totelem)
+{
+  int cached_index = 0;
+  for (int index = 0; index < data->totlayer; index++) {
+    const CustomDataLayer *layer = &data->layers[index];
+    if (layer->flag & CD_FLAG_NOCOPY) {
+      continue;
+    }
+    if (cached_index == cached->totlayer) {
+      return false;
+    }
+    const CustomDataLayer *cached_layer = &cached->layers[cached_index++];
+    if (cached_layer->type != layer->type || !STREQ(cached_layer->name, layer->name)) {
+      return false;
+    }
+    if (!subdiv_mesh_cache_layer_data_equal(cached_layer, layer, totelem)) {
+      return false;
+    }
+  }
+  return cached_index == cached->totlayer;
+}
+
+static bool subdiv_mesh_cache_is_valid(const SubdivMeshCache *cache,
+                                       const Subdiv *subdiv,
+                                       const SubdivToMeshSettings *settings,
+                                       const Mesh *coarse_mesh)
+{
+  if (cache->subdiv_mesh == NULL) {
+    return false;
+  }
+  if (!BKE_subdiv_settings_equal(&cache->subdiv_settings, &subdiv->settings) ||
+      cache->settings.resolution != settings->resolution ||
+      cache->settings.use_optimal_display != settings->use_optimal_display ||
+      subdiv->displacement_evaluator != NULL) {
+    return false;
+  }
+  if (cache->coarse_totvert != coarse_mesh->totvert ||
+      cache->coarse_totedge != coarse_mesh->totedge ||
+      cache->coarse_totloop != coarse_mesh->totloop ||
+      cache->coarse_totpoly != coarse_mesh->totpoly) {
+    return false;
+  }
+  /* Topology is compared as part of the edge, loop and polygon layers. */
+  return subdiv_mesh_cache_custom_data_equal(
+             &cache->coarse_vdata, &coarse_mesh->vdata, coarse_mesh->totvert) &&
+         subdiv_mesh_cache_custom_data_equal(
+             &cache->coarse_edata, &coarse_mesh->edata, coarse_mesh->totedge) &&
+         subdiv_mesh_cache_custom_data_equal(
+             &cache->coarse_ldata, &coarse_mesh->ldata, coarse_mesh->totloop) &&
+         subdiv_mesh_cache_custom_data_equal(
+             &cache->coarse_pdata, &coarse_mesh->pdata, coarse_mesh->totpoly);
+}
+
+static bool subdiv_mesh_cache_can_store(const Subdiv *subdiv,
+                                        const Mesh *coarse_mesh,
+                                        const Mesh *subdiv_mesh,
+                                        const OpenSubdiv_PatchCoord *vertex_patch_coords)
+{
+  /* Displacement is not re-evaluated, and normals of vertices on the coarse edges are averaged
+   * from all adjacent ptex faces by the full traversal when they are evaluated. */
+  if (subdiv->displacement_evaluator != NULL || subdiv->settings.is_adaptive) {
+    return false;
+  }
+  if (!subdiv_mesh_cache_custom_data_is_supported(&coarse_mesh->vdata) ||
+      !subdiv_mesh_cache_custom_data_is_supported(&coarse_mesh->ldata)) {
+    return false;
+  }
+  /* Vertices of loose geometry are interpolated from the coarse vertices, not evaluated on the
+   * limit surface. */
+  for (int i = 0; i < subdiv_mesh->totvert; i++) {
+    if (vertex_patch_coords[i].ptex_face < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void subdiv_mesh_cache_store(SubdivMeshCache *cache,
+                                    const Subdiv *subdiv,
+                                    const SubdivToMeshSettings *settings,
+                                    const Mesh *coarse_mesh,
+                                    Mesh *subdiv_mesh,
+                                    OpenSubdiv_PatchCoord *vertex_patch_coords)
+{
+  cache->subdiv_settings = subdiv->settings;
+  cache->settings = *settings;
+  cache->coarse_totvert = coarse_mesh->totvert;
+  cache->coarse_totedge = coarse_mesh->totedge;
+  cache->coarse_totloop = coarse_mesh->totloop;
+  cache->coarse_totpoly = coarse_mesh->totpoly;
+  CustomData_copy(
+      &coarse_mesh->vdata, &cache->coarse_vdata, CD_MASK_ALL, CD_DUPLICATE, coarse_mesh->totvert);
+  CustomData_copy(
+      &coarse_mesh->edata, &cache->coarse_edata, CD_MASK_ALL, CD_DUPLICATE, coarse_mesh->totedge);
+  CustomData_copy(
+      &coarse_mesh->ldata, &cache->coarse_ldata, CD_MASK_ALL, CD_DUPLICATE, coarse_mesh->totloop);
+  CustomData_copy(
+      &coarse_mesh->pdata, &cache->coarse_pdata, CD_MASK_ALL, CD_DUPLICATE, coarse_mesh->totpoly);
+  cache->subdiv_mesh = BKE_mesh_copy_for_eval(subdiv_mesh, false);
+  cache->vertex_patch_coords = vertex_patch_coords;
+}
+
+typedef struct SubdivMeshCacheEvalData {
+  Subdiv *subdiv;
+  const OpenSubdiv_PatchCoord *vertex_patch_coords;
+  MVert *mvert;
+  int totvert;
+} SubdivMeshCacheEvalData;
+
+static void subdiv_mesh_cache_eval_positions_task(void *__restrict userdata,
+                                                  const int batch_index,
+                                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  SubdivMeshCacheEvalData *data = userdata;
+  const int start = batch_index * SUBDIV_MESH_EVAL_BATCH_SIZE;
+  const int num_vertices = min_ii(SUBDIV_MESH_EVAL_BATCH_SIZE, data->totvert - start);
+  float P[SUBDIV_MESH_EVAL_BATCH_SIZE][3];
+  BKE_subdiv_eval_limit_points(data->subdiv, &data->vertex_patch_coords[start], num_vertices, P);
+  for (int i = 0; i < num_vertices; i++) {
+    copy_v3_v3(data->mvert[start + i].co, P[i]);
+  }
+}
+
+static Mesh *subdiv_mesh_cache_deform(const SubdivMeshCache *cache,
+                                      Subdiv *subdiv,
+                                      const Mesh *coarse_mesh)
+{
+  /* Only the vertices change, all other layers reference the data of the cached mesh. The result
+   * is freed with the derived caches of the object before the modifier is evaluated again, and
+   * modifiers after this one duplicate referenced layers before they modify them. */
+  Mesh *result = BKE_mesh_copy_for_eval(cache->subdiv_mesh, true);
+  result->mvert = CustomData_duplicate_referenced_layer(&result->vdata, CD_MVERT, result->totvert);
+  /* Settings which are not stored in custom data might have changed. */
+  BKE_mesh_copy_settings(result, coarse_mesh);
+  SubdivMeshCacheEvalData data = {
+      .subdiv = subdiv,
+      .vertex_patch_coords = cache->vertex_patch_coords,
+      .mvert = result->mvert,
+      .totvert = result->totvert,
+  };
+  const int num_batches = (result->totvert + SUBDIV_MESH_EVAL_BATCH_SIZE - 1) /
+                          SUBDIV_MESH_EVAL_BATCH_SIZE;
+  TaskParallelSettings parallel_range_settings;
+  BLI_parallel_range_settings_defaults(&parallel_range_settings);
+  BLI_task_parallel_range(
+      0, num_batches, &data, subdiv_mesh_cache_eval_positions_task, &parallel_range_settings);
+  /* Same as the full traversal, which only evaluates normals for adaptive subdivision. */
+  result->runtime.cd_dirty_vert |= CD_MASK_NORMAL;
+  return result;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Public entry point
+ * \{ */
+
+Mesh *BKE_subdiv_to_mesh(Subdiv *subdiv,
+                         const SubdivToMeshSettings *settings,
+                         const Mesh *coarse_mesh)
+{
+  return subdiv_to_mesh(subdiv, settings, coarse_mesh, NULL);
+}
+
+Mesh *BKE_subdiv_to_mesh_cached(Subdiv *subdiv,
+                                const SubdivToMeshSettings *settings,
+                                const Mesh *coarse_mesh,
+                                SubdivMeshCache *cache)
+{
+  if (subdiv_mesh_cache_is_valid(cache, subdiv, settings, coarse_mesh)) {
+    BKE_subdiv_stats_begin(&subdiv->stats, SUBDIV_STATS_SUBDIV_TO_MESH);
+    Mesh *result = NULL;
+    /* Refine the evaluator for the new positions of the coarse vertices. */
+    if (BKE_subdiv_eval_begin_from_mesh(subdiv, coarse_mesh, NULL)) {
+      result = subdiv_mesh_cache_deform(cache, subdiv, coarse_mesh);
+    }
+    BKE_subdiv_stats_end(&subdiv->stats, SUBDIV_STATS_SUBDIV_TO_MESH);
+    return result;
+  }
+  subdiv_mesh_cache_clear(cache);
+  OpenSubdiv_PatchCoord *vertex_patch_coords = NULL;
+  Mesh *result = subdiv_to_mesh(subdiv, settings, coarse_mesh, &vertex_patch_coords);
+  if (result != NULL && vertex_patch_coords != NULL &&
+      subdiv_mesh_cache_can_store(subdiv, coarse_mesh, result, vertex_patch_coords)) {
+    subdiv_mesh_cache_store(cache, subdiv, settings, coarse_mesh, result, vertex_patch_coords);
+  }
+  else {
+    MEM_SAFE_FREE(vertex_patch_coords);
+  }
+  return result;
+}
+
+/** \} */
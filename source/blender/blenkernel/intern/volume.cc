@@ -24,6 +24,7 @@
 #include "DNA_material_types.h"
 #include "DNA_object_types.h"
 #include "DNA_scene_types.h"
+#include "DNA_userdef_types.h"
 #include "DNA_volume_types.h"
 
 #include "BLI_compiler_compat.h"
@@ -85,7 +86,17 @@ static CLG_LogRef LOG = {"bke.volume"};
  * rendering for example. So, depending on the users the grid in the cache may
  * have a tree or not.
  *
- * When the number of users drops to zero, the grid data is immediately deleted.
+ * When the number of tree users drops to zero, the tree is kept in memory as long as the memory
+ * used by such unused trees stays below the volume cache limit in the user preferences. That way
+ * going back to a frame that has been displayed before does not require reading the file again.
+ * When the limit is exceeded, the least recently used unused trees are deleted first. Trees that
+ * are in use are never deleted, because other code may access their voxels at any time.
+ *
+ * Trees are read with OpenVDB's delayed loading, so voxel buffers of leaf nodes are only paged
+ * in from the file when they are accessed.
+ *
+ * Entries remember the modification time of their file, so that trees kept in the cache are not
+ * used anymore after the file has been written again, for example by a simulation.
  *
  * TODO: also add a cache for OpenVDB files rather than individual grids,
  * so getting the list of grids is also cached.
@@ -97,13 +108,18 @@ static CLG_LogRef LOG = {"bke.volume"};
 static struct VolumeFileCache {
   /* Cache Entry */
   struct Entry {
-    Entry(const std::string &filepath, const openvdb::GridBase::Ptr &grid)
+    Entry(const std::string &filepath,
+          const openvdb::GridBase::Ptr &grid,
+          const int64_t file_mtime)
         : filepath(filepath),
           grid_name(grid->getName()),
           grid(grid),
+          file_mtime(file_mtime),
           is_loaded(false),
           num_metadata_users(0),
-          num_tree_users(0)
+          num_tree_users(0),
+          tree_memory(0),
+          last_used(0)
     {
     }
 
@@ -111,9 +127,12 @@ static struct VolumeFileCache {
         : filepath(other.filepath),
           grid_name(other.grid_name),
           grid(other.grid),
+          file_mtime(other.file_mtime),
           is_loaded(other.is_loaded),
           num_metadata_users(0),
-          num_tree_users(0)
+          num_tree_users(0),
+          tree_memory(0),
+          last_used(0)
     {
     }
 
@@ -143,6 +162,9 @@ static struct VolumeFileCache {
     /* Simplified versions of #grid. The integer key is the simplification level. */
     blender::Map<int, openvdb::GridBase::Ptr> simplified_grids;
 
+    /* Modification time of the file when the grid was read from it. */
+    int64_t file_mtime;
+
     /* Has the grid tree been loaded? */
     bool is_loaded;
     /* Error message if an error occured during loading. */
@@ -150,6 +172,10 @@ static struct VolumeFileCache {
     /* User counting. */
     int num_metadata_users;
     int num_tree_users;
+    /* Memory used by the loaded tree, in bytes. */
+    size_t tree_memory;
+    /* Time stamp of when the last tree user has been removed, used for LRU eviction. */
+    uint64_t last_used;
     /* Mutex for on-demand reading of tree. */
     std::mutex mutex;
   };
@@ -177,6 +203,8 @@ static struct VolumeFileCache {
 
   ~VolumeFileCache()
   {
+    /* Trees that are kept after their last user has been removed are still in the cache. */
+    evict_unused(0);
     BLI_assert(cache.empty());
   }
 
@@ -184,6 +212,21 @@ static struct VolumeFileCache {
   {
     std::lock_guard<std::mutex> lock(mutex);
     EntrySet::iterator it = cache.find(template_entry);
+    if (it != cache.end() && it->file_mtime != template_entry.file_mtime) {
+      /* The file has been written since the grid was read, don't give out a tree that was only
+       * kept in the cache. Trees that are still in use are left alone. */
+      Entry &entry = (Entry &)*it;
+      if (entry.num_metadata_users + entry.num_tree_users == 0) {
+        remove_entry(entry);
+        it = cache.end();
+      }
+      else if (entry.num_tree_users == 0) {
+        if (entry.is_loaded) {
+          unload_tree(entry);
+        }
+        entry.file_mtime = template_entry.file_mtime;
+      }
+    }
     if (it == cache.end()) {
       it = cache.emplace(template_entry).first;
     }
@@ -236,24 +279,116 @@ static struct VolumeFileCache {
     update_for_remove_user(entry);
   }
 
+  /* Called after the tree of an entry has been read from the file. With delayed loading this is
+   * only the memory of the tree topology, it is updated when the last tree user is removed. */
+  void add_loaded_tree(Entry &entry, const size_t tree_memory)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    entry.tree_memory = tree_memory;
+    memory_used += tree_memory;
+    evict_unused(memory_limit());
+  }
+
+  void update_memory_limit()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    evict_unused(memory_limit());
+  }
+
+  size_t get_memory_used()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return memory_used;
+  }
+
  protected:
+  static size_t memory_limit()
+  {
+    return (size_t)std::max(U.volume_cache_limit, 0) * 1024 * 1024;
+  }
+
   void update_for_remove_user(Entry &entry)
   {
-    if (entry.num_metadata_users + entry.num_tree_users == 0) {
-      cache.erase(entry);
+    if (entry.num_tree_users > 0) {
+      return;
+    }
+    if (entry.is_loaded && memory_limit() > 0) {
+      /* Keep the tree around in case it is used again soon. With delayed loading, leaf buffers
+       * are read from the file as they are accessed, so measure the memory again now that
+       * nobody is using the tree anymore. */
+      memory_used -= entry.tree_memory;
+      entry.tree_memory = entry.grid->memUsage();
+      memory_used += entry.tree_memory;
+      entry.last_used = ++use_counter;
+      evict_unused(memory_limit());
+      return;
+    }
+    if (entry.num_metadata_users == 0) {
+      remove_entry(entry);
+    }
+    else {
+      unload_tree(entry);
+    }
+  }
+
+  void unload_tree(Entry &entry)
+  {
+    /* Note we replace the grid rather than clearing, so that if there is
+     * any other shared pointer to the grid it will keep the tree. */
+    entry.grid = entry.grid->copyGridWithNewTree();
+    entry.simplified_grids.clear();
+    entry.is_loaded = false;
+    memory_used -= entry.tree_memory;
+    entry.tree_memory = 0;
+  }
+
+  void remove_entry(Entry &entry)
+  {
+    memory_used -= entry.tree_memory;
+    cache.erase(entry);
+  }
+
+  /* Delete least recently used trees that have no tree users, until the memory used by all loaded
+   * trees is below the limit or there are no more such trees. */
+  void evict_unused(const size_t limit)
+  {
+    while (memory_used > limit) {
+      Entry *oldest_entry = nullptr;
+      for (const Entry &entry : cache) {
+        if (entry.num_tree_users == 0 && entry.is_loaded &&
+            (oldest_entry == nullptr || entry.last_used < oldest_entry->last_used)) {
+          oldest_entry = (Entry *)&entry;
+        }
+      }
+      if (oldest_entry == nullptr) {
+        break;
+      }
+      if (oldest_entry->num_metadata_users == 0) {
+        remove_entry(*oldest_entry);
+      }
+      else {
+        unload_tree(*oldest_entry);
+      }
     }
-    else if (entry.num_tree_users == 0) {
-      /* Note we replace the grid rather than clearing, so that if there is
-       * any other shared pointer to the grid it will keep the tree. */
-      entry.grid = entry.grid->copyGridWithNewTree();
-      entry.simplified_grids.clear();
-      entry.is_loaded = false;
+    if (limit == 0) {
+      /* Also remove entries that are not used at all, but don't have a tree. */
+      for (EntrySet::iterator it = cache.begin(); it != cache.end();) {
+        if (it->num_metadata_users + it->num_tree_users == 0) {
+          it = cache.erase(it);
+        }
+        else {
+          ++it;
+        }
+      }
     }
   }
 
   /* Cache contents */
   typedef std::unordered_set<Entry, EntryHasher, EntryEqual> EntrySet;
   EntrySet cache;
+  /* Memory used by all loaded trees in the cache, in bytes. */
+  size_t memory_used = 0;
+  uint64_t use_counter = 0;
   /* Mutex for multithreaded access. */
   std::mutex mutex;
 } GLOBAL_CACHE;
@@ -322,9 +457,11 @@ struct VolumeGrid {
 
     try {
       file.setCopyMaxBytes(0);
-      file.open();
+      /* With delayed loading, voxel buffers are only read when they are accessed. */
+      file.open(true);
       openvdb::GridBase::Ptr vdb_grid = file.readGrid(name());
       entry->grid->setTree(vdb_grid->baseTreePtr());
+      GLOBAL_CACHE.add_loaded_tree(*entry, entry->grid->memUsage());
     }
     catch (const openvdb::IoError &e) {
       entry->error_msg = e.what();
@@ -492,6 +629,24 @@ void BKE_volumes_init()
 #endif
 }
 
+/* Global cache of grids loaded from files. */
+
+void BKE_volume_cache_limit_update(void)
+{
+#ifdef WITH_OPENVDB
+  GLOBAL_CACHE.update_memory_limit();
+#endif
+}
+
+size_t BKE_volume_cache_memory_used(void)
+{
+#ifdef WITH_OPENVDB
+  return GLOBAL_CACHE.get_memory_used();
+#else
+  return 0;
+#endif
+}
+
 /* Volume datablock */
 
 static void volume_init_data(ID *id)
@@ -790,6 +945,12 @@ bool BKE_volume_load(Volume *volume, Main *bmain)
     return false;
   }
 
+  /* Cached grids read from an older version of the file are not used. */
+  BLI_stat_t file_stat;
+  const int64_t file_mtime = (BLI_stat(grids.filepath, &file_stat) == 0) ?
+                                 (int64_t)file_stat.st_mtime :
+                                 0;
+
   /* Open OpenVDB file. */
   openvdb::io::File file(grids.filepath);
   openvdb::GridPtrVec vdb_grids;
@@ -808,7 +969,7 @@ bool BKE_volume_load(Volume *volume, Main *bmain)
   /* Add grids read from file to own vector, filtering out any NULL pointers. */
   for (const openvdb::GridBase::Ptr &vdb_grid : vdb_grids) {
     if (vdb_grid) {
-      VolumeFileCache::Entry template_entry(grids.filepath, vdb_grid);
+      VolumeFileCache::Entry template_entry(grids.filepath, vdb_grid, file_mtime);
       grids.emplace_back(template_entry, volume->runtime.default_simplify_level);
     }
   }
@@ -0,0 +1,128 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * A container that stores a separate value for every thread that accesses it. This is useful
+ * when threads have to accumulate data or need scratch memory (e.g. a #LinearAllocator) that
+ * should not be shared with other threads. After the parallel work is done, all values can be
+ * iterated over.
+ */
+
+#ifdef WITH_TBB
+/* Quiet top level deprecation message, unrelated to API usage here. */
+#  define TBB_SUPPRESS_DEPRECATED_MESSAGES 1
+#  include <tbb/enumerable_thread_specific.h>
+#endif
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "BLI_map.hh"
+#include "BLI_utility_mixins.hh"
+
+namespace blender {
+
+namespace enumerable_thread_specific_utils {
+/* Returns a small integer that uniquely identifies the calling thread. */
+inline int current_thread_id()
+{
+  static std::atomic<int> next_id = 0;
+  static thread_local const int thread_id = next_id.fetch_add(1);
+  return thread_id;
+}
+}  // namespace enumerable_thread_specific_utils
+
+template<typename T> class EnumerableThreadSpecific : NonCopyable, NonMovable {
+#ifdef WITH_TBB
+ private:
+  tbb::enumerable_thread_specific<T> values_;
+
+ public:
+  T &local()
+  {
+    return values_.local();
+  }
+
+  auto begin()
+  {
+    return values_.begin();
+  }
+
+  auto end()
+  {
+    return values_.end();
+  }
+
+#else
+ private:
+  std::mutex mutex_;
+  /* The values are not embedded in the map, so that their address does not change when the map
+   * grows. */
+  Map<int, std::unique_ptr<T>> values_;
+
+ public:
+  T &local()
+  {
+    const int thread_id = enumerable_thread_specific_utils::current_thread_id();
+    std::lock_guard lock{mutex_};
+    return *values_.lookup_or_add_cb(thread_id, []() { return std::make_unique<T>(); });
+  }
+
+  class Iterator {
+   private:
+    typename Map<int, std::unique_ptr<T>>::MutableValueIterator iterator_;
+
+   public:
+    Iterator(typename Map<int, std::unique_ptr<T>>::MutableValueIterator iterator)
+        : iterator_(iterator)
+    {
+    }
+
+    Iterator &operator++()
+    {
+      ++iterator_;
+      return *this;
+    }
+
+    T &operator*()
+    {
+      return **iterator_;
+    }
+
+    friend bool operator!=(const Iterator &a, const Iterator &b)
+    {
+      return a.iterator_ != b.iterator_;
+    }
+  };
+
+  Iterator begin()
+  {
+    return Iterator(values_.values().begin());
+  }
+
+  Iterator end()
+  {
+    return Iterator(values_.values().end());
+  }
+#endif
+};
+
+}  // namespace blender
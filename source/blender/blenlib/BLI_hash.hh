@@ -78,6 +78,7 @@
 #include <string>
 #include <utility>
 
+#include "BLI_hash_mm2a.h"
 #include "BLI_math_base.h"
 #include "BLI_string_ref.hh"
 #include "BLI_utildefines.h"
@@ -155,6 +156,31 @@ inline uint64_t hash_string(StringRef str)
   return hash;
 }
 
+/**
+ * Combine two hashes so that all bits of both contribute to all bits of the result. Unlike the
+ * trivial combinations used by the #DefaultHash specializations, this is suitable when the
+ * result is used as a key by itself, e.g. to detect whether cached data is still valid.
+ */
+inline uint64_t hash_combine(const uint64_t a, const uint64_t b)
+{
+  uint64_t x = a ^ (b + 0x9e3779b97f4a7c15ull + (a << 6) + (a >> 2));
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+/**
+ * A 64 bit hash of arbitrary data, made of two independently seeded 32 bit hashes, so that
+ * collisions are unlikely even for large amounts of data.
+ */
+inline uint64_t hash_bytes(const void *data, const int64_t size)
+{
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  const uint64_t low = BLI_hash_mm2(bytes, static_cast<size_t>(size), 0);
+  const uint64_t high = BLI_hash_mm2(bytes, static_cast<size_t>(size), 0x5bd1e995);
+  return (high << 32) | low;
+}
+
 template<> struct DefaultHash<std::string> {
   /**
    * Take a #StringRef as parameter to support heterogeneous lookups in hash table implementations
@@ -0,0 +1,58 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ * \brief Find points which are close enough to be merged.
+ */
+
+#include "BLI_bitmap.h"
+#include "BLI_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Find duplicate points in \a range, with the same result as #BLI_kdtree_3d_calc_duplicates_fast
+ * with `use_index_order` enabled. Points are sorted into a uniform grid instead of a tree, which
+ * allows finding the neighbors of all points in parallel.
+ *
+ * Merge targets are chosen in index order, so lower indices are preferred as targets and the
+ * result never depends on the layout of a tree. Points at exactly the same location are merged
+ * when \a range is zero.
+ *
+ * \param co: Coordinates of the first point, the coordinates of point `i` are at
+ * `co + i * co_stride` bytes.
+ * \param mask: When not null, only the points with an enabled bit are used.
+ * \param duplicates: An array of \a co_len int's.
+ * Values initialized to -1 are candidates to be merged.
+ * Setting the index to its own position in the array prevents it from being touched,
+ * although it can still be used as a target.
+ * \returns The number of merges found.
+ */
+int BLI_merge_by_distance_3d(const float *co,
+                             int co_len,
+                             size_t co_stride,
+                             const BLI_bitmap *mask,
+                             float range,
+                             int *duplicates);
+
+#ifdef __cplusplus
+}
+#endif
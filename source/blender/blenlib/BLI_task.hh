@@ -41,6 +41,8 @@
 #  endif
 #endif
 
+#include <algorithm>
+
 #include "BLI_index_range.hh"
 #include "BLI_utildefines.h"
 
@@ -75,4 +77,14 @@ void parallel_for(IndexRange range, int64_t grain_size, const Function &function
 #endif
 }
 
+template<typename RandomAccessIterator, typename Compare>
+void parallel_sort(RandomAccessIterator begin, RandomAccessIterator end, const Compare &comp)
+{
+#ifdef WITH_TBB
+  tbb::parallel_sort(begin, end, comp);
+#else
+  std::sort(begin, end, comp);
+#endif
+}
+
 }  // namespace blender
@@ -0,0 +1,281 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * The points are sorted into a uniform grid whose cells are at least as large as the merge
+ * distance, so all neighbors of a point are in the 27 cells around it. Cells are hashed into a
+ * fixed number of buckets, so memory usage only depends on the number of points, not on the size
+ * of the grid. Building the grid and finding the points that have any neighbor is done in
+ * parallel. Choosing the merge targets is serial, but only points with neighbors are searched
+ * again. Apart from points that are kept, targets are never in range of each other, so every point
+ * is only visited by a few targets and a large cluster of coincident points takes linear time.
+ */
+
+#include <algorithm>
+
+#include "atomic_ops.h"
+
+#include "BLI_array.hh"
+#include "BLI_float3.hh"
+#include "BLI_hash.h"
+#include "BLI_math_base.h"
+#include "BLI_math_vector.h"
+#include "BLI_merge_by_distance.h"
+#include "BLI_task.hh"
+
+namespace blender {
+
+/* Limit the number of cells along every axis, so that cell coordinates can't overflow. When the
+ * merge distance is tiny compared to the size of the point set, cells become larger than the merge
+ * distance, which is slower but still correct. */
+static constexpr int max_cells_per_axis = 1 << 20;
+/* The number of buckets is a power of two that has to fit in an int. */
+static constexpr int64_t max_buckets_num = 1 << 30;
+static constexpr int64_t grain_size = 4096;
+
+struct MergeGrid {
+  float3 min;
+  float cell_size_inv;
+  uint32_t bucket_mask;
+  /* Points of bucket `b` are `bucket_points[bucket_offsets[b]]` until the next offset. */
+  Array<int> bucket_offsets;
+  Array<int> bucket_points;
+};
+
+struct MergePoints {
+  const float *co;
+  size_t co_stride;
+  const BLI_bitmap *mask;
+
+  const float *operator[](const int64_t i) const
+  {
+    return (const float *)POINTER_OFFSET(co, co_stride * (size_t)i);
+  }
+
+  bool is_used(const int64_t i) const
+  {
+    return mask == nullptr || BLI_BITMAP_TEST(mask, i);
+  }
+};
+
+static void merge_grid_cell(const MergeGrid &grid, const float co[3], int r_cell[3])
+{
+  for (int axis = 0; axis < 3; axis++) {
+    const float cell = (co[axis] - grid.min[axis]) * grid.cell_size_inv;
+    r_cell[axis] = std::clamp(static_cast<int>(cell), 0, max_cells_per_axis - 1);
+  }
+}
+
+static uint32_t merge_grid_bucket(const MergeGrid &grid, const int x, const int y, const int z)
+{
+  return BLI_hash_int_2d(BLI_hash_int_2d((uint)x, (uint)y), (uint)z) & grid.bucket_mask;
+}
+
+static void merge_grid_bounds(const MergePoints &points,
+                              const int64_t points_len,
+                              float3 &r_min,
+                              float3 &r_max)
+{
+  const int64_t chunks_num = (points_len + grain_size - 1) / grain_size;
+  Array<float3> chunk_min(chunks_num, float3(FLT_MAX));
+  Array<float3> chunk_max(chunks_num, float3(-FLT_MAX));
+  parallel_for(IndexRange(chunks_num), 1, [&](IndexRange chunks) {
+    for (const int64_t chunk : chunks) {
+      const IndexRange range(chunk * grain_size,
+                             std::min(grain_size, points_len - chunk * grain_size));
+      for (const int64_t i : range) {
+        if (points.is_used(i)) {
+          minmax_v3v3_v3(chunk_min[chunk], chunk_max[chunk], points[i]);
+        }
+      }
+    }
+  });
+  r_min = float3(FLT_MAX);
+  r_max = float3(-FLT_MAX);
+  for (const int64_t chunk : IndexRange(chunks_num)) {
+    minmax_v3v3_v3(r_min, r_max, chunk_min[chunk]);
+    minmax_v3v3_v3(r_min, r_max, chunk_max[chunk]);
+  }
+}
+
+static void merge_grid_build(const MergePoints &points,
+                             const int64_t points_len,
+                             const float range,
+                             MergeGrid &grid)
+{
+  float3 min, max;
+  merge_grid_bounds(points, points_len, min, max);
+  const float3 size = max - min;
+  const float max_size = std::max({size.x, size.y, size.z, 0.0f});
+  float cell_size = std::max(range, max_size / (max_cells_per_axis - 1));
+  if (!(cell_size > 0.0f)) {
+    /* All points are at the same location. */
+    cell_size = 1.0f;
+  }
+  grid.min = min;
+  grid.cell_size_inv = 1.0f / cell_size;
+
+  const int64_t buckets_num = power_of_2_max_i(
+      static_cast<int>(std::clamp<int64_t>(points_len, 1, max_buckets_num)));
+  grid.bucket_mask = static_cast<uint32_t>(buckets_num - 1);
+
+  /* Counting sort of the points by bucket. The order of the points within a bucket depends on
+   * the scheduling of the threads, the result of the search does not. */
+  Array<uint32_t> point_buckets(points_len);
+  grid.bucket_offsets = Array<int>(buckets_num + 1, 0);
+  parallel_for(IndexRange(points_len), grain_size, [&](IndexRange range) {
+    for (const int64_t i : range) {
+      if (!points.is_used(i)) {
+        continue;
+      }
+      int cell[3];
+      merge_grid_cell(grid, points[i], cell);
+      const uint32_t bucket = merge_grid_bucket(grid, cell[0], cell[1], cell[2]);
+      point_buckets[i] = bucket;
+      atomic_add_and_fetch_int32(&grid.bucket_offsets[bucket], 1);
+    }
+  });
+  int offset = 0;
+  for (const int64_t bucket : IndexRange(buckets_num)) {
+    const int count = grid.bucket_offsets[bucket];
+    grid.bucket_offsets[bucket] = offset;
+    offset += count;
+  }
+  grid.bucket_offsets[buckets_num] = offset;
+
+  grid.bucket_points = Array<int>(offset);
+  Array<int> bucket_fill(buckets_num);
+  bucket_fill.as_mutable_span().copy_from(grid.bucket_offsets.as_span().take_front(buckets_num));
+  parallel_for(IndexRange(points_len), grain_size, [&](IndexRange range) {
+    for (const int64_t i : range) {
+      if (points.is_used(i)) {
+        const int index = atomic_fetch_and_add_int32(&bucket_fill[point_buckets[i]], 1);
+        grid.bucket_points[index] = static_cast<int>(i);
+      }
+    }
+  });
+}
+
+/**
+ * Call the function for all other points which are in range of the given point, until it
+ * returns false.
+ */
+template<typename Func>
+static void merge_grid_foreach_neighbor(const MergeGrid &grid,
+                                        const MergePoints &points,
+                                        const float range_sq,
+                                        const int64_t index,
+                                        const Func &func)
+{
+  const float *co = points[index];
+  int cell[3];
+  merge_grid_cell(grid, co, cell);
+  int cell_min[3], cell_max[3];
+  for (int axis = 0; axis < 3; axis++) {
+    cell_min[axis] = std::max(cell[axis] - 1, 0);
+    cell_max[axis] = std::min(cell[axis] + 1, max_cells_per_axis - 1);
+  }
+  /* Neighboring cells can be in the same bucket, every bucket must only be visited once. */
+  uint32_t visited_buckets[27];
+  int visited_buckets_len = 0;
+  for (int x = cell_min[0]; x <= cell_max[0]; x++) {
+    for (int y = cell_min[1]; y <= cell_max[1]; y++) {
+      for (int z = cell_min[2]; z <= cell_max[2]; z++) {
+        const uint32_t bucket = merge_grid_bucket(grid, x, y, z);
+        if (std::find(visited_buckets, visited_buckets + visited_buckets_len, bucket) !=
+            visited_buckets + visited_buckets_len) {
+          continue;
+        }
+        visited_buckets[visited_buckets_len++] = bucket;
+        for (int i = grid.bucket_offsets[bucket]; i < grid.bucket_offsets[bucket + 1]; i++) {
+          const int other = grid.bucket_points[i];
+          if (other != index && len_squared_v3v3(co, points[other]) <= range_sq) {
+            if (!func(other)) {
+              return;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+static int merge_by_distance(const MergePoints &points,
+                             const int64_t points_len,
+                             const float range,
+                             int *duplicates)
+{
+  const float range_sq = square_f(range);
+  MergeGrid grid;
+  merge_grid_build(points, points_len, range, grid);
+
+  /* Points without any neighbor are neither merged nor targets, which is the case for most
+   * points, so only the others have to be searched in order. */
+  Array<bool> has_neighbor(points_len, false);
+  parallel_for(IndexRange(points_len), grain_size, [&](IndexRange range) {
+    for (const int64_t i : range) {
+      if (points.is_used(i)) {
+        merge_grid_foreach_neighbor(grid, points, range_sq, i, [&](int) {
+          has_neighbor[i] = true;
+          return false;
+        });
+      }
+    }
+  });
+
+  /* Loop over the points in index order, every point that hasn't been merged yet takes all its
+   * neighbors which haven't been merged either. */
+  auto can_be_target = [&](const int64_t i) {
+    return points.is_used(i) && ELEM(duplicates[i], -1, i);
+  };
+  int found = 0;
+  for (const int64_t i : IndexRange(points_len)) {
+    if (!has_neighbor[i] || !can_be_target(i)) {
+      continue;
+    }
+    const int found_prev = found;
+    merge_grid_foreach_neighbor(grid, points, range_sq, i, [&](const int other) {
+      if (duplicates[other] == -1) {
+        duplicates[other] = static_cast<int>(i);
+        found++;
+      }
+      return true;
+    });
+    if (found != found_prev) {
+      /* Prevent chains of doubles. */
+      duplicates[i] = static_cast<int>(i);
+    }
+  }
+  return found;
+}
+
+}  // namespace blender
+
+int BLI_merge_by_distance_3d(const float *co,
+                             const int co_len,
+                             const size_t co_stride,
+                             const BLI_bitmap *mask,
+                             const float range,
+                             int *duplicates)
+{
+  if (co_len == 0) {
+    return 0;
+  }
+  const blender::MergePoints points{co, co_stride, mask};
+  return blender::merge_by_distance(points, co_len, range, duplicates);
+}
@@ -0,0 +1,126 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_kdtree.h"
+#include "BLI_merge_by_distance.h"
+#include "BLI_rand.h"
+
+TEST(merge_by_distance, Empty)
+{
+  EXPECT_EQ(BLI_merge_by_distance_3d(nullptr, 0, sizeof(float[3]), nullptr, 0.1f, nullptr), 0);
+}
+
+TEST(merge_by_distance, Simple)
+{
+  const float co[5][3] = {
+      {0.0f, 0.0f, 0.0f},
+      {0.05f, 0.0f, 0.0f},
+      {1.0f, 0.0f, 0.0f},
+      {0.0f, 0.0f, 0.09f},
+      {1.0f, 0.0f, 0.0f},
+  };
+  int duplicates[5] = {-1, -1, -1, -1, -1};
+  EXPECT_EQ(BLI_merge_by_distance_3d(co[0], 5, sizeof(*co), nullptr, 0.1f, duplicates), 3);
+  EXPECT_EQ(duplicates[0], 0);
+  EXPECT_EQ(duplicates[1], 0);
+  EXPECT_EQ(duplicates[2], 2);
+  EXPECT_EQ(duplicates[3], 0);
+  EXPECT_EQ(duplicates[4], 2);
+}
+
+TEST(merge_by_distance, NoChains)
+{
+  /* The third point is only in range of the second one, which is merged into the first. */
+  const float co[3][3] = {
+      {0.0f, 0.0f, 0.0f},
+      {0.08f, 0.0f, 0.0f},
+      {0.16f, 0.0f, 0.0f},
+  };
+  int duplicates[3] = {-1, -1, -1};
+  EXPECT_EQ(BLI_merge_by_distance_3d(co[0], 3, sizeof(*co), nullptr, 0.1f, duplicates), 1);
+  EXPECT_EQ(duplicates[0], 0);
+  EXPECT_EQ(duplicates[1], 0);
+  EXPECT_EQ(duplicates[2], -1);
+}
+
+TEST(merge_by_distance, KeepAndMask)
+{
+  const float co[4][3] = {
+      {0.0f, 0.0f, 0.0f},
+      {0.0f, 0.0f, 0.0f},
+      {0.0f, 0.0f, 0.0f},
+      {0.0f, 0.0f, 0.0f},
+  };
+  /* The second point is kept, the last one is not used. */
+  int duplicates[4] = {-1, 1, -1, -1};
+  BLI_bitmap *mask = BLI_BITMAP_NEW(4, __func__);
+  for (int i = 0; i < 3; i++) {
+    BLI_BITMAP_ENABLE(mask, i);
+  }
+  EXPECT_EQ(BLI_merge_by_distance_3d(co[0], 4, sizeof(*co), mask, 0.0f, duplicates), 1);
+  EXPECT_EQ(duplicates[0], 0);
+  EXPECT_EQ(duplicates[1], 1);
+  EXPECT_EQ(duplicates[2], 0);
+  EXPECT_EQ(duplicates[3], -1);
+  MEM_freeN(mask);
+}
+
+/* All points of a large cluster are merged into the first one. */
+TEST(merge_by_distance, Cluster)
+{
+  const int points_len = 100000;
+  float(*co)[3] = (float(*)[3])MEM_calloc_arrayN(points_len, sizeof(*co), __func__);
+  int *duplicates = (int *)MEM_malloc_arrayN(points_len, sizeof(int), __func__);
+  for (int i = 0; i < points_len; i++) {
+    duplicates[i] = -1;
+  }
+  EXPECT_EQ(BLI_merge_by_distance_3d(co[0], points_len, sizeof(*co), nullptr, 0.0f, duplicates),
+            points_len - 1);
+  for (int i = 0; i < points_len; i++) {
+    EXPECT_EQ(duplicates[i], 0);
+  }
+  MEM_freeN(duplicates);
+  MEM_freeN(co);
+}
+
+/* Result has to match the kd-tree when looping over the points in index order. */
+TEST(merge_by_distance, MatchKDTree)
+{
+  const int points_len = 20000;
+  const float range = 0.02f;
+  float(*co)[3] = (float(*)[3])MEM_malloc_arrayN(points_len, sizeof(*co), __func__);
+  RNG *rng = BLI_rng_new(0);
+  for (int i = 0; i < points_len; i++) {
+    for (int axis = 0; axis < 3; axis++) {
+      co[i][axis] = BLI_rng_get_float(rng);
+    }
+  }
+  BLI_rng_free(rng);
+
+  int *duplicates_tree = (int *)MEM_malloc_arrayN(points_len, sizeof(int), __func__);
+  int *duplicates_grid = (int *)MEM_malloc_arrayN(points_len, sizeof(int), __func__);
+  KDTree_3d *tree = BLI_kdtree_3d_new(points_len);
+  for (int i = 0; i < points_len; i++) {
+    BLI_kdtree_3d_insert(tree, i, co[i]);
+    duplicates_tree[i] = -1;
+    duplicates_grid[i] = -1;
+  }
+  BLI_kdtree_3d_balance(tree);
+  const int found_tree = BLI_kdtree_3d_calc_duplicates_fast(tree, range, true, duplicates_tree);
+  BLI_kdtree_3d_free(tree);
+
+  const int found_grid = BLI_merge_by_distance_3d(
+      co[0], points_len, sizeof(*co), nullptr, range, duplicates_grid);
+  EXPECT_GT(found_grid, 0);
+  EXPECT_EQ(found_tree, found_grid);
+  for (int i = 0; i < points_len; i++) {
+    EXPECT_EQ(duplicates_tree[i], duplicates_grid[i]);
+  }
+
+  MEM_freeN(duplicates_tree);
+  MEM_freeN(duplicates_grid);
+  MEM_freeN(co);
+}
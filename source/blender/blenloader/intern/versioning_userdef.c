@@ -818,6 +818,10 @@ void blo_do_versions_userdef(UserDef *userdef)
     userdef->uiflag &= ~USER_UIFLAG_UNUSED_3;
   }
 
+  if (!USER_VERSION_ATLEAST(292, 7)) {
+    userdef->volume_cache_limit = 1024;
+  }
+
   /**
    * Versioning code until next subversion bump goes here.
    *
@@ -3618,6 +3618,9 @@ void DRW_batch_cache_free_old(Object *ob, int ctime)
         DRW_mesh_batch_cache_free_old(mesh_eval, ctime);
       }
       break;
+    case OB_POINTCLOUD:
+      DRW_pointcloud_batch_cache_free_old((PointCloud *)ob->data, ctime);
+      break;
     /* TODO all cases */
     default:
       break;
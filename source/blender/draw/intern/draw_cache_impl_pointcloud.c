@@ -28,32 +28,60 @@
 #include "MEM_guardedalloc.h"
 
 #include "BLI_math_base.h"
+#include "BLI_math_matrix.h"
 #include "BLI_math_vector.h"
 #include "BLI_utildefines.h"
 
 #include "DNA_object_types.h"
 #include "DNA_pointcloud_types.h"
+#include "DNA_userdef_types.h"
 
 #include "BKE_pointcloud.h"
 
 #include "GPU_batch.h"
 
+#include "DRW_render.h"
+
 #include "draw_cache_impl.h" /* own include */
 
+/* Point clouds with fewer points are always drawn completely. */
+#define POINTCLOUD_LOD_MIN_POINTS (1 << 20)
+/* Amount of points drawn for every pixel that is covered by the bounds of the point cloud. */
+#define POINTCLOUD_LOD_POINTS_PER_PIXEL 2.0f
+
 static void pointcloud_batch_cache_clear(PointCloud *pointcloud);
 
 /* ---------------------------------------------------------------------- */
 /* PointCloud GPUBatch Cache */
 
-typedef struct PointCloudBatchCache {
-  GPUVertBuf *pos;  /* Position and radius. */
-  GPUVertBuf *geom; /* Instanced geometry for each point in the cloud (small sphere). */
-  GPUIndexBuf *geom_indices;
+/* Buffers and batches for one level of detail. */
+typedef struct PointCloudBatchLevel {
+  GPUVertBuf *pos; /* Position and radius. */
+  /* Amount of points in #pos, a prefix of the LOD ordering. */
+  int points_len;
 
   GPUBatch *dots;
   GPUBatch *surface;
   GPUBatch **surface_per_mat;
 
+  /* Set when the level is drawn, used to free levels that are not drawn anymore. */
+  bool used_over_time;
+  int lastused;
+} PointCloudBatchLevel;
+
+typedef struct PointCloudBatchCache {
+  GPUVertBuf *geom; /* Instanced geometry for each point in the cloud (small sphere). */
+  GPUIndexBuf *geom_indices;
+
+  /* Level of detail ordering of the points, only built for large point clouds. */
+  PointCloudLOD *lod;
+  /* The cache is shared by all objects that use the point cloud, and each of them can need a
+   * different level of detail. So every level gets its own batches, which are created on first
+   * use and freed by #DRW_pointcloud_batch_cache_free_old when they haven't been drawn for a
+   * while. The last level contains all points. */
+  PointCloudBatchLevel *levels;
+  int levels_len;
+
   /* settings to determine if cache is invalid */
   bool is_dirty;
 
@@ -87,8 +115,18 @@ static void pointcloud_batch_cache_init(PointCloud *pointcloud)
   }
 
   cache->mat_len = DRW_pointcloud_material_count_get(pointcloud);
-  cache->surface_per_mat = MEM_callocN(sizeof(GPUBatch *) * cache->mat_len,
-                                       "pointcloud suface_per_mat");
+
+  if (pointcloud->totpoint >= POINTCLOUD_LOD_MIN_POINTS) {
+    cache->lod = BKE_pointcloud_lod_build(pointcloud);
+  }
+  cache->levels_len = cache->lod ? cache->lod->levels_num : 1;
+  cache->levels = MEM_callocN(sizeof(*cache->levels) * cache->levels_len, __func__);
+  for (int i = 0; i < cache->levels_len; i++) {
+    PointCloudBatchLevel *level = &cache->levels[i];
+    level->points_len = cache->lod ? cache->lod->level_sizes[i] : pointcloud->totpoint;
+    level->surface_per_mat = MEM_callocN(sizeof(GPUBatch *) * cache->mat_len,
+                                         "pointcloud suface_per_mat");
+  }
 
   cache->is_dirty = false;
 }
@@ -121,6 +159,18 @@ void DRW_pointcloud_batch_cache_dirty_tag(PointCloud *pointcloud, int mode)
   }
 }
 
+static void pointcloud_batch_cache_level_discard(PointCloudBatchCache *cache,
+                                                 PointCloudBatchLevel *level)
+{
+  GPU_BATCH_DISCARD_SAFE(level->dots);
+  GPU_BATCH_DISCARD_SAFE(level->surface);
+  GPU_VERTBUF_DISCARD_SAFE(level->pos);
+
+  for (int j = 0; j < cache->mat_len; j++) {
+    GPU_BATCH_DISCARD_SAFE(level->surface_per_mat[j]);
+  }
+}
+
 static void pointcloud_batch_cache_clear(PointCloud *pointcloud)
 {
   PointCloudBatchCache *cache = pointcloud->batch_cache;
@@ -128,18 +178,21 @@ static void pointcloud_batch_cache_clear(PointCloud *pointcloud)
     return;
   }
 
-  GPU_BATCH_DISCARD_SAFE(cache->dots);
-  GPU_BATCH_DISCARD_SAFE(cache->surface);
-  GPU_VERTBUF_DISCARD_SAFE(cache->pos);
+  for (int i = 0; i < cache->levels_len; i++) {
+    PointCloudBatchLevel *level = &cache->levels[i];
+    pointcloud_batch_cache_level_discard(cache, level);
+    MEM_freeN(level->surface_per_mat);
+  }
+  MEM_SAFE_FREE(cache->levels);
+  cache->levels_len = 0;
+
   GPU_VERTBUF_DISCARD_SAFE(cache->geom);
   GPU_INDEXBUF_DISCARD_SAFE(cache->geom_indices);
 
-  if (cache->surface_per_mat) {
-    for (int i = 0; i < cache->mat_len; i++) {
-      GPU_BATCH_DISCARD_SAFE(cache->surface_per_mat[i]);
-    }
+  if (cache->lod) {
+    BKE_pointcloud_lod_free(cache->lod);
+    cache->lod = NULL;
   }
-  MEM_SAFE_FREE(cache->surface_per_mat);
 }
 
 void DRW_pointcloud_batch_cache_free(PointCloud *pointcloud)
@@ -148,9 +201,92 @@ void DRW_pointcloud_batch_cache_free(PointCloud *pointcloud)
   MEM_SAFE_FREE(pointcloud->batch_cache);
 }
 
-static void pointcloud_batch_cache_ensure_pos(Object *ob, PointCloudBatchCache *cache)
+/* Thread safety need to be assured by caller. Don't call this during drawing.
+ * Frees the buffers of levels of detail that haven't been drawn for #U.vbotimeout seconds. */
+void DRW_pointcloud_batch_cache_free_old(PointCloud *pointcloud, int ctime)
 {
-  if (cache->pos != NULL) {
+  PointCloudBatchCache *cache = pointcloud->batch_cache;
+  if (cache == NULL) {
+    return;
+  }
+
+  for (int i = 0; i < cache->levels_len; i++) {
+    PointCloudBatchLevel *level = &cache->levels[i];
+    if (level->used_over_time) {
+      level->lastused = ctime;
+      level->used_over_time = false;
+    }
+    else if (level->pos != NULL && ctime - level->lastused > U.vbotimeout) {
+      pointcloud_batch_cache_level_discard(cache, level);
+    }
+  }
+}
+
+/**
+ * Find the level of detail that has enough points to draw the object without visible gaps, based
+ * on the screen space area covered by its bounds.
+ */
+static PointCloudBatchLevel *pointcloud_batch_cache_level_find(Object *ob,
+                                                               PointCloudBatchCache *cache)
+{
+  PointCloudBatchLevel *level_all = &cache->levels[cache->levels_len - 1];
+  const PointCloudLOD *lod = cache->lod;
+  if (lod == NULL || DRW_state_is_image_render() || DRW_view_default_get() == NULL) {
+    return level_all;
+  }
+
+  float persmat[4][4], obpersmat[4][4];
+  DRW_view_persmat_get(NULL, persmat, false);
+  mul_m4_m4m4(obpersmat, persmat, ob->obmat);
+
+  float screen_min[2] = {1.0f, 1.0f};
+  float screen_max[2] = {-1.0f, -1.0f};
+  for (int i = 0; i < 8; i++) {
+    float co[4] = {
+        (i & 1) ? lod->max[0] : lod->min[0],
+        (i & 2) ? lod->max[1] : lod->min[1],
+        (i & 4) ? lod->max[2] : lod->min[2],
+        1.0f,
+    };
+    mul_m4_v4(obpersmat, co);
+    if (co[3] <= FLT_EPSILON) {
+      /* Bounds intersect the near plane, the point cloud may cover the whole screen. */
+      return level_all;
+    }
+    const float ndc[2] = {co[0] / co[3], co[1] / co[3]};
+    minmax_v2v2_v2(screen_min, screen_max, ndc);
+  }
+  CLAMP(screen_min[0], -1.0f, 1.0f);
+  CLAMP(screen_min[1], -1.0f, 1.0f);
+  CLAMP(screen_max[0], -1.0f, 1.0f);
+  CLAMP(screen_max[1], -1.0f, 1.0f);
+
+  const float *viewport_size = DRW_viewport_size_get();
+  const float area = max_ff(screen_max[0] - screen_min[0], 0.0f) * 0.5f * viewport_size[0] *
+                     max_ff(screen_max[1] - screen_min[1], 0.0f) * 0.5f * viewport_size[1];
+  const float points_len = area * POINTCLOUD_LOD_POINTS_PER_PIXEL;
+
+  for (int i = 0; i < cache->levels_len; i++) {
+    if (cache->levels[i].points_len >= points_len) {
+      return &cache->levels[i];
+    }
+  }
+  return level_all;
+}
+
+static PointCloudBatchLevel *pointcloud_batch_cache_level_get(Object *ob,
+                                                              PointCloudBatchCache *cache)
+{
+  PointCloudBatchLevel *level = pointcloud_batch_cache_level_find(ob, cache);
+  level->used_over_time = true;
+  return level;
+}
+
+static void pointcloud_batch_cache_ensure_pos(Object *ob,
+                                              PointCloudBatchCache *cache,
+                                              PointCloudBatchLevel *level)
+{
+  if (level->pos != NULL) {
     return;
   }
 
@@ -172,11 +308,24 @@ static void pointcloud_batch_cache_ensure_pos(Object *ob, PointCloudBatchCache *
     pos = GPU_vertformat_attr_add(&format, "pos", GPU_COMP_F32, 4, GPU_FETCH_FLOAT);
   }
 
-  cache->pos = GPU_vertbuf_create_with_format(has_radius ? &format : &format_no_radius);
-  GPU_vertbuf_data_alloc(cache->pos, pointcloud->totpoint);
-
-  if (has_radius) {
-    float(*vbo_data)[4] = (float(*)[4])GPU_vertbuf_get_data(cache->pos);
+  level->pos = GPU_vertbuf_create_with_format(has_radius ? &format : &format_no_radius);
+  GPU_vertbuf_data_alloc(level->pos, level->points_len);
+
+  if (level->points_len < pointcloud->totpoint) {
+    /* Only upload the first levels of detail. */
+    const int *order = cache->lod->order;
+    float *vbo_data = (float *)GPU_vertbuf_get_data(level->pos);
+    const int stride = has_radius ? 4 : 3;
+    for (int i = 0; i < level->points_len; i++) {
+      const int point = order[i];
+      copy_v3_v3(&vbo_data[i * stride], pointcloud->co[point]);
+      if (has_radius) {
+        vbo_data[i * stride + 3] = pointcloud->radius[point] * 100.0f;
+      }
+    }
+  }
+  else if (has_radius) {
+    float(*vbo_data)[4] = (float(*)[4])GPU_vertbuf_get_data(level->pos);
     for (int i = 0; i < pointcloud->totpoint; i++) {
       copy_v3_v3(vbo_data[i], pointcloud->co[i]);
       /* TODO(fclem): remove multiplication here.
@@ -185,7 +334,7 @@ static void pointcloud_batch_cache_ensure_pos(Object *ob, PointCloudBatchCache *
     }
   }
   else {
-    GPU_vertbuf_attr_fill(cache->pos, pos, pointcloud->co);
+    GPU_vertbuf_attr_fill(level->pos, pos, pointcloud->co);
   }
 }
 
@@ -240,29 +389,31 @@ GPUBatch *DRW_pointcloud_batch_cache_get_dots(Object *ob)
 {
   PointCloud *pointcloud = ob->data;
   PointCloudBatchCache *cache = pointcloud_batch_cache_get(pointcloud);
+  PointCloudBatchLevel *level = pointcloud_batch_cache_level_get(ob, cache);
 
-  if (cache->dots == NULL) {
-    pointcloud_batch_cache_ensure_pos(ob, cache);
-    cache->dots = GPU_batch_create(GPU_PRIM_POINTS, cache->pos, NULL);
+  if (level->dots == NULL) {
+    pointcloud_batch_cache_ensure_pos(ob, cache, level);
+    level->dots = GPU_batch_create(GPU_PRIM_POINTS, level->pos, NULL);
   }
 
-  return cache->dots;
+  return level->dots;
 }
 
 GPUBatch *DRW_pointcloud_batch_cache_get_surface(Object *ob)
 {
   PointCloud *pointcloud = ob->data;
   PointCloudBatchCache *cache = pointcloud_batch_cache_get(pointcloud);
+  PointCloudBatchLevel *level = pointcloud_batch_cache_level_get(ob, cache);
 
-  if (cache->surface == NULL) {
-    pointcloud_batch_cache_ensure_pos(ob, cache);
+  if (level->surface == NULL) {
+    pointcloud_batch_cache_ensure_pos(ob, cache, level);
     pointcloud_batch_cache_ensure_geom(ob, cache);
 
-    cache->surface = GPU_batch_create(GPU_PRIM_TRIS, cache->geom, cache->geom_indices);
-    GPU_batch_instbuf_add_ex(cache->surface, cache->pos, false);
+    level->surface = GPU_batch_create(GPU_PRIM_TRIS, cache->geom, cache->geom_indices);
+    GPU_batch_instbuf_add_ex(level->surface, level->pos, false);
   }
 
-  return cache->surface;
+  return level->surface;
 }
 
 GPUBatch **DRW_cache_pointcloud_surface_shaded_get(Object *ob,
@@ -273,16 +424,17 @@ GPUBatch **DRW_cache_pointcloud_surface_shaded_get(Object *ob,
   PointCloudBatchCache *cache = pointcloud_batch_cache_get(pointcloud);
   BLI_assert(cache->mat_len == gpumat_array_len);
   UNUSED_VARS(gpumat_array_len);
+  PointCloudBatchLevel *level = pointcloud_batch_cache_level_get(ob, cache);
 
-  if (cache->surface_per_mat[0] == NULL) {
-    pointcloud_batch_cache_ensure_pos(ob, cache);
+  if (level->surface_per_mat[0] == NULL) {
+    pointcloud_batch_cache_ensure_pos(ob, cache, level);
     pointcloud_batch_cache_ensure_geom(ob, cache);
 
-    cache->surface_per_mat[0] = GPU_batch_create(GPU_PRIM_TRIS, cache->geom, cache->geom_indices);
-    GPU_batch_instbuf_add_ex(cache->surface_per_mat[0], cache->pos, false);
+    level->surface_per_mat[0] = GPU_batch_create(GPU_PRIM_TRIS, cache->geom, cache->geom_indices);
+    GPU_batch_instbuf_add_ex(level->surface_per_mat[0], level->pos, false);
   }
 
-  return cache->surface_per_mat;
+  return level->surface_per_mat;
 }
 
 int DRW_pointcloud_material_count_get(PointCloud *pointcloud)
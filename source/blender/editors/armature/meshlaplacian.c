@@ -25,16 +25,20 @@
 #include "DNA_meshdata_types.h"
 #include "DNA_object_types.h"
 #include "DNA_scene_types.h"
+#include "DNA_windowmanager_types.h"
 
 #include "BLI_alloca.h"
 #include "BLI_edgehash.h"
 #include "BLI_math.h"
 #include "BLI_memarena.h"
-#include "BLI_string.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 
 #include "BLT_translation.h"
 
 #include "BKE_bvhutils.h"
+#include "BKE_global.h"
+#include "BKE_main.h"
 #include "BKE_mesh.h"
 #include "BKE_mesh_runtime.h"
 #include "BKE_mesh_wrapper.h"
@@ -45,22 +49,46 @@
 
 #include "DEG_depsgraph.h"
 
+#include "WM_api.h"
+#include "WM_types.h"
+
 #include "eigen_capi.h"
 
 #include "meshlaplacian.h"
 
-/* ************* XXX *************** */
-static void waitcursor(int UNUSED(val))
+/* ************* Progress *************** */
+
+/* Binding runs from the modifier evaluation, without a context, so use the active window. */
+static wmWindow *progress_window(void)
+{
+  if (G.background) {
+    return NULL;
+  }
+  wmWindowManager *wm = G_MAIN->wm.first;
+  return wm ? wm->winactive : NULL;
+}
+static void waitcursor(int val)
 {
+  WM_cursor_wait(val);
 }
-static void progress_bar(int UNUSED(dummy_val), const char *UNUSED(dummy))
+static void progress_bar(float progress)
 {
+  wmWindow *win = progress_window();
+  if (win) {
+    WM_cursor_time(win, (int)(progress * 100.0f));
+  }
 }
 static void start_progress_bar(void)
 {
+  /* Escape sets this, binding is cancelled when it is set. */
+  G.is_break = false;
 }
 static void end_progress_bar(void)
 {
+  wmWindow *win = progress_window();
+  if (win) {
+    WM_cursor_modal_restore(win);
+  }
 }
 static void error(const char *str)
 {
@@ -907,10 +935,11 @@ typedef struct MeshDeformBind {
 
   /* grids */
   MemArena *memarena;
+  /* intersections are found from multiple threads */
+  SpinLock memarena_lock;
   MDefBoundIsect *(*boundisect)[6];
   int *semibound;
   int *tag;
-  float *phi, *totalphi;
 
   /* mesh stuff */
   int *inside;
@@ -1043,7 +1072,9 @@ static MDefBoundIsect *meshdeform_ray_tree_intersect(MeshDeformBind *mdb,
     float(*mp_cagecos)[3] = BLI_array_alloca(mp_cagecos, mp->totloop);
 
     /* create MDefBoundIsect, and extra for 'poly_weights[]' */
+    BLI_spin_lock(&mdb->memarena_lock);
     isect = BLI_memarena_alloc(mdb->memarena, sizeof(*isect) + (sizeof(float) * mp->totloop));
+    BLI_spin_unlock(&mdb->memarena_lock);
 
     /* compute intersection coordinate */
     madd_v3_v3v3fl(isect->co, co1, isect_mdef.vec, len);
@@ -1151,6 +1182,26 @@ static void meshdeform_add_intersections(MeshDeformBind *mdb, int x, int y, int
   }
 }
 
+static void meshdeform_inside_cage_cb(void *__restrict userdata,
+                                      const int index,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MeshDeformBind *mdb = userdata;
+  mdb->inside[index] = meshdeform_inside_cage(mdb, mdb->vertexcos[index]);
+}
+
+static void meshdeform_add_intersections_cb(void *__restrict userdata,
+                                            const int z,
+                                            const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MeshDeformBind *mdb = userdata;
+  for (int y = 0; y < mdb->size; y++) {
+    for (int x = 0; x < mdb->size; x++) {
+      meshdeform_add_intersections(mdb, x, y, z);
+    }
+  }
+}
+
 static void meshdeform_bind_floodfill(MeshDeformBind *mdb)
 {
   int *stack, *tag = mdb->tag;
@@ -1235,6 +1286,7 @@ static float meshdeform_boundary_phi(const MeshDeformBind *mdb,
 }
 
 static float meshdeform_interp_w(MeshDeformBind *mdb,
+                                 const float *phi,
                                  const float *gridvec,
                                  float *UNUSED(vec),
                                  int UNUSED(cagevert))
@@ -1284,7 +1336,7 @@ static float meshdeform_interp_w(MeshDeformBind *mdb,
 
     int a = meshdeform_index(mdb, x, y, z, 0);
     float weight = wx * wy * wz;
-    result += weight * mdb->phi[a];
+    result += weight * phi[a];
     totweight += weight;
   }
 
@@ -1370,7 +1422,7 @@ static void meshdeform_matrix_add_cell(
 }
 
 static void meshdeform_matrix_add_rhs(
-    MeshDeformBind *mdb, LinearSolver *context, int x, int y, int z, int cagevert)
+    MeshDeformBind *mdb, double *rhs_vec, int x, int y, int z, int cagevert)
 {
   MDefBoundIsect *isect;
   float rhs, weight, totweight;
@@ -1393,13 +1445,13 @@ static void meshdeform_matrix_add_rhs(
     if (isect) {
       weight = (1.0f / isect->len) / totweight;
       rhs = weight * meshdeform_boundary_phi(mdb, isect, cagevert);
-      EIG_linear_solver_right_hand_side_add(context, 0, mdb->varidx[acenter], rhs);
+      rhs_vec[mdb->varidx[acenter]] += rhs;
     }
   }
 }
 
 static void meshdeform_matrix_add_semibound_phi(
-    MeshDeformBind *mdb, int x, int y, int z, int cagevert)
+    MeshDeformBind *mdb, float *phi, int x, int y, int z, int cagevert)
 {
   MDefBoundIsect *isect;
   float rhs, weight, totweight;
@@ -1410,7 +1462,7 @@ static void meshdeform_matrix_add_semibound_phi(
     return;
   }
 
-  mdb->phi[a] = 0.0f;
+  phi[a] = 0.0f;
 
   totweight = meshdeform_boundary_total_weight(mdb, x, y, z);
   for (i = 1; i <= 6; i++) {
@@ -1419,15 +1471,15 @@ static void meshdeform_matrix_add_semibound_phi(
     if (isect) {
       weight = (1.0f / isect->len) / totweight;
       rhs = weight * meshdeform_boundary_phi(mdb, isect, cagevert);
-      mdb->phi[a] += rhs;
+      phi[a] += rhs;
     }
   }
 }
 
 static void meshdeform_matrix_add_exterior_phi(
-    MeshDeformBind *mdb, int x, int y, int z, int UNUSED(cagevert))
+    MeshDeformBind *mdb, float *phi, int x, int y, int z, int UNUSED(cagevert))
 {
-  float phi, totweight;
+  float phi_sum, totweight;
   int i, a, acenter;
 
   acenter = meshdeform_index(mdb, x, y, z, 0);
@@ -1435,28 +1487,126 @@ static void meshdeform_matrix_add_exterior_phi(
     return;
   }
 
-  phi = 0.0f;
+  phi_sum = 0.0f;
   totweight = 0.0f;
   for (i = 1; i <= 6; i++) {
     a = meshdeform_index(mdb, x, y, z, i);
 
     if (a != -1 && mdb->semibound[a]) {
-      phi += mdb->phi[a];
+      phi_sum += phi[a];
       totweight += 1.0f;
     }
   }
 
   if (totweight != 0.0f) {
-    mdb->phi[acenter] = phi / totweight;
+    phi[acenter] = phi_sum / totweight;
   }
 }
 
-static void meshdeform_matrix_solve(MeshDeformModifierData *mmd, MeshDeformBind *mdb)
+typedef struct MeshDeformSolveData {
+  MeshDeformBind *mdb;
+  const LinearSolver *context;
+  int totvar;
+  /** The first cage vertex of the batch. */
+  int cagevert_start;
+  /** Grid values of every cage vertex in the batch, `size3` floats each. */
+  float *batch_phi;
+  bool *batch_failed;
+} MeshDeformSolveData;
+
+typedef struct MeshDeformSolveTLS {
+  double *rhs;
+  double *result;
+} MeshDeformSolveTLS;
+
+/* The factorized matrix is the same for all cage vertices, only the right hand side is different,
+ * so every cage vertex can be solved independently. */
+static void meshdeform_matrix_solve_cb(void *__restrict userdata,
+                                       const int batch_index,
+                                       const TaskParallelTLS *__restrict tls)
 {
-  LinearSolver *context;
+  const MeshDeformSolveData *data = userdata;
+  MeshDeformSolveTLS *solve_tls = tls->userdata_chunk;
+  MeshDeformBind *mdb = data->mdb;
+  float *phi = data->batch_phi + (size_t)batch_index * (size_t)mdb->size3;
+  const int a = data->cagevert_start + batch_index;
   float vec[3], gridvec[3];
+  int b, x, y, z;
+
+  if (solve_tls->rhs == NULL) {
+    solve_tls->rhs = MEM_mallocN(sizeof(double) * data->totvar, __func__);
+    solve_tls->result = MEM_mallocN(sizeof(double) * data->totvar, __func__);
+  }
+
+  /* fill in right hand side and solve */
+  memset(solve_tls->rhs, 0, sizeof(double) * data->totvar);
+  for (z = 0; z < mdb->size; z++) {
+    for (y = 0; y < mdb->size; y++) {
+      for (x = 0; x < mdb->size; x++) {
+        meshdeform_matrix_add_rhs(mdb, solve_tls->rhs, x, y, z, a);
+      }
+    }
+  }
+
+  if (!EIG_linear_solver_solve_vector(data->context, solve_tls->rhs, solve_tls->result)) {
+    data->batch_failed[batch_index] = true;
+    return;
+  }
+
+  memset(phi, 0, sizeof(float) * mdb->size3);
+  for (z = 0; z < mdb->size; z++) {
+    for (y = 0; y < mdb->size; y++) {
+      for (x = 0; x < mdb->size; x++) {
+        meshdeform_matrix_add_semibound_phi(mdb, phi, x, y, z, a);
+      }
+    }
+  }
+
+  for (z = 0; z < mdb->size; z++) {
+    for (y = 0; y < mdb->size; y++) {
+      for (x = 0; x < mdb->size; x++) {
+        meshdeform_matrix_add_exterior_phi(mdb, phi, x, y, z, a);
+      }
+    }
+  }
+
+  for (b = 0; b < mdb->size3; b++) {
+    if (mdb->tag[b] != MESHDEFORM_TAG_EXTERIOR) {
+      phi[b] = (float)solve_tls->result[mdb->varidx[b]];
+    }
+  }
+
+  if (mdb->weights) {
+    /* static bind : compute weights for each vertex */
+    for (b = 0; b < mdb->totvert; b++) {
+      if (mdb->inside[b]) {
+        copy_v3_v3(vec, mdb->vertexcos[b]);
+        gridvec[0] = (vec[0] - mdb->min[0] - mdb->halfwidth[0]) / mdb->width[0];
+        gridvec[1] = (vec[1] - mdb->min[1] - mdb->halfwidth[1]) / mdb->width[1];
+        gridvec[2] = (vec[2] - mdb->min[2] - mdb->halfwidth[2]) / mdb->width[2];
+
+        mdb->weights[b * mdb->totcagevert + a] = meshdeform_interp_w(mdb, phi, gridvec, vec, a);
+      }
+    }
+  }
+}
+
+static void meshdeform_matrix_solve_free(const void *__restrict UNUSED(userdata),
+                                         void *__restrict tls_v)
+{
+  MeshDeformSolveTLS *solve_tls = tls_v;
+  MEM_SAFE_FREE(solve_tls->rhs);
+  MEM_SAFE_FREE(solve_tls->result);
+}
+
+/* Memory the cage vertices solved at once may use, in bytes. */
+#define MESHDEFORM_SOLVE_BATCH_MEMORY (512 * 1024 * 1024)
+
+/* Returns false when binding was cancelled. */
+static bool meshdeform_matrix_solve(MeshDeformModifierData *mmd, MeshDeformBind *mdb)
+{
+  LinearSolver *context;
   int a, b, x, y, z, totvar;
-  char message[256];
 
   /* setup variable indices */
   mdb->varidx = MEM_callocN(sizeof(int) * mdb->size3, "MeshDeformDSvaridx");
@@ -1466,10 +1616,10 @@ static void meshdeform_matrix_solve(MeshDeformModifierData *mmd, MeshDeformBind
 
   if (totvar == 0) {
     MEM_freeN(mdb->varidx);
-    return;
+    return true;
   }
 
-  progress_bar(0, "Starting mesh deform solve");
+  progress_bar(0.0f);
 
   /* setup linear solver */
   context = EIG_linear_solver_new(totvar, totvar, 1);
@@ -1483,109 +1633,100 @@ static void meshdeform_matrix_solve(MeshDeformModifierData *mmd, MeshDeformBind
     }
   }
 
-  /* solve for each cage vert */
-  for (a = 0; a < mdb->totcagevert; a++) {
-    /* fill in right hand side and solve */
-    for (z = 0; z < mdb->size; z++) {
-      for (y = 0; y < mdb->size; y++) {
-        for (x = 0; x < mdb->size; x++) {
-          meshdeform_matrix_add_rhs(mdb, context, x, y, z, a);
-        }
-      }
-    }
+  /* Solve for a batch of cage verts at once. Every cage vert in the batch needs its grid values,
+   * and the thread solving it needs a right hand side and a result, so the batch is limited to
+   * what fits in the memory budget (but always solves at least one cage vert). */
+  const size_t cagevert_memory = sizeof(float) * (size_t)mdb->size3 +
+                                 sizeof(double[2]) * (size_t)totvar;
+  const int batch_size = max_ii(
+      1,
+      min_ii(min_ii(BLI_system_thread_count(), mdb->totcagevert),
+             (int)min_zz(MESHDEFORM_SOLVE_BATCH_MEMORY / cagevert_memory, INT_MAX)));
+  MeshDeformSolveData data = {
+      .mdb = mdb,
+      .context = context,
+      .totvar = totvar,
+      .batch_phi = MEM_mallocN(sizeof(float) * (size_t)batch_size * (size_t)mdb->size3,
+                               "MeshDeformBindPhi"),
+      .batch_failed = MEM_mallocN(sizeof(bool) * batch_size, __func__),
+  };
+  MeshDeformSolveTLS solve_tls = {NULL};
 
-    if (EIG_linear_solver_solve(context)) {
-      for (z = 0; z < mdb->size; z++) {
-        for (y = 0; y < mdb->size; y++) {
-          for (x = 0; x < mdb->size; x++) {
-            meshdeform_matrix_add_semibound_phi(mdb, x, y, z, a);
-          }
-        }
-      }
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  settings.userdata_chunk = &solve_tls;
+  settings.userdata_chunk_size = sizeof(solve_tls);
+  settings.func_free = meshdeform_matrix_solve_free;
 
-      for (z = 0; z < mdb->size; z++) {
-        for (y = 0; y < mdb->size; y++) {
-          for (x = 0; x < mdb->size; x++) {
-            meshdeform_matrix_add_exterior_phi(mdb, x, y, z, a);
-          }
-        }
-      }
+  bool failed = !EIG_linear_solver_factorize(context);
+  bool cancelled = false;
 
-      for (b = 0; b < mdb->size3; b++) {
-        if (mdb->tag[b] != MESHDEFORM_TAG_EXTERIOR) {
-          mdb->phi[b] = EIG_linear_solver_variable_get(context, 0, mdb->varidx[b]);
-        }
-        mdb->totalphi[b] += mdb->phi[b];
-      }
+  for (a = 0; a < mdb->totcagevert && !failed; a += batch_size) {
+    if (G.is_break) {
+      cancelled = true;
+      break;
+    }
 
-      if (mdb->weights) {
-        /* static bind : compute weights for each vertex */
-        for (b = 0; b < mdb->totvert; b++) {
-          if (mdb->inside[b]) {
-            copy_v3_v3(vec, mdb->vertexcos[b]);
-            gridvec[0] = (vec[0] - mdb->min[0] - mdb->halfwidth[0]) / mdb->width[0];
-            gridvec[1] = (vec[1] - mdb->min[1] - mdb->halfwidth[1]) / mdb->width[1];
-            gridvec[2] = (vec[2] - mdb->min[2] - mdb->halfwidth[2]) / mdb->width[2];
+    const int batch_len = min_ii(batch_size, mdb->totcagevert - a);
 
-            mdb->weights[b * mdb->totcagevert + a] = meshdeform_interp_w(mdb, gridvec, vec, a);
-          }
-        }
+    data.cagevert_start = a;
+    memset(data.batch_failed, 0, sizeof(bool) * batch_len);
+    BLI_task_parallel_range(0, batch_len, &data, meshdeform_matrix_solve_cb, &settings);
+
+    /* Handle the results in order, so the influences don't depend on the threads. */
+    for (int batch_index = 0; batch_index < batch_len; batch_index++) {
+      const int cagevert = a + batch_index;
+      const float *phi = data.batch_phi + (size_t)batch_index * (size_t)mdb->size3;
+
+      if (data.batch_failed[batch_index]) {
+        failed = true;
+        break;
       }
-      else {
+
+      if (mdb->dyngrid) {
         MDefBindInfluence *inf;
 
         /* dynamic bind */
         for (b = 0; b < mdb->size3; b++) {
-          if (mdb->phi[b] >= MESHDEFORM_MIN_INFLUENCE) {
+          if (phi[b] >= MESHDEFORM_MIN_INFLUENCE) {
             inf = BLI_memarena_alloc(mdb->memarena, sizeof(*inf));
-            inf->vertex = a;
-            inf->weight = mdb->phi[b];
+            inf->vertex = cagevert;
+            inf->weight = phi[b];
             inf->next = mdb->dyngrid[b];
             mdb->dyngrid[b] = inf;
           }
         }
       }
     }
-    else {
-      BKE_modifier_set_error(
-          mmd->object, &mmd->modifier, "Failed to find bind solution (increase precision?)");
-      error("Mesh Deform: failed to find bind solution.");
-      break;
-    }
 
-    BLI_snprintf(
-        message, sizeof(message), "Mesh deform solve %d / %d       |||", a + 1, mdb->totcagevert);
-    progress_bar((float)(a + 1) / (float)(mdb->totcagevert), message);
+    progress_bar((float)(a + batch_len) / (float)(mdb->totcagevert));
   }
 
-#if 0
-  /* sanity check */
-  for (b = 0; b < mdb->size3; b++) {
-    if (mdb->tag[b] != MESHDEFORM_TAG_EXTERIOR) {
-      if (fabsf(mdb->totalphi[b] - 1.0f) > 1e-4f) {
-        printf("totalphi deficiency [%s|%d] %d: %.10f\n",
-               (mdb->tag[b] == MESHDEFORM_TAG_INTERIOR) ? "interior" : "boundary",
-               mdb->semibound[b],
-               mdb->varidx[b],
-               mdb->totalphi[b]);
-      }
-    }
+  if (failed) {
+    BKE_modifier_set_error(
+        mmd->object, &mmd->modifier, "Failed to find bind solution (increase precision?)");
+    error("Mesh Deform: failed to find bind solution.");
   }
-#endif
 
   /* free */
+  MEM_freeN(data.batch_phi);
+  MEM_freeN(data.batch_failed);
   MEM_freeN(mdb->varidx);
 
   EIG_linear_solver_delete(context);
+
+  return !cancelled;
 }
 
-static void harmonic_coordinates_bind(MeshDeformModifierData *mmd, MeshDeformBind *mdb)
+/* Returns false when binding was cancelled, nothing is assigned to the modifier then. */
+static bool harmonic_coordinates_bind(MeshDeformModifierData *mmd, MeshDeformBind *mdb)
 {
   MDefBindInfluence *inf;
   MDefInfluence *mdinf;
   MDefCell *cell;
-  float center[3], vec[3], maxwidth, totweight;
-  int a, b, x, y, z, totinside, offset;
+  float center[3], maxwidth, totweight;
+  int a, b, x, y, z, offset;
 
   /* compute bounding box of the cage mesh */
   INIT_MINMAX(mdb->min, mdb->max);
@@ -1598,8 +1739,6 @@ static void harmonic_coordinates_bind(MeshDeformModifierData *mmd, MeshDeformBin
   mdb->size = (2 << (mmd->gridsize - 1)) + 2;
   mdb->size3 = mdb->size * mdb->size * mdb->size;
   mdb->tag = MEM_callocN(sizeof(int) * mdb->size3, "MeshDeformBindTag");
-  mdb->phi = MEM_callocN(sizeof(float) * mdb->size3, "MeshDeformBindPhi");
-  mdb->totalphi = MEM_callocN(sizeof(float) * mdb->size3, "MeshDeformBindTotalPhi");
   mdb->boundisect = MEM_callocN(sizeof(*mdb->boundisect) * mdb->size3, "MDefBoundIsect");
   mdb->semibound = MEM_callocN(sizeof(int) * mdb->size3, "MDefSemiBound");
   mdb->bvhtree = BKE_bvhtree_from_mesh_get(&mdb->bvhdata, mdb->cagemesh, BVHTREE_FROM_LOOPTRI, 4);
@@ -1614,6 +1753,7 @@ static void harmonic_coordinates_bind(MeshDeformModifierData *mmd, MeshDeformBin
 
   mdb->memarena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, "harmonic coords arena");
   BLI_memarena_use_calloc(mdb->memarena);
+  BLI_spin_init(&mdb->memarena_lock);
 
   /* initialize data from 'cagedm' for reuse */
   {
@@ -1647,16 +1787,12 @@ static void harmonic_coordinates_bind(MeshDeformModifierData *mmd, MeshDeformBin
     mdb->halfwidth[a] = mdb->width[a] * 0.5f;
   }
 
-  progress_bar(0, "Setting up mesh deform system");
+  progress_bar(0.0f);
 
-  totinside = 0;
-  for (a = 0; a < mdb->totvert; a++) {
-    copy_v3_v3(vec, mdb->vertexcos[a]);
-    mdb->inside[a] = meshdeform_inside_cage(mdb, vec);
-    if (mdb->inside[a]) {
-      totinside++;
-    }
-  }
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 64;
+  BLI_task_parallel_range(0, mdb->totvert, mdb, meshdeform_inside_cage_cb, &settings);
 
   /* free temporary MDefBoundIsects */
   BLI_memarena_free(mdb->memarena);
@@ -1667,14 +1803,9 @@ static void harmonic_coordinates_bind(MeshDeformModifierData *mmd, MeshDeformBin
     mdb->tag[a] = MESHDEFORM_TAG_UNTYPED;
   }
 
-  /* detect intersections and tag boundary cells */
-  for (z = 0; z < mdb->size; z++) {
-    for (y = 0; y < mdb->size; y++) {
-      for (x = 0; x < mdb->size; x++) {
-        meshdeform_add_intersections(mdb, x, y, z);
-      }
-    }
-  }
+  /* detect intersections and tag boundary cells, every cell only writes to itself */
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, mdb->size, mdb, meshdeform_add_intersections_cb, &settings);
 
   /* compute exterior and interior tags */
   meshdeform_bind_floodfill(mdb);
@@ -1688,10 +1819,15 @@ static void harmonic_coordinates_bind(MeshDeformModifierData *mmd, MeshDeformBin
   }
 
   /* solve */
-  meshdeform_matrix_solve(mmd, mdb);
+  const bool bound = meshdeform_matrix_solve(mmd, mdb);
 
   /* assign results */
-  if (mmd->flag & MOD_MDEF_DYNAMIC_BIND) {
+  if (!bound) {
+    MEM_SAFE_FREE(mdb->dyngrid);
+    MEM_SAFE_FREE(mdb->weights);
+    MEM_freeN(mdb->inside);
+  }
+  else if (mmd->flag & MOD_MDEF_DYNAMIC_BIND) {
     mmd->totinfluence = 0;
     for (a = 0; a < mdb->size3; a++) {
       for (inf = mdb->dyngrid[a]; inf; inf = inf->next) {
@@ -1738,12 +1874,13 @@ static void harmonic_coordinates_bind(MeshDeformModifierData *mmd, MeshDeformBin
   }
 
   MEM_freeN(mdb->tag);
-  MEM_freeN(mdb->phi);
-  MEM_freeN(mdb->totalphi);
   MEM_freeN(mdb->boundisect);
   MEM_freeN(mdb->semibound);
   BLI_memarena_free(mdb->memarena);
+  BLI_spin_end(&mdb->memarena_lock);
   free_bvhtree_from_mesh(&mdb->bvhdata);
+
+  return bound;
 }
 
 void ED_mesh_deform_bind_callback(MeshDeformModifierData *mmd,
@@ -1784,25 +1921,29 @@ void ED_mesh_deform_bind_callback(MeshDeformModifierData *mmd,
   }
 
   /* solve */
-  harmonic_coordinates_bind(mmd_orig, &mdb);
-
-  /* assign bind variables */
-  mmd_orig->bindcagecos = (float *)mdb.cagecos;
-  mmd_orig->totvert = mdb.totvert;
-  mmd_orig->totcagevert = mdb.totcagevert;
-  copy_m4_m4(mmd_orig->bindmat, mmd_orig->object->obmat);
+  if (harmonic_coordinates_bind(mmd_orig, &mdb)) {
+    /* assign bind variables */
+    mmd_orig->bindcagecos = (float *)mdb.cagecos;
+    mmd_orig->totvert = mdb.totvert;
+    mmd_orig->totcagevert = mdb.totcagevert;
+    copy_m4_m4(mmd_orig->bindmat, mmd_orig->object->obmat);
+
+    /* transform bindcagecos to world space */
+    for (a = 0; a < mdb.totcagevert; a++) {
+      mul_m4_v3(mmd_orig->object->obmat, mmd_orig->bindcagecos + a * 3);
+    }
 
-  /* transform bindcagecos to world space */
-  for (a = 0; a < mdb.totcagevert; a++) {
-    mul_m4_v3(mmd_orig->object->obmat, mmd_orig->bindcagecos + a * 3);
+    /* compact weights */
+    BKE_modifier_mdef_compact_influences((ModifierData *)mmd_orig);
+  }
+  else {
+    /* Cancelled, leave the modifier unbound. */
+    MEM_freeN(mdb.cagecos);
   }
 
   /* free */
   MEM_freeN(mdb.vertexcos);
 
-  /* compact weights */
-  BKE_modifier_mdef_compact_influences((ModifierData *)mmd_orig);
-
   end_progress_bar();
   waitcursor(0);
 }
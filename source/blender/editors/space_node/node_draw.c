@@ -25,7 +25,9 @@
 #include "DNA_light_types.h"
 #include "DNA_linestyle_types.h"
 #include "DNA_material_types.h"
+#include "DNA_modifier_types.h"
 #include "DNA_node_types.h"
+#include "DNA_object_types.h"
 #include "DNA_screen_types.h"
 #include "DNA_space_types.h"
 #include "DNA_texture_types.h"
@@ -40,6 +42,8 @@
 #include "BKE_lib_id.h"
 #include "BKE_main.h"
 #include "BKE_node.h"
+#include "BKE_node_tree_profile.h"
+#include "BKE_object.h"
 
 #include "DEG_depsgraph.h"
 
@@ -1120,6 +1124,67 @@ void node_draw_sockets(View2D *v2d,
   GPU_blend(GPU_BLEND_NONE);
 }
 
+/* Profile of the active nodes modifier of the object whose node tree is edited. */
+static const NodeTreeProfile *node_get_profile(const SpaceNode *snode)
+{
+  if (snode->id == NULL || GS(snode->id->name) != ID_OB) {
+    return NULL;
+  }
+  ModifierData *md = BKE_object_active_modifier((Object *)snode->id);
+  if (md == NULL || md->type != eModifierType_Nodes) {
+    return NULL;
+  }
+  NodesModifierData *nmd = (NodesModifierData *)md;
+  if ((nmd->flag & NODES_MODIFIER_PROFILE) == 0) {
+    return NULL;
+  }
+  return nmd->runtime_profile;
+}
+
+/* Draw the time, element count and output size of the last evaluation above the node. */
+static void node_draw_profile(const SpaceNode *snode, bNodeTree *ntree, bNode *node)
+{
+  const NodeTreeProfile *profile = node_get_profile(snode);
+  if (profile == NULL) {
+    return;
+  }
+  NodeProfileStats stats;
+  if (!BKE_node_tree_profile_lookup(profile, ntree, node->name, &stats)) {
+    return;
+  }
+
+  char info[128];
+  int info_len = BLI_snprintf(info, sizeof(info), "%.2f ms", stats.time_ms);
+  if (stats.elements_num > 0) {
+    info_len += BLI_snprintf(info + info_len,
+                             sizeof(info) - info_len,
+                             " | %" PRId64 " %s",
+                             stats.elements_num,
+                             IFACE_("elements"));
+  }
+  if (stats.bytes > 0) {
+    char memory_str[15];
+    BLI_str_format_byte_unit(memory_str, stats.bytes, false);
+    BLI_snprintf(info + info_len, sizeof(info) - info_len, " | %s", memory_str);
+  }
+
+  const rctf *rct = &node->totr;
+  uiDefBut(node->block,
+           UI_BTYPE_LABEL,
+           0,
+           info,
+           (int)rct->xmin,
+           (int)rct->ymax,
+           (short)max_ff(BLI_rctf_size_x(rct), 8.0f * U.widget_unit),
+           (short)NODE_DY,
+           NULL,
+           0,
+           0,
+           0,
+           0,
+           "");
+}
+
 static void node_draw_basis(const bContext *C,
                             ARegion *region,
                             SpaceNode *snode,
@@ -1289,6 +1354,8 @@ static void node_draw_basis(const bContext *C,
     UI_but_flag_enable(but, UI_BUT_INACTIVE);
   }
 
+  node_draw_profile(snode, ntree, node);
+
   /* body */
   if (nodeTypeUndefined(node)) {
     /* use warning color to indicate undefined types */
@@ -1660,6 +1727,18 @@ static void draw_tree_path(SpaceNode *snode)
 
   UI_FontThemeColor(BLF_default(), TH_TEXT_HI);
   BLF_draw_default(1.5f * UI_UNIT_X, 1.5f * UI_UNIT_Y, 0.0f, info, sizeof(info));
+
+  /* Total time of the profiled evaluation above the path. */
+  const NodeTreeProfile *profile = node_get_profile(snode);
+  if (profile != NULL) {
+    BLI_snprintf(info,
+                 sizeof(info),
+                 "%s %d: %.2f ms",
+                 IFACE_("Frame"),
+                 (int)BKE_node_tree_profile_frame(profile),
+                 BKE_node_tree_profile_total_time(profile));
+    BLF_draw_default(1.5f * UI_UNIT_X, 2.5f * UI_UNIT_Y, 0.0f, info, sizeof(info));
+  }
 }
 
 static void snode_setup_v2d(SpaceNode *snode, ARegion *region, const float center[2])
@@ -758,7 +758,8 @@ static void node_region_listener(wmWindow *UNUSED(win),
       ED_region_tag_redraw(region);
       break;
     case NC_OBJECT:
-      if (wmn->data == ND_OB_SHADING) {
+      /* Modifier changes can change the profile shown on the nodes. */
+      if (ELEM(wmn->data, ND_OB_SHADING, ND_MODIFIER)) {
         ED_region_tag_redraw(region);
       }
       break;
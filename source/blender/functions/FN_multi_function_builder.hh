@@ -23,11 +23,157 @@
  */
 
 #include <functional>
+#include <tuple>
 
 #include "FN_multi_function.hh"
 
 namespace blender::fn {
 
+namespace multi_function_builder_detail {
+
+/**
+ * Accessor for a virtual span that has the same value at every index. The value is copied, so
+ * that the compiler does not have to assume that it changes when an output is written.
+ */
+template<typename T> struct SingleValueAccessor {
+  T value;
+
+  const T &operator[](const int64_t UNUSED(index)) const
+  {
+    return value;
+  }
+};
+
+/**
+ * Accessor for a virtual span that is backed by an actual array.
+ */
+template<typename T> struct ArrayAccessor {
+  const T *data;
+
+  const T &operator[](const int64_t index) const
+  {
+    return data[index];
+  }
+};
+
+template<typename T> inline bool is_devirtualizable(const VSpan<T> &span)
+{
+  return span.is_single_element() || span.is_full_array();
+}
+
+/**
+ * Call the function with an accessor that is specialized for how the values of the span are
+ * stored. This avoids the switch in #VSpan::operator[] in inner loops.
+ */
+template<typename T, typename Func>
+inline void devirtualize_vspan(const VSpan<T> &span, const Func &func)
+{
+  BLI_assert(is_devirtualizable(span));
+  if (span.is_single_element()) {
+    func(SingleValueAccessor<T>{span.as_single_element()});
+  }
+  else {
+    func(ArrayAccessor<T>{span.as_full_array().data()});
+  }
+}
+
+/**
+ * Call the function with an #IndexRange when the mask is a range and with the indices otherwise.
+ * Loops over a range can be vectorized by the compiler.
+ */
+template<typename Func> inline void devirtualize_mask(const IndexMask mask, const Func &func)
+{
+  if (mask.is_range()) {
+    func(mask.as_range());
+  }
+  else {
+    func(mask.indices());
+  }
+}
+
+template<typename Out, typename ElementFuncT, typename... Accessors>
+inline void execute_with_accessors(const IndexMask mask,
+                                   MutableSpan<Out> out,
+                                   const ElementFuncT &element_fn,
+                                   const Accessors &... accessors)
+{
+  Out *out_data = out.data();
+  devirtualize_mask(mask, [&](const auto indices) {
+    for (const int64_t i : indices) {
+      new (static_cast<void *>(out_data + i)) Out(element_fn(accessors[i]...));
+    }
+  });
+}
+
+template<typename Out, typename ElementFuncT, typename... Accessors>
+inline void devirtualize_inputs(const IndexMask mask,
+                                MutableSpan<Out> out,
+                                const ElementFuncT &element_fn,
+                                const std::tuple<Accessors...> &accessors)
+{
+  std::apply(
+      [&](const Accessors &... accessors) {
+        execute_with_accessors(mask, out, element_fn, accessors...);
+      },
+      accessors);
+}
+
+/* Replace the virtual spans by specialized accessors one after another. */
+template<typename Out,
+         typename ElementFuncT,
+         typename... Accessors,
+         typename In,
+         typename... RemainingIn>
+inline void devirtualize_inputs(const IndexMask mask,
+                                MutableSpan<Out> out,
+                                const ElementFuncT &element_fn,
+                                const std::tuple<Accessors...> &accessors,
+                                const VSpan<In> &in,
+                                const VSpan<RemainingIn> &... remaining_in)
+{
+  devirtualize_vspan(in, [&](const auto &accessor) {
+    devirtualize_inputs(mask,
+                        out,
+                        element_fn,
+                        std::tuple_cat(accessors, std::make_tuple(accessor)),
+                        remaining_in...);
+  });
+}
+
+/**
+ * Compute the output for every index in the mask by calling the element function. There are
+ * specialized code paths for the common cases, so that the compiler can generate tight (and often
+ * vectorized) loops:
+ *  - When all inputs are single values, the function is only called once.
+ *  - When all inputs are single values or arrays, they are accessed directly without going through
+ *    #VSpan, and loops over contiguous masks are separated from loops over indices.
+ */
+template<typename Out, typename ElementFuncT, typename... In>
+inline void execute_element_function(const IndexMask mask,
+                                     MutableSpan<Out> out,
+                                     const ElementFuncT &element_fn,
+                                     const VSpan<In> &... in)
+{
+  if (mask.size() == 0) {
+    return;
+  }
+  if ((in.is_single_element() && ...)) {
+    const Out value = element_fn(in.as_single_element()...);
+    Out *out_data = out.data();
+    mask.foreach_index(
+        [&](const int64_t i) { new (static_cast<void *>(out_data + i)) Out(value); });
+    return;
+  }
+  if ((is_devirtualizable(in) && ...)) {
+    devirtualize_inputs(mask, out, element_fn, std::tuple<>(), in...);
+    return;
+  }
+  mask.foreach_index(
+      [&](const int64_t i) { new (static_cast<void *>(&out[i])) Out(element_fn(in[i]...)); });
+}
+
+}  // namespace multi_function_builder_detail
+
 /**
  * Generates a multi-function with the following parameters:
  * 1. single input (SI) of type In1
@@ -58,8 +204,7 @@ template<typename In1, typename Out1> class CustomMF_SI_SO : public MultiFunctio
   template<typename ElementFuncT> static FunctionT create_function(ElementFuncT element_fn)
   {
     return [=](IndexMask mask, VSpan<In1> in1, MutableSpan<Out1> out1) {
-      mask.foreach_index(
-          [&](int i) { new (static_cast<void *>(&out1[i])) Out1(element_fn(in1[i])); });
+      multi_function_builder_detail::execute_element_function(mask, out1, element_fn, in1);
     };
   }
 
@@ -101,8 +246,7 @@ class CustomMF_SI_SI_SO : public MultiFunction {
   template<typename ElementFuncT> static FunctionT create_function(ElementFuncT element_fn)
   {
     return [=](IndexMask mask, VSpan<In1> in1, VSpan<In2> in2, MutableSpan<Out1> out1) {
-      mask.foreach_index(
-          [&](int i) { new (static_cast<void *>(&out1[i])) Out1(element_fn(in1[i], in2[i])); });
+      multi_function_builder_detail::execute_element_function(mask, out1, element_fn, in1, in2);
     };
   }
 
@@ -152,9 +296,8 @@ class CustomMF_SI_SI_SI_SO : public MultiFunction {
                VSpan<In2> in2,
                VSpan<In3> in3,
                MutableSpan<Out1> out1) {
-      mask.foreach_index([&](int i) {
-        new (static_cast<void *>(&out1[i])) Out1(element_fn(in1[i], in2[i], in3[i]));
-      });
+      multi_function_builder_detail::execute_element_function(
+          mask, out1, element_fn, in1, in2, in3);
     };
   }
 
@@ -193,7 +336,12 @@ template<typename Mut1> class CustomMF_SM : public MultiFunction {
   template<typename ElementFuncT> static FunctionT create_function(ElementFuncT element_fn)
   {
     return [=](IndexMask mask, MutableSpan<Mut1> mut1) {
-      mask.foreach_index([&](int i) { element_fn(mut1[i]); });
+      Mut1 *mut1_data = mut1.data();
+      multi_function_builder_detail::devirtualize_mask(mask, [&](const auto indices) {
+        for (const int64_t i : indices) {
+          element_fn(mut1_data[i]);
+        }
+      });
     };
   }
 
@@ -222,9 +370,8 @@ template<typename From, typename To> class CustomMF_Convert : public MultiFuncti
     VSpan<From> inputs = params.readonly_single_input<From>(0);
     MutableSpan<To> outputs = params.uninitialized_single_output<To>(1);
 
-    for (int64_t i : mask) {
-      new (static_cast<void *>(&outputs[i])) To(inputs[i]);
-    }
+    multi_function_builder_detail::execute_element_function(
+        mask, outputs, [](const From &value) { return To(value); }, inputs);
   }
 };
 
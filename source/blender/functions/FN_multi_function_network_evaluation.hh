@@ -25,13 +25,23 @@
 namespace blender::fn {
 
 class MFNetworkEvaluationStorage;
+class MFNetworkEvaluationBufferPool;
 
 class MFNetworkEvaluator : public MultiFunction {
  private:
   Vector<const MFOutputSocket *> inputs_;
   Vector<const MFInputSocket *> outputs_;
+  /* Networks that only have single value inputs and outputs can be evaluated in chunks. */
+  bool supports_chunked_evaluation_ = true;
 
  public:
+  /**
+   * Larger masks are split into chunks of this size. The entire network is evaluated for one chunk
+   * at a time, so that the buffers for intermediate values stay small enough to remain in the CPU
+   * cache and can be reused for the next chunk. Chunks are evaluated in parallel.
+   */
+  static constexpr int64_t chunk_size = 4096;
+
   MFNetworkEvaluator(Vector<const MFOutputSocket *> inputs, Vector<const MFInputSocket *> outputs);
 
   void call(IndexMask mask, MFParams params, MFContext context) const override;
@@ -39,6 +49,12 @@ class MFNetworkEvaluator : public MultiFunction {
  private:
   using Storage = MFNetworkEvaluationStorage;
 
+  void call_in_chunks(IndexMask mask, MFParams params, MFContext context) const;
+  void call_without_chunks(IndexMask mask,
+                           MFParams params,
+                           MFContext context,
+                           MFNetworkEvaluationBufferPool *buffer_pool) const;
+
   void copy_inputs_to_storage(MFParams params, Storage &storage) const;
   void copy_outputs_to_storage(
       MFParams params,
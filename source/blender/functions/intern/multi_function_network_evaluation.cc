@@ -28,21 +28,58 @@
  * - Avoids data copies in many cases.
  * - Every node is executed at most once.
  * - Can compute sub-functions on a single element, when the result is the same for all elements.
+ * - Large masks are split into chunks that are evaluated in parallel. Buffers for intermediate
+ *   values only have the size of a chunk and are reused for the next chunk on the same thread.
  *
  * Possible improvements:
- * - Cache and reuse buffers.
  * - Use "deepest depth first" heuristic to decide which order the inputs of a node should be
  *   computed. This reduces the number of required temporary buffers when they are reused.
  */
 
 #include "FN_multi_function_network_evaluation.hh"
 
+#include "BLI_enumerable_thread_specific.hh"
 #include "BLI_stack.hh"
+#include "BLI_task.hh"
 
 namespace blender::fn {
 
 struct Value;
 
+/**
+ * Keeps the buffers of intermediate values alive after they have been used, so that they can be
+ * reused when the next chunk is evaluated. Chunks mostly have the same size, so there are many
+ * buffers with the same size. A pool must only be used by one thread at a time.
+ */
+class MFNetworkEvaluationBufferPool : NonCopyable, NonMovable {
+ private:
+  Map<std::pair<int64_t, int64_t>, Vector<void *>> free_buffers_;
+
+ public:
+  ~MFNetworkEvaluationBufferPool()
+  {
+    for (Span<void *> buffers : free_buffers_.values()) {
+      for (void *buffer : buffers) {
+        MEM_freeN(buffer);
+      }
+    }
+  }
+
+  void *allocate(const int64_t size, const int64_t alignment)
+  {
+    Vector<void *> *buffers = free_buffers_.lookup_ptr({size, alignment});
+    if (buffers != nullptr && !buffers->is_empty()) {
+      return buffers->pop_last();
+    }
+    return MEM_mallocN_aligned(static_cast<size_t>(size), static_cast<size_t>(alignment), AT);
+  }
+
+  void deallocate(void *buffer, const int64_t size, const int64_t alignment)
+  {
+    free_buffers_.lookup_or_add_default({size, alignment}).append(buffer);
+  }
+};
+
 /**
  * This keeps track of all the values that flow through the multi-function network. Therefore it
  * maintains a mapping between output sockets and their corresponding values. Every `value`
@@ -56,9 +93,13 @@ class MFNetworkEvaluationStorage {
   IndexMask mask_;
   Array<Value *> value_per_output_id_;
   int64_t min_array_size_;
+  /* Optional, buffers are allocated and freed directly when this is null. */
+  MFNetworkEvaluationBufferPool *buffer_pool_;
 
  public:
-  MFNetworkEvaluationStorage(IndexMask mask, int socket_id_amount);
+  MFNetworkEvaluationStorage(IndexMask mask,
+                             int socket_id_amount,
+                             MFNetworkEvaluationBufferPool *buffer_pool);
   ~MFNetworkEvaluationStorage();
 
   /* Add the values that have been provided by the caller of the multi-function network. */
@@ -97,6 +138,10 @@ class MFNetworkEvaluationStorage {
   bool socket_is_computed(const MFOutputSocket &socket);
   bool is_same_value_for_every_index(const MFOutputSocket &socket);
   bool socket_has_buffer_for_output(const MFOutputSocket &socket);
+
+ private:
+  GMutableSpan allocate_full_buffer(const CPPType &type);
+  void free_full_buffer(GMutableSpan span);
 };
 
 MFNetworkEvaluator::MFNetworkEvaluator(Vector<const MFOutputSocket *> inputs,
@@ -116,6 +161,7 @@ MFNetworkEvaluator::MFNetworkEvaluator(Vector<const MFOutputSocket *> inputs,
         break;
       case MFDataType::Vector:
         signature.vector_input(socket->name(), type.vector_base_type());
+        supports_chunked_evaluation_ = false;
         break;
     }
   }
@@ -130,6 +176,7 @@ MFNetworkEvaluator::MFNetworkEvaluator(Vector<const MFOutputSocket *> inputs,
         break;
       case MFDataType::Vector:
         signature.vector_output(socket->name(), type.vector_base_type());
+        supports_chunked_evaluation_ = false;
         break;
     }
   }
@@ -140,9 +187,70 @@ void MFNetworkEvaluator::call(IndexMask mask, MFParams params, MFContext context
   if (mask.size() == 0) {
     return;
   }
+  if (supports_chunked_evaluation_ && mask.size() > chunk_size) {
+    this->call_in_chunks(mask, params, context);
+  }
+  else {
+    this->call_without_chunks(mask, params, context, nullptr);
+  }
+}
 
+/**
+ * Every chunk is evaluated with a mask that starts at zero and with parameters that are offset
+ * accordingly. This way the intermediate buffers only have to be as large as the chunk.
+ */
+BLI_NOINLINE void MFNetworkEvaluator::call_in_chunks(IndexMask mask,
+                                                     MFParams params,
+                                                     MFContext context) const
+{
+  const int64_t chunk_amount = (mask.size() + chunk_size - 1) / chunk_size;
+  EnumerableThreadSpecific<MFNetworkEvaluationBufferPool> buffer_pools;
+
+  parallel_for(IndexRange(chunk_amount), 1, [&](const IndexRange chunk_range) {
+    MFNetworkEvaluationBufferPool &buffer_pool = buffer_pools.local();
+    Vector<int64_t> chunk_indices_buffer;
+
+    for (const int64_t chunk_index : chunk_range) {
+      const int64_t start = chunk_index * chunk_size;
+      const Span<int64_t> indices = mask.indices().slice(
+          start, std::min(chunk_size, mask.size() - start));
+      const int64_t offset = indices.first();
+      const int64_t chunk_array_size = indices.last() - offset + 1;
+
+      IndexMask chunk_mask;
+      if (chunk_array_size == indices.size()) {
+        chunk_mask = IndexRange(chunk_array_size);
+      }
+      else {
+        chunk_indices_buffer.clear();
+        for (const int64_t index : indices) {
+          chunk_indices_buffer.append(index - offset);
+        }
+        chunk_mask = chunk_indices_buffer.as_span();
+      }
+
+      MFParamsBuilder chunk_params{*this, chunk_array_size};
+      for (const int input_index : inputs_.index_range()) {
+        const GVSpan values = params.readonly_single_input(input_index);
+        chunk_params.add_readonly_single_input(values.slice(offset, chunk_array_size));
+      }
+      for (const int output_index : outputs_.index_range()) {
+        const GMutableSpan values = params.uninitialized_single_output(inputs_.size() +
+                                                                        output_index);
+        chunk_params.add_uninitialized_single_output(values.slice(offset, chunk_array_size));
+      }
+      this->call_without_chunks(chunk_mask, chunk_params, context, &buffer_pool);
+    }
+  });
+}
+
+void MFNetworkEvaluator::call_without_chunks(IndexMask mask,
+                                             MFParams params,
+                                             MFContext context,
+                                             MFNetworkEvaluationBufferPool *buffer_pool) const
+{
   const MFNetwork &network = outputs_[0]->node().network();
-  Storage storage(mask, network.socket_id_amount());
+  Storage storage(mask, network.socket_id_amount(), buffer_pool);
 
   Vector<const MFInputSocket *> outputs_to_initialize_in_the_end;
 
@@ -506,10 +614,13 @@ struct OwnVectorValue : public Value {
 /** \name Storage methods
  * \{ */
 
-MFNetworkEvaluationStorage::MFNetworkEvaluationStorage(IndexMask mask, int socket_id_amount)
+MFNetworkEvaluationStorage::MFNetworkEvaluationStorage(IndexMask mask,
+                                                       int socket_id_amount,
+                                                       MFNetworkEvaluationBufferPool *buffer_pool)
     : mask_(mask),
       value_per_output_id_(socket_id_amount, nullptr),
-      min_array_size_(mask.min_array_size())
+      min_array_size_(mask.min_array_size()),
+      buffer_pool_(buffer_pool)
 {
 }
 
@@ -528,7 +639,7 @@ MFNetworkEvaluationStorage::~MFNetworkEvaluationStorage()
       }
       else {
         type.destruct_indices(span.data(), mask_);
-        MEM_freeN(span.data());
+        this->free_full_buffer(span);
       }
     }
     else if (any_value->type == ValueType::OwnVector) {
@@ -543,6 +654,26 @@ IndexMask MFNetworkEvaluationStorage::mask() const
   return mask_;
 }
 
+GMutableSpan MFNetworkEvaluationStorage::allocate_full_buffer(const CPPType &type)
+{
+  const int64_t size = min_array_size_ * type.size();
+  void *buffer = (buffer_pool_ == nullptr) ?
+                     MEM_mallocN_aligned(size, type.alignment(), AT) :
+                     buffer_pool_->allocate(size, type.alignment());
+  return GMutableSpan(type, buffer, min_array_size_);
+}
+
+void MFNetworkEvaluationStorage::free_full_buffer(GMutableSpan span)
+{
+  const CPPType &type = span.type();
+  if (buffer_pool_ == nullptr) {
+    MEM_freeN(span.data());
+  }
+  else {
+    buffer_pool_->deallocate(span.data(), span.size() * type.size(), type.alignment());
+  }
+}
+
 bool MFNetworkEvaluationStorage::socket_is_computed(const MFOutputSocket &socket)
 {
   Value *any_value = value_per_output_id_[socket.id()];
@@ -638,7 +769,7 @@ void MFNetworkEvaluationStorage::finish_input_socket(const MFInputSocket &socket
         }
         else {
           type.destruct_indices(span.data(), mask_);
-          MEM_freeN(span.data());
+          this->free_full_buffer(span);
         }
         value_per_output_id_[origin.id()] = nullptr;
       }
@@ -702,8 +833,7 @@ GMutableSpan MFNetworkEvaluationStorage::get_single_output__full(const MFOutputS
   Value *any_value = value_per_output_id_[socket.id()];
   if (any_value == nullptr) {
     const CPPType &type = socket.data_type().single_type();
-    void *buffer = MEM_mallocN_aligned(min_array_size_ * type.size(), type.alignment(), AT);
-    GMutableSpan span(type, buffer, min_array_size_);
+    GMutableSpan span = this->allocate_full_buffer(type);
 
     auto *value = allocator_.construct<OwnSingleValue>(span, socket.targets().size(), false);
     value_per_output_id_[socket.id()] = value;
@@ -802,8 +932,7 @@ GMutableSpan MFNetworkEvaluationStorage::get_mutable_single__full(const MFInputS
   }
 
   GVSpan virtual_span = this->get_single_input__full(input);
-  void *new_buffer = MEM_mallocN_aligned(min_array_size_ * type.size(), type.alignment(), AT);
-  GMutableSpan new_array_ref(type, new_buffer, min_array_size_);
+  GMutableSpan new_array_ref = this->allocate_full_buffer(type);
   virtual_span.materialize_to_uninitialized(mask_, new_array_ref.data());
 
   OwnSingleValue *new_value = allocator_.construct<OwnSingleValue>(
@@ -65,6 +65,70 @@ TEST(multi_function_network, Test1)
   }
 }
 
+TEST(multi_function_network, ChunkedEvaluation)
+{
+  CustomMF_SI_SO<int, int> add_10_fn("add 10", [](int value) { return value + 10; });
+  CustomMF_SI_SI_SO<int, int, int> multiply_fn("multiply", [](int a, int b) { return a * b; });
+
+  MFNetwork network;
+
+  MFNode &node1 = network.add_function(add_10_fn);
+  MFNode &node2 = network.add_function(multiply_fn);
+  MFOutputSocket &input1 = network.add_input("Input 1", MFDataType::ForSingle<int>());
+  MFOutputSocket &input2 = network.add_input("Input 2", MFDataType::ForSingle<int>());
+  MFInputSocket &output1 = network.add_output("Output 1", MFDataType::ForSingle<int>());
+  MFInputSocket &output2 = network.add_output("Output 2", MFDataType::ForSingle<int>());
+  network.add_link(input1, node1.input(0));
+  network.add_link(node1.output(0), node2.input(0));
+  network.add_link(input2, node2.input(1));
+  network.add_link(node2.output(0), output1);
+  network.add_link(node1.output(0), output2);
+
+  MFNetworkEvaluator network_fn{{&input1, &input2}, {&output1, &output2}};
+
+  const int64_t size = MFNetworkEvaluator::chunk_size * 3 + 17;
+  Array<int> values(size);
+  for (const int64_t i : values.index_range()) {
+    values[i] = static_cast<int>(i % 100);
+  }
+  const int factor = 2;
+
+  /* Use every third index, so that the chunks are not contiguous. */
+  Vector<int64_t> indices;
+  for (int64_t i = 1; i < size; i += 3) {
+    indices.append(i);
+  }
+
+  for (const IndexMask mask : {IndexMask(size), IndexMask(indices.as_span())}) {
+    Array<int> results1(size, -1);
+    Array<int> results2(size, -1);
+
+    MFParamsBuilder params(network_fn, size);
+    params.add_readonly_single_input(values.as_span());
+    params.add_readonly_single_input(&factor);
+    params.add_uninitialized_single_output(results1.as_mutable_span());
+    params.add_uninitialized_single_output(results2.as_mutable_span());
+
+    MFContextBuilder context;
+    network_fn.call(mask, params, context);
+
+    Array<bool> is_masked(size, false);
+    for (const int64_t i : mask) {
+      is_masked[i] = true;
+    }
+    for (const int64_t i : IndexRange(size)) {
+      if (is_masked[i]) {
+        EXPECT_EQ(results1[i], (values[i] + 10) * factor);
+        EXPECT_EQ(results2[i], values[i] + 10);
+      }
+      else {
+        EXPECT_EQ(results1[i], -1);
+        EXPECT_EQ(results2[i], -1);
+      }
+    }
+  }
+}
+
 class ConcatVectorsFunction : public MultiFunction {
  public:
   ConcatVectorsFunction()
@@ -249,6 +249,73 @@ TEST(multi_function, CustomMF_SI_SI_SO)
   EXPECT_EQ(outputs[3], 90);
 }
 
+TEST(multi_function, CustomMF_SI_SI_SO_Devirtualized)
+{
+  CustomMF_SI_SI_SO<float, float, float> fn("add", [](float a, float b) { return a + b; });
+  MFContextBuilder context;
+
+  Array<float> values_a = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f};
+  Array<float> values_b = {10.0f, 20.0f, 30.0f, 40.0f, 50.0f};
+  float value_a = 100.0f;
+  float value_b = 1000.0f;
+
+  {
+    /* Both inputs are single values. */
+    Array<float> outputs(5, -1.0f);
+    MFParamsBuilder params(fn, 5);
+    params.add_readonly_single_input(&value_a);
+    params.add_readonly_single_input(&value_b);
+    params.add_uninitialized_single_output(outputs.as_mutable_span());
+    fn.call({1, 3, 4}, params, context);
+    EXPECT_EQ(outputs[0], -1.0f);
+    EXPECT_EQ(outputs[1], 1100.0f);
+    EXPECT_EQ(outputs[2], -1.0f);
+    EXPECT_EQ(outputs[3], 1100.0f);
+    EXPECT_EQ(outputs[4], 1100.0f);
+  }
+  {
+    /* An array and a single value with a contiguous mask. */
+    Array<float> outputs(5, -1.0f);
+    MFParamsBuilder params(fn, 5);
+    params.add_readonly_single_input(values_a.as_span());
+    params.add_readonly_single_input(&value_b);
+    params.add_uninitialized_single_output(outputs.as_mutable_span());
+    fn.call(IndexRange(1, 3), params, context);
+    EXPECT_EQ(outputs[0], -1.0f);
+    EXPECT_EQ(outputs[1], 1002.0f);
+    EXPECT_EQ(outputs[2], 1003.0f);
+    EXPECT_EQ(outputs[3], 1004.0f);
+    EXPECT_EQ(outputs[4], -1.0f);
+  }
+  {
+    /* Two arrays with a non-contiguous mask. */
+    Array<float> outputs(5, -1.0f);
+    MFParamsBuilder params(fn, 5);
+    params.add_readonly_single_input(values_a.as_span());
+    params.add_readonly_single_input(values_b.as_span());
+    params.add_uninitialized_single_output(outputs.as_mutable_span());
+    fn.call({0, 2, 4}, params, context);
+    EXPECT_EQ(outputs[0], 11.0f);
+    EXPECT_EQ(outputs[1], -1.0f);
+    EXPECT_EQ(outputs[2], 33.0f);
+    EXPECT_EQ(outputs[3], -1.0f);
+    EXPECT_EQ(outputs[4], 55.0f);
+  }
+  {
+    /* Values referenced by pointers use the generic code path. */
+    Array<const float *> pointers = {&values_b[4], &values_b[3], &values_b[2]};
+    Array<float> outputs(3, -1.0f);
+    MFParamsBuilder params(fn, 3);
+    params.add_readonly_single_input(values_a.as_span().take_front(3));
+    params.add_readonly_single_input(GVSpan(VSpan<float>(pointers.as_span())));
+    params.add_uninitialized_single_output(outputs.as_mutable_span());
+    fn.call(IndexRange(3), params, context);
+    EXPECT_EQ(outputs[0], 51.0f);
+    EXPECT_EQ(outputs[1], 42.0f);
+    EXPECT_EQ(outputs[2], 33.0f);
+  }
+}
+
 TEST(multi_function, CustomMF_SI_SI_SI_SO)
 {
   CustomMF_SI_SI_SI_SO<int, std::string, bool, uint> fn{
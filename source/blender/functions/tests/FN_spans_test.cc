@@ -219,4 +219,30 @@ TEST(generic_virtual_span, SingleConstructor)
   EXPECT_EQ(converted[2], 5);
 }
 
+TEST(generic_virtual_span, Slice)
+{
+  int values[5] = {1, 2, 3, 4, 5};
+  GVSpan array_span{Span<int>(values, 5)};
+  GVSpan array_slice = array_span.slice(1, 3);
+  EXPECT_EQ(array_slice.size(), 3);
+  EXPECT_TRUE(array_slice.is_full_array());
+  EXPECT_EQ(array_slice[0], &values[1]);
+  EXPECT_EQ(array_slice[2], &values[3]);
+
+  int value = 7;
+  GVSpan single_span = GVSpan::FromSingle(CPPType::get<int32_t>(), &value, 5);
+  GVSpan single_slice = single_span.slice(2, 2);
+  EXPECT_EQ(single_slice.size(), 2);
+  EXPECT_TRUE(single_slice.is_single_element());
+  EXPECT_EQ(single_slice[1], &value);
+
+  const int *pointers[4] = {&values[4], &values[3], &values[2], &values[1]};
+  GVSpan pointer_span = GVSpan::FromFullPointerArray(
+      CPPType::get<int32_t>(), (const void *const *)pointers, 4);
+  GVSpan pointer_slice = pointer_span.slice(1, 2);
+  EXPECT_EQ(pointer_slice.size(), 2);
+  EXPECT_EQ(pointer_slice[0], &values[3]);
+  EXPECT_EQ(pointer_slice[1], &values[2]);
+}
+
 }  // namespace blender::fn::tests
@@ -574,7 +574,9 @@
   }
 
 #define _DNA_DEFAULT_NodesModifierData \
-  { 0 }
+  { \
+    .cache_memory_limit = 256, \
+  }
 
 #define _DNA_DEFAULT_SkinModifierData \
   { \
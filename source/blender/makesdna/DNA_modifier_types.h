@@ -2245,8 +2245,21 @@ typedef struct NodesModifierData {
   ModifierData modifier;
   struct bNodeTree *node_group;
   struct NodesModifierSettings settings;
+  /** Memory budget for cached intermediate geometry in megabytes, 0 disables caching. */
+  int cache_memory_limit;
+  int flag;
+  /**
+   * Runtime only, #NodeTreeProfile of the last evaluation. Only stored on the original modifier.
+   */
+  void *runtime_profile;
 } NodesModifierData;
 
+/* NodesModifierData.flag */
+enum {
+  /** Record the evaluation time of every node, see #NodeTreeProfile. */
+  NODES_MODIFIER_PROFILE = (1 << 0),
+};
+
 typedef struct MeshToVolumeModifierData {
   ModifierData modifier;
 
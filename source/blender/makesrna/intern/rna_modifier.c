@@ -604,6 +604,7 @@ const EnumPropertyItem rna_enum_axis_flag_xyz_items[] = {
 #  include "BKE_context.h"
 #  include "BKE_mesh_runtime.h"
 #  include "BKE_modifier.h"
+#  include "BKE_node_tree_profile.h"
 #  include "BKE_object.h"
 #  include "BKE_particle.h"
 
@@ -1617,6 +1618,45 @@ static void rna_NodesModifier_node_group_update(Main *bmain, Scene *scene, Point
   MOD_nodes_update_interface(object, nmd);
 }
 
+static float rna_NodesModifier_profile_frame_get(PointerRNA *ptr)
+{
+  NodesModifierData *nmd = ptr->data;
+  if (nmd->runtime_profile == NULL) {
+    return 0.0f;
+  }
+  return BKE_node_tree_profile_frame(nmd->runtime_profile);
+}
+
+static float rna_NodesModifier_profile_time_get(PointerRNA *ptr)
+{
+  NodesModifierData *nmd = ptr->data;
+  if (nmd->runtime_profile == NULL) {
+    return 0.0f;
+  }
+  return (float)BKE_node_tree_profile_total_time(nmd->runtime_profile);
+}
+
+static void rna_NodesModifier_profile_node(NodesModifierData *nmd,
+                                           PointerRNA *node_ptr,
+                                           float *r_time,
+                                           int *r_elements,
+                                           float *r_memory)
+{
+  const bNodeTree *ntree = (const bNodeTree *)node_ptr->owner_id;
+  const bNode *node = node_ptr->data;
+  NodeProfileStats stats;
+  if (nmd->runtime_profile == NULL ||
+      !BKE_node_tree_profile_lookup(nmd->runtime_profile, ntree, node->name, &stats)) {
+    *r_time = 0.0f;
+    *r_elements = 0;
+    *r_memory = 0.0f;
+    return;
+  }
+  *r_time = (float)stats.time_ms;
+  *r_elements = (int)MIN2(stats.elements_num, INT_MAX);
+  *r_memory = (float)((double)stats.bytes / (1024.0 * 1024.0));
+}
+
 static IDProperty *rna_NodesModifierSettings_properties(PointerRNA *ptr, bool create)
 {
   NodesModifierSettings *settings = ptr->data;
@@ -6977,6 +7017,8 @@ static void rna_def_modifier_nodes(BlenderRNA *brna)
 {
   StructRNA *srna;
   PropertyRNA *prop;
+  FunctionRNA *func;
+  PropertyRNA *parm;
 
   srna = RNA_def_struct(brna, "NodesModifier", "Modifier");
   RNA_def_struct_ui_text(srna, "Nodes Modifier", "");
@@ -6995,8 +7037,58 @@ static void rna_def_modifier_nodes(BlenderRNA *brna)
   RNA_def_property_flag(prop, PROP_NEVER_NULL);
   RNA_def_property_ui_text(prop, "Settings", "Settings that are passed into the node group");
 
+  prop = RNA_def_property(srna, "cache_memory_limit", PROP_INT, PROP_NONE);
+  RNA_def_property_range(prop, 0, INT_MAX);
+  RNA_def_property_ui_range(prop, 0, 8192, 64, -1);
+  RNA_def_property_ui_text(prop,
+                           "Cache Limit",
+                           "Memory in megabytes that is used to keep results of parts of the node "
+                           "tree whose inputs did not change (0 disables caching)");
+  RNA_def_property_update(prop, 0, "rna_Modifier_update");
+
+  prop = RNA_def_property(srna, "use_profiling", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "flag", NODES_MODIFIER_PROFILE);
+  RNA_def_property_ui_text(
+      prop,
+      "Profile",
+      "Record the evaluation time of every node and display it in the node editor");
+  RNA_def_property_update(prop, 0, "rna_Modifier_update");
+
   RNA_define_lib_overridable(false);
 
+  prop = RNA_def_property(srna, "profile_frame", PROP_FLOAT, PROP_TIME);
+  RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+  RNA_def_property_float_funcs(prop, "rna_NodesModifier_profile_frame_get", NULL, NULL);
+  RNA_def_property_ui_text(prop, "Profile Frame", "Frame of the last profiled evaluation");
+
+  prop = RNA_def_property(srna, "profile_time", PROP_FLOAT, PROP_NONE);
+  RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+  RNA_def_property_float_funcs(prop, "rna_NodesModifier_profile_time_get", NULL, NULL);
+  RNA_def_property_ui_text(
+      prop, "Profile Time", "Time in milliseconds of the last profiled evaluation of the tree");
+
+  func = RNA_def_function(srna, "profile_node", "rna_NodesModifier_profile_node");
+  RNA_def_function_ui_description(
+      func, "Statistics of a node from the last profiled evaluation, zero when it did not run");
+  parm = RNA_def_pointer(func, "node", "Node", "", "Node in the node group or a nested group");
+  RNA_def_parameter_flags(parm, PROP_NEVER_NULL, PARM_REQUIRED | PARM_RNAPTR);
+  parm = RNA_def_float(
+      func, "time", 0.0f, 0.0f, FLT_MAX, "", "Execution time in milliseconds", 0.0f, FLT_MAX);
+  RNA_def_function_output(func, parm);
+  parm = RNA_def_int(func,
+                     "elements",
+                     0,
+                     0,
+                     INT_MAX,
+                     "",
+                     "Number of points, vertices and instances in the geometry outputs",
+                     0,
+                     INT_MAX);
+  RNA_def_function_output(func, parm);
+  parm = RNA_def_float(
+      func, "memory", 0.0f, 0.0f, FLT_MAX, "", "Size of the outputs in megabytes", 0.0f, FLT_MAX);
+  RNA_def_function_output(func, parm);
+
   rna_def_modifier_nodes_settings(brna);
 }
 
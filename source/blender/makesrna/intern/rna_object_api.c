@@ -380,7 +380,8 @@ static void rna_Object_camera_fit_coords(
 static Mesh *rna_Object_to_mesh(Object *object,
                                 ReportList *reports,
                                 bool preserve_all_data_layers,
-                                Depsgraph *depsgraph)
+                                Depsgraph *depsgraph,
+                                bool realize_instances)
 {
   /* TODO(sergey): Make it more re-usable function, de-duplicate with
    * rna_Main_meshes_new_from_object. */
@@ -390,13 +391,18 @@ static Mesh *rna_Object_to_mesh(Object *object,
     case OB_SURF:
     case OB_MBALL:
     case OB_MESH:
+    case OB_POINTCLOUD:
       break;
     default:
       BKE_report(reports, RPT_ERROR, "Object does not have geometry data");
       return NULL;
   }
+  if (realize_instances && depsgraph == NULL) {
+    BKE_report(reports, RPT_ERROR, "Realizing instances requires a dependency graph");
+    return NULL;
+  }
 
-  return BKE_object_to_mesh(depsgraph, object, preserve_all_data_layers);
+  return BKE_object_to_mesh(depsgraph, object, preserve_all_data_layers, realize_instances);
 }
 
 static void rna_Object_to_mesh_clear(Object *object)
@@ -970,7 +976,15 @@ void RNA_api_object(StructRNA *srna)
       "depsgraph",
       "Depsgraph",
       "Dependency Graph",
-      "Evaluated dependency graph which is required when preserve_all_data_layers is true");
+      "Evaluated dependency graph which is required when preserve_all_data_layers or "
+      "realize_instances is true");
+  RNA_def_boolean(func,
+                  "realize_instances",
+                  false,
+                  "",
+                  "Join the geometry of the instances generated by the object itself (e.g. by "
+                  "geometry nodes) into the mesh. These instances are part of "
+                  "Depsgraph.object_instances as well, so they should be skipped there");
   parm = RNA_def_pointer(func, "mesh", "Mesh", "", "Mesh created from object");
   RNA_def_function_return(func, parm);
 
@@ -38,6 +38,7 @@
 #include "BKE_appdir.h"
 #include "BKE_sound.h"
 #include "BKE_studiolight.h"
+#include "BKE_volume.h"
 
 #include "RNA_access.h"
 #include "RNA_define.h"
@@ -564,6 +565,19 @@ static void rna_Userdef_memcache_update(Main *UNUSED(bmain),
   USERDEF_TAG_DIRTY;
 }
 
+static void rna_Userdef_volume_cache_update(Main *UNUSED(bmain),
+                                            Scene *UNUSED(scene),
+                                            PointerRNA *UNUSED(ptr))
+{
+  BKE_volume_cache_limit_update();
+  USERDEF_TAG_DIRTY;
+}
+
+static int rna_Userdef_volume_cache_memory_used_get(PointerRNA *UNUSED(ptr))
+{
+  return (int)(BKE_volume_cache_memory_used() / (1024 * 1024));
+}
+
 static void rna_Userdef_disk_cache_dir_update(Main *UNUSED(bmain),
                                               Scene *UNUSED(scene),
                                               PointerRNA *UNUSED(ptr))
@@ -5371,6 +5385,22 @@ static void rna_def_userdef_system(BlenderRNA *brna)
   RNA_def_property_ui_text(prop, "Memory Cache Limit", "Memory cache limit (in megabytes)");
   RNA_def_property_update(prop, 0, "rna_Userdef_memcache_update");
 
+  prop = RNA_def_property(srna, "volume_cache_limit", PROP_INT, PROP_NONE);
+  RNA_def_property_int_sdna(prop, NULL, "volume_cache_limit");
+  RNA_def_property_range(prop, 0, max_memory_in_megabytes_int());
+  RNA_def_property_ui_text(prop,
+                           "Volume Cache Limit",
+                           "Memory used to keep volume grids loaded after they are not used "
+                           "anymore, so that they don't have to be read again (in megabytes)");
+  RNA_def_property_update(prop, 0, "rna_Userdef_volume_cache_update");
+
+  prop = RNA_def_property(srna, "volume_cache_memory_used", PROP_INT, PROP_NONE);
+  RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+  RNA_def_property_int_funcs(prop, "rna_Userdef_volume_cache_memory_used_get", NULL, NULL);
+  RNA_def_property_ui_text(prop,
+                           "Volume Cache Memory Used",
+                           "Memory used by all volume grids loaded from files (in megabytes)");
+
   /* Sequencer disk cache */
 
   prop = RNA_def_property(srna, "use_sequencer_disk_cache", PROP_BOOLEAN, PROP_NONE);
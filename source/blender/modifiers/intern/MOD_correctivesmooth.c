@@ -26,6 +26,7 @@
 #include "BLI_utildefines.h"
 
 #include "BLI_math.h"
+#include "BLI_task.h"
 
 #include "BLT_translation.h"
 
@@ -43,6 +44,7 @@
 #include "BKE_editmesh.h"
 #include "BKE_lib_id.h"
 #include "BKE_mesh.h"
+#include "BKE_mesh_mapping.h"
 #include "BKE_mesh_wrapper.h"
 #include "BKE_screen.h"
 
@@ -66,9 +68,6 @@
 #  include "PIL_time_utildefines.h"
 #endif
 
-/* minor optimization, calculate this inline */
-#define USE_TANGENT_CALC_INLINE
-
 static void initData(ModifierData *md)
 {
   CorrectiveSmoothModifierData *csmd = (CorrectiveSmoothModifierData *)md;
@@ -177,6 +176,59 @@ static void mesh_get_boundaries(Mesh *mesh, float *smooth_weights)
   MEM_freeN(boundaries);
 }
 
+/* -------------------------------------------------------------------- */
+/* Smoothing
+ *
+ * Each iteration first gathers the delta of every vertex from its edges, then moves the vertices,
+ * so both steps can run in parallel over the vertices.
+ * Edges of each vertex are in index order, giving the same result as accumulating per edge.
+ */
+
+struct SmoothingData_Weighted {
+  float delta[3];
+  /* Only used by #smooth_iter__length_weight. */
+  float edge_length_sum;
+};
+
+typedef struct SmoothIterData {
+  const MEdge *edges;
+  const MeshElemMap *vert_edges;
+  float (*vertexCos)[3];
+  const float *smooth_weights;
+  float lambda;
+  /* Per vertex, the simple smoothing stores the already weighted inverse count here. */
+  const float *vertex_edge_count;
+  struct SmoothingData_Weighted *smooth_data;
+} SmoothIterData;
+
+static void smooth_iter__simple_delta_cb(void *__restrict userdata,
+                                         const int i,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SmoothIterData *data = userdata;
+  const MeshElemMap *vert_edges = &data->vert_edges[i];
+  float(*vertexCos)[3] = data->vertexCos;
+  float *delta = data->smooth_data[i].delta;
+
+  zero_v3(delta);
+  for (int j = 0; j < vert_edges->count; j++) {
+    const MEdge *e = &data->edges[vert_edges->indices[j]];
+    const uint v_other = ((int)e->v1 == i) ? e->v2 : e->v1;
+    float edge_dir[3];
+
+    sub_v3_v3v3(edge_dir, vertexCos[v_other], vertexCos[i]);
+    add_v3_v3(delta, edge_dir);
+  }
+}
+
+static void smooth_iter__simple_apply_cb(void *__restrict userdata,
+                                         const int i,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SmoothIterData *data = userdata;
+  madd_v3_v3fl(data->vertexCos[i], data->smooth_data[i].delta, data->vertex_edge_count[i]);
+}
+
 /* -------------------------------------------------------------------- */
 /* Simple Weighted Smoothing
  *
@@ -195,69 +247,105 @@ static void smooth_iter__simple(CorrectiveSmoothModifierData *csmd,
   const uint numEdges = (uint)mesh->totedge;
   const MEdge *edges = mesh->medge;
   float *vertex_edge_count_div;
+  MeshElemMap *vert_edges;
+  int *vert_edges_mem;
 
-  struct SmoothingData_Simple {
-    float delta[3];
-  } *smooth_data = MEM_calloc_arrayN(numVerts, sizeof(*smooth_data), __func__);
+  BKE_mesh_vert_edge_map_create(&vert_edges, &vert_edges_mem, edges, (int)numVerts, (int)numEdges);
 
-  vertex_edge_count_div = MEM_calloc_arrayN(numVerts, sizeof(float), __func__);
-
-  /* calculate as floats to avoid int->float conversion in #smooth_iter */
-  for (i = 0; i < numEdges; i++) {
-    vertex_edge_count_div[edges[i].v1] += 1.0f;
-    vertex_edge_count_div[edges[i].v2] += 1.0f;
-  }
+  vertex_edge_count_div = MEM_malloc_arrayN(numVerts, sizeof(float), __func__);
 
   /* a little confusing, but we can include 'lambda' and smoothing weight
    * here to avoid multiplying for every iteration */
   if (smooth_weights == NULL) {
     for (i = 0; i < numVerts; i++) {
-      vertex_edge_count_div[i] = lambda * (vertex_edge_count_div[i] ?
-                                               (1.0f / vertex_edge_count_div[i]) :
-                                               1.0f);
+      const int count = vert_edges[i].count;
+      vertex_edge_count_div[i] = lambda * (count ? (1.0f / (float)count) : 1.0f);
     }
   }
   else {
     for (i = 0; i < numVerts; i++) {
+      const int count = vert_edges[i].count;
       vertex_edge_count_div[i] = smooth_weights[i] * lambda *
-                                 (vertex_edge_count_div[i] ? (1.0f / vertex_edge_count_div[i]) :
-                                                             1.0f);
+                                 (count ? (1.0f / (float)count) : 1.0f);
     }
   }
 
+  SmoothIterData data = {
+      .edges = edges,
+      .vert_edges = vert_edges,
+      .vertexCos = vertexCos,
+      .vertex_edge_count = vertex_edge_count_div,
+      .smooth_data = MEM_malloc_arrayN(numVerts, sizeof(*data.smooth_data), __func__),
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+
   /* -------------------------------------------------------------------- */
   /* Main Smoothing Loop */
 
   while (iterations--) {
-    for (i = 0; i < numEdges; i++) {
-      struct SmoothingData_Simple *sd_v1;
-      struct SmoothingData_Simple *sd_v2;
-      float edge_dir[3];
-
-      sub_v3_v3v3(edge_dir, vertexCos[edges[i].v2], vertexCos[edges[i].v1]);
-
-      sd_v1 = &smooth_data[edges[i].v1];
-      sd_v2 = &smooth_data[edges[i].v2];
-
-      add_v3_v3(sd_v1->delta, edge_dir);
-      sub_v3_v3(sd_v2->delta, edge_dir);
-    }
-
-    for (i = 0; i < numVerts; i++) {
-      struct SmoothingData_Simple *sd = &smooth_data[i];
-      madd_v3_v3fl(vertexCos[i], sd->delta, vertex_edge_count_div[i]);
-      /* zero for the next iteration (saves memset on entire array) */
-      memset(sd, 0, sizeof(*sd));
-    }
+    BLI_task_parallel_range(0, (int)numVerts, &data, smooth_iter__simple_delta_cb, &settings);
+    BLI_task_parallel_range(0, (int)numVerts, &data, smooth_iter__simple_apply_cb, &settings);
   }
 
   MEM_freeN(vertex_edge_count_div);
-  MEM_freeN(smooth_data);
+  MEM_freeN(data.smooth_data);
+  MEM_freeN(vert_edges);
+  MEM_freeN(vert_edges_mem);
 }
 
 /* -------------------------------------------------------------------- */
 /* Edge-Length Weighted Smoothing
  */
+
+static void smooth_iter__length_weight_delta_cb(void *__restrict userdata,
+                                                const int i,
+                                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SmoothIterData *data = userdata;
+  const MeshElemMap *vert_edges = &data->vert_edges[i];
+  float(*vertexCos)[3] = data->vertexCos;
+  struct SmoothingData_Weighted *sd = &data->smooth_data[i];
+
+  zero_v3(sd->delta);
+  sd->edge_length_sum = 0.0f;
+  for (int j = 0; j < vert_edges->count; j++) {
+    const MEdge *e = &data->edges[vert_edges->indices[j]];
+    const uint v_other = ((int)e->v1 == i) ? e->v2 : e->v1;
+    float edge_dir[3];
+    float edge_dist;
+
+    sub_v3_v3v3(edge_dir, vertexCos[v_other], vertexCos[i]);
+    edge_dist = len_v3(edge_dir);
+
+    /* weight by distance */
+    mul_v3_fl(edge_dir, edge_dist);
+
+    add_v3_v3(sd->delta, edge_dir);
+    sd->edge_length_sum += edge_dist;
+  }
+}
+
+static void smooth_iter__length_weight_apply_cb(void *__restrict userdata,
+                                                const int i,
+                                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const float eps = FLT_EPSILON * 10.0f;
+  const SmoothIterData *data = userdata;
+  const struct SmoothingData_Weighted *sd = &data->smooth_data[i];
+  /* Divide by sum of all neighbor distances (weighted) and amount of neighbors,
+   * (mean average). */
+  const float div = sd->edge_length_sum * data->vertex_edge_count[i];
+  if (div > eps) {
+    const float lambda_w = data->smooth_weights ? data->lambda * data->smooth_weights[i] :
+                                                  data->lambda;
+    /* first calculate the new location, then interpolate, in one step */
+    madd_v3_v3fl(data->vertexCos[i], sd->delta, lambda_w / div);
+  }
+}
+
 static void smooth_iter__length_weight(CorrectiveSmoothModifierData *csmd,
                                        Mesh *mesh,
                                        float (*vertexCos)[3],
@@ -265,91 +353,52 @@ static void smooth_iter__length_weight(CorrectiveSmoothModifierData *csmd,
                                        const float *smooth_weights,
                                        uint iterations)
 {
-  const float eps = FLT_EPSILON * 10.0f;
   const uint numEdges = (uint)mesh->totedge;
   /* note: the way this smoothing method works, its approx half as strong as the simple-smooth,
    * and 2.0 rarely spikes, double the value for consistent behavior. */
   const float lambda = csmd->lambda * 2.0f;
   const MEdge *edges = mesh->medge;
   float *vertex_edge_count;
+  MeshElemMap *vert_edges;
+  int *vert_edges_mem;
   uint i;
 
-  struct SmoothingData_Weighted {
-    float delta[3];
-    float edge_length_sum;
-  } *smooth_data = MEM_calloc_arrayN(numVerts, sizeof(*smooth_data), __func__);
+  BKE_mesh_vert_edge_map_create(&vert_edges, &vert_edges_mem, edges, (int)numVerts, (int)numEdges);
 
   /* calculate as floats to avoid int->float conversion in #smooth_iter */
-  vertex_edge_count = MEM_calloc_arrayN(numVerts, sizeof(float), __func__);
-  for (i = 0; i < numEdges; i++) {
-    vertex_edge_count[edges[i].v1] += 1.0f;
-    vertex_edge_count[edges[i].v2] += 1.0f;
+  vertex_edge_count = MEM_malloc_arrayN(numVerts, sizeof(float), __func__);
+  for (i = 0; i < numVerts; i++) {
+    vertex_edge_count[i] = (float)vert_edges[i].count;
   }
 
+  SmoothIterData data = {
+      .edges = edges,
+      .vert_edges = vert_edges,
+      .vertexCos = vertexCos,
+      .smooth_weights = smooth_weights,
+      .lambda = lambda,
+      .vertex_edge_count = vertex_edge_count,
+      .smooth_data = MEM_malloc_arrayN(numVerts, sizeof(*data.smooth_data), __func__),
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+
   /* -------------------------------------------------------------------- */
   /* Main Smoothing Loop */
 
   while (iterations--) {
-    for (i = 0; i < numEdges; i++) {
-      struct SmoothingData_Weighted *sd_v1;
-      struct SmoothingData_Weighted *sd_v2;
-      float edge_dir[3];
-      float edge_dist;
-
-      sub_v3_v3v3(edge_dir, vertexCos[edges[i].v2], vertexCos[edges[i].v1]);
-      edge_dist = len_v3(edge_dir);
-
-      /* weight by distance */
-      mul_v3_fl(edge_dir, edge_dist);
-
-      sd_v1 = &smooth_data[edges[i].v1];
-      sd_v2 = &smooth_data[edges[i].v2];
-
-      add_v3_v3(sd_v1->delta, edge_dir);
-      sub_v3_v3(sd_v2->delta, edge_dir);
-
-      sd_v1->edge_length_sum += edge_dist;
-      sd_v2->edge_length_sum += edge_dist;
-    }
-
-    if (smooth_weights == NULL) {
-      /* fast-path */
-      for (i = 0; i < numVerts; i++) {
-        struct SmoothingData_Weighted *sd = &smooth_data[i];
-        /* Divide by sum of all neighbor distances (weighted) and amount of neighbors,
-         * (mean average). */
-        const float div = sd->edge_length_sum * vertex_edge_count[i];
-        if (div > eps) {
-#if 0
-          /* first calculate the new location */
-          mul_v3_fl(sd->delta, 1.0f / div);
-          /* then interpolate */
-          madd_v3_v3fl(vertexCos[i], sd->delta, lambda);
-#else
-          /* do this in one step */
-          madd_v3_v3fl(vertexCos[i], sd->delta, lambda / div);
-#endif
-        }
-        /* zero for the next iteration (saves memset on entire array) */
-        memset(sd, 0, sizeof(*sd));
-      }
-    }
-    else {
-      for (i = 0; i < numVerts; i++) {
-        struct SmoothingData_Weighted *sd = &smooth_data[i];
-        const float div = sd->edge_length_sum * vertex_edge_count[i];
-        if (div > eps) {
-          const float lambda_w = lambda * smooth_weights[i];
-          madd_v3_v3fl(vertexCos[i], sd->delta, lambda_w / div);
-        }
-
-        memset(sd, 0, sizeof(*sd));
-      }
-    }
+    BLI_task_parallel_range(
+        0, (int)numVerts, &data, smooth_iter__length_weight_delta_cb, &settings);
+    BLI_task_parallel_range(
+        0, (int)numVerts, &data, smooth_iter__length_weight_apply_cb, &settings);
   }
 
   MEM_freeN(vertex_edge_count);
-  MEM_freeN(smooth_data);
+  MEM_freeN(data.smooth_data);
+  MEM_freeN(vert_edges);
+  MEM_freeN(vert_edges_mem);
 }
 
 static void smooth_iter(CorrectiveSmoothModifierData *csmd,
@@ -438,11 +487,12 @@ static void calc_tangent_ortho(float ts[3][3])
 }
 
 /**
- * accumulate edge-vectors from all polys.
+ * Calculate the contribution of a loop to the tangent space of its vertex, from its edge-vectors.
+ * Returns false when both edges are aligned, only the bitangent is set then.
  */
-static void calc_tangent_loop_accum(const float v_dir_prev[3],
-                                    const float v_dir_next[3],
-                                    float r_tspace[3][3])
+static bool calc_tangent_loop(const float v_dir_prev[3],
+                              const float v_dir_next[3],
+                              float r_tspace[3][3])
 {
   add_v3_v3v3(r_tspace[1], v_dir_prev, v_dir_next);
 
@@ -455,60 +505,119 @@ static void calc_tangent_loop_accum(const float v_dir_prev[3],
 
     cross_v3_v3v3(r_tspace[0], r_tspace[1], nor);
 
-    mul_v3_fl(nor, weight);
-    /* accumulate weighted normals */
-    add_v3_v3(r_tspace[2], nor);
+    /* weighted normal, accumulated per vertex */
+    mul_v3_v3fl(r_tspace[2], nor, weight);
+    return true;
   }
+  return false;
 }
 
-static void calc_tangent_spaces(Mesh *mesh, float (*vertexCos)[3], float (*r_tangent_spaces)[3][3])
+typedef struct LoopTangentSpace {
+  float tspace[3][3];
+  bool is_valid;
+} LoopTangentSpace;
+
+typedef struct CalcTangentSpacesData {
+  const MPoly *mpoly;
+  const MLoop *mloop;
+  const float (*vertexCos)[3];
+  const MeshElemMap *vert_loops;
+  LoopTangentSpace *loop_tangent_spaces;
+  float (*r_tangent_spaces)[3][3];
+} CalcTangentSpacesData;
+
+static void calc_tangent_spaces_poly_cb(void *__restrict userdata,
+                                        const int i,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  const uint mpoly_num = (uint)mesh->totpoly;
-#ifndef USE_TANGENT_CALC_INLINE
-  const uint mvert_num = (uint)dm->getNumVerts(dm);
-#endif
-  const MPoly *mpoly = mesh->mpoly;
-  const MLoop *mloop = mesh->mloop;
-  uint i;
+  const CalcTangentSpacesData *data = userdata;
+  const float(*vertexCos)[3] = data->vertexCos;
+  const MPoly *mp = &data->mpoly[i];
+  const MLoop *l_next = &data->mloop[mp->loopstart];
+  const MLoop *l_term = l_next + mp->totloop;
+  const MLoop *l_prev = l_term - 2;
+  const MLoop *l_curr = l_term - 1;
 
-  for (i = 0; i < mpoly_num; i++) {
-    const MPoly *mp = &mpoly[i];
-    const MLoop *l_next = &mloop[mp->loopstart];
-    const MLoop *l_term = l_next + mp->totloop;
-    const MLoop *l_prev = l_term - 2;
-    const MLoop *l_curr = l_term - 1;
-
-    /* loop directions */
-    float v_dir_prev[3], v_dir_next[3];
-
-    /* needed entering the loop */
-    sub_v3_v3v3(v_dir_prev, vertexCos[l_prev->v], vertexCos[l_curr->v]);
-    normalize_v3(v_dir_prev);
-
-    for (; l_next != l_term; l_prev = l_curr, l_curr = l_next, l_next++) {
-      float(*ts)[3] = r_tangent_spaces[l_curr->v];
-
-      /* re-use the previous value */
-#if 0
-      sub_v3_v3v3(v_dir_prev, vertexCos[l_prev->v], vertexCos[l_curr->v]);
-      normalize_v3(v_dir_prev);
-#endif
-      sub_v3_v3v3(v_dir_next, vertexCos[l_curr->v], vertexCos[l_next->v]);
-      normalize_v3(v_dir_next);
+  /* loop directions */
+  float v_dir_prev[3], v_dir_next[3];
 
-      calc_tangent_loop_accum(v_dir_prev, v_dir_next, ts);
+  /* needed entering the loop */
+  sub_v3_v3v3(v_dir_prev, vertexCos[l_prev->v], vertexCos[l_curr->v]);
+  normalize_v3(v_dir_prev);
 
-      copy_v3_v3(v_dir_prev, v_dir_next);
-    }
+  for (; l_next != l_term; l_prev = l_curr, l_curr = l_next, l_next++) {
+    LoopTangentSpace *lts = &data->loop_tangent_spaces[l_curr - data->mloop];
+
+    sub_v3_v3v3(v_dir_next, vertexCos[l_curr->v], vertexCos[l_next->v]);
+    normalize_v3(v_dir_next);
+
+    lts->is_valid = calc_tangent_loop(v_dir_prev, v_dir_next, lts->tspace);
+
+    copy_v3_v3(v_dir_prev, v_dir_next);
   }
+}
 
-  /* do inline */
-#ifndef USE_TANGENT_CALC_INLINE
-  for (i = 0; i < mvert_num; i++) {
-    float(*ts)[3] = r_tangent_spaces[i];
-    calc_tangent_ortho(ts);
+static void calc_tangent_spaces_vert_cb(void *__restrict userdata,
+                                        const int i,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const CalcTangentSpacesData *data = userdata;
+  const MeshElemMap *vert_loops = &data->vert_loops[i];
+  float(*ts)[3] = data->r_tangent_spaces[i];
+
+  /* Loops are in poly order, the tangent and bitangent of the last one are used. */
+  zero_m3(ts);
+  for (int j = 0; j < vert_loops->count; j++) {
+    const LoopTangentSpace *lts = &data->loop_tangent_spaces[vert_loops->indices[j]];
+    copy_v3_v3(ts[1], lts->tspace[1]);
+    if (lts->is_valid) {
+      copy_v3_v3(ts[0], lts->tspace[0]);
+      add_v3_v3(ts[2], lts->tspace[2]);
+    }
   }
-#endif
+
+  calc_tangent_ortho(ts);
+}
+
+/**
+ * Calculate orthogonal tangent spaces of all vertices, first per loop (in parallel over polys),
+ * then accumulated per vertex (in parallel over vertices).
+ */
+static void calc_tangent_spaces(Mesh *mesh,
+                                const float (*vertexCos)[3],
+                                uint numVerts,
+                                float (*r_tangent_spaces)[3][3])
+{
+  MeshElemMap *vert_loops;
+  int *vert_loops_mem;
+
+  BKE_mesh_vert_loop_map_create(&vert_loops,
+                                &vert_loops_mem,
+                                mesh->mpoly,
+                                mesh->mloop,
+                                (int)numVerts,
+                                mesh->totpoly,
+                                mesh->totloop);
+
+  CalcTangentSpacesData data = {
+      .mpoly = mesh->mpoly,
+      .mloop = mesh->mloop,
+      .vertexCos = vertexCos,
+      .vert_loops = vert_loops,
+      .loop_tangent_spaces = MEM_malloc_arrayN(
+          (size_t)mesh->totloop, sizeof(LoopTangentSpace), __func__),
+      .r_tangent_spaces = r_tangent_spaces,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+  BLI_task_parallel_range(0, mesh->totpoly, &data, calc_tangent_spaces_poly_cb, &settings);
+  BLI_task_parallel_range(0, (int)numVerts, &data, calc_tangent_spaces_vert_cb, &settings);
+
+  MEM_freeN(data.loop_tangent_spaces);
+  MEM_freeN(vert_loops);
+  MEM_freeN(vert_loops_mem);
 }
 
 static void store_cache_settings(CorrectiveSmoothModifierData *csmd)
@@ -543,7 +652,7 @@ static void calc_deltas(CorrectiveSmoothModifierData *csmd,
   float(*tangent_spaces)[3][3];
   uint i;
 
-  tangent_spaces = MEM_calloc_arrayN(numVerts, sizeof(float[3][3]), __func__);
+  tangent_spaces = MEM_malloc_arrayN(numVerts, sizeof(float[3][3]), __func__);
 
   if (csmd->delta_cache.totverts != numVerts) {
     MEM_SAFE_FREE(csmd->delta_cache.deltas);
@@ -557,15 +666,11 @@ static void calc_deltas(CorrectiveSmoothModifierData *csmd,
 
   smooth_verts(csmd, mesh, dvert, defgrp_index, smooth_vertex_coords, numVerts);
 
-  calc_tangent_spaces(mesh, smooth_vertex_coords, tangent_spaces);
+  calc_tangent_spaces(mesh, (const float(*)[3])smooth_vertex_coords, numVerts, tangent_spaces);
 
   for (i = 0; i < numVerts; i++) {
     float imat[3][3], delta[3];
 
-#ifdef USE_TANGENT_CALC_INLINE
-    calc_tangent_ortho(tangent_spaces[i]);
-#endif
-
     sub_v3_v3v3(delta, rest_coords[i], smooth_vertex_coords[i]);
     if (UNLIKELY(!invert_m3_m3(imat, tangent_spaces[i]))) {
       transpose_m3_m3(imat, tangent_spaces[i]);
@@ -707,18 +812,13 @@ static void correctivesmooth_modifier_do(ModifierData *md,
 
     float(*tangent_spaces)[3][3];
     const float scale = csmd->scale;
-    /* calloc, since values are accumulated */
-    tangent_spaces = MEM_calloc_arrayN(numVerts, sizeof(float[3][3]), __func__);
+    tangent_spaces = MEM_malloc_arrayN(numVerts, sizeof(float[3][3]), __func__);
 
-    calc_tangent_spaces(mesh, vertexCos, tangent_spaces);
+    calc_tangent_spaces(mesh, (const float(*)[3])vertexCos, numVerts, tangent_spaces);
 
     for (i = 0; i < numVerts; i++) {
       float delta[3];
 
-#ifdef USE_TANGENT_CALC_INLINE
-      calc_tangent_ortho(tangent_spaces[i]);
-#endif
-
       mul_v3_m3v3(delta, tangent_spaces[i], csmd->delta_cache.deltas[i]);
       madd_v3_v3fl(vertexCos[i], delta, scale);
     }
@@ -46,6 +46,7 @@
 #include "MOD_ui_common.h"
 
 #include "BLI_float4x4.hh"
+#include "BLI_hash.hh"
 #include "BLI_index_range.hh"
 #include "BLI_span.hh"
 
@@ -101,6 +102,22 @@ class OpenVDBMeshAdapter {
     pos = &transformed_co.x;
   }
 };
+
+/**
+ * Voxelizing the mesh is by far the most expensive part of the modifier. The generated grid is
+ * kept in the runtime data of the modifier, so that it does not have to be recomputed when e.g.
+ * only the density changed or the object was re-evaluated for an unrelated reason.
+ */
+struct MeshToVolumeCache {
+  /* Hash of the mesh and of all settings that influence the generated grid. */
+  uint64_t key = 0;
+  /* Voxelized mesh in index space, before the density is assigned. */
+  openvdb::FloatGrid::Ptr grid;
+  /* The voxelized mesh with the density assigned. Its tree is shared with the generated volumes,
+   * it is only recomputed when the grid or the density changed. */
+  openvdb::FloatGrid::Ptr density_grid;
+  float density = 0.0f;
+};
 }  // namespace blender
 #endif
 
@@ -117,6 +134,22 @@ static void initData(ModifierData *md)
   mvmd->density = 1.0f;
 }
 
+static void freeRuntimeData(void *runtime_data)
+{
+#ifdef WITH_OPENVDB
+  delete static_cast<blender::MeshToVolumeCache *>(runtime_data);
+#else
+  BLI_assert(runtime_data == nullptr);
+  UNUSED_VARS_NDEBUG(runtime_data);
+#endif
+}
+
+static void freeData(ModifierData *md)
+{
+  freeRuntimeData(md->runtime);
+  md->runtime = nullptr;
+}
+
 static void updateDepsgraph(ModifierData *md, const ModifierUpdateDepsgraphContext *ctx)
 {
   MeshToVolumeModifierData *mvmd = reinterpret_cast<MeshToVolumeModifierData *>(md);
@@ -202,6 +235,32 @@ static float compute_voxel_size(const ModifierEvalContext *ctx,
   const float voxel_size = approximate_volume_side_length / mvmd->voxel_amount / volume_simplify;
   return voxel_size;
 }
+
+/**
+ * Compute a key that changes whenever the grid generated from the mesh would be different. The
+ * vertex normals and flags are hashed as well, that only causes unnecessary updates in rare cases
+ * and is much faster than hashing the positions separately.
+ */
+static uint64_t compute_cache_key(const Mesh &mesh,
+                                  const blender::float4x4 &mesh_to_index_space_transform,
+                                  const float exterior_band_width,
+                                  const float interior_band_width,
+                                  const bool fill_volume)
+{
+  using namespace blender;
+  uint64_t key = hash_combine(mesh.totvert, mesh.totloop);
+  key = hash_combine(key, mesh.totpoly);
+  key = hash_combine(key, hash_bytes(mesh.mvert, sizeof(MVert) * mesh.totvert));
+  key = hash_combine(key, hash_bytes(mesh.mloop, sizeof(MLoop) * mesh.totloop));
+  key = hash_combine(key, hash_bytes(mesh.mpoly, sizeof(MPoly) * mesh.totpoly));
+  key = hash_combine(key,
+                     hash_bytes(mesh_to_index_space_transform.values,
+                                sizeof(mesh_to_index_space_transform.values)));
+  key = hash_combine(key, hash_bytes(&exterior_band_width, sizeof(float)));
+  key = hash_combine(key, hash_bytes(&interior_band_width, sizeof(float)));
+  key = hash_combine(key, fill_volume);
+  return key;
+}
 #endif
 
 static Volume *modifyVolume(ModifierData *md, const ModifierEvalContext *ctx, Volume *input_volume)
@@ -234,21 +293,50 @@ static Volume *modifyVolume(ModifierData *md, const ModifierEvalContext *ctx, Vo
   /* Better align generated grid with the source mesh. */
   add_v3_fl(mesh_to_index_space_transform.values[3], -0.5f);
 
-  OpenVDBMeshAdapter mesh_adapter{*mesh, mesh_to_index_space_transform};
-
   /* Convert the bandwidths from object in index space. */
   const float exterior_band_width = MAX2(0.001f, mvmd->exterior_band_width / voxel_size);
   const float interior_band_width = MAX2(0.001f, mvmd->interior_band_width / voxel_size);
 
-  openvdb::FloatGrid::Ptr new_grid;
-  if (mvmd->fill_volume) {
-    /* Setting the interior bandwidth to FLT_MAX, will make it fill the entire volume. */
-    new_grid = openvdb::tools::meshToVolume<openvdb::FloatGrid>(
-        mesh_adapter, {}, exterior_band_width, FLT_MAX);
+  if (md->runtime == nullptr) {
+    md->runtime = new MeshToVolumeCache();
   }
-  else {
-    new_grid = openvdb::tools::meshToVolume<openvdb::FloatGrid>(
-        mesh_adapter, {}, exterior_band_width, interior_band_width);
+  MeshToVolumeCache &cache = *static_cast<MeshToVolumeCache *>(md->runtime);
+
+  const uint64_t key = compute_cache_key(*mesh,
+                                         mesh_to_index_space_transform,
+                                         exterior_band_width,
+                                         interior_band_width,
+                                         mvmd->fill_volume);
+  if (!cache.grid || cache.key != key) {
+    /* Free the old grids first to reduce peak memory usage. */
+    cache.density_grid.reset();
+    cache.grid.reset();
+
+    OpenVDBMeshAdapter mesh_adapter{*mesh, mesh_to_index_space_transform};
+    if (mvmd->fill_volume) {
+      /* Setting the interior bandwidth to FLT_MAX, will make it fill the entire volume. */
+      cache.grid = openvdb::tools::meshToVolume<openvdb::FloatGrid>(
+          mesh_adapter, {}, exterior_band_width, FLT_MAX);
+    }
+    else {
+      cache.grid = openvdb::tools::meshToVolume<openvdb::FloatGrid>(
+          mesh_adapter, {}, exterior_band_width, interior_band_width);
+    }
+    cache.key = key;
+  }
+
+  if (!cache.density_grid || cache.density != mvmd->density) {
+    /* The cached grid must not be modified, because it is used by later evaluations, so only copy
+     * it when the density has to be assigned again. */
+    cache.density_grid.reset();
+    cache.density_grid = openvdb::FloatGrid::create();
+    cache.density_grid->merge(*cache.grid->deepCopy());
+
+    /* Give each grid cell a fixed density for now. */
+    openvdb::tools::foreach (
+        cache.density_grid->beginValueOn(),
+        [&](const openvdb::FloatGrid::ValueOnIter &iter) { iter.setValue(mvmd->density); });
+    cache.density = mvmd->density;
   }
 
   /* Create a new volume object and add the density grid. */
@@ -257,18 +345,13 @@ static Volume *modifyVolume(ModifierData *md, const ModifierEvalContext *ctx, Vo
   openvdb::FloatGrid::Ptr density_grid = openvdb::gridPtrCast<openvdb::FloatGrid>(
       BKE_volume_grid_openvdb_for_write(volume, c_density_grid, false));
 
-  /* Merge the generated grid into the density grid. Should be cheap because density_grid has just
-   * been created as well. */
-  density_grid->merge(*new_grid);
+  /* Share the tree with the cache instead of copying it. Volume grids are copied before they are
+   * modified (see #BKE_volume_grid_openvdb_for_write), so the cached tree stays unchanged. */
+  density_grid->setTree(cache.density_grid->treePtr());
 
   /* Change transform so that the index space is correctly transformed to object space. */
   density_grid->transform().postScale(voxel_size);
 
-  /* Give each grid cell a fixed density for now. */
-  openvdb::tools::foreach (
-      density_grid->beginValueOn(),
-      [&](const openvdb::FloatGrid::ValueOnIter &iter) { iter.setValue(mvmd->density); });
-
   return volume;
 
 #else
@@ -300,14 +383,14 @@ ModifierTypeInfo modifierType_MeshToVolume = {
 
     /* initData */ initData,
     /* requiredDataMask */ nullptr,
-    /* freeData */ nullptr,
+    /* freeData */ freeData,
     /* isDisabled */ nullptr,
     /* updateDepsgraph */ updateDepsgraph,
     /* dependsOnTime */ nullptr,
     /* dependsOnNormals */ nullptr,
     /* foreachIDLink */ foreachIDLink,
     /* foreachTexLink */ nullptr,
-    /* freeRuntimeData */ nullptr,
+    /* freeRuntimeData */ freeRuntimeData,
     /* panelRegister */ panelRegister,
     /* blendWrite */ nullptr,
     /* blendRead */ nullptr,
@@ -48,6 +48,7 @@
 #include "BKE_lib_query.h"
 #include "BKE_mesh.h"
 #include "BKE_modifier.h"
+#include "BKE_node_tree_profile.h"
 #include "BKE_pointcloud.h"
 #include "BKE_screen.h"
 #include "BKE_simulation.h"
@@ -65,6 +66,8 @@
 
 #include "MOD_modifiertypes.h"
 #include "MOD_nodes.h"
+#include "MOD_nodes_cache.hh"
+#include "MOD_nodes_evaluator.hh"
 #include "MOD_ui_common.h"
 
 #include "NOD_derived_node_tree.hh"
@@ -73,6 +76,8 @@
 #include "NOD_node_tree_multi_function.hh"
 #include "NOD_type_callbacks.hh"
 
+#include "PIL_time.h"
+
 using blender::float3;
 using blender::IndexRange;
 using blender::Map;
@@ -190,234 +195,6 @@ static bool isDisabled(const struct Scene *UNUSED(scene),
   return false;
 }
 
-class GeometryNodesEvaluator {
- private:
-  blender::LinearAllocator<> allocator_;
-  Map<const DInputSocket *, GMutablePointer> value_by_input_;
-  Vector<const DInputSocket *> group_outputs_;
-  blender::nodes::MultiFunctionByNode &mf_by_node_;
-  const blender::nodes::DataTypeConversions &conversions_;
-  const blender::bke::PersistentDataHandleMap &handle_map_;
-  const Object *self_object_;
-
- public:
-  GeometryNodesEvaluator(const Map<const DOutputSocket *, GMutablePointer> &group_input_data,
-                         Vector<const DInputSocket *> group_outputs,
-                         blender::nodes::MultiFunctionByNode &mf_by_node,
-                         const blender::bke::PersistentDataHandleMap &handle_map,
-                         const Object *self_object)
-      : group_outputs_(std::move(group_outputs)),
-        mf_by_node_(mf_by_node),
-        conversions_(blender::nodes::get_implicit_type_conversions()),
-        handle_map_(handle_map),
-        self_object_(self_object)
-  {
-    for (auto item : group_input_data.items()) {
-      this->forward_to_inputs(*item.key, item.value);
-    }
-  }
-
-  Vector<GMutablePointer> execute()
-  {
-    Vector<GMutablePointer> results;
-    for (const DInputSocket *group_output : group_outputs_) {
-      GMutablePointer result = this->get_input_value(*group_output);
-      results.append(result);
-    }
-    for (GMutablePointer value : value_by_input_.values()) {
-      value.destruct();
-    }
-    return results;
-  }
-
- private:
-  GMutablePointer get_input_value(const DInputSocket &socket_to_compute)
-  {
-    std::optional<GMutablePointer> value = value_by_input_.pop_try(&socket_to_compute);
-    if (value.has_value()) {
-      /* This input has been computed before, return it directly. */
-      return *value;
-    }
-
-    Span<const DOutputSocket *> from_sockets = socket_to_compute.linked_sockets();
-    Span<const DGroupInput *> from_group_inputs = socket_to_compute.linked_group_inputs();
-    const int total_inputs = from_sockets.size() + from_group_inputs.size();
-    BLI_assert(total_inputs <= 1);
-
-    if (total_inputs == 0) {
-      /* The input is not connected, use the value from the socket itself. */
-      return get_unlinked_input_value(socket_to_compute);
-    }
-    if (from_group_inputs.size() == 1) {
-      /* The input gets its value from the input of a group that is not further connected. */
-      return get_unlinked_input_value(socket_to_compute);
-    }
-
-    /* Compute the socket now. */
-    const DOutputSocket &from_socket = *from_sockets[0];
-    this->compute_output_and_forward(from_socket);
-    return value_by_input_.pop(&socket_to_compute);
-  }
-
-  void compute_output_and_forward(const DOutputSocket &socket_to_compute)
-  {
-    const DNode &node = socket_to_compute.node();
-    const bNode &bnode = *node.bnode();
-
-    if (!socket_to_compute.is_available()) {
-      /* If the output is not available, use a default value. */
-      const CPPType &type = *blender::nodes::socket_cpp_type_get(*socket_to_compute.typeinfo());
-      void *buffer = allocator_.allocate(type.size(), type.alignment());
-      type.copy_to_uninitialized(type.default_value(), buffer);
-      this->forward_to_inputs(socket_to_compute, {type, buffer});
-      return;
-    }
-
-    /* Prepare inputs required to execute the node. */
-    GValueMap<StringRef> node_inputs_map{allocator_};
-    for (const DInputSocket *input_socket : node.inputs()) {
-      if (input_socket->is_available()) {
-        GMutablePointer value = this->get_input_value(*input_socket);
-        node_inputs_map.add_new_direct(input_socket->identifier(), value);
-      }
-    }
-
-    /* Execute the node. */
-    GValueMap<StringRef> node_outputs_map{allocator_};
-    GeoNodeExecParams params{bnode, node_inputs_map, node_outputs_map, handle_map_, self_object_};
-    this->execute_node(node, params);
-
-    /* Forward computed outputs to linked input sockets. */
-    for (const DOutputSocket *output_socket : node.outputs()) {
-      if (output_socket->is_available()) {
-        GMutablePointer value = node_outputs_map.extract(output_socket->identifier());
-        this->forward_to_inputs(*output_socket, value);
-      }
-    }
-  }
-
-  void execute_node(const DNode &node, GeoNodeExecParams params)
-  {
-    const bNode &bnode = params.node();
-    if (bnode.typeinfo->geometry_node_execute != nullptr) {
-      bnode.typeinfo->geometry_node_execute(params);
-      return;
-    }
-
-    /* Use the multi-function implementation of the node. */
-    const MultiFunction &fn = *mf_by_node_.lookup(&node);
-    MFContextBuilder fn_context;
-    MFParamsBuilder fn_params{fn, 1};
-    Vector<GMutablePointer> input_data;
-    for (const DInputSocket *dsocket : node.inputs()) {
-      if (dsocket->is_available()) {
-        GMutablePointer data = params.extract_input(dsocket->identifier());
-        fn_params.add_readonly_single_input(GSpan(*data.type(), data.get(), 1));
-        input_data.append(data);
-      }
-    }
-    Vector<GMutablePointer> output_data;
-    for (const DOutputSocket *dsocket : node.outputs()) {
-      if (dsocket->is_available()) {
-        const CPPType &type = *blender::nodes::socket_cpp_type_get(*dsocket->typeinfo());
-        void *buffer = allocator_.allocate(type.size(), type.alignment());
-        fn_params.add_uninitialized_single_output(GMutableSpan(type, buffer, 1));
-        output_data.append(GMutablePointer(type, buffer));
-      }
-    }
-    fn.call(IndexRange(1), fn_params, fn_context);
-    for (GMutablePointer value : input_data) {
-      value.destruct();
-    }
-    int output_index = 0;
-    for (const int i : node.outputs().index_range()) {
-      if (node.output(i).is_available()) {
-        GMutablePointer value = output_data[output_index];
-        params.set_output_by_move(node.output(i).identifier(), value);
-        value.destruct();
-        output_index++;
-      }
-    }
-  }
-
-  void forward_to_inputs(const DOutputSocket &from_socket, GMutablePointer value_to_forward)
-  {
-    Span<const DInputSocket *> to_sockets_all = from_socket.linked_sockets();
-
-    const CPPType &from_type = *value_to_forward.type();
-
-    Vector<const DInputSocket *> to_sockets_same_type;
-    for (const DInputSocket *to_socket : to_sockets_all) {
-      const CPPType &to_type = *blender::nodes::socket_cpp_type_get(*to_socket->typeinfo());
-      if (from_type == to_type) {
-        to_sockets_same_type.append(to_socket);
-      }
-      else {
-        void *buffer = allocator_.allocate(to_type.size(), to_type.alignment());
-        if (conversions_.is_convertible(from_type, to_type)) {
-          conversions_.convert(from_type, to_type, value_to_forward.get(), buffer);
-        }
-        else {
-          to_type.copy_to_uninitialized(to_type.default_value(), buffer);
-        }
-        value_by_input_.add_new(to_socket, GMutablePointer{to_type, buffer});
-      }
-    }
-
-    if (to_sockets_same_type.size() == 0) {
-      /* This value is not further used, so destruct it. */
-      value_to_forward.destruct();
-    }
-    else if (to_sockets_same_type.size() == 1) {
-      /* This value is only used on one input socket, no need to copy it. */
-      const DInputSocket *to_socket = to_sockets_same_type[0];
-      value_by_input_.add_new(to_socket, value_to_forward);
-    }
-    else {
-      /* Multiple inputs use the value, make a copy for every input except for one. */
-      const DInputSocket *first_to_socket = to_sockets_same_type[0];
-      Span<const DInputSocket *> other_to_sockets = to_sockets_same_type.as_span().drop_front(1);
-      const CPPType &type = *value_to_forward.type();
-
-      value_by_input_.add_new(first_to_socket, value_to_forward);
-      for (const DInputSocket *to_socket : other_to_sockets) {
-        void *buffer = allocator_.allocate(type.size(), type.alignment());
-        type.copy_to_uninitialized(value_to_forward.get(), buffer);
-        value_by_input_.add_new(to_socket, GMutablePointer{type, buffer});
-      }
-    }
-  }
-
-  GMutablePointer get_unlinked_input_value(const DInputSocket &socket)
-  {
-    bNodeSocket *bsocket;
-    if (socket.linked_group_inputs().size() == 0) {
-      bsocket = socket.bsocket();
-    }
-    else {
-      bsocket = socket.linked_group_inputs()[0]->bsocket();
-    }
-    const CPPType &type = *blender::nodes::socket_cpp_type_get(*socket.typeinfo());
-    void *buffer = allocator_.allocate(type.size(), type.alignment());
-
-    if (bsocket->type == SOCK_OBJECT) {
-      Object *object = ((bNodeSocketValueObject *)bsocket->default_value)->value;
-      blender::bke::PersistentObjectHandle object_handle = handle_map_.lookup(object);
-      new (buffer) blender::bke::PersistentObjectHandle(object_handle);
-    }
-    else if (bsocket->type == SOCK_COLLECTION) {
-      Collection *collection = ((bNodeSocketValueCollection *)bsocket->default_value)->value;
-      blender::bke::PersistentCollectionHandle collection_handle = handle_map_.lookup(collection);
-      new (buffer) blender::bke::PersistentCollectionHandle(collection_handle);
-    }
-    else {
-      blender::nodes::socket_cpp_value_get(*bsocket, buffer);
-    }
-
-    return {type, buffer};
-  }
-};
-
 /**
  * This code is responsible for creating the new property and also creating the group of
  * properties in the prop_ui_container group for the UI info, the mapping for which is
@@ -779,17 +556,40 @@ static void fill_data_handle_map(const DerivedNodeTree &tree,
   }
 }
 
+/**
+ * The cache is stored in the runtime data of the modifier, so that it persists between
+ * evaluations. Returns null when caching is disabled.
+ */
+static blender::modifiers::geometry_nodes::GeometryNodesCache *ensure_cache(
+    NodesModifierData *nmd)
+{
+  using blender::modifiers::geometry_nodes::GeometryNodesCache;
+  GeometryNodesCache *cache = static_cast<GeometryNodesCache *>(nmd->modifier.runtime);
+  if (nmd->cache_memory_limit <= 0) {
+    if (cache != nullptr) {
+      delete cache;
+      nmd->modifier.runtime = nullptr;
+    }
+    return nullptr;
+  }
+  if (cache == nullptr) {
+    cache = new GeometryNodesCache();
+    nmd->modifier.runtime = cache;
+  }
+  cache->set_memory_limit(static_cast<int64_t>(nmd->cache_memory_limit) * 1024 * 1024);
+  return cache;
+}
+
 /**
  * Evaluate a node group to compute the output geometry.
- * Currently, this uses a fairly basic and inefficient algorithm that might compute things more
- * often than necessary. It's going to be replaced soon.
  */
 static GeometrySet compute_geometry(const DerivedNodeTree &tree,
                                     Span<const DOutputSocket *> group_input_sockets,
                                     const DInputSocket &socket_to_compute,
                                     GeometrySet input_geometry_set,
                                     NodesModifierData *nmd,
-                                    const ModifierEvalContext *ctx)
+                                    const ModifierEvalContext *ctx,
+                                    NodeTreeProfile *profile)
 {
   blender::ResourceCollector resources;
   blender::LinearAllocator<> &allocator = resources.linear_allocator();
@@ -825,13 +625,25 @@ static GeometrySet compute_geometry(const DerivedNodeTree &tree,
   blender::bke::PersistentDataHandleMap handle_map;
   fill_data_handle_map(tree, handle_map);
 
-  GeometryNodesEvaluator evaluator{
-      group_inputs, group_outputs, mf_by_node, handle_map, ctx->object};
-  Vector<GMutablePointer> results = evaluator.execute();
+  blender::modifiers::geometry_nodes::GeometryNodesEvaluationParams eval_params{allocator};
+  eval_params.input_values = std::move(group_inputs);
+  eval_params.output_sockets = std::move(group_outputs);
+  eval_params.mf_by_node = &mf_by_node;
+  eval_params.handle_map = &handle_map;
+  eval_params.self_object = ctx->object;
+  eval_params.cache = ensure_cache(nmd);
+  eval_params.profile = profile;
+  const double start_time = PIL_check_seconds_timer();
+  Vector<GMutablePointer> results = blender::modifiers::geometry_nodes::evaluate_geometry_nodes(
+      eval_params);
+  if (profile != nullptr) {
+    BKE_node_tree_profile_set_total_time(profile, (PIL_check_seconds_timer() - start_time) * 1e3);
+  }
   BLI_assert(results.size() == 1);
   GMutablePointer result = results[0];
 
   GeometrySet output_geometry = std::move(*(GeometrySet *)result.get());
+  result.destruct();
   return output_geometry;
 }
 
@@ -890,6 +702,20 @@ static void check_property_socket_sync(const Object *ob, ModifierData *md)
   }
 }
 
+/**
+ * Replace the profile of the previous evaluation. The profile is stored on the original modifier,
+ * so that it can be displayed in the node editor and accessed from Python.
+ */
+static void store_profile(ModifierData *md, NodeTreeProfile *profile)
+{
+  NodesModifierData *nmd_orig = reinterpret_cast<NodesModifierData *>(
+      BKE_modifier_get_original(md));
+  if (nmd_orig->runtime_profile != nullptr) {
+    BKE_node_tree_profile_free(static_cast<NodeTreeProfile *>(nmd_orig->runtime_profile));
+  }
+  nmd_orig->runtime_profile = profile;
+}
+
 static void modifyGeometry(ModifierData *md,
                            const ModifierEvalContext *ctx,
                            GeometrySet &geometry_set)
@@ -933,8 +759,20 @@ static void modifyGeometry(ModifierData *md,
     return;
   }
 
+  /* Only evaluations of the active depsgraph are profiled, renders should not replace the profile
+   * of the viewport. */
+  const bool is_active_depsgraph = DEG_is_active(ctx->depsgraph);
+  NodeTreeProfile *profile = nullptr;
+  if (is_active_depsgraph && (nmd->flag & NODES_MODIFIER_PROFILE)) {
+    profile = BKE_node_tree_profile_new(DEG_get_ctime(ctx->depsgraph));
+  }
+
   geometry_set = compute_geometry(
-      tree, group_inputs, *group_outputs[0], std::move(geometry_set), nmd, ctx);
+      tree, group_inputs, *group_outputs[0], std::move(geometry_set), nmd, ctx, profile);
+
+  if (is_active_depsgraph) {
+    store_profile(md, profile);
+  }
 }
 
 static Mesh *modifyMesh(ModifierData *md, const ModifierEvalContext *ctx, Mesh *mesh)
@@ -1013,6 +851,9 @@ static void panel_draw(const bContext *C, Panel *panel)
     }
   }
 
+  uiItemR(layout, ptr, "cache_memory_limit", 0, nullptr, ICON_NONE);
+  uiItemR(layout, ptr, "use_profiling", 0, nullptr, ICON_NONE);
+
   modifier_panel_end(layout, ptr);
 }
 
@@ -1036,6 +877,7 @@ static void blendRead(BlendDataReader *reader, ModifierData *md)
   NodesModifierData *nmd = reinterpret_cast<NodesModifierData *>(md);
   BLO_read_data_address(reader, &nmd->settings.properties);
   IDP_BlendDataRead(reader, &nmd->settings.properties);
+  nmd->runtime_profile = nullptr;
 }
 
 static void copyData(const ModifierData *md, ModifierData *target, const int flag)
@@ -1048,6 +890,12 @@ static void copyData(const ModifierData *md, ModifierData *target, const int fla
   if (nmd->settings.properties != nullptr) {
     tnmd->settings.properties = IDP_CopyProperty_ex(nmd->settings.properties, flag);
   }
+  tnmd->runtime_profile = nullptr;
+}
+
+static void freeRuntimeData(void *runtime_data)
+{
+  delete static_cast<blender::modifiers::geometry_nodes::GeometryNodesCache *>(runtime_data);
 }
 
 static void freeData(ModifierData *md)
@@ -1057,6 +905,12 @@ static void freeData(ModifierData *md)
     IDP_FreeProperty_ex(nmd->settings.properties, false);
     nmd->settings.properties = nullptr;
   }
+  if (nmd->runtime_profile != nullptr) {
+    BKE_node_tree_profile_free(static_cast<NodeTreeProfile *>(nmd->runtime_profile));
+    nmd->runtime_profile = nullptr;
+  }
+  freeRuntimeData(md->runtime);
+  md->runtime = nullptr;
 }
 
 ModifierTypeInfo modifierType_Nodes = {
@@ -1091,7 +945,7 @@ ModifierTypeInfo modifierType_Nodes = {
     /* dependsOnNormals */ nullptr,
     /* foreachIDLink */ foreachIDLink,
     /* foreachTexLink */ nullptr,
-    /* freeRuntimeData */ nullptr,
+    /* freeRuntimeData */ freeRuntimeData,
     /* panelRegister */ panelRegister,
     /* blendWrite */ blendWrite,
     /* blendRead */ blendRead,
@@ -0,0 +1,387 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup modifiers
+ */
+
+#include <string>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_array.hh"
+#include "BLI_hash.hh"
+#include "BLI_hash_mm3.h"
+#include "BLI_task.hh"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_pointcloud_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_geometry_set.hh"
+#include "BKE_persistent_data_handle.hh"
+
+#include "MOD_nodes_cache.hh"
+
+namespace blender::modifiers::geometry_nodes {
+
+/* Large buffers are hashed in chunks of this size in parallel. */
+static constexpr int64_t hash_chunk_size = 1 << 20;
+
+static CacheKey hash_chunk(const void *data, const int64_t size)
+{
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  CacheKey key;
+  key.lookup_hash = hash_bytes(bytes, size);
+  /* A different hash function, so that its collisions are independent from the lookup hash. */
+  key.check_hash = hash_combine(static_cast<uint64_t>(size),
+                                BLI_hash_mm3(bytes, static_cast<size_t>(size), 0));
+  return key;
+}
+
+/**
+ * Hash the elements in \a range in parallel, in chunks of \a chunk_len elements. The result
+ * only depends on the chunk length and on the hashes of the chunks, not on the threading.
+ */
+template<typename HashFn>
+static CacheKey hash_in_chunks(const IndexRange range,
+                               const int64_t chunk_len,
+                               const HashFn &hash_fn)
+{
+  if (range.size() <= chunk_len) {
+    return hash_fn(range);
+  }
+  const int64_t chunks_num = (range.size() + chunk_len - 1) / chunk_len;
+  Array<CacheKey> chunk_keys(chunks_num);
+  parallel_for(IndexRange(chunks_num), 1, [&](const IndexRange chunks) {
+    for (const int64_t i : chunks) {
+      const int64_t start = i * chunk_len;
+      chunk_keys[i] = hash_fn(range.slice(start, std::min(chunk_len, range.size() - start)));
+    }
+  });
+  CacheKey key = static_cast<uint64_t>(range.size());
+  for (const CacheKey &chunk_key : chunk_keys) {
+    key = key.combine(chunk_key);
+  }
+  return key;
+}
+
+CacheKey CacheKey::from_bytes(const void *data, const int64_t size)
+{
+  const char *bytes = static_cast<const char *>(data);
+  return hash_in_chunks(IndexRange(size), hash_chunk_size, [&](const IndexRange chunk) {
+    return hash_chunk(bytes + chunk.start(), chunk.size());
+  });
+}
+
+std::optional<CacheKey> cache_hash_value(const CPPType &type, const void *value)
+{
+  if (type.is<bke::PersistentObjectHandle>() || type.is<bke::PersistentCollectionHandle>()) {
+    /* The referenced data can change without the node tree noticing. */
+    return {};
+  }
+  if (type.is<std::string>()) {
+    const std::string &str = *static_cast<const std::string *>(value);
+    return CacheKey::from_bytes(str.data(), static_cast<int64_t>(str.size()));
+  }
+  if (type.is<GeometrySet>()) {
+    return cache_hash_geometry_set(*static_cast<const GeometrySet *>(value));
+  }
+  if (type.is_trivially_destructible()) {
+    /* Hash the bytes directly, because the hash functions of simple types like vectors and
+     * colors produce collisions too easily. */
+    return CacheKey::from_bytes(value, type.size());
+  }
+  return CacheKey(type.hash(value)).combine(type.size());
+}
+
+/* #MPoly has a padding byte that is not necessarily initialized, it must not be hashed. */
+static CacheKey hash_polys(const MPoly *mpoly, const int size)
+{
+  const int64_t chunk_len = hash_chunk_size / static_cast<int64_t>(sizeof(MPoly));
+  return hash_in_chunks(IndexRange(size), chunk_len, [&](const IndexRange chunk) {
+    Array<MPoly> polys(chunk.size());
+    for (const int64_t i : IndexRange(chunk.size())) {
+      polys[i] = mpoly[chunk[i]];
+      polys[i]._pad = 0;
+    }
+    return hash_chunk(polys.data(), polys.as_span().size_in_bytes());
+  });
+}
+
+/**
+ * The custom data layers of a mesh or point cloud are simple arrays, except for a few types
+ * that reference other memory. Those are handled separately.
+ */
+static std::optional<CacheKey> hash_custom_data(const CustomData &data, const int size)
+{
+  CacheKey key = CacheKey(static_cast<uint64_t>(size)).combine(data.totlayer);
+  for (const int i : IndexRange(data.totlayer)) {
+    const CustomDataLayer &layer = data.layers[i];
+    key = key.combine(static_cast<uint64_t>(layer.type));
+    key = key.combine(CacheKey::from_bytes(layer.name, strlen(layer.name)));
+    if (layer.data == nullptr) {
+      continue;
+    }
+    if (layer.type == CD_MDEFORMVERT) {
+      const MDeformVert *dverts = static_cast<const MDeformVert *>(layer.data);
+      for (const int j : IndexRange(size)) {
+        const MDeformVert &dvert = dverts[j];
+        key = key.combine(dvert.totweight);
+        if (dvert.totweight > 0) {
+          key = key.combine(
+              CacheKey::from_bytes(dvert.dw, sizeof(MDeformWeight) * dvert.totweight));
+        }
+      }
+      continue;
+    }
+    if (ELEM(layer.type, CD_MDISPS, CD_GRID_PAINT_MASK)) {
+      /* Multires data is not hashed, the geometry is just not cached in this case. */
+      return {};
+    }
+    if (layer.type == CD_MPOLY) {
+      key = key.combine(hash_polys(static_cast<const MPoly *>(layer.data), size));
+      continue;
+    }
+    const int64_t layer_size = static_cast<int64_t>(CustomData_sizeof(layer.type)) * size;
+    key = key.combine(CacheKey::from_bytes(layer.data, layer_size));
+  }
+  return key;
+}
+
+static std::optional<CacheKey> hash_mesh_component(const MeshComponent &component)
+{
+  const Mesh *mesh = component.get_for_read();
+  if (mesh == nullptr) {
+    return CacheKey(0);
+  }
+  CacheKey key = 1;
+  const std::pair<const CustomData *, int> custom_datas[] = {{&mesh->vdata, mesh->totvert},
+                                                             {&mesh->edata, mesh->totedge},
+                                                             {&mesh->ldata, mesh->totloop},
+                                                             {&mesh->pdata, mesh->totpoly}};
+  for (const std::pair<const CustomData *, int> &item : custom_datas) {
+    const std::optional<CacheKey> data_key = hash_custom_data(*item.first, item.second);
+    if (!data_key) {
+      return {};
+    }
+    key = key.combine(*data_key);
+  }
+  /* Materials are passed through to the output geometry. */
+  for (const int i : IndexRange(mesh->totcol)) {
+    key = key.combine(reinterpret_cast<uintptr_t>(mesh->mat[i]));
+  }
+  /* The order of the vertex group names does not matter, so their hashes are combined with an
+   * order independent operation. */
+  CacheKey names_key = 0;
+  for (const auto &item : component.vertex_group_names().items()) {
+    const CacheKey name_key = CacheKey::from_bytes(item.key.data(), item.key.size())
+                                  .combine(item.value);
+    names_key.lookup_hash += name_key.lookup_hash;
+    names_key.check_hash += name_key.check_hash;
+  }
+  return key.combine(names_key);
+}
+
+static std::optional<CacheKey> hash_pointcloud_component(const PointCloudComponent &component)
+{
+  const PointCloud *pointcloud = component.get_for_read();
+  if (pointcloud == nullptr) {
+    return CacheKey(0);
+  }
+  return hash_custom_data(pointcloud->pdata, pointcloud->totpoint);
+}
+
+static CacheKey hash_instances_component(const InstancesComponent &component)
+{
+  CacheKey key = static_cast<uint64_t>(component.instances_amount());
+  const Span<float3> positions = component.positions();
+  const Span<float3> rotations = component.rotations();
+  const Span<float3> scales = component.scales();
+  key = key.combine(CacheKey::from_bytes(positions.data(), positions.size_in_bytes()));
+  key = key.combine(CacheKey::from_bytes(rotations.data(), rotations.size_in_bytes()));
+  key = key.combine(CacheKey::from_bytes(scales.data(), scales.size_in_bytes()));
+  for (const InstancedData &data : component.instanced_data()) {
+    key = key.combine(static_cast<uint64_t>(data.type));
+    key = key.combine(reinterpret_cast<uintptr_t>(data.data.object));
+  }
+  return key;
+}
+
+/**
+ * Returns a key for everything in the geometry that can influence the evaluation of nodes, or
+ * nothing when the geometry contains data that is not hashed.
+ */
+std::optional<CacheKey> cache_hash_geometry_set(const GeometrySet &geometry_set)
+{
+  CacheKey key = 2;
+  if (const MeshComponent *component = geometry_set.get_component_for_read<MeshComponent>()) {
+    const std::optional<CacheKey> component_key = hash_mesh_component(*component);
+    if (!component_key) {
+      return {};
+    }
+    key = key.combine(*component_key);
+  }
+  if (const PointCloudComponent *component =
+          geometry_set.get_component_for_read<PointCloudComponent>()) {
+    const std::optional<CacheKey> component_key = hash_pointcloud_component(*component);
+    if (!component_key) {
+      return {};
+    }
+    key = key.combine(*component_key);
+  }
+  if (const InstancesComponent *component =
+          geometry_set.get_component_for_read<InstancesComponent>()) {
+    key = key.combine(hash_instances_component(*component));
+  }
+  return key;
+}
+
+static int64_t custom_data_size_in_bytes(const CustomData &data, const int size)
+{
+  int64_t size_in_bytes = 0;
+  for (const int i : IndexRange(data.totlayer)) {
+    size_in_bytes += static_cast<int64_t>(CustomData_sizeof(data.layers[i].type)) * size;
+  }
+  return size_in_bytes;
+}
+
+int64_t cache_estimate_size_in_bytes(const CPPType &type, const void *value)
+{
+  int64_t size_in_bytes = type.size();
+  if (!type.is<GeometrySet>()) {
+    return size_in_bytes;
+  }
+  const GeometrySet &geometry_set = *static_cast<const GeometrySet *>(value);
+  if (const Mesh *mesh = geometry_set.get_mesh_for_read()) {
+    size_in_bytes += custom_data_size_in_bytes(mesh->vdata, mesh->totvert);
+    size_in_bytes += custom_data_size_in_bytes(mesh->edata, mesh->totedge);
+    size_in_bytes += custom_data_size_in_bytes(mesh->ldata, mesh->totloop);
+    size_in_bytes += custom_data_size_in_bytes(mesh->pdata, mesh->totpoly);
+  }
+  if (const PointCloud *pointcloud = geometry_set.get_pointcloud_for_read()) {
+    size_in_bytes += custom_data_size_in_bytes(pointcloud->pdata, pointcloud->totpoint);
+  }
+  if (const InstancesComponent *component =
+          geometry_set.get_component_for_read<InstancesComponent>()) {
+    size_in_bytes += static_cast<int64_t>(component->instances_amount()) *
+                     (3 * sizeof(float3) + sizeof(InstancedData));
+  }
+  return size_in_bytes;
+}
+
+GeometryNodesCache::~GeometryNodesCache()
+{
+  this->clear();
+}
+
+void GeometryNodesCache::set_memory_limit(const int64_t memory_limit)
+{
+  std::lock_guard lock{mutex_};
+  memory_limit_ = memory_limit;
+  this->evict_until_below(memory_limit_);
+}
+
+int64_t GeometryNodesCache::memory_used() const
+{
+  return memory_used_;
+}
+
+void GeometryNodesCache::clear()
+{
+  std::lock_guard lock{mutex_};
+  this->evict_until_below(0);
+}
+
+std::optional<Vector<GMutablePointer>> GeometryNodesCache::lookup(const CacheKey &key,
+                                                                  LinearAllocator<> &allocator)
+{
+  std::lock_guard lock{mutex_};
+  Entry *entry = entries_.lookup_ptr(key);
+  if (entry == nullptr) {
+    return {};
+  }
+  entry->last_used = use_counter_++;
+  Vector<GMutablePointer> values;
+  for (const GMutablePointer &value : entry->values) {
+    const CPPType &type = *value.type();
+    void *buffer = allocator.allocate(type.size(), type.alignment());
+    type.copy_to_uninitialized(value.get(), buffer);
+    values.append({type, buffer});
+  }
+  return values;
+}
+
+void GeometryNodesCache::add(const CacheKey &key, Span<GMutablePointer> values)
+{
+  int64_t size_in_bytes = 0;
+  for (const GMutablePointer &value : values) {
+    size_in_bytes += cache_estimate_size_in_bytes(*value.type(), value.get());
+  }
+
+  std::lock_guard lock{mutex_};
+  if (size_in_bytes > memory_limit_ || entries_.contains(key)) {
+    return;
+  }
+  this->evict_until_below(memory_limit_ - size_in_bytes);
+
+  Entry entry;
+  entry.size_in_bytes = size_in_bytes;
+  entry.last_used = use_counter_++;
+  for (const GMutablePointer &value : values) {
+    const CPPType &type = *value.type();
+    void *buffer = MEM_mallocN_aligned(type.size(), type.alignment(), __func__);
+    type.copy_to_uninitialized(value.get(), buffer);
+    if (type.is<GeometrySet>()) {
+      static_cast<GeometrySet *>(buffer)->ensure_owns_direct_data();
+    }
+    entry.values.append({type, buffer});
+  }
+  entries_.add_new(key, std::move(entry));
+  memory_used_ += size_in_bytes;
+}
+
+void GeometryNodesCache::free_entry(Entry &entry)
+{
+  for (GMutablePointer &value : entry.values) {
+    value.destruct();
+    MEM_freeN(value.get());
+  }
+  memory_used_ -= entry.size_in_bytes;
+}
+
+/* Remove the least recently used entries until the used memory is below the limit. */
+void GeometryNodesCache::evict_until_below(const int64_t memory_limit)
+{
+  while (memory_used_ > memory_limit && !entries_.is_empty()) {
+    CacheKey oldest_key;
+    uint64_t oldest_use = UINT64_MAX;
+    for (const auto &item : entries_.items()) {
+      if (item.value.last_used < oldest_use) {
+        oldest_key = item.key;
+        oldest_use = item.value.last_used;
+      }
+    }
+    Entry entry = entries_.pop(oldest_key);
+    this->free_entry(entry);
+  }
+  if (entries_.is_empty()) {
+    BLI_assert(memory_used_ == 0);
+  }
+}
+
+}  // namespace blender::modifiers::geometry_nodes
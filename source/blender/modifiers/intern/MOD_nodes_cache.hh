@@ -0,0 +1,138 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup modifiers
+ *
+ * Cache for the outputs of nodes in a geometry node tree, that persists between evaluations of a
+ * nodes modifier. This avoids recomputing parts of the tree whose inputs did not change, e.g.
+ * when only a parameter at the end of the tree is changed.
+ *
+ * Entries are identified by a #CacheKey that is computed from the node settings and the keys of
+ * all its inputs. The keys of group inputs are computed from their values, for geometry the
+ * content of the geometry is hashed. Therefore, the key of a node changes whenever anything that
+ * can influence its outputs changes, and old entries are never invalidated explicitly. Instead
+ * they are evicted when the memory limit is reached.
+ *
+ * Geometry is hashed by content rather than by e.g. the session UUID of its ID, because the
+ * input geometry is usually created by previous modifiers for every evaluation, so it would never
+ * be found in the cache otherwise.
+ */
+
+#include <mutex>
+#include <optional>
+
+#include "BLI_hash.hh"
+#include "BLI_linear_allocator.hh"
+#include "BLI_map.hh"
+#include "BLI_utility_mixins.hh"
+
+#include "FN_generic_pointer.hh"
+
+struct GeometrySet;
+
+namespace blender::modifiers::geometry_nodes {
+
+using fn::CPPType;
+using fn::GMutablePointer;
+
+/**
+ * Two hashes of the same data that are computed independently from each other. The first one is
+ * used to find entries, the second one also has to match for a cache hit. That way a collision of
+ * a single 64 bit hash can't return the outputs for different inputs.
+ */
+struct CacheKey {
+  uint64_t lookup_hash = 0;
+  uint64_t check_hash = 0;
+
+  CacheKey() = default;
+  CacheKey(const uint64_t value) : lookup_hash(value), check_hash(value)
+  {
+  }
+
+  /** Hash raw data, the size of the data is part of the check. */
+  static CacheKey from_bytes(const void *data, int64_t size);
+
+  /** The result depends on the order of the keys. */
+  CacheKey combine(const CacheKey &other) const
+  {
+    CacheKey result;
+    result.lookup_hash = hash_combine(lookup_hash, other.lookup_hash);
+    /* Combine the check differently, so that it does not collide together with the lookup hash. */
+    result.check_hash = hash_combine(other.check_hash ^ 0xc2b2ae3d27d4eb4full, check_hash);
+    return result;
+  }
+
+  uint64_t hash() const
+  {
+    return lookup_hash;
+  }
+
+  friend bool operator==(const CacheKey &a, const CacheKey &b)
+  {
+    return a.lookup_hash == b.lookup_hash && a.check_hash == b.check_hash;
+  }
+};
+
+class GeometryNodesCache : NonCopyable, NonMovable {
+ private:
+  struct Entry {
+    /* Values owned by the entry, allocated with #MEM_mallocN_aligned. */
+    Vector<GMutablePointer> values;
+    int64_t size_in_bytes;
+    uint64_t last_used;
+  };
+
+  std::mutex mutex_;
+  Map<CacheKey, Entry> entries_;
+  int64_t memory_limit_ = 0;
+  int64_t memory_used_ = 0;
+  uint64_t use_counter_ = 0;
+
+ public:
+  ~GeometryNodesCache();
+
+  void set_memory_limit(int64_t memory_limit);
+  int64_t memory_used() const;
+  void clear();
+
+  /**
+   * Returns copies of the values stored for the key. The copies are allocated with the given
+   * allocator and have to be destructed by the caller.
+   */
+  std::optional<Vector<GMutablePointer>> lookup(const CacheKey &key,
+                                                LinearAllocator<> &allocator);
+
+  /**
+   * Store copies of the given values. Geometry that references data it does not own is copied
+   * so that the entry stays valid after the evaluation.
+   */
+  void add(const CacheKey &key, Span<GMutablePointer> values);
+
+ private:
+  void free_entry(Entry &entry);
+  void evict_until_below(int64_t memory_limit);
+};
+
+/* These return nothing when the value references data that is not hashed. */
+std::optional<CacheKey> cache_hash_value(const CPPType &type, const void *value);
+std::optional<CacheKey> cache_hash_geometry_set(const GeometrySet &geometry_set);
+/* Estimate the memory used by a value, which is mostly relevant for geometry. */
+int64_t cache_estimate_size_in_bytes(const CPPType &type, const void *value);
+
+}  // namespace blender::modifiers::geometry_nodes
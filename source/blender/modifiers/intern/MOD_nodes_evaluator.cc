@@ -0,0 +1,844 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup modifiers
+ *
+ * The evaluator schedules nodes based on data flow. A node is executed as soon as all of its
+ * required inputs are available, so independent branches of the tree are computed in parallel.
+ *
+ * Evaluation starts at the requested output sockets and propagates requests backwards through
+ * the tree. Only nodes whose outputs are required are executed. Nodes that support laziness are
+ * executed before their inputs are computed and can request the inputs they actually need.
+ *
+ * Every node has a #NodeState that is protected by a mutex. Locks are never held while another
+ * node state is accessed or while a task is pushed to the task pool, so there are no lock-order
+ * problems.
+ *
+ * When a #GeometryNodesCache is used, every node gets a key that identifies its outputs. The key
+ * is computed from the node settings and the keys of its inputs, so it only stays the same when
+ * nothing upstream changed. Nodes with geometry outputs look up their outputs in the cache before
+ * requesting their inputs, so entire unchanged branches of the tree are skipped.
+ *
+ * When a #NodeTreeProfile is passed in, the wall time of every node execution and the size of
+ * its outputs are recorded. Nodes are identified by their original tree, so that the profile can
+ * be displayed in the node editor.
+ */
+
+#include <mutex>
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_pointcloud_types.h"
+
+#include "BLI_enumerable_thread_specific.hh"
+#include "BLI_stack.hh"
+#include "BLI_task.h"
+
+#include "BKE_geometry_set.hh"
+#include "BKE_node.h"
+#include "BKE_node_tree_profile.h"
+
+#include "DEG_depsgraph_query.h"
+
+#include "FN_generic_value_map.hh"
+#include "FN_multi_function.hh"
+
+#include "NOD_type_callbacks.hh"
+
+#include "MOD_nodes_cache.hh"
+#include "MOD_nodes_evaluator.hh"
+
+#include "PIL_time.h"
+
+namespace blender::modifiers::geometry_nodes {
+
+using fn::CPPType;
+using fn::GValueMap;
+using nodes::GeoNodeExecParams;
+using nodes::GeoNodeLazyEvalState;
+using namespace fn::multi_function_types;
+
+enum class ValueUsage : uint8_t {
+  /* The node will use the value. */
+  Required,
+  /* The node might use the value. Only nodes that support laziness have inputs in this state for
+   * a longer time. */
+  Maybe,
+};
+
+struct InputState {
+  /* Type of the socket. This is null when the socket is not available. */
+  const CPPType *type = nullptr;
+  /* Null when the value has not been computed yet or when it has been passed to the node. */
+  void *value = nullptr;
+  ValueUsage usage = ValueUsage::Maybe;
+};
+
+struct OutputState {
+  /* True when another node or the caller of the evaluator needs the value. */
+  bool is_required = false;
+};
+
+enum class NodeScheduleState {
+  NotScheduled,
+  Scheduled,
+  Running,
+  /* The node got new inputs while it was running, so it has to run again. */
+  RunningAndRescheduled,
+};
+
+struct NodeState {
+  /* Protects all other members. Values are passed to the node from multiple threads. */
+  std::mutex mutex;
+  MutableSpan<InputState> inputs;
+  MutableSpan<OutputState> outputs;
+  /* Number of inputs with #ValueUsage::Required that do not have a value yet. */
+  int missing_required_inputs = 0;
+  /* True when at least one output is required, i.e. the node has to be executed eventually. */
+  bool has_required_outputs = false;
+  /* True when all inputs of a node that does not support laziness have been requested. */
+  bool non_lazy_inputs_handled = false;
+  /* True when the node has computed its outputs and will not run again. */
+  bool node_has_finished = false;
+  NodeScheduleState schedule_state = NodeScheduleState::NotScheduled;
+  /* Identifies the outputs of the node in the cache. Not set when the outputs depend on data that
+   * is not part of the key, e.g. objects. */
+  std::optional<CacheKey> cache_key;
+  /* True when the cache has been checked already, it is only checked before the first run. */
+  bool cache_checked = false;
+};
+
+/* Number of elements in a geometry, used to relate the execution time of a node to its work. */
+static int64_t geometry_elements_num(const CPPType &type, const void *value)
+{
+  if (!type.is<GeometrySet>()) {
+    return 0;
+  }
+  const GeometrySet &geometry_set = *static_cast<const GeometrySet *>(value);
+  int64_t elements_num = 0;
+  if (const Mesh *mesh = geometry_set.get_mesh_for_read()) {
+    elements_num += mesh->totvert;
+  }
+  if (const PointCloud *pointcloud = geometry_set.get_pointcloud_for_read()) {
+    elements_num += pointcloud->totpoint;
+  }
+  if (const InstancesComponent *component =
+          geometry_set.get_component_for_read<InstancesComponent>()) {
+    elements_num += component->instances_amount();
+  }
+  return elements_num;
+}
+
+class GeometryNodesEvaluator {
+ private:
+  GeometryNodesEvaluationParams &params_;
+  /* #LinearAllocator is not thread-safe, so every thread allocates values in its own allocator. */
+  EnumerableThreadSpecific<LinearAllocator<>> local_allocators_;
+  /* Only nodes that might contribute to the requested outputs have a state. */
+  Map<const DNode *, NodeState *> node_states_;
+  const nodes::DataTypeConversions &conversions_;
+  TaskPool *task_pool_ = nullptr;
+
+ public:
+  GeometryNodesEvaluator(GeometryNodesEvaluationParams &params)
+      : params_(params), conversions_(nodes::get_implicit_type_conversions())
+  {
+  }
+
+  Vector<GMutablePointer> execute()
+  {
+    this->create_states_for_reachable_nodes();
+    if (params_.cache != nullptr) {
+      this->compute_cache_keys();
+    }
+    this->forward_group_inputs();
+
+    task_pool_ = BLI_task_pool_create(this, TASK_PRIORITY_HIGH);
+    this->request_group_outputs();
+    BLI_task_pool_work_and_wait(task_pool_);
+    BLI_task_pool_free(task_pool_);
+    task_pool_ = nullptr;
+
+    Vector<GMutablePointer> results = this->extract_group_outputs();
+    this->destruct_node_states();
+    return results;
+  }
+
+ private:
+  void create_states_for_reachable_nodes()
+  {
+    LinearAllocator<> &allocator = local_allocators_.local();
+
+    Stack<const DNode *> nodes_to_check;
+    for (const DInputSocket *socket : params_.output_sockets) {
+      nodes_to_check.push(&socket->node());
+    }
+    while (!nodes_to_check.is_empty()) {
+      const DNode &node = *nodes_to_check.pop();
+      if (node_states_.contains(&node)) {
+        continue;
+      }
+
+      NodeState &node_state = *allocator.construct<NodeState>();
+      node_state.inputs = allocator.allocate_array<InputState>(node.inputs().size());
+      node_state.outputs = allocator.allocate_array<OutputState>(node.outputs().size());
+      for (InputState &input_state : node_state.inputs) {
+        new (&input_state) InputState();
+      }
+      for (OutputState &output_state : node_state.outputs) {
+        new (&output_state) OutputState();
+      }
+      node_states_.add_new(&node, &node_state);
+
+      for (const DInputSocket *socket : node.inputs()) {
+        if (!socket->is_available()) {
+          continue;
+        }
+        InputState &input_state = node_state.inputs[socket->index()];
+        input_state.type = nodes::socket_cpp_type_get(*socket->typeinfo());
+
+        Span<const DOutputSocket *> origin_sockets = socket->linked_sockets();
+        BLI_assert(origin_sockets.size() + socket->linked_group_inputs().size() <= 1);
+        if (origin_sockets.is_empty()) {
+          /* The value does not depend on other nodes, so it can be initialized right away. */
+          input_state.value = this->get_unlinked_input_value(*socket).get();
+          continue;
+        }
+        const DOutputSocket &origin_socket = *origin_sockets[0];
+        if (!origin_socket.is_available()) {
+          /* Unavailable outputs are never computed, use a default value instead. */
+          const CPPType &type = *input_state.type;
+          void *buffer = allocator.allocate(type.size(), type.alignment());
+          type.copy_to_uninitialized(type.default_value(), buffer);
+          input_state.value = buffer;
+          continue;
+        }
+        if (params_.input_values.contains(&origin_socket)) {
+          /* The value is passed in by the caller. */
+          continue;
+        }
+        nodes_to_check.push(&origin_socket.node());
+      }
+    }
+  }
+
+  static CacheKey hash_node_settings(const bNode &bnode)
+  {
+    CacheKey key = CacheKey::from_bytes(bnode.idname, strlen(bnode.idname));
+    key = key.combine(static_cast<uint64_t>(bnode.custom1));
+    key = key.combine(static_cast<uint64_t>(bnode.custom2));
+    key = key.combine(CacheKey::from_bytes(&bnode.custom3, sizeof(float)));
+    key = key.combine(CacheKey::from_bytes(&bnode.custom4, sizeof(float)));
+    if (bnode.storage != nullptr) {
+      const int64_t storage_size = static_cast<int64_t>(MEM_allocN_len(bnode.storage));
+      key = key.combine(CacheKey::from_bytes(bnode.storage, storage_size));
+    }
+    return key;
+  }
+
+  void compute_cache_keys()
+  {
+    Map<const DOutputSocket *, std::optional<CacheKey>> group_input_keys;
+    for (auto item : params_.input_values.items()) {
+      const GMutablePointer value = item.value;
+      group_input_keys.add_new(item.key, cache_hash_value(*value.type(), value.get()));
+    }
+
+    Set<const DNode *> handled_nodes;
+    for (auto item : node_states_.items()) {
+      this->compute_cache_key(*item.key, group_input_keys, handled_nodes);
+    }
+  }
+
+  std::optional<CacheKey> compute_cache_key(
+      const DNode &node,
+      const Map<const DOutputSocket *, std::optional<CacheKey>> &group_input_keys,
+      Set<const DNode *> &handled_nodes)
+  {
+    NodeState &node_state = *node_states_.lookup(&node);
+    if (!handled_nodes.add(&node)) {
+      return node_state.cache_key;
+    }
+
+    std::optional<CacheKey> key = hash_node_settings(*node.bnode());
+    for (const DInputSocket *socket : node.inputs()) {
+      const InputState &input_state = node_state.inputs[socket->index()];
+      if (input_state.type == nullptr) {
+        continue;
+      }
+      std::optional<CacheKey> input_key;
+      if (input_state.value != nullptr) {
+        input_key = cache_hash_value(*input_state.type, input_state.value);
+      }
+      else {
+        const DOutputSocket &origin_socket = *socket->linked_sockets()[0];
+        if (group_input_keys.contains(&origin_socket)) {
+          input_key = group_input_keys.lookup(&origin_socket);
+        }
+        else {
+          const std::optional<CacheKey> origin_key = this->compute_cache_key(
+              origin_socket.node(), group_input_keys, handled_nodes);
+          if (origin_key) {
+            input_key = origin_key->combine(origin_socket.index());
+          }
+        }
+      }
+      if (!input_key) {
+        key.reset();
+        break;
+      }
+      *key = key->combine(CacheKey(socket->index()).combine(*input_key));
+    }
+    node_state.cache_key = key;
+    return key;
+  }
+
+  static bool node_uses_cache(const DNode &node)
+  {
+    /* Only geometry is expensive enough to compute to be worth caching. */
+    for (const DOutputSocket *socket : node.outputs()) {
+      if (socket->is_available() && socket->typeinfo()->type == SOCK_GEOMETRY) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void forward_group_inputs()
+  {
+    for (auto item : params_.input_values.items()) {
+      this->forward_output(*item.key, item.value);
+    }
+    params_.input_values.clear();
+  }
+
+  void request_group_outputs()
+  {
+    Vector<const DInputSocket *> inputs_to_request;
+    for (const DInputSocket *socket : params_.output_sockets) {
+      NodeState &node_state = *node_states_.lookup(&socket->node());
+      std::lock_guard lock{node_state.mutex};
+      this->set_input_required_locked(node_state, *socket, inputs_to_request);
+    }
+    this->request_inputs_from_origins(inputs_to_request);
+  }
+
+  Vector<GMutablePointer> extract_group_outputs()
+  {
+    Vector<GMutablePointer> results;
+    for (const DInputSocket *socket : params_.output_sockets) {
+      NodeState &node_state = *node_states_.lookup(&socket->node());
+      InputState &input_state = node_state.inputs[socket->index()];
+      const CPPType &type = *input_state.type;
+      void *buffer = params_.allocator.allocate(type.size(), type.alignment());
+      if (input_state.value != nullptr) {
+        type.relocate_to_uninitialized(input_state.value, buffer);
+        input_state.value = nullptr;
+      }
+      else {
+        BLI_assert(false);
+        type.copy_to_uninitialized(type.default_value(), buffer);
+      }
+      results.append({type, buffer});
+    }
+    return results;
+  }
+
+  void destruct_node_states()
+  {
+    for (NodeState *node_state : node_states_.values()) {
+      for (InputState &input_state : node_state->inputs) {
+        if (input_state.value != nullptr) {
+          input_state.type->destruct(input_state.value);
+        }
+      }
+      node_state->~NodeState();
+    }
+    node_states_.clear();
+  }
+
+  static void run_node_from_task_pool(TaskPool *task_pool, void *task_data)
+  {
+    GeometryNodesEvaluator &evaluator = *(GeometryNodesEvaluator *)BLI_task_pool_user_data(
+        task_pool);
+    const DNode &node = *(const DNode *)task_data;
+    evaluator.run_node_task(node);
+  }
+
+  void add_node_to_task_pool(const DNode &node)
+  {
+    BLI_task_pool_push(task_pool_, run_node_from_task_pool, (void *)&node, false, nullptr);
+  }
+
+  /**
+   * Returns true when the caller has to push the node to the task pool after the lock has been
+   * released.
+   */
+  bool schedule_node_locked(NodeState &node_state)
+  {
+    if (node_state.node_has_finished) {
+      return false;
+    }
+    switch (node_state.schedule_state) {
+      case NodeScheduleState::NotScheduled: {
+        if (node_state.non_lazy_inputs_handled && node_state.missing_required_inputs > 0) {
+          /* The node will be scheduled once its missing inputs have been computed. */
+          return false;
+        }
+        node_state.schedule_state = NodeScheduleState::Scheduled;
+        return true;
+      }
+      case NodeScheduleState::Scheduled: {
+        return false;
+      }
+      case NodeScheduleState::Running: {
+        node_state.schedule_state = NodeScheduleState::RunningAndRescheduled;
+        return false;
+      }
+      case NodeScheduleState::RunningAndRescheduled: {
+        return false;
+      }
+    }
+    BLI_assert(false);
+    return false;
+  }
+
+  void set_input_required_locked(NodeState &node_state,
+                                 const DInputSocket &socket,
+                                 Vector<const DInputSocket *> &r_inputs_to_request)
+  {
+    InputState &input_state = node_state.inputs[socket.index()];
+    if (input_state.type == nullptr) {
+      /* The socket is not available. */
+      return;
+    }
+    if (input_state.usage == ValueUsage::Required) {
+      return;
+    }
+    input_state.usage = ValueUsage::Required;
+    if (input_state.value != nullptr) {
+      return;
+    }
+    node_state.missing_required_inputs++;
+    r_inputs_to_request.append(&socket);
+  }
+
+  void request_inputs_from_origins(Span<const DInputSocket *> sockets)
+  {
+    for (const DInputSocket *socket : sockets) {
+      /* Inputs that are not linked to another node have a value from the start. */
+      BLI_assert(socket->linked_sockets().size() == 1);
+      const DOutputSocket &origin_socket = *socket->linked_sockets()[0];
+      this->request_output(origin_socket);
+    }
+  }
+
+  void request_output(const DOutputSocket &socket)
+  {
+    const DNode &node = socket.node();
+    NodeState *node_state = node_states_.lookup_default(&node, nullptr);
+    if (node_state == nullptr) {
+      BLI_assert(false);
+      return;
+    }
+    bool schedule = false;
+    {
+      std::lock_guard lock{node_state->mutex};
+      OutputState &output_state = node_state->outputs[socket.index()];
+      if (output_state.is_required) {
+        return;
+      }
+      output_state.is_required = true;
+      node_state->has_required_outputs = true;
+      schedule = this->schedule_node_locked(*node_state);
+    }
+    if (schedule) {
+      this->add_node_to_task_pool(node);
+    }
+  }
+
+  void run_node_task(const DNode &node)
+  {
+    NodeState &node_state = *node_states_.lookup(&node);
+    const bool is_lazy = node.typeinfo()->geometry_node_execute_supports_laziness;
+
+    bool check_cache = false;
+    {
+      std::lock_guard lock{node_state.mutex};
+      BLI_assert(node_state.schedule_state == NodeScheduleState::Scheduled);
+      node_state.schedule_state = NodeScheduleState::Running;
+      check_cache = !node_state.cache_checked && !node_state.node_has_finished;
+      node_state.cache_checked = true;
+    }
+    if (check_cache) {
+      /* When the outputs are cached, the inputs are never requested and the nodes that compute
+       * them are not executed. */
+      this->load_outputs_from_cache(node, node_state);
+    }
+
+    Vector<const DInputSocket *> inputs_to_request;
+    bool can_execute = false;
+    {
+      std::lock_guard lock{node_state.mutex};
+      if (!node_state.node_has_finished) {
+        if (!node_state.non_lazy_inputs_handled) {
+          if (!is_lazy) {
+            for (const DInputSocket *socket : node.inputs()) {
+              this->set_input_required_locked(node_state, *socket, inputs_to_request);
+            }
+          }
+          node_state.non_lazy_inputs_handled = true;
+        }
+        can_execute = node_state.missing_required_inputs == 0;
+      }
+    }
+
+    this->request_inputs_from_origins(inputs_to_request);
+    if (can_execute) {
+      this->execute_node(node, node_state);
+    }
+
+    bool reschedule = false;
+    {
+      std::lock_guard lock{node_state.mutex};
+      if (node_state.schedule_state == NodeScheduleState::RunningAndRescheduled &&
+          !node_state.node_has_finished) {
+        node_state.schedule_state = NodeScheduleState::Scheduled;
+        reschedule = true;
+      }
+      else {
+        node_state.schedule_state = NodeScheduleState::NotScheduled;
+      }
+    }
+    if (reschedule) {
+      this->add_node_to_task_pool(node);
+    }
+  }
+
+  void load_outputs_from_cache(const DNode &node, NodeState &node_state)
+  {
+    if (params_.cache == nullptr || !node_state.cache_key || !node_uses_cache(node)) {
+      return;
+    }
+    std::optional<Vector<GMutablePointer>> values = params_.cache->lookup(
+        *node_state.cache_key, local_allocators_.local());
+    if (!values) {
+      return;
+    }
+    {
+      std::lock_guard lock{node_state.mutex};
+      node_state.node_has_finished = true;
+    }
+    int value_index = 0;
+    for (const DOutputSocket *socket : node.outputs()) {
+      if (socket->is_available()) {
+        this->forward_output(*socket, (*values)[value_index]);
+        value_index++;
+      }
+    }
+  }
+
+  void execute_node(const DNode &node, NodeState &node_state)
+  {
+    const bNode &bnode = *node.bnode();
+    LinearAllocator<> &allocator = local_allocators_.local();
+
+    GeoNodeLazyEvalState lazy_state;
+    GValueMap<StringRef> node_inputs_map{allocator};
+    {
+      std::lock_guard lock{node_state.mutex};
+      for (const DInputSocket *socket : node.inputs()) {
+        InputState &input_state = node_state.inputs[socket->index()];
+        if (input_state.value != nullptr) {
+          node_inputs_map.add_new_direct(socket->identifier(),
+                                         GMutablePointer{*input_state.type, input_state.value});
+          input_state.value = nullptr;
+        }
+      }
+      for (const DOutputSocket *socket : node.outputs()) {
+        if (node_state.outputs[socket->index()].is_required) {
+          lazy_state.required_outputs.add(socket->identifier());
+        }
+      }
+    }
+
+    NodeProfileStats profile_stats = {0.0, 0, 0, 1};
+    const double start_time = (params_.profile != nullptr) ? PIL_check_seconds_timer() : 0.0;
+
+    GValueMap<StringRef> node_outputs_map{allocator};
+    GeoNodeExecParams params{bnode,
+                             node_inputs_map,
+                             node_outputs_map,
+                             *params_.handle_map,
+                             params_.self_object,
+                             &lazy_state};
+    if (bnode.typeinfo->geometry_node_execute != nullptr) {
+      bnode.typeinfo->geometry_node_execute(params);
+    }
+    else {
+      this->execute_multi_function_node(node, params, allocator);
+    }
+
+    if (params_.profile != nullptr) {
+      profile_stats.time_ms = (PIL_check_seconds_timer() - start_time) * 1e3;
+    }
+
+    Vector<const DInputSocket *> inputs_to_request;
+    bool node_has_finished;
+    {
+      std::lock_guard lock{node_state.mutex};
+      /* Lazy nodes might not have used all inputs yet, keep them for the next execution. */
+      for (const DInputSocket *socket : node.inputs()) {
+        if (node_inputs_map.contains(socket->identifier())) {
+          node_state.inputs[socket->index()].value =
+              node_inputs_map.extract(socket->identifier()).get();
+        }
+      }
+      for (const StringRef identifier : lazy_state.requested_inputs) {
+        for (const DInputSocket *socket : node.inputs()) {
+          if (socket->identifier() == identifier) {
+            this->set_input_required_locked(node_state, *socket, inputs_to_request);
+            break;
+          }
+        }
+      }
+      node_has_finished = lazy_state.requested_inputs.is_empty();
+      node_state.node_has_finished = node_has_finished;
+      if (!node_has_finished && node_state.missing_required_inputs == 0) {
+        /* The requested inputs have been computed while the node was running. */
+        node_state.schedule_state = NodeScheduleState::RunningAndRescheduled;
+      }
+    }
+
+    if (node_has_finished) {
+      Vector<GMutablePointer> output_values;
+      bool all_outputs_computed = true;
+      for (const DOutputSocket *socket : node.outputs()) {
+        if (!socket->is_available()) {
+          continue;
+        }
+        if (node_outputs_map.contains(socket->identifier())) {
+          output_values.append(node_outputs_map.extract(socket->identifier()));
+        }
+        else {
+          /* Lazy nodes don't have to compute outputs that are not required. */
+          const CPPType &type = *nodes::socket_cpp_type_get(*socket->typeinfo());
+          void *buffer = allocator.allocate(type.size(), type.alignment());
+          type.copy_to_uninitialized(type.default_value(), buffer);
+          output_values.append({type, buffer});
+          all_outputs_computed = false;
+        }
+      }
+      if (params_.profile != nullptr) {
+        for (const GMutablePointer &value : output_values) {
+          profile_stats.elements_num += geometry_elements_num(*value.type(), value.get());
+          profile_stats.bytes += cache_estimate_size_in_bytes(*value.type(), value.get());
+        }
+      }
+      if (params_.cache != nullptr && node_state.cache_key && all_outputs_computed &&
+          node_uses_cache(node)) {
+        params_.cache->add(*node_state.cache_key, output_values);
+      }
+      int value_index = 0;
+      for (const DOutputSocket *socket : node.outputs()) {
+        if (socket->is_available()) {
+          this->forward_output(*socket, output_values[value_index]);
+          value_index++;
+        }
+      }
+    }
+    if (params_.profile != nullptr) {
+      this->add_to_profile(node, profile_stats);
+    }
+    this->request_inputs_from_origins(inputs_to_request);
+  }
+
+  /**
+   * The time is also added to all group nodes that contain the node, so that the cost of a group
+   * is visible in the parent tree.
+   */
+  void add_to_profile(const DNode &node, const NodeProfileStats &stats)
+  {
+    BKE_node_tree_profile_add(params_.profile,
+                              get_original_tree(node.node_ref()),
+                              node.node_ref().bnode()->name,
+                              &stats);
+    const NodeProfileStats group_stats = {stats.time_ms, 0, 0, 0};
+    for (const DParentNode *parent = node.parent(); parent != nullptr;
+         parent = parent->parent()) {
+      BKE_node_tree_profile_add(params_.profile,
+                                get_original_tree(parent->node_ref()),
+                                parent->node_ref().bnode()->name,
+                                &group_stats);
+    }
+  }
+
+  static const bNodeTree *get_original_tree(const nodes::NodeRef &node_ref)
+  {
+    return reinterpret_cast<const bNodeTree *>(DEG_get_original_id(&node_ref.btree()->id));
+  }
+
+  void execute_multi_function_node(const DNode &node,
+                                   GeoNodeExecParams &params,
+                                   LinearAllocator<> &allocator)
+  {
+    const MultiFunction &fn = *params_.mf_by_node->lookup(&node);
+    MFContextBuilder fn_context;
+    MFParamsBuilder fn_params{fn, 1};
+    Vector<GMutablePointer> input_data;
+    for (const DInputSocket *dsocket : node.inputs()) {
+      if (dsocket->is_available()) {
+        GMutablePointer data = params.extract_input(dsocket->identifier());
+        fn_params.add_readonly_single_input(GSpan(*data.type(), data.get(), 1));
+        input_data.append(data);
+      }
+    }
+    Vector<GMutablePointer> output_data;
+    for (const DOutputSocket *dsocket : node.outputs()) {
+      if (dsocket->is_available()) {
+        const CPPType &type = *nodes::socket_cpp_type_get(*dsocket->typeinfo());
+        void *buffer = allocator.allocate(type.size(), type.alignment());
+        fn_params.add_uninitialized_single_output(GMutableSpan(type, buffer, 1));
+        output_data.append(GMutablePointer(type, buffer));
+      }
+    }
+    fn.call(IndexRange(1), fn_params, fn_context);
+    for (GMutablePointer value : input_data) {
+      value.destruct();
+    }
+    int output_index = 0;
+    for (const int i : node.outputs().index_range()) {
+      if (node.output(i).is_available()) {
+        GMutablePointer value = output_data[output_index];
+        params.set_output_by_move(node.output(i).identifier(), value);
+        value.destruct();
+        output_index++;
+      }
+    }
+  }
+
+  /**
+   * Pass the value to all linked inputs that belong to nodes that might be executed. The last
+   * input gets the original value, so that there is no copy when there is only a single user.
+   */
+  void forward_output(const DOutputSocket &from_socket, GMutablePointer value_to_forward)
+  {
+    LinearAllocator<> &allocator = local_allocators_.local();
+    const CPPType &from_type = *value_to_forward.type();
+
+    Vector<const DInputSocket *> to_sockets;
+    for (const DInputSocket *to_socket : from_socket.linked_sockets()) {
+      if (to_socket->is_available() && node_states_.contains(&to_socket->node())) {
+        to_sockets.append(to_socket);
+      }
+    }
+
+    if (to_sockets.is_empty()) {
+      /* This value is not further used, so destruct it. */
+      value_to_forward.destruct();
+      return;
+    }
+
+    for (const int i : to_sockets.index_range()) {
+      const DInputSocket &to_socket = *to_sockets[i];
+      const CPPType &to_type = *nodes::socket_cpp_type_get(*to_socket.typeinfo());
+      const bool is_last_user = i == to_sockets.size() - 1;
+      if (from_type == to_type) {
+        if (is_last_user) {
+          this->add_value_to_input(to_socket, value_to_forward);
+        }
+        else {
+          void *buffer = allocator.allocate(to_type.size(), to_type.alignment());
+          to_type.copy_to_uninitialized(value_to_forward.get(), buffer);
+          this->add_value_to_input(to_socket, {to_type, buffer});
+        }
+      }
+      else {
+        void *buffer = allocator.allocate(to_type.size(), to_type.alignment());
+        if (conversions_.is_convertible(from_type, to_type)) {
+          conversions_.convert(from_type, to_type, value_to_forward.get(), buffer);
+        }
+        else {
+          to_type.copy_to_uninitialized(to_type.default_value(), buffer);
+        }
+        this->add_value_to_input(to_socket, {to_type, buffer});
+        if (is_last_user) {
+          value_to_forward.destruct();
+        }
+      }
+    }
+  }
+
+  void add_value_to_input(const DInputSocket &socket, GMutablePointer value)
+  {
+    NodeState &node_state = *node_states_.lookup(&socket.node());
+    bool schedule = false;
+    {
+      std::lock_guard lock{node_state.mutex};
+      InputState &input_state = node_state.inputs[socket.index()];
+      BLI_assert(input_state.value == nullptr);
+      input_state.value = value.get();
+      if (input_state.usage == ValueUsage::Required) {
+        node_state.missing_required_inputs--;
+        if (node_state.missing_required_inputs == 0 && node_state.has_required_outputs) {
+          schedule = this->schedule_node_locked(node_state);
+        }
+      }
+    }
+    if (schedule) {
+      this->add_node_to_task_pool(socket.node());
+    }
+  }
+
+  GMutablePointer get_unlinked_input_value(const DInputSocket &socket)
+  {
+    bNodeSocket *bsocket;
+    if (socket.linked_group_inputs().size() == 0) {
+      bsocket = socket.bsocket();
+    }
+    else {
+      bsocket = socket.linked_group_inputs()[0]->bsocket();
+    }
+    const CPPType &type = *nodes::socket_cpp_type_get(*socket.typeinfo());
+    void *buffer = local_allocators_.local().allocate(type.size(), type.alignment());
+
+    if (bsocket->type == SOCK_OBJECT) {
+      Object *object = ((bNodeSocketValueObject *)bsocket->default_value)->value;
+      bke::PersistentObjectHandle object_handle = params_.handle_map->lookup(object);
+      new (buffer) bke::PersistentObjectHandle(object_handle);
+    }
+    else if (bsocket->type == SOCK_COLLECTION) {
+      Collection *collection = ((bNodeSocketValueCollection *)bsocket->default_value)->value;
+      bke::PersistentCollectionHandle collection_handle = params_.handle_map->lookup(collection);
+      new (buffer) bke::PersistentCollectionHandle(collection_handle);
+    }
+    else {
+      nodes::socket_cpp_value_get(*bsocket, buffer);
+    }
+
+    return {type, buffer};
+  }
+};
+
+Vector<GMutablePointer> evaluate_geometry_nodes(GeometryNodesEvaluationParams &params)
+{
+  GeometryNodesEvaluator evaluator{params};
+  return evaluator.execute();
+}
+
+}  // namespace blender::modifiers::geometry_nodes
@@ -0,0 +1,70 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup modifiers
+ */
+
+#include "BLI_map.hh"
+
+#include "NOD_derived_node_tree.hh"
+#include "NOD_geometry_exec.hh"
+#include "NOD_node_tree_multi_function.hh"
+
+#include "FN_generic_pointer.hh"
+
+struct NodeTreeProfile;
+
+namespace blender::modifiers::geometry_nodes {
+
+using namespace nodes::derived_node_tree_types;
+using fn::GMutablePointer;
+
+class GeometryNodesCache;
+
+struct GeometryNodesEvaluationParams {
+  /* Used to allocate the computed output values. They have to be destructed by the caller. */
+  LinearAllocator<> &allocator;
+
+  /* Values for the output sockets of the group input node. The evaluator takes ownership of them
+   * and destructs them when they are not used anymore. */
+  Map<const DOutputSocket *, GMutablePointer> input_values;
+  /* Sockets whose values should be computed. */
+  Vector<const DInputSocket *> output_sockets;
+
+  nodes::MultiFunctionByNode *mf_by_node;
+  const bke::PersistentDataHandleMap *handle_map;
+  const Object *self_object;
+  /* Optional cache for the outputs of nodes that persists between evaluations. */
+  GeometryNodesCache *cache = nullptr;
+  /* Optional, receives the execution time of every node. */
+  NodeTreeProfile *profile = nullptr;
+
+  GeometryNodesEvaluationParams(LinearAllocator<> &allocator) : allocator(allocator)
+  {
+  }
+};
+
+/**
+ * Evaluate the node tree to compute the values of #GeometryNodesEvaluationParams.output_sockets.
+ * Nodes whose inputs are available are executed in parallel on the task scheduler, and only
+ * nodes that contribute to the requested outputs are executed.
+ */
+Vector<GMutablePointer> evaluate_geometry_nodes(GeometryNodesEvaluationParams &params);
+
+}  // namespace blender::modifiers::geometry_nodes
@@ -22,6 +22,7 @@
 
 #include "BLI_bitmap.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_utildefines_stack.h"
 
 #include "DNA_mesh_types.h"
@@ -179,6 +180,390 @@ static void mesh_calc_hq_normal(Mesh *mesh, float (*poly_nors)[3], float (*r_ver
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Threaded Passes
+ *
+ * Loops over the faces and vertices of the new mesh which only write to their own elements.
+ * \{ */
+
+typedef struct SolidifyShellFlipData {
+  const CustomData *src_ldata;
+  CustomData *dst_ldata;
+  /** The faces and loops of the shell, stored after the original ones. */
+  MPoly *mpoly;
+  MLoop *mloop;
+  int totloop;
+  uint numVerts;
+  uint numEdges;
+  short mat_ofs;
+  short mat_nr_max;
+} SolidifyShellFlipData;
+
+static void solidify_shell_flip_cb(void *__restrict userdata,
+                                   const int poly_index,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SolidifyShellFlipData *data = userdata;
+  MPoly *mp = &data->mpoly[poly_index];
+  const int loop_end = mp->totloop - 1;
+  MLoop *ml2;
+  uint e;
+  int j;
+
+  /* reverses the loop direction (MLoop.v as well as custom-data)
+   * MLoop.e also needs to be corrected too, done in a separate loop below. */
+  ml2 = data->mloop + mp->loopstart;
+#if 0
+  for (j = 0; j < mp->totloop; j++) {
+    CustomData_copy_data(data->src_ldata,
+                         data->dst_ldata,
+                         mp->loopstart + j,
+                         mp->loopstart + (loop_end - j) + data->totloop,
+                         1);
+  }
+#else
+  /* slightly more involved, keep the first vertex the same for the copy,
+   * ensures the diagonals in the new face match the original. */
+  j = 0;
+  for (int j_prev = loop_end; j < mp->totloop; j_prev = j++) {
+    CustomData_copy_data(data->src_ldata,
+                         data->dst_ldata,
+                         mp->loopstart + j,
+                         mp->loopstart + (loop_end - j_prev) + data->totloop,
+                         1);
+  }
+#endif
+
+  if (data->mat_ofs) {
+    mp->mat_nr += data->mat_ofs;
+    CLAMP(mp->mat_nr, 0, data->mat_nr_max);
+  }
+
+  e = ml2[0].e;
+  for (j = 0; j < loop_end; j++) {
+    ml2[j].e = ml2[j + 1].e;
+  }
+  ml2[loop_end].e = e;
+
+  mp->loopstart += data->totloop;
+
+  for (j = 0; j < mp->totloop; j++) {
+    ml2[j].e += data->numEdges;
+    ml2[j].v += data->numVerts;
+  }
+}
+
+typedef struct SolidifyEvenAnglesData {
+  const MVert *mvert;
+  const MLoop *mloop;
+  const MPoly *mpoly;
+  const float (*vert_nors)[3];
+  const float (*poly_nors)[3];
+#ifdef USE_NONMANIFOLD_WORKAROUND
+  const MEdge *orig_medge;
+  bool check_non_manifold;
+#endif
+  /** Per loop: the corner angle and the thickness weighted by it. */
+  float (*r_loop_angles)[2];
+} SolidifyEvenAnglesData;
+
+static void solidify_even_angles_cb(void *__restrict userdata,
+                                    const int poly_index,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SolidifyEvenAnglesData *data = userdata;
+  const MVert *mvert = data->mvert;
+  const MPoly *mp = &data->mpoly[poly_index];
+  const MLoop *ml = &data->mloop[mp->loopstart];
+  float(*loop_angles)[2] = &data->r_loop_angles[mp->loopstart];
+
+  /* #BKE_mesh_calc_poly_angles logic is inlined here */
+  float nor_prev[3];
+  float nor_next[3];
+
+  int i_curr = mp->totloop - 1;
+  int i_next = 0;
+
+  sub_v3_v3v3(nor_prev, mvert[ml[i_curr - 1].v].co, mvert[ml[i_curr].v].co);
+  normalize_v3(nor_prev);
+
+  while (i_next < mp->totloop) {
+    float angle;
+    sub_v3_v3v3(nor_next, mvert[ml[i_curr].v].co, mvert[ml[i_next].v].co);
+    normalize_v3(nor_next);
+    angle = angle_normalized_v3v3(nor_prev, nor_next);
+
+    /* --- not related to angle calc --- */
+    if (angle < FLT_EPSILON) {
+      angle = FLT_EPSILON;
+    }
+
+    const uint vidx = ml[i_curr].v;
+    loop_angles[i_curr][0] = angle;
+
+#ifdef USE_NONMANIFOLD_WORKAROUND
+    /* skip 3+ face user edges */
+    if ((data->check_non_manifold == false) ||
+        LIKELY(((data->orig_medge[ml[i_curr].e].flag & ME_EDGE_TMP_TAG) == 0) &&
+               ((data->orig_medge[ml[i_next].e].flag & ME_EDGE_TMP_TAG) == 0))) {
+      loop_angles[i_curr][1] = shell_v3v3_normalized_to_dist(data->vert_nors[vidx],
+                                                             data->poly_nors[poly_index]) *
+                               angle;
+    }
+    else {
+      loop_angles[i_curr][1] = angle;
+    }
+#else
+    loop_angles[i_curr][1] = shell_v3v3_normalized_to_dist(data->vert_nors[vidx],
+                                                           data->poly_nors[poly_index]) *
+                             angle;
+#endif
+    /* --- end non-angle-calc section --- */
+
+    /* step */
+    copy_v3_v3(nor_prev, nor_next);
+    i_curr = i_next;
+    i_next++;
+  }
+}
+
+typedef struct SolidifyOffsetData {
+  /** The first vertex to offset, see `INIT_VERT_ARRAY_OFFSETS`. */
+  MVert *mvert;
+  const uint *new_vert_arr;
+  bool do_shell_align;
+  /** Offsetting the original vertices instead of the new ones. */
+  bool is_orig;
+
+  /* No even thickness. */
+  float scalar_short;
+  const MDeformVert *dvert;
+  int defgrp_index;
+  bool defgrp_invert;
+  float offset_fac_vg;
+  float offset_fac_vg_inv;
+  bool do_clamp;
+  bool do_angle_clamp;
+  float offset;
+  float offset_sq;
+  const float *vert_lens;
+  const float *vert_angs;
+
+  /* Even thickness. */
+  float ofs;
+  const float (*vert_nors)[3];
+  const float *vert_angles;
+  const float *vert_accum;
+} SolidifyOffsetData;
+
+static void solidify_offset_cb(void *__restrict userdata,
+                               const int index,
+                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SolidifyOffsetData *data = userdata;
+  const uint i_orig = (uint)index;
+  const uint i = data->do_shell_align ? i_orig : data->new_vert_arr[i_orig];
+  const float offset = data->offset;
+  MVert *mv = &data->mvert[i_orig];
+  float scalar_short_vgroup = data->scalar_short;
+
+  if (data->dvert) {
+    const MDeformVert *dv = &data->dvert[i];
+    if (data->defgrp_invert) {
+      scalar_short_vgroup = 1.0f - BKE_defvert_find_weight(dv, data->defgrp_index);
+    }
+    else {
+      scalar_short_vgroup = BKE_defvert_find_weight(dv, data->defgrp_index);
+    }
+    scalar_short_vgroup = (data->offset_fac_vg +
+                           (scalar_short_vgroup * data->offset_fac_vg_inv)) *
+                          data->scalar_short;
+  }
+  if (data->do_clamp && offset > FLT_EPSILON) {
+    if (data->do_angle_clamp) {
+      /* The original vertices are indexed by their position in the vertex array here. */
+      const float cos_ang = data->is_orig ? cosf(data->vert_angs[i_orig] * 0.5f) :
+                                            cosf(((2 * M_PI) - data->vert_angs[i]) * 0.5f);
+      if (cos_ang > 0) {
+        float max_off = sqrtf(data->vert_lens[i]) * 0.5f / cos_ang;
+        if (max_off < offset * 0.5f) {
+          scalar_short_vgroup *= max_off / offset * 2;
+        }
+      }
+    }
+    else {
+      if (data->vert_lens[i] < data->offset_sq) {
+        float scalar = sqrtf(data->vert_lens[i]) / offset;
+        scalar_short_vgroup *= scalar;
+      }
+    }
+  }
+  madd_v3v3short_fl(mv->co, mv->no, scalar_short_vgroup);
+}
+
+static void solidify_offset_even_cb(void *__restrict userdata,
+                                    const int index,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SolidifyOffsetData *data = userdata;
+  const uint i_orig = (uint)index;
+  const uint i_other = data->do_shell_align ? i_orig : data->new_vert_arr[i_orig];
+  if (data->vert_accum[i_other]) { /* zero if unselected */
+    madd_v3_v3fl(data->mvert[i_orig].co,
+                 data->vert_nors[i_other],
+                 data->ofs * (data->vert_angles[i_other] / data->vert_accum[i_other]));
+  }
+}
+
+typedef struct SolidifyRimData {
+  const CustomData *src_pdata;
+  const CustomData *src_ldata;
+  CustomData *dst_pdata;
+  CustomData *dst_ldata;
+  MEdge *medge;
+  MPoly *mpoly;
+  MLoop *mloop;
+  const uint *new_vert_arr;
+  const uint *new_edge_arr;
+  const uint *old_vert_arr;
+  const uint *edge_users;
+  const char *edge_order;
+  uint numVerts;
+  uint numEdges;
+  uint numPolys;
+  uint numLoops;
+  uint newEdges;
+  uint stride;
+  bool do_shell;
+  short mat_ofs_rim;
+  short mat_nr_max;
+  uchar crease_rim;
+  uchar crease_outer;
+  uchar crease_inner;
+} SolidifyRimData;
+
+/** Rim edges are stored after the copied and new edges, one per rim vertex. */
+static void solidify_rim_edge_cb(void *__restrict userdata,
+                                 const int index,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SolidifyRimData *data = userdata;
+  const uint i = (uint)index;
+  MEdge *ed = &data->medge[(data->numEdges * data->stride) + data->newEdges + i];
+
+  ed->v1 = data->new_vert_arr[i];
+  ed->v2 = (data->do_shell ? data->new_vert_arr[i] : i) + data->numVerts;
+  ed->flag |= ME_EDGEDRAW | ME_EDGERENDER;
+
+  if (data->crease_rim) {
+    ed->crease = data->crease_rim;
+  }
+}
+
+/**
+ * Rim faces are quads stored after the copied faces, one per boundary edge,
+ * so the loops of each face start at four times its index.
+ */
+static void solidify_rim_poly_cb(void *__restrict userdata,
+                                 const int index,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SolidifyRimData *data = userdata;
+  const uint numEdges = data->numEdges;
+  const uint numVerts = data->numVerts;
+  const uint edge_ofs = (numEdges * data->stride) + data->newEdges;
+  const uint *old_vert_arr = data->old_vert_arr;
+  const bool do_shell = data->do_shell;
+  const uint i = (uint)index;
+  const uint eidx = data->new_edge_arr[i];
+  const uint poly_dst = (data->numPolys * data->stride) + i;
+  const uint loop_dst = (data->numLoops * data->stride) + (i * 4);
+  uint pidx = data->edge_users[eidx];
+  MPoly *mp = &data->mpoly[poly_dst];
+  MLoop *ml = &data->mloop[loop_dst];
+  MEdge *ed = &data->medge[eidx];
+  int k1, k2;
+  bool flip;
+
+  if (pidx >= data->numPolys) {
+    pidx -= data->numPolys;
+    flip = true;
+  }
+  else {
+    flip = false;
+  }
+
+  /* copy most of the face settings */
+  CustomData_copy_data(data->src_pdata, data->dst_pdata, (int)pidx, (int)poly_dst, 1);
+  mp->loopstart = (int)loop_dst;
+  mp->flag = data->mpoly[pidx].flag;
+
+  /* notice we use 'mp->totloop' which is later overwritten,
+   * we could lookup the original face but there's no point since this is a copy
+   * and will have the same value, just take care when changing order of assignment */
+
+  /* prev loop */
+  k1 = data->mpoly[pidx].loopstart +
+       (((data->edge_order[eidx] - 1) + mp->totloop) % mp->totloop);
+
+  k2 = data->mpoly[pidx].loopstart + (data->edge_order[eidx]);
+
+  mp->totloop = 4;
+
+  CustomData_copy_data(data->src_ldata, data->dst_ldata, k2, (int)loop_dst + 0, 1);
+  CustomData_copy_data(data->src_ldata, data->dst_ldata, k1, (int)loop_dst + 1, 1);
+  CustomData_copy_data(data->src_ldata, data->dst_ldata, k1, (int)loop_dst + 2, 1);
+  CustomData_copy_data(data->src_ldata, data->dst_ldata, k2, (int)loop_dst + 3, 1);
+
+  if (flip == false) {
+    ml[0].v = ed->v1;
+    ml[0].e = eidx;
+
+    ml[1].v = ed->v2;
+    ml[1].e = edge_ofs + old_vert_arr[ed->v2];
+
+    ml[2].v = (do_shell ? ed->v2 : old_vert_arr[ed->v2]) + numVerts;
+    ml[2].e = (do_shell ? eidx : i) + numEdges;
+
+    ml[3].v = (do_shell ? ed->v1 : old_vert_arr[ed->v1]) + numVerts;
+    ml[3].e = edge_ofs + old_vert_arr[ed->v1];
+  }
+  else {
+    ml[0].v = ed->v2;
+    ml[0].e = eidx;
+
+    ml[1].v = ed->v1;
+    ml[1].e = edge_ofs + old_vert_arr[ed->v1];
+
+    ml[2].v = (do_shell ? ed->v1 : old_vert_arr[ed->v1]) + numVerts;
+    ml[2].e = (do_shell ? eidx : i) + numEdges;
+
+    ml[3].v = (do_shell ? ed->v2 : old_vert_arr[ed->v2]) + numVerts;
+    ml[3].e = edge_ofs + old_vert_arr[ed->v2];
+  }
+
+  /* use the next material index if option enabled */
+  if (data->mat_ofs_rim) {
+    mp->mat_nr += data->mat_ofs_rim;
+    CLAMP(mp->mat_nr, 0, data->mat_nr_max);
+  }
+  if (data->crease_outer) {
+    /* crease += crease_outer; without wrapping */
+    char *cr = &(ed->crease);
+    int tcr = *cr + data->crease_outer;
+    *cr = tcr > 255 ? 255 : tcr;
+  }
+
+  if (data->crease_inner) {
+    /* crease += crease_inner; without wrapping */
+    char *cr = &(data->medge[numEdges + (do_shell ? eidx : i)].crease);
+    int tcr = *cr + data->crease_inner;
+    *cr = tcr > 255 ? 255 : tcr;
+  }
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Main Solidify Function
  * \{ */
@@ -448,55 +833,21 @@ Mesh *MOD_solidify_extrude_modifyMesh(ModifierData *md, const ModifierEvalContex
   if (do_shell) {
     uint i;
 
-    mp = mpoly + numPolys;
-    for (i = 0; i < mesh->totpoly; i++, mp++) {
-      const int loop_end = mp->totloop - 1;
-      MLoop *ml2;
-      uint e;
-      int j;
-
-      /* reverses the loop direction (MLoop.v as well as custom-data)
-       * MLoop.e also needs to be corrected too, done in a separate loop below. */
-      ml2 = mloop + mp->loopstart + mesh->totloop;
-#if 0
-      for (j = 0; j < mp->totloop; j++) {
-        CustomData_copy_data(&mesh->ldata,
-                             &result->ldata,
-                             mp->loopstart + j,
-                             mp->loopstart + (loop_end - j) + mesh->totloop,
-                             1);
-      }
-#else
-      /* slightly more involved, keep the first vertex the same for the copy,
-       * ensures the diagonals in the new face match the original. */
-      j = 0;
-      for (int j_prev = loop_end; j < mp->totloop; j_prev = j++) {
-        CustomData_copy_data(&mesh->ldata,
-                             &result->ldata,
-                             mp->loopstart + j,
-                             mp->loopstart + (loop_end - j_prev) + mesh->totloop,
-                             1);
-      }
-#endif
-
-      if (mat_ofs) {
-        mp->mat_nr += mat_ofs;
-        CLAMP(mp->mat_nr, 0, mat_nr_max);
-      }
-
-      e = ml2[0].e;
-      for (j = 0; j < loop_end; j++) {
-        ml2[j].e = ml2[j + 1].e;
-      }
-      ml2[loop_end].e = e;
-
-      mp->loopstart += mesh->totloop;
-
-      for (j = 0; j < mp->totloop; j++) {
-        ml2[j].e += numEdges;
-        ml2[j].v += numVerts;
-      }
-    }
+    SolidifyShellFlipData flip_data = {
+        .src_ldata = &mesh->ldata,
+        .dst_ldata = &result->ldata,
+        .mpoly = mpoly + numPolys,
+        .mloop = mloop + numLoops,
+        .totloop = mesh->totloop,
+        .numVerts = numVerts,
+        .numEdges = numEdges,
+        .mat_ofs = mat_ofs,
+        .mat_nr_max = mat_nr_max,
+    };
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1024;
+    BLI_task_parallel_range(0, mesh->totpoly, &flip_data, solidify_shell_flip_cb, &settings);
 
     for (i = 0, ed = medge + numEdges; i < numEdges; i++, ed++) {
       ed->v1 += numVerts;
@@ -507,8 +858,6 @@ Mesh *MOD_solidify_extrude_modifyMesh(ModifierData *md, const ModifierEvalContex
   /* note, copied vertex layers don't have flipped normals yet. do this after applying offset */
   if ((smd->flag & MOD_SOLIDIFY_EVEN) == 0) {
     /* no even thickness, very simple */
-    float scalar_short;
-    float scalar_short_vgroup;
 
     /* for clamping */
     float *vert_lens = NULL;
@@ -593,97 +942,49 @@ Mesh *MOD_solidify_extrude_modifyMesh(ModifierData *md, const ModifierEvalContex
       MEM_freeN(edge_user_pairs);
     }
 
+    SolidifyOffsetData offset_data = {
+        .new_vert_arr = new_vert_arr,
+        .dvert = dvert,
+        .defgrp_index = defgrp_index,
+        .defgrp_invert = defgrp_invert,
+        .offset_fac_vg = offset_fac_vg,
+        .offset_fac_vg_inv = offset_fac_vg_inv,
+        .do_clamp = do_clamp,
+        .do_angle_clamp = do_angle_clamp,
+        .offset = offset,
+        .offset_sq = offset_sq,
+        .vert_lens = vert_lens,
+        .vert_angs = vert_angs,
+    };
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1024;
+
     if (ofs_new != 0.0f) {
-      uint i_orig, i_end;
+      uint i_end;
       bool do_shell_align;
 
-      scalar_short = scalar_short_vgroup = ofs_new / 32767.0f;
-
       INIT_VERT_ARRAY_OFFSETS(false);
 
-      for (i_orig = 0; i_orig < i_end; i_orig++, mv++) {
-        const uint i = do_shell_align ? i_orig : new_vert_arr[i_orig];
-        if (dvert) {
-          MDeformVert *dv = &dvert[i];
-          if (defgrp_invert) {
-            scalar_short_vgroup = 1.0f - BKE_defvert_find_weight(dv, defgrp_index);
-          }
-          else {
-            scalar_short_vgroup = BKE_defvert_find_weight(dv, defgrp_index);
-          }
-          scalar_short_vgroup = (offset_fac_vg + (scalar_short_vgroup * offset_fac_vg_inv)) *
-                                scalar_short;
-        }
-        if (do_clamp && offset > FLT_EPSILON) {
-          /* always reset because we may have set before */
-          if (dvert == NULL) {
-            scalar_short_vgroup = scalar_short;
-          }
-          if (do_angle_clamp) {
-            float cos_ang = cosf(((2 * M_PI) - vert_angs[i]) * 0.5f);
-            if (cos_ang > 0) {
-              float max_off = sqrtf(vert_lens[i]) * 0.5f / cos_ang;
-              if (max_off < offset * 0.5f) {
-                scalar_short_vgroup *= max_off / offset * 2;
-              }
-            }
-          }
-          else {
-            if (vert_lens[i] < offset_sq) {
-              float scalar = sqrtf(vert_lens[i]) / offset;
-              scalar_short_vgroup *= scalar;
-            }
-          }
-        }
-        madd_v3v3short_fl(mv->co, mv->no, scalar_short_vgroup);
-      }
+      offset_data.mvert = mv;
+      offset_data.do_shell_align = do_shell_align;
+      offset_data.is_orig = false;
+      offset_data.scalar_short = ofs_new / 32767.0f;
+      BLI_task_parallel_range(0, (int)i_end, &offset_data, solidify_offset_cb, &settings);
     }
 
     if (ofs_orig != 0.0f) {
-      uint i_orig, i_end;
+      uint i_end;
       bool do_shell_align;
 
-      scalar_short = scalar_short_vgroup = ofs_orig / 32767.0f;
-
       /* as above but swapped */
       INIT_VERT_ARRAY_OFFSETS(true);
 
-      for (i_orig = 0; i_orig < i_end; i_orig++, mv++) {
-        const uint i = do_shell_align ? i_orig : new_vert_arr[i_orig];
-        if (dvert) {
-          MDeformVert *dv = &dvert[i];
-          if (defgrp_invert) {
-            scalar_short_vgroup = 1.0f - BKE_defvert_find_weight(dv, defgrp_index);
-          }
-          else {
-            scalar_short_vgroup = BKE_defvert_find_weight(dv, defgrp_index);
-          }
-          scalar_short_vgroup = (offset_fac_vg + (scalar_short_vgroup * offset_fac_vg_inv)) *
-                                scalar_short;
-        }
-        if (do_clamp && offset > FLT_EPSILON) {
-          /* always reset because we may have set before */
-          if (dvert == NULL) {
-            scalar_short_vgroup = scalar_short;
-          }
-          if (do_angle_clamp) {
-            float cos_ang = cosf(vert_angs[i_orig] * 0.5f);
-            if (cos_ang > 0) {
-              float max_off = sqrtf(vert_lens[i]) * 0.5f / cos_ang;
-              if (max_off < offset * 0.5f) {
-                scalar_short_vgroup *= max_off / offset * 2;
-              }
-            }
-          }
-          else {
-            if (vert_lens[i] < offset_sq) {
-              float scalar = sqrtf(vert_lens[i]) / offset;
-              scalar_short_vgroup *= scalar;
-            }
-          }
-        }
-        madd_v3v3short_fl(mv->co, mv->no, scalar_short_vgroup);
-      }
+      offset_data.mvert = mv;
+      offset_data.do_shell_align = do_shell_align;
+      offset_data.is_orig = true;
+      offset_data.scalar_short = ofs_orig / 32767.0f;
+      BLI_task_parallel_range(0, (int)i_end, &offset_data, solidify_offset_cb, &settings);
     }
 
     if (do_bevel_convex) {
@@ -738,55 +1039,38 @@ Mesh *MOD_solidify_extrude_modifyMesh(ModifierData *md, const ModifierEvalContex
       }
     }
 
-    for (i = 0, mp = mpoly; i < numPolys; i++, mp++) {
-      /* #BKE_mesh_calc_poly_angles logic is inlined here */
-      float nor_prev[3];
-      float nor_next[3];
-
-      int i_curr = mp->totloop - 1;
-      int i_next = 0;
-
-      ml = &mloop[mp->loopstart];
-
-      sub_v3_v3v3(nor_prev, mvert[ml[i_curr - 1].v].co, mvert[ml[i_curr].v].co);
-      normalize_v3(nor_prev);
-
-      while (i_next < mp->totloop) {
-        float angle;
-        sub_v3_v3v3(nor_next, mvert[ml[i_curr].v].co, mvert[ml[i_next].v].co);
-        normalize_v3(nor_next);
-        angle = angle_normalized_v3v3(nor_prev, nor_next);
-
-        /* --- not related to angle calc --- */
-        if (angle < FLT_EPSILON) {
-          angle = FLT_EPSILON;
-        }
-
-        vidx = ml[i_curr].v;
-        vert_accum[vidx] += angle;
-
+    /* Calculate the corner angles in parallel, accumulate them in order so the result doesn't
+     * depend on the threads. */
+    float(*loop_angles)[2] = MEM_malloc_arrayN(numLoops, sizeof(*loop_angles), __func__);
+    {
+      SolidifyEvenAnglesData angles_data = {
+          .mvert = mvert,
+          .mloop = mloop,
+          .mpoly = mpoly,
+          .vert_nors = (const float(*)[3])vert_nors,
+          .poly_nors = (const float(*)[3])poly_nors,
 #ifdef USE_NONMANIFOLD_WORKAROUND
-        /* skip 3+ face user edges */
-        if ((check_non_manifold == false) ||
-            LIKELY(((orig_medge[ml[i_curr].e].flag & ME_EDGE_TMP_TAG) == 0) &&
-                   ((orig_medge[ml[i_next].e].flag & ME_EDGE_TMP_TAG) == 0))) {
-          vert_angles[vidx] += shell_v3v3_normalized_to_dist(vert_nors[vidx], poly_nors[i]) *
-                               angle;
-        }
-        else {
-          vert_angles[vidx] += angle;
-        }
-#else
-        vert_angles[vidx] += shell_v3v3_normalized_to_dist(vert_nors[vidx], poly_nors[i]) * angle;
+          .orig_medge = orig_medge,
+          .check_non_manifold = check_non_manifold,
 #endif
-        /* --- end non-angle-calc section --- */
+          .r_loop_angles = loop_angles,
+      };
+      TaskParallelSettings settings;
+      BLI_parallel_range_settings_defaults(&settings);
+      settings.min_iter_per_thread = 1024;
+      BLI_task_parallel_range(0, (int)numPolys, &angles_data, solidify_even_angles_cb, &settings);
+    }
 
-        /* step */
-        copy_v3_v3(nor_prev, nor_next);
-        i_curr = i_next;
-        i_next++;
+    for (i = 0, mp = mpoly; i < numPolys; i++, mp++) {
+      ml = &mloop[mp->loopstart];
+      const float(*poly_loop_angles)[2] = &loop_angles[mp->loopstart];
+      for (int i_curr = mp->totloop - 1, i_next = 0; i_next < mp->totloop; i_curr = i_next++) {
+        vidx = ml[i_curr].v;
+        vert_accum[vidx] += poly_loop_angles[i_curr][0];
+        vert_angles[vidx] += poly_loop_angles[i_curr][1];
       }
     }
+    MEM_freeN(loop_angles);
 
     /* vertex group support */
     if (dvert) {
@@ -943,35 +1227,39 @@ Mesh *MOD_solidify_extrude_modifyMesh(ModifierData *md, const ModifierEvalContex
 #undef INVALID_UNUSED
 #undef INVALID_PAIR
 
+    SolidifyOffsetData offset_data = {
+        .new_vert_arr = new_vert_arr,
+        .vert_nors = (const float(*)[3])vert_nors,
+        .vert_angles = vert_angles,
+        .vert_accum = vert_accum,
+    };
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1024;
+
     if (ofs_new != 0.0f) {
-      uint i_orig, i_end;
+      uint i_end;
       bool do_shell_align;
 
       INIT_VERT_ARRAY_OFFSETS(false);
 
-      for (i_orig = 0; i_orig < i_end; i_orig++, mv++) {
-        const uint i_other = do_shell_align ? i_orig : new_vert_arr[i_orig];
-        if (vert_accum[i_other]) { /* zero if unselected */
-          madd_v3_v3fl(
-              mv->co, vert_nors[i_other], ofs_new * (vert_angles[i_other] / vert_accum[i_other]));
-        }
-      }
+      offset_data.mvert = mv;
+      offset_data.do_shell_align = do_shell_align;
+      offset_data.ofs = ofs_new;
+      BLI_task_parallel_range(0, (int)i_end, &offset_data, solidify_offset_even_cb, &settings);
     }
 
     if (ofs_orig != 0.0f) {
-      uint i_orig, i_end;
+      uint i_end;
       bool do_shell_align;
 
       /* same as above but swapped, intentional use of 'ofs_new' */
       INIT_VERT_ARRAY_OFFSETS(true);
 
-      for (i_orig = 0; i_orig < i_end; i_orig++, mv++) {
-        const uint i_other = do_shell_align ? i_orig : new_vert_arr[i_orig];
-        if (vert_accum[i_other]) { /* zero if unselected */
-          madd_v3_v3fl(
-              mv->co, vert_nors[i_other], ofs_orig * (vert_angles[i_other] / vert_accum[i_other]));
-        }
-      }
+      offset_data.mvert = mv;
+      offset_data.do_shell_align = do_shell_align;
+      offset_data.ofs = ofs_orig;
+      BLI_task_parallel_range(0, (int)i_end, &offset_data, solidify_offset_even_cb, &settings);
     }
 
     MEM_freeN(vert_angles);
@@ -1053,142 +1341,64 @@ Mesh *MOD_solidify_extrude_modifyMesh(ModifierData *md, const ModifierEvalContex
     const uchar crease_inner = smd->crease_inner * 255.0f;
 
     int *origindex_edge;
-    int *orig_ed;
-    uint j;
 
     if (crease_rim || crease_outer || crease_inner) {
       result->cd_flag |= ME_CDFLAG_EDGE_CREASE;
     }
 
     /* add faces & edges */
+    SolidifyRimData rim_data = {
+        .src_pdata = &mesh->pdata,
+        .src_ldata = &mesh->ldata,
+        .dst_pdata = &result->pdata,
+        .dst_ldata = &result->ldata,
+        .medge = medge,
+        .mpoly = mpoly,
+        .mloop = mloop,
+        .new_vert_arr = new_vert_arr,
+        .new_edge_arr = new_edge_arr,
+        .old_vert_arr = old_vert_arr,
+        .edge_users = edge_users,
+        .edge_order = edge_order,
+        .numVerts = numVerts,
+        .numEdges = numEdges,
+        .numPolys = numPolys,
+        .numLoops = numLoops,
+        .newEdges = newEdges,
+        .stride = stride,
+        .do_shell = do_shell,
+        .mat_ofs_rim = mat_ofs_rim,
+        .mat_nr_max = mat_nr_max,
+        .crease_rim = crease_rim,
+        .crease_outer = crease_outer,
+        .crease_inner = crease_inner,
+    };
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1024;
+    BLI_task_parallel_range(0, (int)rimVerts, &rim_data, solidify_rim_edge_cb, &settings);
+    BLI_task_parallel_range(0, (int)newPolys, &rim_data, solidify_rim_poly_cb, &settings);
+
+    /* The loops of the rim faces only use rim edges besides the original and shell ones. */
     origindex_edge = CustomData_get_layer(&result->edata, CD_ORIGINDEX);
-    orig_ed = (origindex_edge) ? &origindex_edge[(numEdges * stride) + newEdges] : NULL;
-    ed = &medge[(numEdges * stride) + newEdges]; /* start after copied edges */
-    for (i = 0; i < rimVerts; i++, ed++) {
-      ed->v1 = new_vert_arr[i];
-      ed->v2 = (do_shell ? new_vert_arr[i] : i) + numVerts;
-      ed->flag |= ME_EDGEDRAW | ME_EDGERENDER;
-
-      if (orig_ed) {
-        *orig_ed = ORIGINDEX_NONE;
-        orig_ed++;
-      }
-
-      if (crease_rim) {
-        ed->crease = crease_rim;
-      }
+    if (origindex_edge) {
+      copy_vn_i(&origindex_edge[(numEdges * stride) + newEdges], (int)rimVerts, ORIGINDEX_NONE);
     }
 
-    /* faces */
-    mp = mpoly + (numPolys * stride);
-    ml = mloop + (numLoops * stride);
-    j = 0;
-    for (i = 0; i < newPolys; i++, mp++) {
-      uint eidx = new_edge_arr[i];
-      uint pidx = edge_users[eidx];
-      int k1, k2;
-      bool flip;
-
-      if (pidx >= numPolys) {
-        pidx -= numPolys;
-        flip = true;
-      }
-      else {
-        flip = false;
-      }
-
-      ed = medge + eidx;
-
-      /* copy most of the face settings */
-      CustomData_copy_data(
-          &mesh->pdata, &result->pdata, (int)pidx, (int)((numPolys * stride) + i), 1);
-      mp->loopstart = (int)(j + (numLoops * stride));
-      mp->flag = mpoly[pidx].flag;
-
-      /* notice we use 'mp->totloop' which is later overwritten,
-       * we could lookup the original face but there's no point since this is a copy
-       * and will have the same value, just take care when changing order of assignment */
-
-      /* prev loop */
-      k1 = mpoly[pidx].loopstart + (((edge_order[eidx] - 1) + mp->totloop) % mp->totloop);
-
-      k2 = mpoly[pidx].loopstart + (edge_order[eidx]);
-
-      mp->totloop = 4;
-
-      CustomData_copy_data(
-          &mesh->ldata, &result->ldata, k2, (int)((numLoops * stride) + j + 0), 1);
-      CustomData_copy_data(
-          &mesh->ldata, &result->ldata, k1, (int)((numLoops * stride) + j + 1), 1);
-      CustomData_copy_data(
-          &mesh->ldata, &result->ldata, k1, (int)((numLoops * stride) + j + 2), 1);
-      CustomData_copy_data(
-          &mesh->ldata, &result->ldata, k2, (int)((numLoops * stride) + j + 3), 1);
-
-      if (flip == false) {
-        ml[j].v = ed->v1;
-        ml[j++].e = eidx;
-
-        ml[j].v = ed->v2;
-        ml[j++].e = (numEdges * stride) + old_vert_arr[ed->v2] + newEdges;
-
-        ml[j].v = (do_shell ? ed->v2 : old_vert_arr[ed->v2]) + numVerts;
-        ml[j++].e = (do_shell ? eidx : i) + numEdges;
-
-        ml[j].v = (do_shell ? ed->v1 : old_vert_arr[ed->v1]) + numVerts;
-        ml[j++].e = (numEdges * stride) + old_vert_arr[ed->v1] + newEdges;
-      }
-      else {
-        ml[j].v = ed->v2;
-        ml[j++].e = eidx;
-
-        ml[j].v = ed->v1;
-        ml[j++].e = (numEdges * stride) + old_vert_arr[ed->v1] + newEdges;
-
-        ml[j].v = (do_shell ? ed->v1 : old_vert_arr[ed->v1]) + numVerts;
-        ml[j++].e = (do_shell ? eidx : i) + numEdges;
-
-        ml[j].v = (do_shell ? ed->v2 : old_vert_arr[ed->v2]) + numVerts;
-        ml[j++].e = (numEdges * stride) + old_vert_arr[ed->v2] + newEdges;
-      }
-
-      if (origindex_edge) {
-        origindex_edge[ml[j - 3].e] = ORIGINDEX_NONE;
-        origindex_edge[ml[j - 1].e] = ORIGINDEX_NONE;
-      }
-
-      /* use the next material index if option enabled */
-      if (mat_ofs_rim) {
-        mp->mat_nr += mat_ofs_rim;
-        CLAMP(mp->mat_nr, 0, mat_nr_max);
-      }
-      if (crease_outer) {
-        /* crease += crease_outer; without wrapping */
-        char *cr = &(ed->crease);
-        int tcr = *cr + crease_outer;
-        *cr = tcr > 255 ? 255 : tcr;
-      }
-
-      if (crease_inner) {
-        /* crease += crease_inner; without wrapping */
-        char *cr = &(medge[numEdges + (do_shell ? eidx : i)].crease);
-        int tcr = *cr + crease_inner;
-        *cr = tcr > 255 ? 255 : tcr;
-      }
-
 #ifdef SOLIDIFY_SIDE_NORMALS
-      if (do_side_normals) {
-        normal_quad_v3(nor,
-                       mvert[ml[j - 4].v].co,
-                       mvert[ml[j - 3].v].co,
-                       mvert[ml[j - 2].v].co,
-                       mvert[ml[j - 1].v].co);
+    if (do_side_normals) {
+      /* Accumulated per vertex, so this stays a serial loop. */
+      ml = mloop + (numLoops * stride);
+      for (i = 0; i < newPolys; i++, ml += 4) {
+        ed = medge + new_edge_arr[i];
+        normal_quad_v3(
+            nor, mvert[ml[0].v].co, mvert[ml[1].v].co, mvert[ml[2].v].co, mvert[ml[3].v].co);
 
         add_v3_v3(edge_vert_nos[ed->v1], nor);
         add_v3_v3(edge_vert_nos[ed->v2], nor);
       }
-#endif
     }
+#endif
 
 #ifdef SOLIDIFY_SIDE_NORMALS
     if (do_side_normals) {
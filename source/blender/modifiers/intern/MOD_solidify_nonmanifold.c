@@ -21,6 +21,7 @@
 #include "BLI_utildefines.h"
 
 #include "BLI_math.h"
+#include "BLI_task.h"
 
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
@@ -78,6 +79,8 @@ static float angle_signed_on_axis_normalized_v3v3_v3(const float n[3],
 
 /* Data structures for manifold solidify. */
 
+#define MOD_SOLIDIFY_EMPTY_TAG ((uint)-1)
+
 typedef struct NewFaceRef {
   MPoly *face;
   uint index;
@@ -132,6 +135,890 @@ static int comp_float_int_pair(const void *a, const void *b)
   return (int)(x->angle > y->angle) - (int)(x->angle < y->angle);
 }
 
+typedef struct SolidifyGroupCoData {
+  const SolidifyModifierData *smd;
+  EdgeGroup **orig_vert_groups_arr;
+  const uint *vm;
+  const float (*orig_mvert_co)[3];
+  MEdge *orig_medge;
+  MLoop *orig_mloop;
+  const float (*poly_nors)[3];
+  const bool *null_faces;
+  const float *face_weight;
+  const float *orig_edge_lengths;
+  MDeformVert *dvert;
+  int defgrp_index;
+  bool defgrp_invert;
+  bool do_flat_faces;
+  bool do_clamp;
+  bool do_angle_clamp;
+  float ofs_front_clamped;
+  float ofs_back_clamped;
+  float offset_fac_vg;
+  float offset_fac_vg_inv;
+  float offset;
+} SolidifyGroupCoData;
+
+/**
+ * Calculate the coordinates of all edge groups of a vertex.
+ */
+static void solidify_group_co_cb(void *__restrict userdata,
+                                 const int vert_index,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SolidifyGroupCoData *data = userdata;
+  const SolidifyModifierData *smd = data->smd;
+  const uint *vm = data->vm;
+  const float(*orig_mvert_co)[3] = data->orig_mvert_co;
+  MEdge *orig_medge = data->orig_medge;
+  MLoop *orig_mloop = data->orig_mloop;
+  const float(*poly_nors)[3] = data->poly_nors;
+  const bool *null_faces = data->null_faces;
+  const float *face_weight = data->face_weight;
+  const float *orig_edge_lengths = data->orig_edge_lengths;
+  MDeformVert *dvert = data->dvert;
+  const int defgrp_index = data->defgrp_index;
+  const bool defgrp_invert = data->defgrp_invert;
+  const bool do_flat_faces = data->do_flat_faces;
+  const bool do_clamp = data->do_clamp;
+  const bool do_angle_clamp = data->do_angle_clamp;
+  const float ofs_front_clamped = data->ofs_front_clamped;
+  const float ofs_back_clamped = data->ofs_back_clamped;
+  const float offset_fac_vg = data->offset_fac_vg;
+  const float offset_fac_vg_inv = data->offset_fac_vg_inv;
+  const float offset = data->offset;
+  const uint i = (uint)vert_index;
+  MLoop *ml;
+
+  EdgeGroup *g = data->orig_vert_groups_arr[i];
+  if (g == NULL) {
+    return;
+  }
+  for (; g->valid; g++) {
+    if (!g->is_singularity) {
+      float *nor = g->no;
+      float move_nor[3] = {0, 0, 0};
+      bool disable_boundary_fix = (smd->nonmanifold_boundary_mode ==
+                                       MOD_SOLIDIFY_NONMANIFOLD_BOUNDARY_MODE_NONE ||
+                                   (g->is_orig_closed || g->split));
+      /* Constraints Method. */
+      if (smd->nonmanifold_offset_mode == MOD_SOLIDIFY_NONMANIFOLD_OFFSET_MODE_CONSTRAINTS) {
+        NewEdgeRef *first_edge = NULL;
+        NewEdgeRef **edge_ptr = g->edges;
+        /* Contains normal and offset [nx, ny, nz, ofs]. */
+        float(*normals_queue)[4] = MEM_malloc_arrayN(
+            g->edges_len + 1, sizeof(*normals_queue), "normals_queue in solidify");
+        uint queue_index = 0;
+
+        float face_nors[3][3];
+        float nor_ofs[3];
+
+        const bool cycle = (g->is_orig_closed && !g->split) || g->is_even_split;
+        for (uint k = 0; k < g->edges_len; k++, edge_ptr++) {
+          if (!(k & 1) || (!cycle && k == g->edges_len - 1)) {
+            NewEdgeRef *edge = *edge_ptr;
+            for (uint l = 0; l < 2; l++) {
+              NewFaceRef *face = edge->faces[l];
+              if (face && (first_edge == NULL ||
+                           (first_edge->faces[0] != face && first_edge->faces[1] != face))) {
+                float ofs = face->reversed ? ofs_back_clamped : ofs_front_clamped;
+                /* Use face_weight here to make faces thinner. */
+                if (do_flat_faces) {
+                  ofs *= face_weight[face->index];
+                }
+
+                if (!null_faces[face->index]) {
+                  /* And normal to the queue. */
+                  mul_v3_v3fl(
+                      normals_queue[queue_index], poly_nors[face->index], face->reversed ? -1 : 1);
+                  normals_queue[queue_index++][3] = ofs;
+                }
+                else {
+                  /* Just use this approximate normal of the null face if there is no other
+                   * normal to use. */
+                  mul_v3_v3fl(face_nors[0], poly_nors[face->index], face->reversed ? -1 : 1);
+                  nor_ofs[0] = ofs;
+                }
+              }
+            }
+            if ((cycle && k == 0) || (!cycle && k + 3 >= g->edges_len)) {
+              first_edge = edge;
+            }
+          }
+        }
+        uint face_nors_len = 0;
+        const float stop_explosion = 0.999f - fabsf(smd->offset_fac) * 0.05f;
+        while (queue_index > 0) {
+          if (face_nors_len == 0) {
+            if (queue_index <= 2) {
+              for (uint k = 0; k < queue_index; k++) {
+                copy_v3_v3(face_nors[k], normals_queue[k]);
+                nor_ofs[k] = normals_queue[k][3];
+              }
+              face_nors_len = queue_index;
+              queue_index = 0;
+            }
+            else {
+              /* Find most different two normals. */
+              float min_p = 2;
+              uint min_n0 = 0;
+              uint min_n1 = 0;
+              for (uint k = 0; k < queue_index; k++) {
+                for (uint m = k + 1; m < queue_index; m++) {
+                  float p = dot_v3v3(normals_queue[k], normals_queue[m]);
+                  if (p <= min_p + FLT_EPSILON) {
+                    min_p = p;
+                    min_n0 = m;
+                    min_n1 = k;
+                  }
+                }
+              }
+              copy_v3_v3(face_nors[0], normals_queue[min_n0]);
+              copy_v3_v3(face_nors[1], normals_queue[min_n1]);
+              nor_ofs[0] = normals_queue[min_n0][3];
+              nor_ofs[1] = normals_queue[min_n1][3];
+              face_nors_len = 2;
+              queue_index--;
+              memmove(normals_queue + min_n0,
+                      normals_queue + min_n0 + 1, (queue_index - min_n0) * sizeof(*normals_queue));
+              queue_index--;
+              memmove(normals_queue + min_n1,
+                      normals_queue + min_n1 + 1, (queue_index - min_n1) * sizeof(*normals_queue));
+              min_p = 1;
+              min_n1 = 0;
+              float max_p = -1;
+              for (uint k = 0; k < queue_index; k++) {
+                max_p = -1;
+                for (uint m = 0; m < face_nors_len; m++) {
+                  float p = dot_v3v3(face_nors[m], normals_queue[k]);
+                  if (p > max_p + FLT_EPSILON) {
+                    max_p = p;
+                  }
+                }
+                if (max_p <= min_p + FLT_EPSILON) {
+                  min_p = max_p;
+                  min_n1 = k;
+                }
+              }
+              if (min_p < 0.8) {
+                copy_v3_v3(face_nors[2], normals_queue[min_n1]);
+                nor_ofs[2] = normals_queue[min_n1][3];
+                face_nors_len++;
+                queue_index--;
+                memmove(normals_queue + min_n1,
+                        normals_queue + min_n1 + 1,
+                        (queue_index - min_n1) * sizeof(*normals_queue));
+              }
+            }
+          }
+          else {
+            uint best = 0;
+            uint best_group = 0;
+            float best_p = -1.0f;
+            for (uint k = 0; k < queue_index; k++) {
+              for (uint m = 0; m < face_nors_len; m++) {
+                float p = dot_v3v3(face_nors[m], normals_queue[k]);
+                if (p > best_p + FLT_EPSILON) {
+                  best_p = p;
+                  best = m;
+                  best_group = k;
+                }
+              }
+            }
+            add_v3_v3(face_nors[best], normals_queue[best_group]);
+            normalize_v3(face_nors[best]);
+            nor_ofs[best] = (nor_ofs[best] + normals_queue[best_group][3]) * 0.5f;
+            queue_index--;
+            memmove(normals_queue + best_group,
+                    normals_queue + best_group + 1,
+                    (queue_index - best_group) * sizeof(*normals_queue));
+          }
+        }
+        MEM_freeN(normals_queue);
+
+        /* When up to 3 constraint normals are found. */
+        if (ELEM(face_nors_len, 2, 3)) {
+          const float q = dot_v3v3(face_nors[0], face_nors[1]);
+          float d = 1.0f - q * q;
+          cross_v3_v3v3(move_nor, face_nors[0], face_nors[1]);
+          if (d > FLT_EPSILON * 10 && q < stop_explosion) {
+            d = 1.0f / d;
+            mul_v3_fl(face_nors[0], (nor_ofs[0] - nor_ofs[1] * q) * d);
+            mul_v3_fl(face_nors[1], (nor_ofs[1] - nor_ofs[0] * q) * d);
+          }
+          else {
+            d = 1.0f / (fabsf(q) + 1.0f);
+            mul_v3_fl(face_nors[0], nor_ofs[0] * d);
+            mul_v3_fl(face_nors[1], nor_ofs[1] * d);
+          }
+          add_v3_v3v3(nor, face_nors[0], face_nors[1]);
+          if (face_nors_len == 3) {
+            float *free_nor = move_nor;
+            mul_v3_fl(face_nors[2], nor_ofs[2]);
+            d = dot_v3v3(face_nors[2], free_nor);
+            if (LIKELY(fabsf(d) > FLT_EPSILON)) {
+              sub_v3_v3v3(face_nors[0], nor, face_nors[2]); /* Override face_nor[0]. */
+              mul_v3_fl(free_nor, dot_v3v3(face_nors[2], face_nors[0]) / d);
+              sub_v3_v3(nor, free_nor);
+            }
+            disable_boundary_fix = true;
+          }
+        }
+        else {
+          BLI_assert(face_nors_len < 2);
+          mul_v3_v3fl(nor, face_nors[0], nor_ofs[0]);
+          disable_boundary_fix = true;
+        }
+      }
+      /* Fixed/Even Method. */
+      else {
+        float total_angle = 0;
+        float total_angle_back = 0;
+        NewEdgeRef *first_edge = NULL;
+        NewEdgeRef **edge_ptr = g->edges;
+        float face_nor[3];
+        float nor_back[3] = {0, 0, 0};
+        bool has_back = false;
+        bool has_front = false;
+        bool cycle = (g->is_orig_closed && !g->split) || g->is_even_split;
+        for (uint k = 0; k < g->edges_len; k++, edge_ptr++) {
+          if (!(k & 1) || (!cycle && k == g->edges_len - 1)) {
+            NewEdgeRef *edge = *edge_ptr;
+            for (uint l = 0; l < 2; l++) {
+              NewFaceRef *face = edge->faces[l];
+              if (face && (first_edge == NULL ||
+                           (first_edge->faces[0] != face && first_edge->faces[1] != face))) {
+                float angle = 1.0f;
+                float ofs = face->reversed ? -ofs_back_clamped : ofs_front_clamped;
+                /* Use face_weight here to make faces thinner. */
+                if (do_flat_faces) {
+                  ofs *= face_weight[face->index];
+                }
+
+                if (smd->nonmanifold_offset_mode == MOD_SOLIDIFY_NONMANIFOLD_OFFSET_MODE_EVEN) {
+                  MLoop *ml_next = orig_mloop + face->face->loopstart;
+                  ml = ml_next + (face->face->totloop - 1);
+                  MLoop *ml_prev = ml - 1;
+                  for (int m = 0; m < face->face->totloop && vm[ml->v] != i; m++, ml_next++) {
+                    ml_prev = ml;
+                    ml = ml_next;
+                  }
+                  angle = angle_v3v3v3(orig_mvert_co[vm[ml_prev->v]],
+                                       orig_mvert_co[i],
+                                       orig_mvert_co[vm[ml_next->v]]);
+                  if (face->reversed) {
+                    total_angle_back += angle * ofs * ofs;
+                  }
+                  else {
+                    total_angle += angle * ofs * ofs;
+                  }
+                }
+                else {
+                  if (face->reversed) {
+                    total_angle_back++;
+                  }
+                  else {
+                    total_angle++;
+                  }
+                }
+                mul_v3_v3fl(face_nor, poly_nors[face->index], angle * ofs);
+                if (face->reversed) {
+                  add_v3_v3(nor_back, face_nor);
+                  has_back = true;
+                }
+                else {
+                  add_v3_v3(nor, face_nor);
+                  has_front = true;
+                }
+              }
+            }
+            if ((cycle && k == 0) || (!cycle && k + 3 >= g->edges_len)) {
+              first_edge = edge;
+            }
+          }
+        }
+
+        /* Set normal length with selected method. */
+        if (smd->nonmanifold_offset_mode == MOD_SOLIDIFY_NONMANIFOLD_OFFSET_MODE_EVEN) {
+          if (has_front) {
+            float length_sq = len_squared_v3(nor);
+            if (LIKELY(length_sq > FLT_EPSILON)) {
+              mul_v3_fl(nor, total_angle / length_sq);
+            }
+          }
+          if (has_back) {
+            float length_sq = len_squared_v3(nor_back);
+            if (LIKELY(length_sq > FLT_EPSILON)) {
+              mul_v3_fl(nor_back, total_angle_back / length_sq);
+            }
+            if (!has_front) {
+              copy_v3_v3(nor, nor_back);
+            }
+          }
+          if (has_front && has_back) {
+            float nor_length = len_v3(nor);
+            float nor_back_length = len_v3(nor_back);
+            float q = dot_v3v3(nor, nor_back);
+            if (LIKELY(fabsf(q) > FLT_EPSILON)) {
+              q /= nor_length * nor_back_length;
+            }
+            float d = 1.0f - q * q;
+            if (LIKELY(d > FLT_EPSILON)) {
+              d = 1.0f / d;
+              if (LIKELY(nor_length > FLT_EPSILON)) {
+                mul_v3_fl(nor, (1 - nor_back_length * q / nor_length) * d);
+              }
+              if (LIKELY(nor_back_length > FLT_EPSILON)) {
+                mul_v3_fl(nor_back, (1 - nor_length * q / nor_back_length) * d);
+              }
+              add_v3_v3(nor, nor_back);
+            }
+            else {
+              mul_v3_fl(nor, 0.5f);
+              mul_v3_fl(nor_back, 0.5f);
+              add_v3_v3(nor, nor_back);
+            }
+          }
+        }
+        else {
+          if (has_front && total_angle > FLT_EPSILON) {
+            mul_v3_fl(nor, 1.0f / total_angle);
+          }
+          if (has_back && total_angle_back > FLT_EPSILON) {
+            mul_v3_fl(nor_back, 1.0f / total_angle_back);
+            add_v3_v3(nor, nor_back);
+            if (has_front && total_angle > FLT_EPSILON) {
+              mul_v3_fl(nor, 0.5f);
+            }
+          }
+        }
+        /* Set move_nor for boundary fix. */
+        if (!disable_boundary_fix && g->edges_len > 2) {
+          edge_ptr = g->edges + 1;
+          float tmp[3];
+          uint k;
+          for (k = 1; k + 1 < g->edges_len; k++, edge_ptr++) {
+            MEdge *e = orig_medge + (*edge_ptr)->old_edge;
+            sub_v3_v3v3(tmp, orig_mvert_co[vm[e->v1] == i ? e->v2 : e->v1], orig_mvert_co[i]);
+            add_v3_v3(move_nor, tmp);
+          }
+          if (k == 1) {
+            disable_boundary_fix = true;
+          }
+          else {
+            disable_boundary_fix = normalize_v3(move_nor) == 0.0f;
+          }
+        }
+        else {
+          disable_boundary_fix = true;
+        }
+      }
+      /* Fix boundary verts. */
+      if (!disable_boundary_fix) {
+        /* Constraint normal, nor * constr_nor == 0 after this fix. */
+        float constr_nor[3];
+        MEdge *e0_edge = orig_medge + g->edges[0]->old_edge;
+        MEdge *e1_edge = orig_medge + g->edges[g->edges_len - 1]->old_edge;
+        float e0[3];
+        float e1[3];
+        sub_v3_v3v3(e0,
+                    orig_mvert_co[vm[e0_edge->v1] == i ? e0_edge->v2 : e0_edge->v1],
+                    orig_mvert_co[i]);
+        sub_v3_v3v3(e1,
+                    orig_mvert_co[vm[e1_edge->v1] == i ? e1_edge->v2 : e1_edge->v1],
+                    orig_mvert_co[i]);
+        if (smd->nonmanifold_boundary_mode == MOD_SOLIDIFY_NONMANIFOLD_BOUNDARY_MODE_FLAT) {
+          cross_v3_v3v3(constr_nor, e0, e1);
+        }
+        else {
+          float f0[3];
+          float f1[3];
+          if (g->edges[0]->faces[0]->reversed) {
+            negate_v3_v3(f0, poly_nors[g->edges[0]->faces[0]->index]);
+          }
+          else {
+            copy_v3_v3(f0, poly_nors[g->edges[0]->faces[0]->index]);
+          }
+          if (g->edges[g->edges_len - 1]->faces[0]->reversed) {
+            negate_v3_v3(f1, poly_nors[g->edges[g->edges_len - 1]->faces[0]->index]);
+          }
+          else {
+            copy_v3_v3(f1, poly_nors[g->edges[g->edges_len - 1]->faces[0]->index]);
+          }
+          float n0[3];
+          float n1[3];
+          cross_v3_v3v3(n0, e0, f0);
+          cross_v3_v3v3(n1, f1, e1);
+          normalize_v3(n0);
+          normalize_v3(n1);
+          add_v3_v3v3(constr_nor, n0, n1);
+        }
+        float d = dot_v3v3(constr_nor, move_nor);
+        if (LIKELY(fabsf(d) > FLT_EPSILON)) {
+          mul_v3_fl(move_nor, dot_v3v3(constr_nor, nor) / d);
+          sub_v3_v3(nor, move_nor);
+        }
+      }
+      float scalar_vgroup = 1;
+      /* Use vertex group. */
+      if (dvert && !do_flat_faces) {
+        MDeformVert *dv = &dvert[i];
+        if (defgrp_invert) {
+          scalar_vgroup = 1.0f - BKE_defvert_find_weight(dv, defgrp_index);
+        }
+        else {
+          scalar_vgroup = BKE_defvert_find_weight(dv, defgrp_index);
+        }
+        scalar_vgroup = offset_fac_vg + (scalar_vgroup * offset_fac_vg_inv);
+      }
+      /* Do clamping. */
+      if (do_clamp) {
+        if (do_angle_clamp) {
+          if (g->edges_len > 2) {
+            float min_length = 0;
+            float angle = 0.5f * M_PI;
+            uint k = 0;
+            for (NewEdgeRef **p = g->edges; k < g->edges_len; k++, p++) {
+              float length = orig_edge_lengths[(*p)->old_edge];
+              float e_ang = (*p)->angle;
+              if (e_ang > angle) {
+                angle = e_ang;
+              }
+              if (length < min_length || k == 0) {
+                min_length = length;
+              }
+            }
+            float cos_ang = cosf(angle * 0.5f);
+            if (cos_ang > 0) {
+              float max_off = min_length * 0.5f / cos_ang;
+              if (max_off < offset * 0.5f) {
+                scalar_vgroup *= max_off / offset * 2;
+              }
+            }
+          }
+        }
+        else {
+          float min_length = 0;
+          uint k = 0;
+          for (NewEdgeRef **p = g->edges; k < g->edges_len; k++, p++) {
+            float length = orig_edge_lengths[(*p)->old_edge];
+            if (length < min_length || k == 0) {
+              min_length = length;
+            }
+          }
+          if (min_length < offset) {
+            scalar_vgroup *= min_length / offset;
+          }
+        }
+      }
+      mul_v3_fl(nor, scalar_vgroup);
+      add_v3_v3v3(g->co, nor, orig_mvert_co[i]);
+    }
+    else {
+      copy_v3_v3(g->co, orig_mvert_co[i]);
+    }
+  }
+}
+
+typedef struct SolidifyNewEdgeData {
+  const CustomData *src_edata;
+  CustomData *dst_edata;
+  NewEdgeRef ***orig_edge_data_arr;
+  const MEdge *orig_medge;
+  MEdge *medge;
+  /** Original edges creating new edges, and the first new edge of each. */
+  const uint *edges;
+  const uint *edge_offsets;
+  bool has_singularities;
+  float bevel_convex;
+} SolidifyNewEdgeData;
+
+static bool solidify_new_edge_is_singularity(const NewEdgeRef *edge, const bool has_singularities)
+{
+  return has_singularities && (edge->link_edge_groups[0]->is_singularity &&
+                               edge->link_edge_groups[1]->is_singularity);
+}
+
+static void solidify_new_edge_fill(const SolidifyNewEdgeData *data,
+                                   const uint i,
+                                   NewEdgeRef *edge,
+                                   const uint insert)
+{
+  MEdge *medge = data->medge;
+  const MEdge *orig_medge = data->orig_medge;
+  const float bevel_convex = data->bevel_convex;
+  const uint v1 = edge->link_edge_groups[0]->new_vert;
+  const uint v2 = edge->link_edge_groups[1]->new_vert;
+  CustomData_copy_data(data->src_edata, data->dst_edata, (int)i, (int)insert, 1);
+  BLI_assert(v1 != MOD_SOLIDIFY_EMPTY_TAG);
+  BLI_assert(v2 != MOD_SOLIDIFY_EMPTY_TAG);
+  medge[insert].v1 = v1;
+  medge[insert].v2 = v2;
+  medge[insert].flag = orig_medge[edge->old_edge].flag | ME_EDGEDRAW | ME_EDGERENDER;
+  medge[insert].crease = orig_medge[edge->old_edge].crease;
+  medge[insert].bweight = orig_medge[edge->old_edge].bweight;
+  if (bevel_convex != 0.0f && edge->faces[1] != NULL) {
+    medge[insert].bweight = (char)clamp_i(
+        (int)medge[insert].bweight + (int)((edge->angle > M_PI + FLT_EPSILON ?
+                                                clamp_f(bevel_convex, 0.0f, 1.0f) :
+                                                (edge->angle < M_PI - FLT_EPSILON ?
+                                                     clamp_f(bevel_convex, -1.0f, 0.0f) :
+                                                     0)) *
+                                           255),
+        0,
+        255);
+  }
+  edge->new_edge = insert;
+}
+
+/**
+ * Create the new edges of an original edge, except the ones merged into singularity edges
+ * which are created beforehand.
+ */
+static void solidify_new_edge_cb(void *__restrict userdata,
+                                 const int index,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SolidifyNewEdgeData *data = userdata;
+  const uint i = data->edges[index];
+  uint edge_index = data->edge_offsets[index];
+  for (NewEdgeRef **l = data->orig_edge_data_arr[i]; *l; l++) {
+    if ((*l)->new_edge != MOD_SOLIDIFY_EMPTY_TAG &&
+        !solidify_new_edge_is_singularity(*l, data->has_singularities)) {
+      solidify_new_edge_fill(data, i, *l, edge_index++);
+    }
+  }
+}
+
+typedef struct SolidifyRimFaceData {
+  const CustomData *src_pdata;
+  const CustomData *src_ldata;
+  CustomData *dst_pdata;
+  CustomData *dst_ldata;
+  NewEdgeRef ***orig_edge_data_arr;
+  const uint *vm;
+  const MEdge *orig_medge;
+  const MLoop *orig_mloop;
+  const MEdge *medge;
+  MPoly *mpoly;
+  MLoop *mloop;
+  /** Boundary edges creating rim faces, and the first loop of each face. */
+  const uint *edges;
+  const uint *loop_offsets;
+  uint poly_start;
+  bool do_flip;
+  short mat_ofs_rim;
+  short mat_nr_max;
+} SolidifyRimFaceData;
+
+static void solidify_rim_face_cb(void *__restrict userdata,
+                                 const int index,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SolidifyRimFaceData *data = userdata;
+  const uint *vm = data->vm;
+  const MEdge *orig_medge = data->orig_medge;
+  const MEdge *medge = data->medge;
+  MPoly *mpoly = data->mpoly;
+  MLoop *mloop = data->mloop;
+  const uint i = data->edges[index];
+  const uint poly_index = data->poly_start + (uint)index;
+  uint loop_index = data->loop_offsets[index];
+  NewEdgeRef **new_edges = data->orig_edge_data_arr[i];
+
+  NewEdgeRef *edge1 = new_edges[0];
+  NewEdgeRef *edge2 = new_edges[1];
+  const bool v1_singularity = edge1->link_edge_groups[0]->is_singularity &&
+                              edge2->link_edge_groups[0]->is_singularity;
+  const bool v2_singularity = edge1->link_edge_groups[1]->is_singularity &&
+                              edge2->link_edge_groups[1]->is_singularity;
+  BLI_assert(!(v1_singularity && v2_singularity));
+
+  MPoly *face = (*new_edges)->faces[0]->face;
+  CustomData_copy_data(data->src_pdata,
+                       data->dst_pdata,
+                       (int)(*new_edges)->faces[0]->index,
+                       (int)poly_index,
+                       1);
+  mpoly[poly_index].loopstart = (int)loop_index;
+  mpoly[poly_index].totloop = 4 - (int)(v1_singularity || v2_singularity);
+  mpoly[poly_index].mat_nr = face->mat_nr + data->mat_ofs_rim;
+  CLAMP(mpoly[poly_index].mat_nr, 0, data->mat_nr_max);
+  mpoly[poly_index].flag = face->flag;
+
+  int loop1 = -1;
+  int loop2 = -1;
+  const MLoop *ml = data->orig_mloop + face->loopstart;
+  const uint old_v1 = vm[orig_medge[edge1->old_edge].v1];
+  const uint old_v2 = vm[orig_medge[edge1->old_edge].v2];
+  for (uint j = 0; j < face->totloop; j++, ml++) {
+    if (vm[ml->v] == old_v1) {
+      loop1 = face->loopstart + (int)j;
+    }
+    else if (vm[ml->v] == old_v2) {
+      loop2 = face->loopstart + (int)j;
+    }
+  }
+  BLI_assert(loop1 != -1 && loop2 != -1);
+  const MEdge *open_face_edge;
+  uint open_face_edge_index;
+  if (!data->do_flip) {
+    CustomData_copy_data(data->src_ldata, data->dst_ldata, loop1, (int)loop_index, 1);
+    mloop[loop_index].v = medge[edge1->new_edge].v1;
+    mloop[loop_index++].e = edge1->new_edge;
+
+    if (!v2_singularity) {
+      open_face_edge_index = edge1->link_edge_groups[1]->open_face_edge;
+      CustomData_copy_data(data->src_ldata, data->dst_ldata, loop2, (int)loop_index, 1);
+      mloop[loop_index].v = medge[edge1->new_edge].v2;
+      open_face_edge = medge + open_face_edge_index;
+      if (ELEM(medge[edge2->new_edge].v2, open_face_edge->v1, open_face_edge->v2)) {
+        mloop[loop_index++].e = open_face_edge_index;
+      }
+      else {
+        mloop[loop_index++].e = edge2->link_edge_groups[1]->open_face_edge;
+      }
+    }
+
+    CustomData_copy_data(data->src_ldata, data->dst_ldata, loop2, (int)loop_index, 1);
+    mloop[loop_index].v = medge[edge2->new_edge].v2;
+    mloop[loop_index++].e = edge2->new_edge;
+
+    if (!v1_singularity) {
+      open_face_edge_index = edge2->link_edge_groups[0]->open_face_edge;
+      CustomData_copy_data(data->src_ldata, data->dst_ldata, loop1, (int)loop_index, 1);
+      mloop[loop_index].v = medge[edge2->new_edge].v1;
+      open_face_edge = medge + open_face_edge_index;
+      if (ELEM(medge[edge1->new_edge].v1, open_face_edge->v1, open_face_edge->v2)) {
+        mloop[loop_index++].e = open_face_edge_index;
+      }
+      else {
+        mloop[loop_index++].e = edge1->link_edge_groups[0]->open_face_edge;
+      }
+    }
+  }
+  else {
+    if (!v1_singularity) {
+      open_face_edge_index = edge1->link_edge_groups[0]->open_face_edge;
+      CustomData_copy_data(data->src_ldata, data->dst_ldata, loop1, (int)loop_index, 1);
+      mloop[loop_index].v = medge[edge1->new_edge].v1;
+      open_face_edge = medge + open_face_edge_index;
+      if (ELEM(medge[edge2->new_edge].v1, open_face_edge->v1, open_face_edge->v2)) {
+        mloop[loop_index++].e = open_face_edge_index;
+      }
+      else {
+        mloop[loop_index++].e = edge2->link_edge_groups[0]->open_face_edge;
+      }
+    }
+
+    CustomData_copy_data(data->src_ldata, data->dst_ldata, loop1, (int)loop_index, 1);
+    mloop[loop_index].v = medge[edge2->new_edge].v1;
+    mloop[loop_index++].e = edge2->new_edge;
+
+    if (!v2_singularity) {
+      open_face_edge_index = edge2->link_edge_groups[1]->open_face_edge;
+      CustomData_copy_data(data->src_ldata, data->dst_ldata, loop2, (int)loop_index, 1);
+      mloop[loop_index].v = medge[edge2->new_edge].v2;
+      open_face_edge = medge + open_face_edge_index;
+      if (ELEM(medge[edge1->new_edge].v2, open_face_edge->v1, open_face_edge->v2)) {
+        mloop[loop_index++].e = open_face_edge_index;
+      }
+      else {
+        mloop[loop_index++].e = edge1->link_edge_groups[1]->open_face_edge;
+      }
+    }
+
+    CustomData_copy_data(data->src_ldata, data->dst_ldata, loop2, (int)loop_index, 1);
+    mloop[loop_index].v = medge[edge1->new_edge].v2;
+    mloop[loop_index++].e = edge1->new_edge;
+  }
+  BLI_assert(loop_index == mpoly[poly_index].loopstart + mpoly[poly_index].totloop);
+}
+
+/**
+ * Collect the loops of a shell face, skipping edges which were collapsed.
+ *
+ * \return the number of loops, zero when the face collapses entirely.
+ */
+static uint solidify_shell_face_build(const NewFaceRef *fr,
+                                      const uint *vm,
+                                      const MEdge *orig_medge,
+                                      const MLoop *orig_mloop,
+                                      const MEdge *medge,
+                                      uint *face_loops,
+                                      uint *face_verts,
+                                      uint *face_edges)
+{
+  const uint loopstart = (uint)fr->face->loopstart;
+  uint totloop = (uint)fr->face->totloop;
+  uint valid_edges = 0;
+  uint k = 0;
+  UNUSED_VARS_NDEBUG(medge);
+  while (totloop > 0 && (!fr->link_edges[totloop - 1] ||
+                         fr->link_edges[totloop - 1]->new_edge == MOD_SOLIDIFY_EMPTY_TAG)) {
+    totloop--;
+  }
+  if (totloop == 0) {
+    return 0;
+  }
+  NewEdgeRef *prior_edge = fr->link_edges[totloop - 1];
+  uint prior_flip = (uint)(vm[orig_medge[prior_edge->old_edge].v1] ==
+                           vm[orig_mloop[loopstart + (totloop - 1)].v]);
+  for (uint j = 0; j < totloop; j++) {
+    NewEdgeRef *new_edge = fr->link_edges[j];
+    if (new_edge && new_edge->new_edge != MOD_SOLIDIFY_EMPTY_TAG) {
+      valid_edges++;
+      const uint flip = (uint)(vm[orig_medge[new_edge->old_edge].v2] ==
+                               vm[orig_mloop[loopstart + j].v]);
+      BLI_assert(flip ||
+                 vm[orig_medge[new_edge->old_edge].v1] == vm[orig_mloop[loopstart + j].v]);
+      /* The vert thats in the current loop. */
+      const uint new_v1 = new_edge->link_edge_groups[flip]->new_vert;
+      /* The vert thats in the next loop. */
+      const uint new_v2 = new_edge->link_edge_groups[1 - flip]->new_vert;
+      if (k == 0 || face_verts[k - 1] != new_v1) {
+        face_loops[k] = loopstart + j;
+        if (fr->reversed) {
+          face_edges[k] = prior_edge->link_edge_groups[prior_flip]->open_face_edge;
+        }
+        else {
+          face_edges[k] = new_edge->link_edge_groups[flip]->open_face_edge;
+        }
+        BLI_assert(k == 0 || medge[face_edges[k]].v2 == face_verts[k - 1] ||
+                   medge[face_edges[k]].v1 == face_verts[k - 1]);
+        BLI_assert(face_edges[k] == MOD_SOLIDIFY_EMPTY_TAG ||
+                   medge[face_edges[k]].v2 == new_v1 || medge[face_edges[k]].v1 == new_v1);
+        face_verts[k++] = new_v1;
+      }
+      prior_edge = new_edge;
+      prior_flip = 1 - flip;
+      if (j < totloop - 1 || face_verts[0] != new_v2) {
+        face_loops[k] = loopstart + (j + 1) % totloop;
+        face_edges[k] = new_edge->new_edge;
+        face_verts[k++] = new_v2;
+      }
+      else {
+        face_edges[0] = new_edge->new_edge;
+      }
+    }
+  }
+  return (k > 2 && valid_edges > 2) ? k : 0;
+}
+
+typedef struct SolidifyShellFaceData {
+  const CustomData *src_pdata;
+  const CustomData *src_ldata;
+  CustomData *dst_pdata;
+  CustomData *dst_ldata;
+  const NewFaceRef *face_sides_arr;
+  const uint *vm;
+  const MEdge *orig_medge;
+  const MLoop *orig_mloop;
+  const MEdge *medge;
+  MPoly *mpoly;
+  MLoop *mloop;
+  uint largest_ngon;
+  /** Loop count of every face side, filled by #solidify_shell_face_len_cb. */
+  uint *face_sides_len;
+  /** Face sides creating shell faces, and the first loop of each face. */
+  const uint *faces;
+  const uint *loop_offsets;
+  uint poly_start;
+  bool do_flip;
+  short mat_ofs;
+  short mat_nr_max;
+} SolidifyShellFaceData;
+
+typedef struct SolidifyShellFaceTLS {
+  uint *face_loops;
+  uint *face_verts;
+  uint *face_edges;
+} SolidifyShellFaceTLS;
+
+static uint solidify_shell_face_build_tls(const SolidifyShellFaceData *data,
+                                          SolidifyShellFaceTLS *tls,
+                                          const uint i)
+{
+  if (tls->face_loops == NULL) {
+    const uint len = data->largest_ngon * 2;
+    tls->face_loops = MEM_malloc_arrayN(len, sizeof(*tls->face_loops), "face_loops in solidify");
+    tls->face_verts = MEM_malloc_arrayN(len, sizeof(*tls->face_verts), "face_verts in solidify");
+    tls->face_edges = MEM_malloc_arrayN(len, sizeof(*tls->face_edges), "face_edges in solidify");
+  }
+  return solidify_shell_face_build(&data->face_sides_arr[i],
+                                   data->vm,
+                                   data->orig_medge,
+                                   data->orig_mloop,
+                                   data->medge,
+                                   tls->face_loops,
+                                   tls->face_verts,
+                                   tls->face_edges);
+}
+
+static void solidify_shell_face_len_cb(void *__restrict userdata,
+                                       const int index,
+                                       const TaskParallelTLS *__restrict tls)
+{
+  const SolidifyShellFaceData *data = userdata;
+  data->face_sides_len[index] = solidify_shell_face_build_tls(
+      data, tls->userdata_chunk, (uint)index);
+}
+
+static void solidify_shell_face_cb(void *__restrict userdata,
+                                   const int index,
+                                   const TaskParallelTLS *__restrict tls)
+{
+  const SolidifyShellFaceData *data = userdata;
+  SolidifyShellFaceTLS *face_tls = tls->userdata_chunk;
+  MPoly *mpoly = data->mpoly;
+  MLoop *mloop = data->mloop;
+  const uint i = data->faces[index];
+  const NewFaceRef *fr = &data->face_sides_arr[i];
+  const uint poly_index = data->poly_start + (uint)index;
+  uint loop_index = data->loop_offsets[index];
+
+  const uint k = solidify_shell_face_build_tls(data, face_tls, i);
+  const uint *face_loops = face_tls->face_loops;
+  const uint *face_verts = face_tls->face_verts;
+  const uint *face_edges = face_tls->face_edges;
+  BLI_assert(k == data->face_sides_len[i]);
+
+  CustomData_copy_data(data->src_pdata, data->dst_pdata, (int)(i / 2), (int)poly_index, 1);
+  mpoly[poly_index].loopstart = (int)loop_index;
+  mpoly[poly_index].totloop = (int)k;
+  mpoly[poly_index].mat_nr = fr->face->mat_nr +
+                             (fr->reversed != data->do_flip ? data->mat_ofs : 0);
+  CLAMP(mpoly[poly_index].mat_nr, 0, data->mat_nr_max);
+  mpoly[poly_index].flag = fr->face->flag;
+  if (fr->reversed != data->do_flip) {
+    for (int l = (int)k - 1; l >= 0; l--) {
+      CustomData_copy_data(
+          data->src_ldata, data->dst_ldata, (int)face_loops[l], (int)loop_index, 1);
+      mloop[loop_index].v = face_verts[l];
+      mloop[loop_index++].e = face_edges[l];
+    }
+  }
+  else {
+    uint l = k - 1;
+    for (uint next_l = 0; next_l < k; next_l++) {
+      CustomData_copy_data(
+          data->src_ldata, data->dst_ldata, (int)face_loops[l], (int)loop_index, 1);
+      mloop[loop_index].v = face_verts[l];
+      mloop[loop_index++].e = face_edges[next_l];
+      l = next_l;
+    }
+  }
+}
+
+static void solidify_shell_face_free(const void *__restrict UNUSED(userdata),
+                                     void *__restrict tls_v)
+{
+  SolidifyShellFaceTLS *tls = tls_v;
+  MEM_SAFE_FREE(tls->face_loops);
+  MEM_SAFE_FREE(tls->face_verts);
+  MEM_SAFE_FREE(tls->face_edges);
+}
+
 /* NOLINTNEXTLINE: readability-function-size */
 Mesh *MOD_solidify_nonmanifold_modifyMesh(ModifierData *md,
                                           const ModifierEvalContext *ctx,
@@ -198,8 +1085,6 @@ Mesh *MOD_solidify_nonmanifold_modifyMesh(ModifierData *md,
   uint numNewLoops = 0;
   uint numNewPolys = 0;
 
-#define MOD_SOLIDIFY_EMPTY_TAG ((uint)-1)
-
   /* Calculate only face normals. */
   poly_nors = MEM_malloc_arrayN(numPolys, sizeof(*poly_nors), __func__);
   BKE_mesh_calc_normals_poly(orig_mvert,
@@ -1405,443 +2290,35 @@ Mesh *MOD_solidify_nonmanifold_modifyMesh(ModifierData *md,
       }
     }
 
-    mv = orig_mvert;
-    gs_ptr = orig_vert_groups_arr;
-    for (uint i = 0; i < numVerts; i++, mv++, gs_ptr++) {
-      if (*gs_ptr) {
-        EdgeGroup *g = *gs_ptr;
-        for (uint j = 0; g->valid; j++, g++) {
-          if (!g->is_singularity) {
-            float *nor = g->no;
-            float move_nor[3] = {0, 0, 0};
-            bool disable_boundary_fix = (smd->nonmanifold_boundary_mode ==
-                                             MOD_SOLIDIFY_NONMANIFOLD_BOUNDARY_MODE_NONE ||
-                                         (g->is_orig_closed || g->split));
-            /* Constraints Method. */
-            if (smd->nonmanifold_offset_mode == MOD_SOLIDIFY_NONMANIFOLD_OFFSET_MODE_CONSTRAINTS) {
-              NewEdgeRef *first_edge = NULL;
-              NewEdgeRef **edge_ptr = g->edges;
-              /* Contains normal and offset [nx, ny, nz, ofs]. */
-              float(*normals_queue)[4] = MEM_malloc_arrayN(
-                  g->edges_len + 1, sizeof(*normals_queue), "normals_queue in solidify");
-              uint queue_index = 0;
-
-              float face_nors[3][3];
-              float nor_ofs[3];
-
-              const bool cycle = (g->is_orig_closed && !g->split) || g->is_even_split;
-              for (uint k = 0; k < g->edges_len; k++, edge_ptr++) {
-                if (!(k & 1) || (!cycle && k == g->edges_len - 1)) {
-                  NewEdgeRef *edge = *edge_ptr;
-                  for (uint l = 0; l < 2; l++) {
-                    NewFaceRef *face = edge->faces[l];
-                    if (face && (first_edge == NULL ||
-                                 (first_edge->faces[0] != face && first_edge->faces[1] != face))) {
-                      float ofs = face->reversed ? ofs_back_clamped : ofs_front_clamped;
-                      /* Use face_weight here to make faces thinner. */
-                      if (do_flat_faces) {
-                        ofs *= face_weight[face->index];
-                      }
-
-                      if (!null_faces[face->index]) {
-                        /* And normal to the queue. */
-                        mul_v3_v3fl(normals_queue[queue_index],
-                                    poly_nors[face->index],
-                                    face->reversed ? -1 : 1);
-                        normals_queue[queue_index++][3] = ofs;
-                      }
-                      else {
-                        /* Just use this approximate normal of the null face if there is no other
-                         * normal to use. */
-                        mul_v3_v3fl(face_nors[0], poly_nors[face->index], face->reversed ? -1 : 1);
-                        nor_ofs[0] = ofs;
-                      }
-                    }
-                  }
-                  if ((cycle && k == 0) || (!cycle && k + 3 >= g->edges_len)) {
-                    first_edge = edge;
-                  }
-                }
-              }
-              uint face_nors_len = 0;
-              const float stop_explosion = 0.999f - fabsf(smd->offset_fac) * 0.05f;
-              while (queue_index > 0) {
-                if (face_nors_len == 0) {
-                  if (queue_index <= 2) {
-                    for (uint k = 0; k < queue_index; k++) {
-                      copy_v3_v3(face_nors[k], normals_queue[k]);
-                      nor_ofs[k] = normals_queue[k][3];
-                    }
-                    face_nors_len = queue_index;
-                    queue_index = 0;
-                  }
-                  else {
-                    /* Find most different two normals. */
-                    float min_p = 2;
-                    uint min_n0 = 0;
-                    uint min_n1 = 0;
-                    for (uint k = 0; k < queue_index; k++) {
-                      for (uint m = k + 1; m < queue_index; m++) {
-                        float p = dot_v3v3(normals_queue[k], normals_queue[m]);
-                        if (p <= min_p + FLT_EPSILON) {
-                          min_p = p;
-                          min_n0 = m;
-                          min_n1 = k;
-                        }
-                      }
-                    }
-                    copy_v3_v3(face_nors[0], normals_queue[min_n0]);
-                    copy_v3_v3(face_nors[1], normals_queue[min_n1]);
-                    nor_ofs[0] = normals_queue[min_n0][3];
-                    nor_ofs[1] = normals_queue[min_n1][3];
-                    face_nors_len = 2;
-                    queue_index--;
-                    memmove(normals_queue + min_n0,
-                            normals_queue + min_n0 + 1,
-                            (queue_index - min_n0) * sizeof(*normals_queue));
-                    queue_index--;
-                    memmove(normals_queue + min_n1,
-                            normals_queue + min_n1 + 1,
-                            (queue_index - min_n1) * sizeof(*normals_queue));
-                    min_p = 1;
-                    min_n1 = 0;
-                    float max_p = -1;
-                    for (uint k = 0; k < queue_index; k++) {
-                      max_p = -1;
-                      for (uint m = 0; m < face_nors_len; m++) {
-                        float p = dot_v3v3(face_nors[m], normals_queue[k]);
-                        if (p > max_p + FLT_EPSILON) {
-                          max_p = p;
-                        }
-                      }
-                      if (max_p <= min_p + FLT_EPSILON) {
-                        min_p = max_p;
-                        min_n1 = k;
-                      }
-                    }
-                    if (min_p < 0.8) {
-                      copy_v3_v3(face_nors[2], normals_queue[min_n1]);
-                      nor_ofs[2] = normals_queue[min_n1][3];
-                      face_nors_len++;
-                      queue_index--;
-                      memmove(normals_queue + min_n1,
-                              normals_queue + min_n1 + 1,
-                              (queue_index - min_n1) * sizeof(*normals_queue));
-                    }
-                  }
-                }
-                else {
-                  uint best = 0;
-                  uint best_group = 0;
-                  float best_p = -1.0f;
-                  for (uint k = 0; k < queue_index; k++) {
-                    for (uint m = 0; m < face_nors_len; m++) {
-                      float p = dot_v3v3(face_nors[m], normals_queue[k]);
-                      if (p > best_p + FLT_EPSILON) {
-                        best_p = p;
-                        best = m;
-                        best_group = k;
-                      }
-                    }
-                  }
-                  add_v3_v3(face_nors[best], normals_queue[best_group]);
-                  normalize_v3(face_nors[best]);
-                  nor_ofs[best] = (nor_ofs[best] + normals_queue[best_group][3]) * 0.5f;
-                  queue_index--;
-                  memmove(normals_queue + best_group,
-                          normals_queue + best_group + 1,
-                          (queue_index - best_group) * sizeof(*normals_queue));
-                }
-              }
-              MEM_freeN(normals_queue);
-
-              /* When up to 3 constraint normals are found. */
-              if (ELEM(face_nors_len, 2, 3)) {
-                const float q = dot_v3v3(face_nors[0], face_nors[1]);
-                float d = 1.0f - q * q;
-                cross_v3_v3v3(move_nor, face_nors[0], face_nors[1]);
-                if (d > FLT_EPSILON * 10 && q < stop_explosion) {
-                  d = 1.0f / d;
-                  mul_v3_fl(face_nors[0], (nor_ofs[0] - nor_ofs[1] * q) * d);
-                  mul_v3_fl(face_nors[1], (nor_ofs[1] - nor_ofs[0] * q) * d);
-                }
-                else {
-                  d = 1.0f / (fabsf(q) + 1.0f);
-                  mul_v3_fl(face_nors[0], nor_ofs[0] * d);
-                  mul_v3_fl(face_nors[1], nor_ofs[1] * d);
-                }
-                add_v3_v3v3(nor, face_nors[0], face_nors[1]);
-                if (face_nors_len == 3) {
-                  float *free_nor = move_nor;
-                  mul_v3_fl(face_nors[2], nor_ofs[2]);
-                  d = dot_v3v3(face_nors[2], free_nor);
-                  if (LIKELY(fabsf(d) > FLT_EPSILON)) {
-                    sub_v3_v3v3(face_nors[0], nor, face_nors[2]); /* Override face_nor[0]. */
-                    mul_v3_fl(free_nor, dot_v3v3(face_nors[2], face_nors[0]) / d);
-                    sub_v3_v3(nor, free_nor);
-                  }
-                  disable_boundary_fix = true;
-                }
-              }
-              else {
-                BLI_assert(face_nors_len < 2);
-                mul_v3_v3fl(nor, face_nors[0], nor_ofs[0]);
-                disable_boundary_fix = true;
-              }
-            }
-            /* Fixed/Even Method. */
-            else {
-              float total_angle = 0;
-              float total_angle_back = 0;
-              NewEdgeRef *first_edge = NULL;
-              NewEdgeRef **edge_ptr = g->edges;
-              float face_nor[3];
-              float nor_back[3] = {0, 0, 0};
-              bool has_back = false;
-              bool has_front = false;
-              bool cycle = (g->is_orig_closed && !g->split) || g->is_even_split;
-              for (uint k = 0; k < g->edges_len; k++, edge_ptr++) {
-                if (!(k & 1) || (!cycle && k == g->edges_len - 1)) {
-                  NewEdgeRef *edge = *edge_ptr;
-                  for (uint l = 0; l < 2; l++) {
-                    NewFaceRef *face = edge->faces[l];
-                    if (face && (first_edge == NULL ||
-                                 (first_edge->faces[0] != face && first_edge->faces[1] != face))) {
-                      float angle = 1.0f;
-                      float ofs = face->reversed ? -ofs_back_clamped : ofs_front_clamped;
-                      /* Use face_weight here to make faces thinner. */
-                      if (do_flat_faces) {
-                        ofs *= face_weight[face->index];
-                      }
-
-                      if (smd->nonmanifold_offset_mode ==
-                          MOD_SOLIDIFY_NONMANIFOLD_OFFSET_MODE_EVEN) {
-                        MLoop *ml_next = orig_mloop + face->face->loopstart;
-                        ml = ml_next + (face->face->totloop - 1);
-                        MLoop *ml_prev = ml - 1;
-                        for (int m = 0; m < face->face->totloop && vm[ml->v] != i;
-                             m++, ml_next++) {
-                          ml_prev = ml;
-                          ml = ml_next;
-                        }
-                        angle = angle_v3v3v3(orig_mvert_co[vm[ml_prev->v]],
-                                             orig_mvert_co[i],
-                                             orig_mvert_co[vm[ml_next->v]]);
-                        if (face->reversed) {
-                          total_angle_back += angle * ofs * ofs;
-                        }
-                        else {
-                          total_angle += angle * ofs * ofs;
-                        }
-                      }
-                      else {
-                        if (face->reversed) {
-                          total_angle_back++;
-                        }
-                        else {
-                          total_angle++;
-                        }
-                      }
-                      mul_v3_v3fl(face_nor, poly_nors[face->index], angle * ofs);
-                      if (face->reversed) {
-                        add_v3_v3(nor_back, face_nor);
-                        has_back = true;
-                      }
-                      else {
-                        add_v3_v3(nor, face_nor);
-                        has_front = true;
-                      }
-                    }
-                  }
-                  if ((cycle && k == 0) || (!cycle && k + 3 >= g->edges_len)) {
-                    first_edge = edge;
-                  }
-                }
-              }
-
-              /* Set normal length with selected method. */
-              if (smd->nonmanifold_offset_mode == MOD_SOLIDIFY_NONMANIFOLD_OFFSET_MODE_EVEN) {
-                if (has_front) {
-                  float length_sq = len_squared_v3(nor);
-                  if (LIKELY(length_sq > FLT_EPSILON)) {
-                    mul_v3_fl(nor, total_angle / length_sq);
-                  }
-                }
-                if (has_back) {
-                  float length_sq = len_squared_v3(nor_back);
-                  if (LIKELY(length_sq > FLT_EPSILON)) {
-                    mul_v3_fl(nor_back, total_angle_back / length_sq);
-                  }
-                  if (!has_front) {
-                    copy_v3_v3(nor, nor_back);
-                  }
-                }
-                if (has_front && has_back) {
-                  float nor_length = len_v3(nor);
-                  float nor_back_length = len_v3(nor_back);
-                  float q = dot_v3v3(nor, nor_back);
-                  if (LIKELY(fabsf(q) > FLT_EPSILON)) {
-                    q /= nor_length * nor_back_length;
-                  }
-                  float d = 1.0f - q * q;
-                  if (LIKELY(d > FLT_EPSILON)) {
-                    d = 1.0f / d;
-                    if (LIKELY(nor_length > FLT_EPSILON)) {
-                      mul_v3_fl(nor, (1 - nor_back_length * q / nor_length) * d);
-                    }
-                    if (LIKELY(nor_back_length > FLT_EPSILON)) {
-                      mul_v3_fl(nor_back, (1 - nor_length * q / nor_back_length) * d);
-                    }
-                    add_v3_v3(nor, nor_back);
-                  }
-                  else {
-                    mul_v3_fl(nor, 0.5f);
-                    mul_v3_fl(nor_back, 0.5f);
-                    add_v3_v3(nor, nor_back);
-                  }
-                }
-              }
-              else {
-                if (has_front && total_angle > FLT_EPSILON) {
-                  mul_v3_fl(nor, 1.0f / total_angle);
-                }
-                if (has_back && total_angle_back > FLT_EPSILON) {
-                  mul_v3_fl(nor_back, 1.0f / total_angle_back);
-                  add_v3_v3(nor, nor_back);
-                  if (has_front && total_angle > FLT_EPSILON) {
-                    mul_v3_fl(nor, 0.5f);
-                  }
-                }
-              }
-              /* Set move_nor for boundary fix. */
-              if (!disable_boundary_fix && g->edges_len > 2) {
-                edge_ptr = g->edges + 1;
-                float tmp[3];
-                uint k;
-                for (k = 1; k + 1 < g->edges_len; k++, edge_ptr++) {
-                  MEdge *e = orig_medge + (*edge_ptr)->old_edge;
-                  sub_v3_v3v3(
-                      tmp, orig_mvert_co[vm[e->v1] == i ? e->v2 : e->v1], orig_mvert_co[i]);
-                  add_v3_v3(move_nor, tmp);
-                }
-                if (k == 1) {
-                  disable_boundary_fix = true;
-                }
-                else {
-                  disable_boundary_fix = normalize_v3(move_nor) == 0.0f;
-                }
-              }
-              else {
-                disable_boundary_fix = true;
-              }
-            }
-            /* Fix boundary verts. */
-            if (!disable_boundary_fix) {
-              /* Constraint normal, nor * constr_nor == 0 after this fix. */
-              float constr_nor[3];
-              MEdge *e0_edge = orig_medge + g->edges[0]->old_edge;
-              MEdge *e1_edge = orig_medge + g->edges[g->edges_len - 1]->old_edge;
-              float e0[3];
-              float e1[3];
-              sub_v3_v3v3(e0,
-                          orig_mvert_co[vm[e0_edge->v1] == i ? e0_edge->v2 : e0_edge->v1],
-                          orig_mvert_co[i]);
-              sub_v3_v3v3(e1,
-                          orig_mvert_co[vm[e1_edge->v1] == i ? e1_edge->v2 : e1_edge->v1],
-                          orig_mvert_co[i]);
-              if (smd->nonmanifold_boundary_mode == MOD_SOLIDIFY_NONMANIFOLD_BOUNDARY_MODE_FLAT) {
-                cross_v3_v3v3(constr_nor, e0, e1);
-              }
-              else {
-                float f0[3];
-                float f1[3];
-                if (g->edges[0]->faces[0]->reversed) {
-                  negate_v3_v3(f0, poly_nors[g->edges[0]->faces[0]->index]);
-                }
-                else {
-                  copy_v3_v3(f0, poly_nors[g->edges[0]->faces[0]->index]);
-                }
-                if (g->edges[g->edges_len - 1]->faces[0]->reversed) {
-                  negate_v3_v3(f1, poly_nors[g->edges[g->edges_len - 1]->faces[0]->index]);
-                }
-                else {
-                  copy_v3_v3(f1, poly_nors[g->edges[g->edges_len - 1]->faces[0]->index]);
-                }
-                float n0[3];
-                float n1[3];
-                cross_v3_v3v3(n0, e0, f0);
-                cross_v3_v3v3(n1, f1, e1);
-                normalize_v3(n0);
-                normalize_v3(n1);
-                add_v3_v3v3(constr_nor, n0, n1);
-              }
-              float d = dot_v3v3(constr_nor, move_nor);
-              if (LIKELY(fabsf(d) > FLT_EPSILON)) {
-                mul_v3_fl(move_nor, dot_v3v3(constr_nor, nor) / d);
-                sub_v3_v3(nor, move_nor);
-              }
-            }
-            float scalar_vgroup = 1;
-            /* Use vertex group. */
-            if (dvert && !do_flat_faces) {
-              MDeformVert *dv = &dvert[i];
-              if (defgrp_invert) {
-                scalar_vgroup = 1.0f - BKE_defvert_find_weight(dv, defgrp_index);
-              }
-              else {
-                scalar_vgroup = BKE_defvert_find_weight(dv, defgrp_index);
-              }
-              scalar_vgroup = offset_fac_vg + (scalar_vgroup * offset_fac_vg_inv);
-            }
-            /* Do clamping. */
-            if (do_clamp) {
-              if (do_angle_clamp) {
-                if (g->edges_len > 2) {
-                  float min_length = 0;
-                  float angle = 0.5f * M_PI;
-                  uint k = 0;
-                  for (NewEdgeRef **p = g->edges; k < g->edges_len; k++, p++) {
-                    float length = orig_edge_lengths[(*p)->old_edge];
-                    float e_ang = (*p)->angle;
-                    if (e_ang > angle) {
-                      angle = e_ang;
-                    }
-                    if (length < min_length || k == 0) {
-                      min_length = length;
-                    }
-                  }
-                  float cos_ang = cosf(angle * 0.5f);
-                  if (cos_ang > 0) {
-                    float max_off = min_length * 0.5f / cos_ang;
-                    if (max_off < offset * 0.5f) {
-                      scalar_vgroup *= max_off / offset * 2;
-                    }
-                  }
-                }
-              }
-              else {
-                float min_length = 0;
-                uint k = 0;
-                for (NewEdgeRef **p = g->edges; k < g->edges_len; k++, p++) {
-                  float length = orig_edge_lengths[(*p)->old_edge];
-                  if (length < min_length || k == 0) {
-                    min_length = length;
-                  }
-                }
-                if (min_length < offset) {
-                  scalar_vgroup *= min_length / offset;
-                }
-              }
-            }
-            mul_v3_fl(nor, scalar_vgroup);
-            add_v3_v3v3(g->co, nor, orig_mvert_co[i]);
-          }
-          else {
-            copy_v3_v3(g->co, orig_mvert_co[i]);
-          }
-        }
-      }
-    }
+    SolidifyGroupCoData data = {
+        .smd = smd,
+        .orig_vert_groups_arr = orig_vert_groups_arr,
+        .vm = vm,
+        .orig_mvert_co = (const float(*)[3])orig_mvert_co,
+        .orig_medge = orig_medge,
+        .orig_mloop = orig_mloop,
+        .poly_nors = (const float(*)[3])poly_nors,
+        .null_faces = null_faces,
+        .face_weight = face_weight,
+        .orig_edge_lengths = orig_edge_lengths,
+        .dvert = dvert,
+        .defgrp_index = defgrp_index,
+        .defgrp_invert = defgrp_invert,
+        .do_flat_faces = do_flat_faces,
+        .do_clamp = do_clamp,
+        .do_angle_clamp = do_angle_clamp,
+        .ofs_front_clamped = ofs_front_clamped,
+        .ofs_back_clamped = ofs_back_clamped,
+        .offset_fac_vg = offset_fac_vg,
+        .offset_fac_vg_inv = offset_fac_vg_inv,
+        .offset = offset,
+    };
+
+    /* Every vertex only writes to its own edge groups. */
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 256;
+    BLI_task_parallel_range(0, (int)numVerts, &data, solidify_group_co_cb, &settings);
 
     if (do_flat_faces) {
       MEM_freeN(face_weight);
@@ -1957,17 +2434,31 @@ Mesh *MOD_solidify_nonmanifold_modifyMesh(ModifierData *md,
 
   /* Make edges. */
   {
-    uint i = 0;
+    SolidifyNewEdgeData edge_data = {
+        .src_edata = &mesh->edata,
+        .dst_edata = &result->edata,
+        .orig_edge_data_arr = orig_edge_data_arr,
+        .orig_medge = orig_medge,
+        .medge = medge,
+        .has_singularities = has_singularities,
+        .bevel_convex = bevel_convex,
+    };
+    uint *new_edge_edges = MEM_malloc_arrayN(numEdges, sizeof(*new_edge_edges), __func__);
+    uint *new_edge_offsets = MEM_malloc_arrayN(numEdges, sizeof(*new_edge_offsets), __func__);
+    uint new_edge_edges_len = 0;
     edge_index += totsingularity;
+    /* Count the new edges of every original edge. Edges merged into a singularity edge are
+     * created here in order, as several of them can map to the same edge. */
+    uint i = 0;
     for (NewEdgeRef ***new_edges = orig_edge_data_arr; i < numEdges; i++, new_edges++) {
       if (*new_edges && (do_shell || edge_adj_faces_len[i] == 1) && (**new_edges)->old_edge == i) {
+        const uint edge_index_start = edge_index;
         for (NewEdgeRef **l = *new_edges; *l; l++) {
           if ((*l)->new_edge != MOD_SOLIDIFY_EMPTY_TAG) {
-            const uint v1 = (*l)->link_edge_groups[0]->new_vert;
-            const uint v2 = (*l)->link_edge_groups[1]->new_vert;
-            uint insert = edge_index;
-            if (has_singularities && ((*l)->link_edge_groups[0]->is_singularity &&
-                                      (*l)->link_edge_groups[1]->is_singularity)) {
+            if (solidify_new_edge_is_singularity(*l, has_singularities)) {
+              const uint v1 = (*l)->link_edge_groups[0]->new_vert;
+              const uint v2 = (*l)->link_edge_groups[1]->new_vert;
+              uint insert = edge_index;
               uint j = 0;
               for (uint(*p)[2] = singularity_edges; j < totsingularity; p++, j++) {
                 if (((*p)[0] == v1 && (*p)[1] == v2) || ((*p)[0] == v2 && (*p)[1] == v1)) {
@@ -1976,34 +2467,30 @@ Mesh *MOD_solidify_nonmanifold_modifyMesh(ModifierData *md,
                 }
               }
               BLI_assert(insert == j);
+              solidify_new_edge_fill(&edge_data, i, *l, insert);
             }
             else {
               edge_index++;
             }
-            CustomData_copy_data(&mesh->edata, &result->edata, (int)i, (int)insert, 1);
-            BLI_assert(v1 != MOD_SOLIDIFY_EMPTY_TAG);
-            BLI_assert(v2 != MOD_SOLIDIFY_EMPTY_TAG);
-            medge[insert].v1 = v1;
-            medge[insert].v2 = v2;
-            medge[insert].flag = orig_medge[(*l)->old_edge].flag | ME_EDGEDRAW | ME_EDGERENDER;
-            medge[insert].crease = orig_medge[(*l)->old_edge].crease;
-            medge[insert].bweight = orig_medge[(*l)->old_edge].bweight;
-            if (bevel_convex != 0.0f && (*l)->faces[1] != NULL) {
-              medge[insert].bweight = (char)clamp_i(
-                  (int)medge[insert].bweight + (int)(((*l)->angle > M_PI + FLT_EPSILON ?
-                                                          clamp_f(bevel_convex, 0.0f, 1.0f) :
-                                                          ((*l)->angle < M_PI - FLT_EPSILON ?
-                                                               clamp_f(bevel_convex, -1.0f, 0.0f) :
-                                                               0)) *
-                                                     255),
-                  0,
-                  255);
-            }
-            (*l)->new_edge = insert;
           }
         }
+        if (edge_index != edge_index_start) {
+          new_edge_edges[new_edge_edges_len] = i;
+          new_edge_offsets[new_edge_edges_len++] = edge_index_start;
+        }
       }
     }
+    edge_data.edges = new_edge_edges;
+    edge_data.edge_offsets = new_edge_offsets;
+
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1024;
+    BLI_task_parallel_range(
+        0, (int)new_edge_edges_len, &edge_data, solidify_new_edge_cb, &settings);
+
+    MEM_freeN(new_edge_edges);
+    MEM_freeN(new_edge_offsets);
   }
   if (singularity_edges) {
     MEM_freeN(singularity_edges);
@@ -2256,6 +2743,9 @@ Mesh *MOD_solidify_nonmanifold_modifyMesh(ModifierData *md,
 
   /* Make boundary faces. */
   if (do_rim) {
+    uint *rim_edges = MEM_malloc_arrayN(numEdges, sizeof(*rim_edges), __func__);
+    uint *rim_loop_offsets = MEM_malloc_arrayN(numEdges, sizeof(*rim_loop_offsets), __func__);
+    uint rim_edges_len = 0;
     for (uint i = 0; i < numEdges; i++) {
       if (edge_adj_faces_len[i] == 1 && orig_edge_data_arr[i] &&
           (*orig_edge_data_arr[i])->old_edge == i) {
@@ -2270,235 +2760,118 @@ Mesh *MOD_solidify_nonmanifold_modifyMesh(ModifierData *md,
         if (v1_singularity && v2_singularity) {
           continue;
         }
+        rim_edges[rim_edges_len] = i;
+        rim_loop_offsets[rim_edges_len++] = loop_index;
+        loop_index += 4 - (uint)(v1_singularity || v2_singularity);
+      }
+    }
 
-        MPoly *face = (*new_edges)->faces[0]->face;
-        CustomData_copy_data(
-            &mesh->pdata, &result->pdata, (int)(*new_edges)->faces[0]->index, (int)poly_index, 1);
-        mpoly[poly_index].loopstart = (int)loop_index;
-        mpoly[poly_index].totloop = 4 - (int)(v1_singularity || v2_singularity);
-        mpoly[poly_index].mat_nr = face->mat_nr + mat_ofs_rim;
-        CLAMP(mpoly[poly_index].mat_nr, 0, mat_nr_max);
-        mpoly[poly_index].flag = face->flag;
-        poly_index++;
-
-        int loop1 = -1;
-        int loop2 = -1;
-        ml = orig_mloop + face->loopstart;
-        const uint old_v1 = vm[orig_medge[edge1->old_edge].v1];
-        const uint old_v2 = vm[orig_medge[edge1->old_edge].v2];
-        for (uint j = 0; j < face->totloop; j++, ml++) {
-          if (vm[ml->v] == old_v1) {
-            loop1 = face->loopstart + (int)j;
-          }
-          else if (vm[ml->v] == old_v2) {
-            loop2 = face->loopstart + (int)j;
-          }
-        }
-        BLI_assert(loop1 != -1 && loop2 != -1);
-        MEdge *open_face_edge;
-        uint open_face_edge_index;
-        if (!do_flip) {
-          if (rim_defgrp_index != -1) {
-            BKE_defvert_ensure_index(&result->dvert[medge[edge1->new_edge].v1], rim_defgrp_index)
-                ->weight = 1.0f;
-          }
-          CustomData_copy_data(&mesh->ldata, &result->ldata, loop1, (int)loop_index, 1);
-          mloop[loop_index].v = medge[edge1->new_edge].v1;
-          mloop[loop_index++].e = edge1->new_edge;
-
-          if (!v2_singularity) {
-            open_face_edge_index = edge1->link_edge_groups[1]->open_face_edge;
-            if (rim_defgrp_index != -1) {
-              BKE_defvert_ensure_index(&result->dvert[medge[edge1->new_edge].v2], rim_defgrp_index)
-                  ->weight = 1.0f;
-            }
-            CustomData_copy_data(&mesh->ldata, &result->ldata, loop2, (int)loop_index, 1);
-            mloop[loop_index].v = medge[edge1->new_edge].v2;
-            open_face_edge = medge + open_face_edge_index;
-            if (ELEM(medge[edge2->new_edge].v2, open_face_edge->v1, open_face_edge->v2)) {
-              mloop[loop_index++].e = open_face_edge_index;
-            }
-            else {
-              mloop[loop_index++].e = edge2->link_edge_groups[1]->open_face_edge;
-            }
-          }
-
-          if (rim_defgrp_index != -1) {
-            BKE_defvert_ensure_index(&result->dvert[medge[edge2->new_edge].v2], rim_defgrp_index)
-                ->weight = 1.0f;
-          }
-          CustomData_copy_data(&mesh->ldata, &result->ldata, loop2, (int)loop_index, 1);
-          mloop[loop_index].v = medge[edge2->new_edge].v2;
-          mloop[loop_index++].e = edge2->new_edge;
-
-          if (!v1_singularity) {
-            open_face_edge_index = edge2->link_edge_groups[0]->open_face_edge;
-            if (rim_defgrp_index != -1) {
-              BKE_defvert_ensure_index(&result->dvert[medge[edge2->new_edge].v1], rim_defgrp_index)
-                  ->weight = 1.0f;
-            }
-            CustomData_copy_data(&mesh->ldata, &result->ldata, loop1, (int)loop_index, 1);
-            mloop[loop_index].v = medge[edge2->new_edge].v1;
-            open_face_edge = medge + open_face_edge_index;
-            if (ELEM(medge[edge1->new_edge].v1, open_face_edge->v1, open_face_edge->v2)) {
-              mloop[loop_index++].e = open_face_edge_index;
-            }
-            else {
-              mloop[loop_index++].e = edge1->link_edge_groups[0]->open_face_edge;
-            }
-          }
-        }
-        else {
-          if (!v1_singularity) {
-            open_face_edge_index = edge1->link_edge_groups[0]->open_face_edge;
-            if (rim_defgrp_index != -1) {
-              BKE_defvert_ensure_index(&result->dvert[medge[edge1->new_edge].v1], rim_defgrp_index)
-                  ->weight = 1.0f;
-            }
-            CustomData_copy_data(&mesh->ldata, &result->ldata, loop1, (int)loop_index, 1);
-            mloop[loop_index].v = medge[edge1->new_edge].v1;
-            open_face_edge = medge + open_face_edge_index;
-            if (ELEM(medge[edge2->new_edge].v1, open_face_edge->v1, open_face_edge->v2)) {
-              mloop[loop_index++].e = open_face_edge_index;
-            }
-            else {
-              mloop[loop_index++].e = edge2->link_edge_groups[0]->open_face_edge;
-            }
-          }
-
-          if (rim_defgrp_index != -1) {
-            BKE_defvert_ensure_index(&result->dvert[medge[edge2->new_edge].v1], rim_defgrp_index)
-                ->weight = 1.0f;
-          }
-          CustomData_copy_data(&mesh->ldata, &result->ldata, loop1, (int)loop_index, 1);
-          mloop[loop_index].v = medge[edge2->new_edge].v1;
-          mloop[loop_index++].e = edge2->new_edge;
-
-          if (!v2_singularity) {
-            open_face_edge_index = edge2->link_edge_groups[1]->open_face_edge;
-            if (rim_defgrp_index != -1) {
-              BKE_defvert_ensure_index(&result->dvert[medge[edge2->new_edge].v2], rim_defgrp_index)
-                  ->weight = 1.0f;
-            }
-            CustomData_copy_data(&mesh->ldata, &result->ldata, loop2, (int)loop_index, 1);
-            mloop[loop_index].v = medge[edge2->new_edge].v2;
-            open_face_edge = medge + open_face_edge_index;
-            if (ELEM(medge[edge1->new_edge].v2, open_face_edge->v1, open_face_edge->v2)) {
-              mloop[loop_index++].e = open_face_edge_index;
-            }
-            else {
-              mloop[loop_index++].e = edge1->link_edge_groups[1]->open_face_edge;
-            }
-          }
-
-          if (rim_defgrp_index != -1) {
-            BKE_defvert_ensure_index(&result->dvert[medge[edge1->new_edge].v2], rim_defgrp_index)
-                ->weight = 1.0f;
-          }
-          CustomData_copy_data(&mesh->ldata, &result->ldata, loop2, (int)loop_index, 1);
-          mloop[loop_index].v = medge[edge1->new_edge].v2;
-          mloop[loop_index++].e = edge1->new_edge;
-        }
+    SolidifyRimFaceData rim_data = {
+        .src_pdata = &mesh->pdata,
+        .src_ldata = &mesh->ldata,
+        .dst_pdata = &result->pdata,
+        .dst_ldata = &result->ldata,
+        .orig_edge_data_arr = orig_edge_data_arr,
+        .vm = vm,
+        .orig_medge = orig_medge,
+        .orig_mloop = orig_mloop,
+        .medge = medge,
+        .mpoly = mpoly,
+        .mloop = mloop,
+        .edges = rim_edges,
+        .loop_offsets = rim_loop_offsets,
+        .poly_start = poly_index,
+        .do_flip = do_flip,
+        .mat_ofs_rim = mat_ofs_rim,
+        .mat_nr_max = mat_nr_max,
+    };
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1024;
+    BLI_task_parallel_range(0, (int)rim_edges_len, &rim_data, solidify_rim_face_cb, &settings);
+
+    /* Vertices are shared between faces, so the weights are set afterwards. */
+    if (rim_defgrp_index != -1 && rim_edges_len != 0) {
+      for (uint l = rim_loop_offsets[0]; l < loop_index; l++) {
+        BKE_defvert_ensure_index(&result->dvert[mloop[l].v], rim_defgrp_index)->weight = 1.0f;
       }
     }
+    poly_index += rim_edges_len;
+
+    MEM_freeN(rim_edges);
+    MEM_freeN(rim_loop_offsets);
   }
 
   /* Make faces. */
   if (do_shell) {
-    NewFaceRef *fr = face_sides_arr;
-    uint *face_loops = MEM_malloc_arrayN(
-        largest_ngon * 2, sizeof(*face_loops), "face_loops in solidify");
-    uint *face_verts = MEM_malloc_arrayN(
-        largest_ngon * 2, sizeof(*face_verts), "face_verts in solidify");
-    uint *face_edges = MEM_malloc_arrayN(
-        largest_ngon * 2, sizeof(*face_edges), "face_edges in solidify");
-    for (uint i = 0; i < numPolys * 2; i++, fr++) {
-      const uint loopstart = (uint)fr->face->loopstart;
-      uint totloop = (uint)fr->face->totloop;
-      uint valid_edges = 0;
-      uint k = 0;
-      while (totloop > 0 && (!fr->link_edges[totloop - 1] ||
-                             fr->link_edges[totloop - 1]->new_edge == MOD_SOLIDIFY_EMPTY_TAG)) {
-        totloop--;
+    const uint face_sides_len = numPolys * 2;
+    uint *face_sides_loops_len = MEM_malloc_arrayN(
+        face_sides_len, sizeof(*face_sides_loops_len), __func__);
+    SolidifyShellFaceData shell_data = {
+        .src_pdata = &mesh->pdata,
+        .src_ldata = &mesh->ldata,
+        .dst_pdata = &result->pdata,
+        .dst_ldata = &result->ldata,
+        .face_sides_arr = face_sides_arr,
+        .vm = vm,
+        .orig_medge = orig_medge,
+        .orig_mloop = orig_mloop,
+        .medge = medge,
+        .mpoly = mpoly,
+        .mloop = mloop,
+        .largest_ngon = largest_ngon,
+        .face_sides_len = face_sides_loops_len,
+        .poly_start = poly_index,
+        .do_flip = do_flip,
+        .mat_ofs = mat_ofs,
+        .mat_nr_max = mat_nr_max,
+    };
+    SolidifyShellFaceTLS tls = {NULL};
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1024;
+    settings.userdata_chunk = &tls;
+    settings.userdata_chunk_size = sizeof(tls);
+    settings.func_free = solidify_shell_face_free;
+    BLI_task_parallel_range(
+        0, (int)face_sides_len, &shell_data, solidify_shell_face_len_cb, &settings);
+
+    /* Offsets of the faces which are not collapsed entirely. */
+    uint *shell_faces = MEM_malloc_arrayN(face_sides_len, sizeof(*shell_faces), __func__);
+    uint *shell_loop_offsets = MEM_malloc_arrayN(
+        face_sides_len, sizeof(*shell_loop_offsets), __func__);
+    uint shell_faces_len = 0;
+    for (uint i = 0; i < face_sides_len; i++) {
+      if (face_sides_loops_len[i] != 0) {
+        shell_faces[shell_faces_len] = i;
+        shell_loop_offsets[shell_faces_len++] = loop_index;
+        loop_index += face_sides_loops_len[i];
       }
-      if (totloop > 0) {
-        NewEdgeRef *prior_edge = fr->link_edges[totloop - 1];
-        uint prior_flip = (uint)(vm[orig_medge[prior_edge->old_edge].v1] ==
-                                 vm[orig_mloop[loopstart + (totloop - 1)].v]);
-        for (uint j = 0; j < totloop; j++) {
-          NewEdgeRef *new_edge = fr->link_edges[j];
-          if (new_edge && new_edge->new_edge != MOD_SOLIDIFY_EMPTY_TAG) {
-            valid_edges++;
-            const uint flip = (uint)(vm[orig_medge[new_edge->old_edge].v2] ==
-                                     vm[orig_mloop[loopstart + j].v]);
-            BLI_assert(flip ||
-                       vm[orig_medge[new_edge->old_edge].v1] == vm[orig_mloop[loopstart + j].v]);
-            /* The vert thats in the current loop. */
-            const uint new_v1 = new_edge->link_edge_groups[flip]->new_vert;
-            /* The vert thats in the next loop. */
-            const uint new_v2 = new_edge->link_edge_groups[1 - flip]->new_vert;
-            if (k == 0 || face_verts[k - 1] != new_v1) {
-              face_loops[k] = loopstart + j;
-              if (fr->reversed) {
-                face_edges[k] = prior_edge->link_edge_groups[prior_flip]->open_face_edge;
-              }
-              else {
-                face_edges[k] = new_edge->link_edge_groups[flip]->open_face_edge;
-              }
-              BLI_assert(k == 0 || medge[face_edges[k]].v2 == face_verts[k - 1] ||
-                         medge[face_edges[k]].v1 == face_verts[k - 1]);
-              BLI_assert(face_edges[k] == MOD_SOLIDIFY_EMPTY_TAG ||
-                         medge[face_edges[k]].v2 == new_v1 || medge[face_edges[k]].v1 == new_v1);
-              face_verts[k++] = new_v1;
-            }
-            prior_edge = new_edge;
-            prior_flip = 1 - flip;
-            if (j < totloop - 1 || face_verts[0] != new_v2) {
-              face_loops[k] = loopstart + (j + 1) % totloop;
-              face_edges[k] = new_edge->new_edge;
-              face_verts[k++] = new_v2;
-            }
-            else {
-              face_edges[0] = new_edge->new_edge;
-            }
-          }
-        }
-        if (k > 2 && valid_edges > 2) {
-          CustomData_copy_data(&mesh->pdata, &result->pdata, (int)(i / 2), (int)poly_index, 1);
-          mpoly[poly_index].loopstart = (int)loop_index;
-          mpoly[poly_index].totloop = (int)k;
-          mpoly[poly_index].mat_nr = fr->face->mat_nr + (fr->reversed != do_flip ? mat_ofs : 0);
-          CLAMP(mpoly[poly_index].mat_nr, 0, mat_nr_max);
-          mpoly[poly_index].flag = fr->face->flag;
-          if (fr->reversed != do_flip) {
-            for (int l = (int)k - 1; l >= 0; l--) {
-              if (shell_defgrp_index != -1) {
-                BKE_defvert_ensure_index(&result->dvert[face_verts[l]], shell_defgrp_index)
-                    ->weight = 1.0f;
-              }
-              CustomData_copy_data(
-                  &mesh->ldata, &result->ldata, (int)face_loops[l], (int)loop_index, 1);
-              mloop[loop_index].v = face_verts[l];
-              mloop[loop_index++].e = face_edges[l];
-            }
-          }
-          else {
-            uint l = k - 1;
-            for (uint next_l = 0; next_l < k; next_l++) {
-              CustomData_copy_data(
-                  &mesh->ldata, &result->ldata, (int)face_loops[l], (int)loop_index, 1);
-              mloop[loop_index].v = face_verts[l];
-              mloop[loop_index++].e = face_edges[next_l];
-              l = next_l;
-            }
+    }
+    shell_data.faces = shell_faces;
+    shell_data.loop_offsets = shell_loop_offsets;
+    BLI_task_parallel_range(
+        0, (int)shell_faces_len, &shell_data, solidify_shell_face_cb, &settings);
+
+    /* Vertices are shared between faces, so the weights are set afterwards. */
+    if (shell_defgrp_index != -1) {
+      for (uint i = 0; i < shell_faces_len; i++) {
+        const NewFaceRef *fr = &face_sides_arr[shell_faces[i]];
+        if (fr->reversed != do_flip) {
+          const MPoly *shell_mp = &mpoly[poly_index + i];
+          for (int l = 0; l < shell_mp->totloop; l++) {
+            BKE_defvert_ensure_index(&result->dvert[mloop[shell_mp->loopstart + l].v],
+                                     shell_defgrp_index)
+                ->weight = 1.0f;
           }
-          poly_index++;
         }
       }
     }
-    MEM_freeN(face_loops);
-    MEM_freeN(face_verts);
-    MEM_freeN(face_edges);
+    poly_index += shell_faces_len;
+
+    MEM_freeN(face_sides_loops_len);
+    MEM_freeN(shell_faces);
+    MEM_freeN(shell_loop_offsets);
   }
   if (edge_index != numNewEdges) {
     BKE_modifier_set_error(ctx->object,
@@ -2558,9 +2931,9 @@ Mesh *MOD_solidify_nonmanifold_modifyMesh(ModifierData *md,
     MEM_freeN(poly_nors);
   }
 
-#undef MOD_SOLIDIFY_EMPTY_TAG
-
   return result;
 }
 
+#undef MOD_SOLIDIFY_EMPTY_TAG
+
 /** \} */
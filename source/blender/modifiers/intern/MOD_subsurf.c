@@ -66,6 +66,8 @@
 typedef struct SubsurfRuntimeData {
   /* Cached subdivision surface descriptor, with topology and settings. */
   struct Subdiv *subdiv;
+  /* Result of the previous evaluation, re-used when the input mesh is only deformed. */
+  struct SubdivMeshCache *mesh_cache;
 } SubsurfRuntimeData;
 
 static void initData(ModifierData *md)
@@ -118,6 +120,9 @@ static void freeRuntimeData(void *runtime_data_v)
   if (runtime_data->subdiv != NULL) {
     BKE_subdiv_free(runtime_data->subdiv);
   }
+  if (runtime_data->mesh_cache != NULL) {
+    BKE_subdiv_mesh_cache_free(runtime_data->mesh_cache);
+  }
   MEM_freeN(runtime_data);
 }
 
@@ -199,7 +204,8 @@ static void subdiv_mesh_settings_init(SubdivToMeshSettings *settings,
 static Mesh *subdiv_as_mesh(SubsurfModifierData *smd,
                             const ModifierEvalContext *ctx,
                             Mesh *mesh,
-                            Subdiv *subdiv)
+                            Subdiv *subdiv,
+                            const bool use_cache)
 {
   Mesh *result = mesh;
   SubdivToMeshSettings mesh_settings;
@@ -207,7 +213,16 @@ static Mesh *subdiv_as_mesh(SubsurfModifierData *smd,
   if (mesh_settings.resolution < 3) {
     return result;
   }
-  result = BKE_subdiv_to_mesh(subdiv, &mesh_settings, mesh);
+  if (use_cache) {
+    SubsurfRuntimeData *runtime_data = (SubsurfRuntimeData *)smd->modifier.runtime;
+    if (runtime_data->mesh_cache == NULL) {
+      runtime_data->mesh_cache = BKE_subdiv_mesh_cache_new();
+    }
+    result = BKE_subdiv_to_mesh_cached(subdiv, &mesh_settings, mesh, runtime_data->mesh_cache);
+  }
+  else {
+    result = BKE_subdiv_to_mesh(subdiv, &mesh_settings, mesh);
+  }
   return result;
 }
 
@@ -281,7 +296,8 @@ static Mesh *modifyMesh(ModifierData *md, const ModifierEvalContext *ctx, Mesh *
   /* TODO(sergey): Decide whether we ever want to use CCG for subsurf,
    * maybe when it is a last modifier in the stack? */
   if (true) {
-    result = subdiv_as_mesh(smd, ctx, mesh, subdiv);
+    /* Split normals are interpolated from the coarse mesh, they change with its positions. */
+    result = subdiv_as_mesh(smd, ctx, mesh, subdiv, !use_clnors);
   }
   else {
     result = subdiv_as_ccg(smd, ctx, mesh, subdiv);
@@ -49,7 +49,9 @@
 
 #include "RNA_access.h"
 
+#include "BLI_array.hh"
 #include "BLI_math_vector.h"
+#include "BLI_task.hh"
 
 #ifdef WITH_OPENVDB
 #  include <openvdb/openvdb.h>
@@ -289,20 +291,28 @@ static Volume *modifyVolume(ModifierData *md, const ModifierEvalContext *ctx, Vo
 #ifdef WITH_OPENVDB
   VolumeDisplaceModifierData *vdmd = reinterpret_cast<VolumeDisplaceModifierData *>(md);
 
-  /* Iterate over all grids and displace them one by one. */
+  /* Get write access to all grids first, because that modifies the volume. */
   BKE_volume_load(volume, DEG_get_bmain(ctx->depsgraph));
   const int grid_amount = BKE_volume_num_grids(volume);
+  blender::Array<openvdb::GridBase::Ptr> grids(grid_amount);
+  blender::Array<VolumeGridType> grid_types(grid_amount);
   for (int grid_index = 0; grid_index < grid_amount; grid_index++) {
     VolumeGrid *volume_grid = BKE_volume_grid_get(volume, grid_index);
     BLI_assert(volume_grid != nullptr);
 
-    openvdb::GridBase::Ptr grid = BKE_volume_grid_openvdb_for_write(volume, volume_grid, false);
-    VolumeGridType grid_type = BKE_volume_grid_type(volume_grid);
-
-    DisplaceGridOp displace_grid_op{*grid, *vdmd, *ctx};
-    BKE_volume_grid_type_operation(grid_type, displace_grid_op);
+    grids[grid_index] = BKE_volume_grid_openvdb_for_write(volume, volume_grid, false);
+    grid_types[grid_index] = BKE_volume_grid_type(volume_grid);
   }
 
+  /* The grids are independent, so they are displaced in parallel. Every grid is processed with
+   * multiple threads as well, the task scheduler balances the work between them. */
+  blender::parallel_for(blender::IndexRange(grid_amount), 1, [&](blender::IndexRange range) {
+    for (const int grid_index : range) {
+      DisplaceGridOp displace_grid_op{*grids[grid_index], *vdmd, *ctx};
+      BKE_volume_grid_type_operation(grid_types[grid_index], displace_grid_op);
+    }
+  });
+
   return volume;
 #else
   UNUSED_VARS(md, ctx);
@@ -37,8 +37,9 @@
 
 #include "BLI_alloca.h"
 #include "BLI_bitmap.h"
-#include "BLI_kdtree.h"
 #include "BLI_math.h"
+#include "BLI_merge_by_distance.h"
+#include "BLI_task.h"
 
 #include "BLT_translation.h"
 
@@ -366,33 +367,119 @@ static void weld_assert_poly_len(const WeldPoly *wp, const WeldLoop *wloop)
 #endif
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Weld Context Chunks
+ *
+ * The vertex, edge and poly contexts only contain the elements affected by the weld, but finding
+ * them has to go over the whole mesh. This is done in parallel, in chunks of elements: every
+ * chunk counts its elements first, then writes them after the elements of all previous chunks.
+ * So the contexts are the same as when they are filled serially.
+ * \{ */
+
+#define WELD_CHUNK_SIZE 4096
+
+static uint weld_chunks_len(const uint elem_len)
+{
+  return (elem_len + WELD_CHUNK_SIZE - 1) / WELD_CHUNK_SIZE;
+}
+
+static void weld_chunk_range(const uint chunk, const uint elem_len, uint *r_start, uint *r_end)
+{
+  *r_start = chunk * WELD_CHUNK_SIZE;
+  *r_end = MIN2(*r_start + WELD_CHUNK_SIZE, elem_len);
+}
+
+static void weld_chunks_parallel(const uint chunks_len,
+                                 void *userdata,
+                                 TaskParallelRangeFunc func)
+{
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = chunks_len > 1;
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, (int)chunks_len, userdata, func, &settings);
+}
+
+/* Turn the element counts of the chunks into offsets, returns the total count. */
+static uint weld_chunks_offsets(uint *chunk_ofs, const uint chunks_len)
+{
+  uint ofs = 0;
+  for (uint chunk = 0; chunk < chunks_len; chunk++) {
+    const uint len = chunk_ofs[chunk];
+    chunk_ofs[chunk] = ofs;
+    ofs += len;
+  }
+  return ofs;
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Weld Vert API
  * \{ */
 
+typedef struct WeldVertCtxData {
+  uint mvert_len;
+  const uint *vert_dest_map;
+  uint *chunk_ofs;
+  WeldVert *wvert;
+} WeldVertCtxData;
+
+static void weld_vert_ctx_count_cb(void *__restrict userdata,
+                                   const int chunk,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  WeldVertCtxData *data = userdata;
+  uint start, end, len = 0;
+  weld_chunk_range((uint)chunk, data->mvert_len, &start, &end);
+  for (uint i = start; i < end; i++) {
+    if (data->vert_dest_map[i] != OUT_OF_CONTEXT) {
+      len++;
+    }
+  }
+  data->chunk_ofs[chunk] = len;
+}
+
+static void weld_vert_ctx_fill_cb(void *__restrict userdata,
+                                  const int chunk,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  WeldVertCtxData *data = userdata;
+  uint start, end;
+  weld_chunk_range((uint)chunk, data->mvert_len, &start, &end);
+  WeldVert *wv = &data->wvert[data->chunk_ofs[chunk]];
+  for (uint i = start; i < end; i++) {
+    const uint v_dest = data->vert_dest_map[i];
+    if (v_dest != OUT_OF_CONTEXT) {
+      wv->vert_dest = v_dest;
+      wv->vert_orig = i;
+      wv++;
+    }
+  }
+}
+
 static void weld_vert_ctx_alloc_and_setup(const uint mvert_len,
                                           uint *r_vert_dest_map,
                                           WeldVert **r_wvert,
                                           uint *r_wvert_len)
 {
   /* Vert Context. */
-  uint wvert_len = 0;
+  const uint chunks_len = weld_chunks_len(mvert_len);
+  WeldVertCtxData data = {
+      .mvert_len = mvert_len,
+      .vert_dest_map = r_vert_dest_map,
+      .chunk_ofs = MEM_mallocN(sizeof(uint) * chunks_len, __func__),
+  };
 
-  WeldVert *wvert, *wv;
-  wvert = MEM_mallocN(sizeof(*wvert) * mvert_len, __func__);
-  wv = &wvert[0];
+  weld_chunks_parallel(chunks_len, &data, weld_vert_ctx_count_cb);
+  const uint wvert_len = weld_chunks_offsets(data.chunk_ofs, chunks_len);
 
-  uint *v_dest_iter = &r_vert_dest_map[0];
-  for (uint i = 0; i < mvert_len; i++, v_dest_iter++) {
-    if (*v_dest_iter != OUT_OF_CONTEXT) {
-      wv->vert_dest = *v_dest_iter;
-      wv->vert_orig = i;
-      wv++;
-      wvert_len++;
-    }
-  }
+  data.wvert = MEM_mallocN(sizeof(*data.wvert) * wvert_len, __func__);
+  weld_chunks_parallel(chunks_len, &data, weld_vert_ctx_fill_cb);
 
-  *r_wvert = MEM_reallocN(wvert, sizeof(*wvert) * wvert_len);
+  MEM_freeN(data.chunk_ofs);
+
+  *r_wvert = data.wvert;
   *r_wvert_len = wvert_len;
 }
 
@@ -587,6 +674,64 @@ static void weld_edge_ctx_setup(const uint mvert_len,
   *r_edge_kiil_len = edge_kill_len;
 }
 
+typedef struct WeldEdgeCtxData {
+  const MEdge *medge;
+  uint medge_len;
+  const uint *vert_dest_map;
+  uint *chunk_ofs;
+  uint *edge_dest_map;
+  uint *edge_map;
+  WeldEdge *wedge;
+} WeldEdgeCtxData;
+
+BLI_INLINE bool weld_edge_is_ctx(const MEdge *me, const uint *vert_dest_map)
+{
+  return (vert_dest_map[me->v1] != OUT_OF_CONTEXT) || (vert_dest_map[me->v2] != OUT_OF_CONTEXT);
+}
+
+static void weld_edge_ctx_count_cb(void *__restrict userdata,
+                                   const int chunk,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  WeldEdgeCtxData *data = userdata;
+  uint start, end, len = 0;
+  weld_chunk_range((uint)chunk, data->medge_len, &start, &end);
+  for (uint i = start; i < end; i++) {
+    if (weld_edge_is_ctx(&data->medge[i], data->vert_dest_map)) {
+      len++;
+    }
+  }
+  data->chunk_ofs[chunk] = len;
+}
+
+static void weld_edge_ctx_fill_cb(void *__restrict userdata,
+                                  const int chunk,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  WeldEdgeCtxData *data = userdata;
+  uint start, end;
+  weld_chunk_range((uint)chunk, data->medge_len, &start, &end);
+  uint wedge_index = data->chunk_ofs[chunk];
+  for (uint i = start; i < end; i++) {
+    const MEdge *me = &data->medge[i];
+    if (weld_edge_is_ctx(me, data->vert_dest_map)) {
+      const uint v_dest_1 = data->vert_dest_map[me->v1];
+      const uint v_dest_2 = data->vert_dest_map[me->v2];
+      WeldEdge *we = &data->wedge[wedge_index];
+      we->vert_a = (v_dest_1 != OUT_OF_CONTEXT) ? v_dest_1 : me->v1;
+      we->vert_b = (v_dest_2 != OUT_OF_CONTEXT) ? v_dest_2 : me->v2;
+      we->edge_dest = OUT_OF_CONTEXT;
+      we->edge_orig = i;
+      data->edge_dest_map[i] = i;
+      data->edge_map[i] = wedge_index++;
+    }
+    else {
+      data->edge_dest_map[i] = OUT_OF_CONTEXT;
+      data->edge_map[i] = OUT_OF_CONTEXT;
+    }
+  }
+}
+
 static void weld_edge_ctx_alloc(const MEdge *medge,
                                 const uint medge_len,
                                 const uint *vert_dest_map,
@@ -596,39 +741,27 @@ static void weld_edge_ctx_alloc(const MEdge *medge,
                                 uint *r_wedge_len)
 {
   /* Edge Context. */
-  uint *edge_map = MEM_mallocN(sizeof(*edge_map) * medge_len, __func__);
-  uint wedge_len = 0;
+  const uint chunks_len = weld_chunks_len(medge_len);
+  WeldEdgeCtxData data = {
+      .medge = medge,
+      .medge_len = medge_len,
+      .vert_dest_map = vert_dest_map,
+      .chunk_ofs = MEM_mallocN(sizeof(uint) * chunks_len, __func__),
+      .edge_dest_map = r_edge_dest_map,
+      .edge_map = MEM_mallocN(sizeof(uint) * medge_len, __func__),
+  };
 
-  WeldEdge *wedge, *we;
-  wedge = MEM_mallocN(sizeof(*wedge) * medge_len, __func__);
-  we = &wedge[0];
+  weld_chunks_parallel(chunks_len, &data, weld_edge_ctx_count_cb);
+  const uint wedge_len = weld_chunks_offsets(data.chunk_ofs, chunks_len);
 
-  const MEdge *me = &medge[0];
-  uint *e_dest_iter = &r_edge_dest_map[0];
-  uint *iter = &edge_map[0];
-  for (uint i = 0; i < medge_len; i++, me++, iter++, e_dest_iter++) {
-    uint v1 = me->v1;
-    uint v2 = me->v2;
-    uint v_dest_1 = vert_dest_map[v1];
-    uint v_dest_2 = vert_dest_map[v2];
-    if ((v_dest_1 != OUT_OF_CONTEXT) || (v_dest_2 != OUT_OF_CONTEXT)) {
-      we->vert_a = (v_dest_1 != OUT_OF_CONTEXT) ? v_dest_1 : v1;
-      we->vert_b = (v_dest_2 != OUT_OF_CONTEXT) ? v_dest_2 : v2;
-      we->edge_dest = OUT_OF_CONTEXT;
-      we->edge_orig = i;
-      we++;
-      *e_dest_iter = i;
-      *iter = wedge_len++;
-    }
-    else {
-      *e_dest_iter = OUT_OF_CONTEXT;
-      *iter = OUT_OF_CONTEXT;
-    }
-  }
+  data.wedge = MEM_mallocN(sizeof(*data.wedge) * wedge_len, __func__);
+  weld_chunks_parallel(chunks_len, &data, weld_edge_ctx_fill_cb);
 
-  *r_wedge = MEM_reallocN(wedge, sizeof(*wedge) * wedge_len);
+  MEM_freeN(data.chunk_ofs);
+
+  *r_wedge = data.wedge;
   *r_wedge_len = wedge_len;
-  *r_edge_ctx_map = edge_map;
+  *r_edge_ctx_map = data.edge_map;
 }
 
 static void weld_edge_groups_setup(const uint medge_len,
@@ -823,108 +956,188 @@ static bool weld_iter_loop_of_poly_next(WeldLoopOfPolyIter *iter)
   return false;
 }
 
-static void weld_poly_loop_ctx_alloc(const MPoly *mpoly,
-                                     const uint mpoly_len,
-                                     const MLoop *mloop,
-                                     const uint mloop_len,
-                                     const uint *vert_dest_map,
-                                     const uint *edge_dest_map,
-                                     WeldMesh *r_weld_mesh)
-{
-  /* Loop/Poly Context. */
-  uint *loop_map = MEM_mallocN(sizeof(*loop_map) * mloop_len, __func__);
-  uint *poly_map = MEM_mallocN(sizeof(*poly_map) * mpoly_len, __func__);
-  uint wloop_len = 0;
-  uint wpoly_len = 0;
-  uint max_ctx_poly_len = 4;
-
-  WeldLoop *wloop, *wl;
-  wloop = MEM_mallocN(sizeof(*wloop) * mloop_len, __func__);
-  wl = &wloop[0];
+typedef struct WeldPolyCtxChunk {
+  /* Number of loops and polys in the context, turned into offsets before filling. */
+  uint loop_ofs;
+  uint poly_ofs;
+  uint maybe_new_poly;
+  uint max_ctx_poly_len;
+} WeldPolyCtxChunk;
+
+typedef struct WeldPolyCtxData {
+  const MPoly *mpoly;
+  uint mpoly_len;
+  const MLoop *mloop;
+  const uint *vert_dest_map;
+  const uint *edge_dest_map;
+  WeldPolyCtxChunk *chunks;
+  uint *loop_map;
+  uint *poly_map;
+  WeldLoop *wloop;
+  WeldPoly *wpoly;
+} WeldPolyCtxData;
 
-  WeldPoly *wpoly, *wp;
-  wpoly = MEM_mallocN(sizeof(*wpoly) * mpoly_len, __func__);
-  wp = &wpoly[0];
+/* Count the loops of the poly that are affected by the weld, and the ones of merged vertices. */
+static uint weld_poly_ctx_loops_len(const WeldPolyCtxData *data,
+                                    const MPoly *mp,
+                                    uint *r_vert_ctx_len)
+{
+  uint loops_len = 0;
+  uint vert_ctx_len = 0;
+  const MLoop *ml = &data->mloop[mp->loopstart];
+  for (uint j = mp->totloop; j--; ml++) {
+    const bool is_vert_ctx = data->vert_dest_map[ml->v] != OUT_OF_CONTEXT;
+    const bool is_edge_ctx = data->edge_dest_map[ml->e] != OUT_OF_CONTEXT;
+    if (is_vert_ctx) {
+      vert_ctx_len++;
+    }
+    if (is_vert_ctx || is_edge_ctx) {
+      loops_len++;
+    }
+  }
+  *r_vert_ctx_len = vert_ctx_len;
+  return loops_len;
+}
 
-  uint maybe_new_poly = 0;
+static void weld_poly_ctx_count_cb(void *__restrict userdata,
+                                   const int chunk,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  WeldPolyCtxData *data = userdata;
+  WeldPolyCtxChunk *poly_chunk = &data->chunks[chunk];
+  uint start, end;
+  weld_chunk_range((uint)chunk, data->mpoly_len, &start, &end);
+  poly_chunk->loop_ofs = 0;
+  poly_chunk->poly_ofs = 0;
+  poly_chunk->maybe_new_poly = 0;
+  poly_chunk->max_ctx_poly_len = 4;
+  for (uint i = start; i < end; i++) {
+    const MPoly *mp = &data->mpoly[i];
+    uint vert_ctx_len;
+    const uint loops_len = weld_poly_ctx_loops_len(data, mp, &vert_ctx_len);
+    if (loops_len == 0) {
+      continue;
+    }
+    poly_chunk->loop_ofs += loops_len;
+    poly_chunk->poly_ofs++;
+    const uint totloop = mp->totloop;
+    if (totloop > 5 && vert_ctx_len > 1) {
+      uint max_new = (totloop / 3) - 1;
+      vert_ctx_len /= 2;
+      poly_chunk->maybe_new_poly += MIN2(max_new, vert_ctx_len);
+      CLAMP_MIN(poly_chunk->max_ctx_poly_len, totloop);
+    }
+  }
+}
 
-  const MPoly *mp = &mpoly[0];
-  uint *iter = &poly_map[0];
-  uint *loop_map_iter = &loop_map[0];
-  for (uint i = 0; i < mpoly_len; i++, mp++, iter++) {
+static void weld_poly_ctx_fill_cb(void *__restrict userdata,
+                                  const int chunk,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  WeldPolyCtxData *data = userdata;
+  const WeldPolyCtxChunk *poly_chunk = &data->chunks[chunk];
+  uint start, end;
+  weld_chunk_range((uint)chunk, data->mpoly_len, &start, &end);
+  uint wloop_len = poly_chunk->loop_ofs;
+  uint wpoly_len = poly_chunk->poly_ofs;
+  for (uint i = start; i < end; i++) {
+    const MPoly *mp = &data->mpoly[i];
     const uint loopstart = mp->loopstart;
     const uint totloop = mp->totloop;
-
-    uint vert_ctx_len = 0;
+    const uint prev_wloop_len = wloop_len;
 
     uint l = loopstart;
-    uint prev_wloop_len = wloop_len;
-    const MLoop *ml = &mloop[l];
-    for (uint j = totloop; j--; l++, ml++, loop_map_iter++) {
-      uint v = ml->v;
-      uint e = ml->e;
-      uint v_dest = vert_dest_map[v];
-      uint e_dest = edge_dest_map[e];
-      bool is_vert_ctx = v_dest != OUT_OF_CONTEXT;
-      bool is_edge_ctx = e_dest != OUT_OF_CONTEXT;
-      if (is_vert_ctx) {
-        vert_ctx_len++;
-      }
+    const MLoop *ml = &data->mloop[l];
+    for (uint j = totloop; j--; l++, ml++) {
+      const uint v = ml->v;
+      const uint e = ml->e;
+      const uint v_dest = data->vert_dest_map[v];
+      const uint e_dest = data->edge_dest_map[e];
+      const bool is_vert_ctx = v_dest != OUT_OF_CONTEXT;
+      const bool is_edge_ctx = e_dest != OUT_OF_CONTEXT;
       if (is_vert_ctx || is_edge_ctx) {
+        WeldLoop *wl = &data->wloop[wloop_len];
         wl->vert = is_vert_ctx ? v_dest : v;
         wl->edge = is_edge_ctx ? e_dest : e;
         wl->loop_orig = l;
         wl->loop_skip_to = OUT_OF_CONTEXT;
-        wl++;
-
-        *loop_map_iter = wloop_len++;
+        data->loop_map[l] = wloop_len++;
       }
       else {
-        *loop_map_iter = OUT_OF_CONTEXT;
+        data->loop_map[l] = OUT_OF_CONTEXT;
       }
     }
     if (wloop_len != prev_wloop_len) {
-      uint loops_len = wloop_len - prev_wloop_len;
-
+      WeldPoly *wp = &data->wpoly[wpoly_len];
       wp->poly_dst = OUT_OF_CONTEXT;
       wp->poly_orig = i;
-      wp->loops.len = loops_len;
+      wp->loops.len = wloop_len - prev_wloop_len;
       wp->loops.ofs = prev_wloop_len;
       wp->loop_start = loopstart;
       wp->loop_end = loopstart + totloop - 1;
       wp->len = totloop;
-      wp++;
-
-      *iter = wpoly_len++;
-      if (totloop > 5 && vert_ctx_len > 1) {
-        uint max_new = (totloop / 3) - 1;
-        vert_ctx_len /= 2;
-        maybe_new_poly += MIN2(max_new, vert_ctx_len);
-        CLAMP_MIN(max_ctx_poly_len, totloop);
-      }
+      data->poly_map[i] = wpoly_len++;
     }
     else {
-      *iter = OUT_OF_CONTEXT;
+      data->poly_map[i] = OUT_OF_CONTEXT;
     }
   }
+}
+
+static void weld_poly_loop_ctx_alloc(const MPoly *mpoly,
+                                     const uint mpoly_len,
+                                     const MLoop *mloop,
+                                     const uint mloop_len,
+                                     const uint *vert_dest_map,
+                                     const uint *edge_dest_map,
+                                     WeldMesh *r_weld_mesh)
+{
+  /* Loop/Poly Context. */
+  const uint chunks_len = weld_chunks_len(mpoly_len);
+  WeldPolyCtxData data = {
+      .mpoly = mpoly,
+      .mpoly_len = mpoly_len,
+      .mloop = mloop,
+      .vert_dest_map = vert_dest_map,
+      .edge_dest_map = edge_dest_map,
+      .chunks = MEM_mallocN(sizeof(WeldPolyCtxChunk) * chunks_len, __func__),
+      .loop_map = MEM_mallocN(sizeof(uint) * mloop_len, __func__),
+      .poly_map = MEM_mallocN(sizeof(uint) * mpoly_len, __func__),
+  };
 
-  if (mpoly_len < (wpoly_len + maybe_new_poly)) {
-    WeldPoly *wpoly_tmp = wpoly;
-    wpoly = MEM_mallocN(sizeof(*wpoly) * ((size_t)wpoly_len + maybe_new_poly), __func__);
-    memcpy(wpoly, wpoly_tmp, sizeof(*wpoly) * wpoly_len);
-    MEM_freeN(wpoly_tmp);
+  weld_chunks_parallel(chunks_len, &data, weld_poly_ctx_count_cb);
+
+  uint wloop_len = 0;
+  uint wpoly_len = 0;
+  uint max_ctx_poly_len = 4;
+  uint maybe_new_poly = 0;
+  for (uint chunk = 0; chunk < chunks_len; chunk++) {
+    WeldPolyCtxChunk *poly_chunk = &data.chunks[chunk];
+    const uint chunk_wloop_len = poly_chunk->loop_ofs;
+    const uint chunk_wpoly_len = poly_chunk->poly_ofs;
+    poly_chunk->loop_ofs = wloop_len;
+    poly_chunk->poly_ofs = wpoly_len;
+    wloop_len += chunk_wloop_len;
+    wpoly_len += chunk_wpoly_len;
+    maybe_new_poly += poly_chunk->maybe_new_poly;
+    CLAMP_MIN(max_ctx_poly_len, poly_chunk->max_ctx_poly_len);
   }
 
-  WeldPoly *poly_new = &wpoly[wpoly_len];
+  /* Splitting polys adds the new polys after the ones of the context. */
+  data.wloop = MEM_mallocN(sizeof(*data.wloop) * wloop_len, __func__);
+  data.wpoly = MEM_mallocN(sizeof(*data.wpoly) * ((size_t)wpoly_len + maybe_new_poly), __func__);
+  weld_chunks_parallel(chunks_len, &data, weld_poly_ctx_fill_cb);
+
+  MEM_freeN(data.chunks);
 
-  r_weld_mesh->wloop = MEM_reallocN(wloop, sizeof(*wloop) * wloop_len);
-  r_weld_mesh->wpoly = wpoly;
-  r_weld_mesh->wpoly_new = poly_new;
+  r_weld_mesh->wloop = data.wloop;
+  r_weld_mesh->wpoly = data.wpoly;
+  r_weld_mesh->wpoly_new = &data.wpoly[wpoly_len];
   r_weld_mesh->wloop_len = wloop_len;
   r_weld_mesh->wpoly_len = wpoly_len;
   r_weld_mesh->wpoly_new_len = 0;
-  r_weld_mesh->loop_map = loop_map;
-  r_weld_mesh->poly_map = poly_map;
+  r_weld_mesh->loop_map = data.loop_map;
+  r_weld_mesh->poly_map = data.poly_map;
   r_weld_mesh->max_poly_len = max_ctx_poly_len;
 }
 
@@ -1694,18 +1907,12 @@ static Mesh *weldModifier_doWeld(WeldModifierData *wmd, const ModifierEvalContex
   }
 #else
   {
-    KDTree_3d *tree = BLI_kdtree_3d_new(v_mask ? v_mask_act : totvert);
     for (uint i = 0; i < totvert; i++) {
-      if (!v_mask || BLI_BITMAP_TEST(v_mask, i)) {
-        BLI_kdtree_3d_insert(tree, i, mvert[i].co);
-      }
       vert_dest_map[i] = OUT_OF_CONTEXT;
     }
-
-    BLI_kdtree_3d_balance(tree);
-    vert_kill_len = BLI_kdtree_3d_calc_duplicates_fast(
-        tree, wmd->merge_dist, false, (int *)vert_dest_map);
-    BLI_kdtree_3d_free(tree);
+    /* Vertices are merged into the one with the lowest index in range. */
+    vert_kill_len = BLI_merge_by_distance_3d(
+        mvert->co, totvert, sizeof(*mvert), v_mask, wmd->merge_dist, (int *)vert_dest_map);
   }
 #endif
   else {
@@ -18,6 +18,9 @@
 
 #include "FN_generic_value_map.hh"
 
+#include "BLI_set.hh"
+#include "BLI_vector.hh"
+
 #include "BKE_attribute_access.hh"
 #include "BKE_geometry_set.hh"
 #include "BKE_persistent_data_handle.hh"
@@ -42,6 +45,18 @@ using fn::CPPType;
 using fn::GMutablePointer;
 using fn::GValueMap;
 
+/**
+ * State that is shared between the evaluator and nodes that support lazy evaluation (see
+ * #bNodeType.geometry_node_execute_supports_laziness).
+ */
+struct GeoNodeLazyEvalState {
+  /* Inputs that the node requested during execution but which are not available yet. The node is
+   * executed again once they have been computed. */
+  Vector<StringRef> requested_inputs;
+  /* Outputs that are used by other nodes. */
+  Set<StringRef> required_outputs;
+};
+
 class GeoNodeExecParams {
  private:
   const bNode &node_;
@@ -49,18 +64,21 @@ class GeoNodeExecParams {
   GValueMap<StringRef> &output_values_;
   const PersistentDataHandleMap &handle_map_;
   const Object *self_object_;
+  GeoNodeLazyEvalState *lazy_state_;
 
  public:
   GeoNodeExecParams(const bNode &node,
                     GValueMap<StringRef> &input_values,
                     GValueMap<StringRef> &output_values,
                     const PersistentDataHandleMap &handle_map,
-                    const Object *self_object)
+                    const Object *self_object,
+                    GeoNodeLazyEvalState *lazy_state = nullptr)
       : node_(node),
         input_values_(input_values),
         output_values_(output_values),
         handle_map_(handle_map),
-        self_object_(self_object)
+        self_object_(self_object),
+        lazy_state_(lazy_state)
   {
   }
 
@@ -130,6 +148,27 @@ class GeoNodeExecParams {
     output_values_.add_new(identifier, std::forward<T>(value));
   }
 
+  /**
+   * Tell the evaluator that the input with the given identifier is required. Returns true when the
+   * value is not available yet. In that case the node has to return without setting any outputs
+   * and will be executed again once the input has been computed.
+   *
+   * This can only be used by nodes that support laziness.
+   */
+  bool lazy_require_input(StringRef identifier);
+
+  /**
+   * Returns true when the output with the given identifier is used by another node. Nodes that
+   * support laziness can skip computing outputs that are not required.
+   */
+  bool lazy_output_is_required(StringRef identifier) const
+  {
+    if (lazy_state_ == nullptr) {
+      return true;
+    }
+    return lazy_state_->required_outputs.contains(identifier);
+  }
+
   /**
    * Get the node that is currently being executed.
    */
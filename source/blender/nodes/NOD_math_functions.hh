@@ -51,6 +51,9 @@ const FloatMathOperationInfo *get_float_math_operation_info(const int operation)
  *
  * If separate instantiations are not desired, the callback can also take a function pointer with
  * the following signature as input instead: float (*math_function)(float a).
+ *
+ * The math functions only use single precision arithmetic, so that loops over many elements can
+ * be vectorized by the compiler.
  */
 template<typename Callback>
 inline bool try_dispatch_float_math_fl_to_fl(const int operation, Callback &&callback)
@@ -74,11 +77,11 @@ inline bool try_dispatch_float_math_fl_to_fl(const int operation, Callback &&cal
     case NODE_MATH_INV_SQRT:
       return dispatch([](float a) { return safe_inverse_sqrtf(a); });
     case NODE_MATH_ABSOLUTE:
-      return dispatch([](float a) { return fabs(a); });
+      return dispatch([](float a) { return fabsf(a); });
     case NODE_MATH_RADIANS:
-      return dispatch([](float a) { return (float)DEG2RAD(a); });
+      return dispatch([](float a) { return DEG2RADF(a); });
     case NODE_MATH_DEGREES:
-      return dispatch([](float a) { return (float)RAD2DEG(a); });
+      return dispatch([](float a) { return RAD2DEGF(a); });
     case NODE_MATH_SIGN:
       return dispatch([](float a) { return compatible_signf(a); });
     case NODE_MATH_ROUND:
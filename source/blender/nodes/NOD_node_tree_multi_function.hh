@@ -422,6 +422,9 @@ class DataTypeConversions {
                const CPPType &to_type,
                const void *from_value,
                void *to_value) const;
+
+  /* Convert all values at once, which is much faster than converting them one by one. */
+  void convert_to_uninitialized(const fn::GSpan from_span, fn::GMutableSpan to_span) const;
 };
 
 const DataTypeConversions &get_implicit_type_conversions();
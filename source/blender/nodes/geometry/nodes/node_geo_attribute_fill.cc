@@ -105,12 +105,9 @@ static void geo_node_attribute_fill_exec(GeoNodeExecParams params)
 {
   GeometrySet geometry_set = params.extract_input<GeometrySet>("Geometry");
 
-  if (geometry_set.has<MeshComponent>()) {
-    fill_attribute(geometry_set.get_component_for_write<MeshComponent>(), params);
-  }
-  if (geometry_set.has<PointCloudComponent>()) {
-    fill_attribute(geometry_set.get_component_for_write<PointCloudComponent>(), params);
-  }
+  geometry_set.modify_components_in_parallel(
+      {GeometryComponentType::Mesh, GeometryComponentType::PointCloud},
+      [&](GeometryComponent &component) { fill_attribute(component, params); });
 
   params.set_output("Geometry", geometry_set);
 }
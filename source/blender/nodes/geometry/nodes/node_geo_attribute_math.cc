@@ -26,6 +26,8 @@
 #include "DNA_mesh_types.h"
 #include "DNA_pointcloud_types.h"
 
+#include "FN_multi_function_builder.hh"
+
 #include "NOD_math_functions.hh"
 
 static bNodeSocketTemplate geo_node_attribute_math_in[] = {
@@ -66,25 +68,27 @@ static void geo_node_attribute_math_update(bNodeTree *UNUSED(ntree), bNode *node
 
 namespace blender::nodes {
 
-static void do_math_operation(const FloatReadAttribute &input_a,
-                              const FloatReadAttribute &input_b,
+/**
+ * The operation is executed with the same multi-function that is used by the math node, which has
+ * specialized code paths for inputs that are single values or arrays.
+ */
+static void do_math_operation(const fn::GVSpan input_a,
+                              const fn::GVSpan input_b,
                               FloatWriteAttribute result,
                               const int operation)
 {
-  const int size = input_a.size();
-
-  Span<float> span_a = input_a.get_span();
-  Span<float> span_b = input_b.get_span();
   MutableSpan<float> span_result = result.get_span();
 
   bool success = try_dispatch_float_math_fl_fl_to_fl(
-      operation, [&](auto math_function, const FloatMathOperationInfo &UNUSED(info)) {
-        for (const int i : IndexRange(size)) {
-          const float in1 = span_a[i];
-          const float in2 = span_b[i];
-          const float out = math_function(in1, in2);
-          span_result[i] = out;
-        }
+      operation, [&](auto math_function, const FloatMathOperationInfo &info) {
+        static fn::CustomMF_SI_SI_SO<float, float, float> fn{info.title_case_name,
+                                                             math_function};
+        fn::MFParamsBuilder fn_params{fn, span_result.size()};
+        fn_params.add_readonly_single_input(input_a);
+        fn_params.add_readonly_single_input(input_b);
+        fn_params.add_uninitialized_single_output(span_result);
+        fn::MFContextBuilder fn_context;
+        fn.call(IndexRange(span_result.size()), fn_params, fn_context);
       });
 
   result.apply_span();
@@ -111,43 +115,55 @@ static void attribute_math_calc(GeometryComponent &component, const GeoNodeExecP
   if (!attribute_result) {
     return;
   }
+  const int64_t size = attribute_result->size();
 
   GeometryNodeUseAttributeFlag flag = static_cast<GeometryNodeUseAttributeFlag>(node.custom2);
 
-  auto get_input_attribute = [&](GeometryNodeUseAttributeFlag use_flag,
-                                 StringRef attribute_socket_identifier,
-                                 StringRef value_socket_identifier) {
+  /* Constant inputs are passed on as single values, so that they don't have to be copied into an
+   * array first. */
+  ReadAttributePtr attribute_a;
+  ReadAttributePtr attribute_b;
+  float value_a = 0.0f;
+  float value_b = 0.0f;
+  auto get_input = [&](GeometryNodeUseAttributeFlag use_flag,
+                       StringRef attribute_socket_identifier,
+                       StringRef value_socket_identifier,
+                       ReadAttributePtr &r_attribute,
+                       float &r_value) -> std::optional<fn::GVSpan> {
     if (flag & use_flag) {
       const std::string attribute_name = params.get_input<std::string>(
           attribute_socket_identifier);
-      return component.attribute_try_get_for_read(attribute_name, result_domain, result_type);
+      r_attribute = component.attribute_try_get_for_read(
+          attribute_name, result_domain, result_type);
+      if (!r_attribute) {
+        return {};
+      }
+      return fn::GVSpan(r_attribute->get_span());
     }
-    const float value = params.get_input<float>(value_socket_identifier);
-    return component.attribute_get_constant_for_read(result_domain, result_type, &value);
+    r_value = params.get_input<float>(value_socket_identifier);
+    return fn::GVSpan::FromSingle(CPPType::get<float>(), &r_value, size);
   };
 
-  ReadAttributePtr attribute_a = get_input_attribute(GEO_NODE_USE_ATTRIBUTE_A, "Attribute A", "A");
-  ReadAttributePtr attribute_b = get_input_attribute(GEO_NODE_USE_ATTRIBUTE_B, "Attribute B", "B");
+  const std::optional<fn::GVSpan> input_a = get_input(
+      GEO_NODE_USE_ATTRIBUTE_A, "Attribute A", "A", attribute_a, value_a);
+  const std::optional<fn::GVSpan> input_b = get_input(
+      GEO_NODE_USE_ATTRIBUTE_B, "Attribute B", "B", attribute_b, value_b);
 
-  if (!attribute_a || !attribute_b) {
+  if (!input_a || !input_b) {
     /* Attribute wasn't found. */
     return;
   }
 
-  do_math_operation(
-      std::move(attribute_a), std::move(attribute_b), std::move(attribute_result), operation);
+  do_math_operation(*input_a, *input_b, std::move(attribute_result), operation);
 }
 
 static void geo_node_attribute_math_exec(GeoNodeExecParams params)
 {
   GeometrySet geometry_set = params.extract_input<GeometrySet>("Geometry");
 
-  if (geometry_set.has<MeshComponent>()) {
-    attribute_math_calc(geometry_set.get_component_for_write<MeshComponent>(), params);
-  }
-  if (geometry_set.has<PointCloudComponent>()) {
-    attribute_math_calc(geometry_set.get_component_for_write<PointCloudComponent>(), params);
-  }
+  geometry_set.modify_components_in_parallel(
+      {GeometryComponentType::Mesh, GeometryComponentType::PointCloud},
+      [&](GeometryComponent &component) { attribute_math_calc(component, params); });
 
   params.set_output("Geometry", geometry_set);
 }
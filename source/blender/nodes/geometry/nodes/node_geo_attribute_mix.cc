@@ -47,15 +47,17 @@ static void do_mix_operation_float(const int blend_mode,
                                    const FloatReadAttribute &inputs_b,
                                    FloatWriteAttribute &results)
 {
-  const int size = results.size();
-  for (const int i : IndexRange(size)) {
-    const float factor = factors[i];
-    float3 a{inputs_a[i]};
-    const float3 b{inputs_b[i]};
-    ramp_blend(blend_mode, a, factor, b);
-    const float result = a.length();
-    results.set(i, result);
+  Span<float> factors_span = factors.get_span();
+  Span<float> inputs_a_span = inputs_a.get_span();
+  Span<float> inputs_b_span = inputs_b.get_span();
+  MutableSpan<float> results_span = results.get_span();
+  for (const int i : results_span.index_range()) {
+    float3 a{inputs_a_span[i]};
+    const float3 b{inputs_b_span[i]};
+    ramp_blend(blend_mode, a, factors_span[i], b);
+    results_span[i] = a.length();
   }
+  results.apply_span();
 }
 
 static void do_mix_operation_float3(const int blend_mode,
@@ -64,14 +66,16 @@ static void do_mix_operation_float3(const int blend_mode,
                                     const Float3ReadAttribute &inputs_b,
                                     Float3WriteAttribute &results)
 {
-  const int size = results.size();
-  for (const int i : IndexRange(size)) {
-    const float factor = factors[i];
-    float3 a = inputs_a[i];
-    const float3 b = inputs_b[i];
-    ramp_blend(blend_mode, a, factor, b);
-    results.set(i, a);
+  Span<float> factors_span = factors.get_span();
+  Span<float3> inputs_a_span = inputs_a.get_span();
+  Span<float3> inputs_b_span = inputs_b.get_span();
+  MutableSpan<float3> results_span = results.get_span();
+  for (const int i : results_span.index_range()) {
+    float3 a = inputs_a_span[i];
+    ramp_blend(blend_mode, a, factors_span[i], inputs_b_span[i]);
+    results_span[i] = a;
   }
+  results.apply_span();
 }
 
 static void do_mix_operation_color4f(const int blend_mode,
@@ -80,14 +84,16 @@ static void do_mix_operation_color4f(const int blend_mode,
                                      const Color4fReadAttribute &inputs_b,
                                      Color4fWriteAttribute &results)
 {
-  const int size = results.size();
-  for (const int i : IndexRange(size)) {
-    const float factor = factors[i];
-    Color4f a = inputs_a[i];
-    const Color4f b = inputs_b[i];
-    ramp_blend(blend_mode, a, factor, b);
-    results.set(i, a);
+  Span<float> factors_span = factors.get_span();
+  Span<Color4f> inputs_a_span = inputs_a.get_span();
+  Span<Color4f> inputs_b_span = inputs_b.get_span();
+  MutableSpan<Color4f> results_span = results.get_span();
+  for (const int i : results_span.index_range()) {
+    Color4f a = inputs_a_span[i];
+    ramp_blend(blend_mode, a, factors_span[i], inputs_b_span[i]);
+    results_span[i] = a;
   }
+  results.apply_span();
 }
 
 static void do_mix_operation(const CustomDataType result_type,
@@ -170,12 +176,9 @@ static void geo_node_attribute_mix_exec(GeoNodeExecParams params)
 {
   GeometrySet geometry_set = params.extract_input<GeometrySet>("Geometry");
 
-  if (geometry_set.has<MeshComponent>()) {
-    attribute_mix_calc(geometry_set.get_component_for_write<MeshComponent>(), params);
-  }
-  if (geometry_set.has<PointCloudComponent>()) {
-    attribute_mix_calc(geometry_set.get_component_for_write<PointCloudComponent>(), params);
-  }
+  geometry_set.modify_components_in_parallel(
+      {GeometryComponentType::Mesh, GeometryComponentType::PointCloud},
+      [&](GeometryComponent &component) { attribute_mix_calc(component, params); });
 
   params.set_output("Geometry", geometry_set);
 }
@@ -14,6 +14,8 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include "BLI_task.hh"
+
 #include "BKE_mesh.h"
 #include "BKE_mesh_runtime.h"
 #include "BKE_pointcloud.h"
@@ -36,67 +38,75 @@ static bNodeSocketTemplate geo_node_join_geometry_out[] = {
 
 namespace blender::nodes {
 
+/* Number of elements that are copied by one task when joining large components. */
+static constexpr int64_t join_grain_size = 4096;
+
 static Mesh *join_mesh_topology_and_builtin_attributes(Span<const MeshComponent *> src_components)
 {
-  int totverts = 0;
-  int totloops = 0;
-  int totedges = 0;
-  int totpolys = 0;
-
-  for (const MeshComponent *mesh_component : src_components) {
-    const Mesh *mesh = mesh_component->get_for_read();
-    totverts += mesh->totvert;
-    totloops += mesh->totloop;
-    totedges += mesh->totedge;
-    totpolys += mesh->totpoly;
+  /* Compute the offsets of every component in the joined mesh first, so that all components can
+   * be copied in parallel. */
+  Array<int> vert_offsets(src_components.size() + 1);
+  Array<int> edge_offsets(src_components.size() + 1);
+  Array<int> loop_offsets(src_components.size() + 1);
+  Array<int> poly_offsets(src_components.size() + 1);
+  vert_offsets[0] = edge_offsets[0] = loop_offsets[0] = poly_offsets[0] = 0;
+  for (const int i : src_components.index_range()) {
+    const Mesh *mesh = src_components[i]->get_for_read();
+    vert_offsets[i + 1] = vert_offsets[i] + mesh->totvert;
+    edge_offsets[i + 1] = edge_offsets[i] + mesh->totedge;
+    loop_offsets[i + 1] = loop_offsets[i] + mesh->totloop;
+    poly_offsets[i + 1] = poly_offsets[i] + mesh->totpoly;
   }
 
   const Mesh *first_input_mesh = src_components[0]->get_for_read();
-  Mesh *new_mesh = BKE_mesh_new_nomain(totverts, totedges, 0, totloops, totpolys);
+  Mesh *new_mesh = BKE_mesh_new_nomain(vert_offsets.last(),
+                                       edge_offsets.last(),
+                                       0,
+                                       loop_offsets.last(),
+                                       poly_offsets.last());
   BKE_mesh_copy_settings(new_mesh, first_input_mesh);
 
-  int vert_offset = 0;
-  int loop_offset = 0;
-  int edge_offset = 0;
-  int poly_offset = 0;
-  for (const MeshComponent *mesh_component : src_components) {
-    const Mesh *mesh = mesh_component->get_for_read();
-    if (mesh == nullptr) {
-      continue;
-    }
-
-    for (const int i : IndexRange(mesh->totvert)) {
-      const MVert &old_vert = mesh->mvert[i];
-      MVert &new_vert = new_mesh->mvert[vert_offset + i];
-      new_vert = old_vert;
+  parallel_for(src_components.index_range(), 1, [&](IndexRange component_range) {
+    for (const int component_index : component_range) {
+      const Mesh *mesh = src_components[component_index]->get_for_read();
+      const int vert_offset = vert_offsets[component_index];
+      const int edge_offset = edge_offsets[component_index];
+      const int loop_offset = loop_offsets[component_index];
+      const int poly_offset = poly_offsets[component_index];
+
+      parallel_for(IndexRange(mesh->totvert), join_grain_size, [&](IndexRange range) {
+        for (const int i : range) {
+          new_mesh->mvert[vert_offset + i] = mesh->mvert[i];
+        }
+      });
+      parallel_for(IndexRange(mesh->totedge), join_grain_size, [&](IndexRange range) {
+        for (const int i : range) {
+          const MEdge &old_edge = mesh->medge[i];
+          MEdge &new_edge = new_mesh->medge[edge_offset + i];
+          new_edge = old_edge;
+          new_edge.v1 += vert_offset;
+          new_edge.v2 += vert_offset;
+        }
+      });
+      parallel_for(IndexRange(mesh->totloop), join_grain_size, [&](IndexRange range) {
+        for (const int i : range) {
+          const MLoop &old_loop = mesh->mloop[i];
+          MLoop &new_loop = new_mesh->mloop[loop_offset + i];
+          new_loop = old_loop;
+          new_loop.v += vert_offset;
+          new_loop.e += edge_offset;
+        }
+      });
+      parallel_for(IndexRange(mesh->totpoly), join_grain_size, [&](IndexRange range) {
+        for (const int i : range) {
+          const MPoly &old_poly = mesh->mpoly[i];
+          MPoly &new_poly = new_mesh->mpoly[poly_offset + i];
+          new_poly = old_poly;
+          new_poly.loopstart += loop_offset;
+        }
+      });
     }
-
-    for (const int i : IndexRange(mesh->totedge)) {
-      const MEdge &old_edge = mesh->medge[i];
-      MEdge &new_edge = new_mesh->medge[edge_offset + i];
-      new_edge = old_edge;
-      new_edge.v1 += vert_offset;
-      new_edge.v2 += vert_offset;
-    }
-    for (const int i : IndexRange(mesh->totloop)) {
-      const MLoop &old_loop = mesh->mloop[i];
-      MLoop &new_loop = new_mesh->mloop[loop_offset + i];
-      new_loop = old_loop;
-      new_loop.v += vert_offset;
-      new_loop.e += edge_offset;
-    }
-    for (const int i : IndexRange(mesh->totpoly)) {
-      const MPoly &old_poly = mesh->mpoly[i];
-      MPoly &new_poly = new_mesh->mpoly[poly_offset + i];
-      new_poly = old_poly;
-      new_poly.loopstart += loop_offset;
-    }
-
-    vert_offset += mesh->totvert;
-    loop_offset += mesh->totloop;
-    edge_offset += mesh->totedge;
-    poly_offset += mesh->totpoly;
-  }
+  });
 
   return new_mesh;
 }
@@ -146,19 +156,28 @@ static void fill_new_attribute(Span<const GeometryComponent *> src_components,
   const CPPType *cpp_type = bke::custom_data_type_to_cpp_type(data_type);
   BLI_assert(cpp_type != nullptr);
 
+  Array<int> offsets(src_components.size());
   int offset = 0;
-  for (const GeometryComponent *component : src_components) {
-    const int domain_size = component->attribute_domain_size(domain);
-    ReadAttributePtr read_attribute = component->attribute_get_for_read(
-        attribute_name, domain, data_type, nullptr);
-
-    fn::GSpan src_span = read_attribute->get_span();
-    const void *src_buffer = src_span.data();
-    void *dst_buffer = dst_span[offset];
-    cpp_type->copy_to_initialized_n(src_buffer, dst_buffer, domain_size);
-
-    offset += domain_size;
+  for (const int i : src_components.index_range()) {
+    offsets[i] = offset;
+    offset += src_components[i]->attribute_domain_size(domain);
   }
+
+  parallel_for(src_components.index_range(), 1, [&](IndexRange component_range) {
+    for (const int component_index : component_range) {
+      const GeometryComponent *component = src_components[component_index];
+      const int domain_size = component->attribute_domain_size(domain);
+      ReadAttributePtr read_attribute = component->attribute_get_for_read(
+          attribute_name, domain, data_type, nullptr);
+
+      fn::GSpan src_span = read_attribute->get_span();
+      fn::GMutableSpan dst_slice = dst_span.slice(offsets[component_index], domain_size);
+      parallel_for(IndexRange(domain_size), join_grain_size, [&](IndexRange range) {
+        cpp_type->copy_to_initialized_n(
+            src_span[range.start()], dst_slice[range.start()], range.size());
+      });
+    }
+  });
 }
 
 static void join_attributes(Span<const GeometryComponent *> src_components,
@@ -170,6 +189,17 @@ static void join_attributes(Span<const GeometryComponent *> src_components,
     attribute_names.remove(name);
   }
 
+  struct JoinedAttribute {
+    std::string name;
+    CustomDataType data_type;
+    AttributeDomain domain;
+    WriteAttributePtr attribute;
+    fn::GMutableSpan span;
+  };
+
+  /* Creating the attributes changes the result component, so it is done before the values of all
+   * attributes are copied in parallel. */
+  Vector<JoinedAttribute> joined_attributes;
   for (const std::string &attribute_name : attribute_names) {
     CustomDataType data_type;
     AttributeDomain domain;
@@ -183,8 +213,20 @@ static void join_attributes(Span<const GeometryComponent *> src_components,
       continue;
     }
     fn::GMutableSpan dst_span = write_attribute->get_span();
-    fill_new_attribute(src_components, attribute_name, data_type, domain, dst_span);
-    write_attribute->apply_span();
+    joined_attributes.append(
+        {attribute_name, data_type, domain, std::move(write_attribute), dst_span});
+  }
+
+  parallel_for(joined_attributes.index_range(), 1, [&](IndexRange range) {
+    for (const int i : range) {
+      const JoinedAttribute &joined = joined_attributes[i];
+      fill_new_attribute(
+          src_components, joined.name, joined.data_type, joined.domain, joined.span);
+    }
+  });
+
+  for (JoinedAttribute &joined : joined_attributes) {
+    joined.attribute->apply_span();
   }
 }
 
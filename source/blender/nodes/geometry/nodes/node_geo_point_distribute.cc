@@ -14,11 +14,18 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+#include "BLI_array.hh"
 #include "BLI_float3.hh"
 #include "BLI_hash.h"
+#include "BLI_map.hh"
 #include "BLI_math_vector.h"
 #include "BLI_rand.hh"
 #include "BLI_span.hh"
+#include "BLI_task.hh"
 
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
@@ -35,6 +42,7 @@ static bNodeSocketTemplate geo_node_point_distribute_in[] = {
     {SOCK_GEOMETRY, N_("Geometry")},
     {SOCK_FLOAT, N_("Density"), 10.0f, 0.0f, 0.0f, 0.0f, 0.0f, 100000.0f, PROP_NONE},
     {SOCK_STRING, N_("Density Attribute")},
+    {SOCK_FLOAT, N_("Distance Min"), 0.1f, 0.0f, 0.0f, 0.0f, 0.0f, 100000.0f, PROP_DISTANCE},
     {-1, ""},
 };
 
@@ -45,51 +53,246 @@ static bNodeSocketTemplate geo_node_point_distribute_out[] = {
 
 namespace blender::nodes {
 
-static Vector<float3> scatter_points_from_mesh(const Mesh *mesh,
-                                               const float density,
-                                               const FloatReadAttribute &density_factors)
+static void geo_node_point_distribute_update(bNodeTree *UNUSED(tree), bNode *node)
+{
+  bNodeSocket *distance_min_socket = (bNodeSocket *)BLI_findlink(&node->inputs, 3);
+
+  GeometryNodePointDistributeMethod method = (GeometryNodePointDistributeMethod)node->custom1;
+
+  nodeSetSocketAvailability(distance_min_socket, method == GEO_NODE_POINT_DISTRIBUTE_POISSON);
+}
+
+struct ScatteredPoints {
+  Array<float3> positions;
+  /* Barycentric coordinates of the points in the triangle they have been scattered on. Together
+   * with the triangle indices, these can be used to interpolate mesh attributes later on. */
+  Array<float3> bary_coords;
+  Array<int> looptri_indices;
+};
+
+/**
+ * Every triangle uses its own random number generator, that is seeded with the triangle index.
+ * The first random number decides how many points are added to the triangle, the following ones
+ * are used for the barycentric coordinates. That makes the result independent of the order in
+ * which triangles are processed.
+ */
+static int looptri_point_amount(const Mesh &mesh,
+                                const MLoopTri &looptri,
+                                const float density,
+                                const Span<float> density_factors,
+                                RandomNumberGenerator &looptri_rng)
+{
+  const int v0_index = mesh.mloop[looptri.tri[0]].v;
+  const int v1_index = mesh.mloop[looptri.tri[1]].v;
+  const int v2_index = mesh.mloop[looptri.tri[2]].v;
+  const float3 v0_pos = mesh.mvert[v0_index].co;
+  const float3 v1_pos = mesh.mvert[v1_index].co;
+  const float3 v2_pos = mesh.mvert[v2_index].co;
+  const float v0_density_factor = std::max(0.0f, density_factors[v0_index]);
+  const float v1_density_factor = std::max(0.0f, density_factors[v1_index]);
+  const float v2_density_factor = std::max(0.0f, density_factors[v2_index]);
+  const float looptri_density_factor = (v0_density_factor + v1_density_factor +
+                                        v2_density_factor) /
+                                       3.0f;
+  const float area = area_tri_v3(v0_pos, v1_pos, v2_pos);
+
+  const float points_amount_fl = area * density * looptri_density_factor;
+  const float add_point_probability = fractf(points_amount_fl);
+  const bool add_point = add_point_probability > looptri_rng.get_float();
+  return (int)points_amount_fl + (int)add_point;
+}
+
+static ScatteredPoints scatter_points_from_mesh(const Mesh *mesh,
+                                                const float density,
+                                                const Span<float> density_factors)
 {
   /* This only updates a cache and can be considered to be logically const. */
   const MLoopTri *looptris = BKE_mesh_runtime_looptri_ensure(const_cast<Mesh *>(mesh));
   const int looptris_len = BKE_mesh_runtime_looptri_len(mesh);
 
-  Vector<float3> points;
-
-  for (const int looptri_index : IndexRange(looptris_len)) {
-    const MLoopTri &looptri = looptris[looptri_index];
-    const int v0_index = mesh->mloop[looptri.tri[0]].v;
-    const int v1_index = mesh->mloop[looptri.tri[1]].v;
-    const int v2_index = mesh->mloop[looptri.tri[2]].v;
-    const float3 v0_pos = mesh->mvert[v0_index].co;
-    const float3 v1_pos = mesh->mvert[v1_index].co;
-    const float3 v2_pos = mesh->mvert[v2_index].co;
-    const float v0_density_factor = std::max(0.0f, density_factors[v0_index]);
-    const float v1_density_factor = std::max(0.0f, density_factors[v1_index]);
-    const float v2_density_factor = std::max(0.0f, density_factors[v2_index]);
-    const float looptri_density_factor = (v0_density_factor + v1_density_factor +
-                                          v2_density_factor) /
-                                         3.0f;
-    const float area = area_tri_v3(v0_pos, v1_pos, v2_pos);
-
-    const int looptri_seed = BLI_hash_int(looptri_index);
-    RandomNumberGenerator looptri_rng(looptri_seed);
-
-    const float points_amount_fl = area * density * looptri_density_factor;
-    const float add_point_probability = fractf(points_amount_fl);
-    const bool add_point = add_point_probability > looptri_rng.get_float();
-    const int point_amount = (int)points_amount_fl + (int)add_point;
-
-    for (int i = 0; i < point_amount; i++) {
-      const float3 bary_coords = looptri_rng.get_barycentric_coordinates();
-      float3 point_pos;
-      interp_v3_v3v3v3(point_pos, v0_pos, v1_pos, v2_pos, bary_coords);
-      points.append(point_pos);
+  /* Count the points on every triangle first, so that every triangle knows where to write its
+   * points. The output is the same no matter how many threads are used. */
+  Array<int> offsets(looptris_len + 1);
+  parallel_for(IndexRange(looptris_len), 512, [&](IndexRange range) {
+    for (const int looptri_index : range) {
+      RandomNumberGenerator looptri_rng(BLI_hash_int(looptri_index));
+      offsets[looptri_index] = looptri_point_amount(
+          *mesh, looptris[looptri_index], density, density_factors, looptri_rng);
     }
+  });
+  int points_len = 0;
+  for (const int looptri_index : IndexRange(looptris_len)) {
+    const int amount = offsets[looptri_index];
+    offsets[looptri_index] = points_len;
+    points_len += amount;
   }
+  offsets[looptris_len] = points_len;
+
+  ScatteredPoints points;
+  points.positions = Array<float3>(points_len);
+  points.bary_coords = Array<float3>(points_len);
+  points.looptri_indices = Array<int>(points_len);
+
+  parallel_for(IndexRange(looptris_len), 512, [&](IndexRange range) {
+    for (const int looptri_index : range) {
+      const IndexRange point_range(offsets[looptri_index],
+                                   offsets[looptri_index + 1] - offsets[looptri_index]);
+      if (point_range.size() == 0) {
+        continue;
+      }
+      const MLoopTri &looptri = looptris[looptri_index];
+      const float3 v0_pos = mesh->mvert[mesh->mloop[looptri.tri[0]].v].co;
+      const float3 v1_pos = mesh->mvert[mesh->mloop[looptri.tri[1]].v].co;
+      const float3 v2_pos = mesh->mvert[mesh->mloop[looptri.tri[2]].v].co;
+
+      RandomNumberGenerator looptri_rng(BLI_hash_int(looptri_index));
+      /* Skip the random number that has been used to compute the amount of points. */
+      looptri_rng.get_float();
+
+      for (const int point_index : point_range) {
+        const float3 bary_coords = looptri_rng.get_barycentric_coordinates();
+        interp_v3_v3v3v3(points.positions[point_index], v0_pos, v1_pos, v2_pos, bary_coords);
+        points.bary_coords[point_index] = bary_coords;
+        points.looptri_indices[point_index] = looptri_index;
+      }
+    }
+  });
 
   return points;
 }
 
+struct PoissonGridCell {
+  int x, y, z;
+
+  uint64_t hash() const
+  {
+    return ((uint64_t)(uint32_t)x * 435109) ^ ((uint64_t)(uint32_t)y * 380867) ^
+           ((uint64_t)(uint32_t)z * 1059217);
+  }
+
+  friend bool operator==(const PoissonGridCell &a, const PoissonGridCell &b)
+  {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+  }
+
+  friend bool operator<(const PoissonGridCell &a, const PoissonGridCell &b)
+  {
+    return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+  }
+
+  /* Neighboring cells never have the same phase. */
+  int phase() const
+  {
+    auto mod3 = [](const int value) { return ((value % 3) + 3) % 3; };
+    return mod3(x) * 9 + mod3(y) * 3 + mod3(z);
+  }
+};
+
+/**
+ * Remove points that are closer than the minimum distance to a point that is kept. The points are
+ * put into a grid whose cells are as large as the minimum distance, so that only the neighboring
+ * cells have to be checked for every point. The cells are processed in 27 phases, such that cells
+ * that are processed at the same time are never neighbors of each other. Within a cell, the points
+ * are processed in the order they have been scattered in. Therefore, the result is deterministic.
+ */
+static void eliminate_points_poisson_disk(ScatteredPoints &points, const float distance_min)
+{
+  const int points_len = points.positions.size();
+  if (distance_min <= 0.0f || points_len == 0) {
+    return;
+  }
+  const float cell_size_inv = 1.0f / distance_min;
+  const float distance_min_sq = distance_min * distance_min;
+
+  /* Clamp the cell coordinates, so that large extents or a tiny distance can't overflow them,
+   * also when the neighbors are looked up. Clamping keeps neighboring points in the same or
+   * neighboring cells, it only makes the outermost cells larger. */
+  const float cell_max = (float)(1 << 30);
+  auto cell_coordinate = [&](const float value) {
+    return (int)clamp_f(floorf(value * cell_size_inv), -cell_max, cell_max);
+  };
+
+  Array<PoissonGridCell> cells(points_len);
+  parallel_for(IndexRange(points_len), 4096, [&](IndexRange range) {
+    for (const int i : range) {
+      const float3 &position = points.positions[i];
+      cells[i] = {cell_coordinate(position.x),
+                  cell_coordinate(position.y),
+                  cell_coordinate(position.z)};
+    }
+  });
+
+  /* Sort the points by cell, while keeping the original order within every cell. */
+  Array<int> sorted_indices(points_len);
+  std::iota(sorted_indices.begin(), sorted_indices.end(), 0);
+  parallel_sort(sorted_indices.begin(), sorted_indices.end(), [&](const int a, const int b) {
+    return cells[a] < cells[b] || (cells[a] == cells[b] && a < b);
+  });
+
+  Map<PoissonGridCell, IndexRange> cell_ranges;
+  Array<Vector<IndexRange>> cell_ranges_by_phase(27);
+  int cell_start = 0;
+  for (const int i : IndexRange(1, points_len)) {
+    const int start_index = sorted_indices[cell_start];
+    if (i < points_len && cells[sorted_indices[i]] == cells[start_index]) {
+      continue;
+    }
+    const IndexRange cell_range(cell_start, i - cell_start);
+    cell_ranges.add_new(cells[start_index], cell_range);
+    cell_ranges_by_phase[cells[start_index].phase()].append(cell_range);
+    cell_start = i;
+  }
+
+  Array<bool> keep(points_len, false);
+  for (const Vector<IndexRange> &phase_cell_ranges : cell_ranges_by_phase) {
+    parallel_for(phase_cell_ranges.index_range(), 64, [&](IndexRange range) {
+      for (const IndexRange cell_range : phase_cell_ranges.as_span().slice(range)) {
+        for (const int point_index : sorted_indices.as_span().slice(cell_range)) {
+          const float3 &position = points.positions[point_index];
+          const PoissonGridCell &cell = cells[point_index];
+          bool too_close = false;
+          for (int dx = -1; dx <= 1 && !too_close; dx++) {
+            for (int dy = -1; dy <= 1 && !too_close; dy++) {
+              for (int dz = -1; dz <= 1 && !too_close; dz++) {
+                const PoissonGridCell neighbor{cell.x + dx, cell.y + dy, cell.z + dz};
+                const IndexRange *neighbor_range = cell_ranges.lookup_ptr(neighbor);
+                if (neighbor_range == nullptr) {
+                  continue;
+                }
+                for (const int other_index : sorted_indices.as_span().slice(*neighbor_range)) {
+                  if (keep[other_index] &&
+                      float3::distance_squared(position, points.positions[other_index]) <
+                          distance_min_sq) {
+                    too_close = true;
+                    break;
+                  }
+                }
+              }
+            }
+          }
+          keep[point_index] = !too_close;
+        }
+      }
+    });
+  }
+
+  ScatteredPoints kept_points;
+  const int kept_len = std::count(keep.begin(), keep.end(), true);
+  kept_points.positions = Array<float3>(kept_len);
+  kept_points.bary_coords = Array<float3>(kept_len);
+  kept_points.looptri_indices = Array<int>(kept_len);
+  int kept_index = 0;
+  for (const int i : IndexRange(points_len)) {
+    if (keep[i]) {
+      kept_points.positions[kept_index] = points.positions[i];
+      kept_points.bary_coords[kept_index] = points.bary_coords[i];
+      kept_points.looptri_indices[kept_index] = points.looptri_indices[i];
+      kept_index++;
+    }
+  }
+  points = std::move(kept_points);
+}
+
 static void geo_node_point_distribute_exec(GeoNodeExecParams params)
 {
   GeometrySet geometry_set = params.extract_input<GeometrySet>("Geometry");
@@ -100,6 +303,8 @@ static void geo_node_point_distribute_exec(GeoNodeExecParams params)
     return;
   }
 
+  const GeometryNodePointDistributeMethod distribute_method =
+      static_cast<GeometryNodePointDistributeMethod>(params.node().custom1);
   const float density = params.extract_input<float>("Density");
   const std::string density_attribute = params.extract_input<std::string>("Density Attribute");
 
@@ -114,16 +319,34 @@ static void geo_node_point_distribute_exec(GeoNodeExecParams params)
   const FloatReadAttribute density_factors = mesh_component.attribute_get_for_read<float>(
       density_attribute, ATTR_DOMAIN_POINT, 1.0f);
 
-  Vector<float3> points = scatter_points_from_mesh(mesh_in, density, density_factors);
-
-  PointCloud *pointcloud = BKE_pointcloud_new_nomain(points.size());
-  memcpy(pointcloud->co, points.data(), sizeof(float3) * points.size());
-  for (const int i : points.index_range()) {
-    *(float3 *)(pointcloud->co + i) = points[i];
-    pointcloud->radius[i] = 0.05f;
+  ScatteredPoints points = scatter_points_from_mesh(
+      mesh_in, density, density_factors.get_span());
+  if (distribute_method == GEO_NODE_POINT_DISTRIBUTE_POISSON) {
+    const float distance_min = params.extract_input<float>("Distance Min");
+    eliminate_points_poisson_disk(points, distance_min);
   }
 
+  const int points_len = points.positions.size();
+  PointCloud *pointcloud = BKE_pointcloud_new_nomain(points_len);
+  memcpy(pointcloud->co, points.positions.data(), sizeof(float3) * points_len);
+  std::fill_n(pointcloud->radius, points_len, 0.05f);
   geometry_set_out.replace_pointcloud(pointcloud);
+
+  PointCloudComponent &point_component =
+      geometry_set_out.get_component_for_write<PointCloudComponent>();
+  WriteAttributePtr bary_coord_attribute = point_component.attribute_try_ensure_for_write(
+      "bary_coord", ATTR_DOMAIN_POINT, CD_PROP_FLOAT3);
+  if (bary_coord_attribute) {
+    bary_coord_attribute->get_span().typed<float3>().copy_from(points.bary_coords);
+    bary_coord_attribute->apply_span();
+  }
+  WriteAttributePtr looptri_index_attribute = point_component.attribute_try_ensure_for_write(
+      "triangle_index", ATTR_DOMAIN_POINT, CD_PROP_INT32);
+  if (looptri_index_attribute) {
+    looptri_index_attribute->get_span().typed<int>().copy_from(points.looptri_indices);
+    looptri_index_attribute->apply_span();
+  }
+
   params.set_output("Geometry", std::move(geometry_set_out));
 }
 }  // namespace blender::nodes
@@ -135,6 +358,7 @@ void register_node_type_geo_point_distribute()
   geo_node_type_base(
       &ntype, GEO_NODE_POINT_DISTRIBUTE, "Point Distribute", NODE_CLASS_GEOMETRY, 0);
   node_type_socket_templates(&ntype, geo_node_point_distribute_in, geo_node_point_distribute_out);
+  node_type_update(&ntype, blender::nodes::geo_node_point_distribute_update);
   ntype.geometry_node_execute = blender::nodes::geo_node_point_distribute_exec;
   nodeRegisterType(&ntype);
 }
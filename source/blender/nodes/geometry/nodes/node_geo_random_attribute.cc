@@ -131,16 +131,20 @@ static void geo_node_random_attribute_exec(GeoNodeExecParams params)
   GeometrySet geometry_set = params.extract_input<GeometrySet>("Geometry");
   const int seed = params.get_input<int>("Seed");
 
-  if (geometry_set.has<MeshComponent>()) {
-    RandomNumberGenerator rng;
-    rng.seed_random(seed);
-    randomize_attribute(geometry_set.get_component_for_write<MeshComponent>(), params, rng);
-  }
-  if (geometry_set.has<PointCloudComponent>()) {
-    RandomNumberGenerator rng;
-    rng.seed_random(seed + 3245231);
-    randomize_attribute(geometry_set.get_component_for_write<PointCloudComponent>(), params, rng);
-  }
+  geometry_set.modify_components_in_parallel(
+      {GeometryComponentType::Mesh, GeometryComponentType::PointCloud},
+      [&](GeometryComponent &component) {
+        /* Every component has its own generator with a fixed seed, so that the result does not
+         * depend on the order in which the components are processed. */
+        RandomNumberGenerator rng;
+        if (component.type() == GeometryComponentType::Mesh) {
+          rng.seed_random(seed);
+        }
+        else {
+          rng.seed_random(seed + 3245231);
+        }
+        randomize_attribute(component, params, rng);
+      });
 
   params.set_output("Geometry", geometry_set);
 }
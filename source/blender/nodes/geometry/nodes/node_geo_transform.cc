@@ -115,20 +115,35 @@ static void geo_node_transform_exec(GeoNodeExecParams params)
   const float3 rotation = params.extract_input<float3>("Rotation");
   const float3 scale = params.extract_input<float3>("Scale");
 
-  if (geometry_set.has_mesh()) {
-    Mesh *mesh = geometry_set.get_mesh_for_write();
-    transform_mesh(mesh, translation, rotation, scale);
-  }
-
-  if (geometry_set.has_pointcloud()) {
-    PointCloud *pointcloud = geometry_set.get_pointcloud_for_write();
-    transform_pointcloud(pointcloud, translation, rotation, scale);
-  }
-
-  if (geometry_set.has_instances()) {
-    InstancesComponent &instances = geometry_set.get_component_for_write<InstancesComponent>();
-    transform_instances(instances, translation, rotation, scale);
-  }
+  geometry_set.modify_components_in_parallel(
+      {GeometryComponentType::Mesh,
+       GeometryComponentType::PointCloud,
+       GeometryComponentType::Instances},
+      [&](GeometryComponent &component) {
+        switch (component.type()) {
+          case GeometryComponentType::Mesh: {
+            Mesh *mesh = static_cast<MeshComponent &>(component).get_for_write();
+            if (mesh != nullptr) {
+              transform_mesh(mesh, translation, rotation, scale);
+            }
+            break;
+          }
+          case GeometryComponentType::PointCloud: {
+            PointCloud *pointcloud = static_cast<PointCloudComponent &>(component).get_for_write();
+            if (pointcloud != nullptr) {
+              transform_pointcloud(pointcloud, translation, rotation, scale);
+            }
+            break;
+          }
+          case GeometryComponentType::Instances: {
+            transform_instances(
+                static_cast<InstancesComponent &>(component), translation, rotation, scale);
+            break;
+          }
+          default:
+            break;
+        }
+      });
 
   params.set_output("Geometry", std::move(geometry_set));
 }
@@ -60,6 +60,17 @@ ReadAttributePtr GeoNodeExecParams::get_input_attribute(const StringRef name,
   return component.attribute_get_constant_for_read(domain, type, default_value);
 }
 
+bool GeoNodeExecParams::lazy_require_input(StringRef identifier)
+{
+  BLI_assert(node_.typeinfo->geometry_node_execute_supports_laziness);
+  BLI_assert(lazy_state_ != nullptr);
+  if (input_values_.contains(identifier)) {
+    return false;
+  }
+  lazy_state_->requested_inputs.append(identifier);
+  return true;
+}
+
 void GeoNodeExecParams::check_extract_input(StringRef identifier,
                                             const CPPType *requested_type) const
 {